@@ -0,0 +1,439 @@
+#include "AudioMixer.h"
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+#include <climits>
+
+extern "C" {
+    #include <libswresample/swresample.h>
+    #include <libavutil/samplefmt.h>
+    #include <libavutil/mem.h>
+    #include <libavutil/mathematics.h>
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIOMIXER_USE_SSE 1
+#endif
+
+namespace {
+    // 软削波拐点：低于该幅度保持线性，高于后平滑逼近满幅
+    const float kSoftClipKnee = 0.8f;
+    const float kSoftClipRange = 1.0f - kSoftClipKnee;
+}
+
+AudioMixer::AudioMixer()
+    : m_inChannels(0)
+    , m_outChannels(0)
+    , m_passthrough(false)
+    , m_mixNs(0)
+    , m_mixedSamples(0)
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+}
+
+AudioMixer::DownmixOptions AudioMixer::defaultOptions()
+{
+    DownmixOptions options;
+    options.centerGain = M_SQRT1_2;    // -3dB
+    options.surroundGain = M_SQRT1_2;  // -3dB
+    options.lfeGain = 0.0;             // 默认丢弃LFE
+    options.normalize = true;
+    return options;
+}
+
+bool AudioMixer::configure(const AVChannelLayout *inLayout, const AVChannelLayout *outLayout,
+                           const DownmixOptions &options)
+{
+    reset();
+
+    if (!inLayout || !outLayout || inLayout->nb_channels <= 0 || outLayout->nb_channels <= 0) {
+        return false;
+    }
+
+    m_inChannels = inLayout->nb_channels;
+    m_outChannels = outLayout->nb_channels;
+
+    // 布局完全一致时直通，不做任何混音
+    if (av_channel_layout_compare(inLayout, outLayout) == 0) {
+        m_passthrough = true;
+        qDebug() << "AudioMixer: passthrough," << m_inChannels << "channels";
+        return true;
+    }
+
+    // 使用swr的矩阵生成逻辑预计算系数，实际混音由我们自己的内核完成
+    // 不归一化时maxval取极大值（与FFmpeg自身的调用一致），取0会把所有系数缩放为0
+    m_matrix.assign(m_outChannels * m_inChannels, 0.0);
+    int ret = swr_build_matrix2(inLayout, outLayout,
+                                options.centerGain, options.surroundGain, options.lfeGain,
+                                options.normalize ? 1.0 : INT_MAX, 1.0,
+                                m_matrix.data(), m_inChannels,
+                                AV_MATRIX_ENCODING_NONE, nullptr);
+    if (ret < 0) {
+        qDebug() << "AudioMixer: failed to build downmix matrix";
+        reset();
+        return false;
+    }
+
+    // 提取非零系数，跳过不参与混音的声道
+    m_taps.resize(m_outChannels);
+    for (int out = 0; out < m_outChannels; out++) {
+        for (int in = 0; in < m_inChannels; in++) {
+            double gain = m_matrix[out * m_inChannels + in];
+            if (std::fabs(gain) > 1e-6) {
+                m_taps[out].push_back({in, static_cast<float>(gain)});
+            }
+        }
+    }
+
+    qDebug() << "AudioMixer: downmix" << m_inChannels << "->" << m_outChannels
+             << "center:" << options.centerGain << "surround:" << options.surroundGain
+             << "lfe:" << options.lfeGain;
+    return true;
+}
+
+void AudioMixer::reset()
+{
+    m_taps.clear();
+    m_matrix.clear();
+    m_inChannels = 0;
+    m_outChannels = 0;
+    m_passthrough = false;
+    m_mixNs = 0;
+    m_mixedSamples = 0;
+}
+
+void AudioMixer::mix(const float * const *in, float * const *out, int samples)
+{
+    if (m_passthrough || samples <= 0) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int ch = 0; ch < m_outChannels; ch++) {
+        const std::vector<MixTap> &taps = m_taps[ch];
+        if (taps.empty()) {
+            memset(out[ch], 0, samples * sizeof(float));
+        } else {
+            mixChannel(in, out[ch], taps.data(), static_cast<int>(taps.size()), samples);
+        }
+    }
+
+    m_mixNs += timer.nsecsElapsed();
+    m_mixedSamples += samples;
+}
+
+void AudioMixer::mixChannel(const float * const *in, float *out, const MixTap *taps, int tapCount, int samples)
+{
+    int i = 0;
+
+#ifdef AUDIOMIXER_USE_SSE
+    // 每次处理4个采样，第一个系数直接写入，其余累加
+    for (; i + 4 <= samples; i += 4) {
+        __m128 acc = _mm_mul_ps(_mm_loadu_ps(in[taps[0].input] + i), _mm_set1_ps(taps[0].gain));
+        for (int t = 1; t < tapCount; t++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in[taps[t].input] + i), _mm_set1_ps(taps[t].gain)));
+        }
+        _mm_storeu_ps(out + i, acc);
+    }
+#endif
+
+    // 标量尾部处理（或无SSE时的回退路径）
+    for (; i < samples; i++) {
+        float acc = in[taps[0].input][i] * taps[0].gain;
+        for (int t = 1; t < tapCount; t++) {
+            acc += in[taps[t].input][i] * taps[t].gain;
+        }
+        out[i] = acc;
+    }
+}
+
+float AudioMixer::softClipSample(float sample)
+{
+    float magnitude = std::fabs(sample);
+    if (magnitude <= kSoftClipKnee) {
+        return sample;
+    }
+    
+    // y/(1+y) 曲线：拐点处斜率为1，渐近到满幅而不会硬削波
+    float y = (magnitude - kSoftClipKnee) / kSoftClipRange;
+    float shaped = kSoftClipKnee + kSoftClipRange * (y / (1.0f + y));
+    return sample < 0.0f ? -shaped : shaped;
+}
+
+void AudioMixer::applyGain(float * const *planes, int channels, int samples,
+                           float startGain, float endGain, bool softClip)
+{
+    if (samples <= 0) {
+        return;
+    }
+    
+    const bool ramp = std::fabs(endGain - startGain) > 1e-6f;
+    const float gainStep = ramp ? (endGain - startGain) / samples : 0.0f;
+    
+    for (int ch = 0; ch < channels; ch++) {
+        float *data = planes[ch];
+        int i = 0;
+        
+#ifdef AUDIOMIXER_USE_SSE
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 knee = _mm_set1_ps(kSoftClipKnee);
+        const __m128 range = _mm_set1_ps(kSoftClipRange);
+        const __m128 invRange = _mm_set1_ps(1.0f / kSoftClipRange);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 step4 = _mm_set1_ps(gainStep * 4.0f);
+        __m128 gain = _mm_setr_ps(startGain, startGain + gainStep,
+                                  startGain + gainStep * 2.0f, startGain + gainStep * 3.0f);
+        
+        for (; i + 4 <= samples; i += 4) {
+            __m128 x = _mm_mul_ps(_mm_loadu_ps(data + i), gain);
+            gain = _mm_add_ps(gain, step4);
+            
+            if (softClip) {
+                __m128 sign = _mm_and_ps(x, signMask);
+                __m128 magnitude = _mm_andnot_ps(signMask, x);
+                __m128 y = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(magnitude, knee), _mm_setzero_ps()), invRange);
+                __m128 shaped = _mm_add_ps(knee, _mm_mul_ps(range, _mm_div_ps(y, _mm_add_ps(one, y))));
+                __m128 aboveKnee = _mm_cmpgt_ps(magnitude, knee);
+                magnitude = _mm_or_ps(_mm_and_ps(aboveKnee, shaped), _mm_andnot_ps(aboveKnee, magnitude));
+                x = _mm_or_ps(magnitude, sign);
+            }
+            
+            _mm_storeu_ps(data + i, x);
+        }
+#endif
+        
+        for (; i < samples; i++) {
+            float x = data[i] * (startGain + gainStep * i);
+            data[i] = softClip ? softClipSample(x) : x;
+        }
+    }
+}
+
+void AudioMixer::interleaveFloat(const float * const *planes, int channels, int samples, float *dst)
+{
+    int i = 0;
+    
+#ifdef AUDIOMIXER_USE_SSE
+    if (channels == 2) {
+        for (; i + 4 <= samples; i += 4) {
+            __m128 left = _mm_loadu_ps(planes[0] + i);
+            __m128 right = _mm_loadu_ps(planes[1] + i);
+            _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(left, right));
+            _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(left, right));
+        }
+    } else if (channels == 1) {
+        memcpy(dst, planes[0], samples * sizeof(float));
+        return;
+    }
+#endif
+    
+    for (; i < samples; i++) {
+        for (int ch = 0; ch < channels; ch++) {
+            dst[i * channels + ch] = planes[ch][i];
+        }
+    }
+}
+
+void AudioMixer::interleaveS16(const float * const *planes, int channels, int samples, int16_t *dst)
+{
+    int i = 0;
+    
+#ifdef AUDIOMIXER_USE_SSE
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    const __m128 maxValue = _mm_set1_ps(1.0f);
+    const __m128 minValue = _mm_set1_ps(-1.0f);
+    
+    if (channels == 2) {
+        for (; i + 4 <= samples; i += 4) {
+            __m128 left = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(planes[0] + i), minValue), maxValue);
+            __m128 right = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(planes[1] + i), minValue), maxValue);
+            __m128i l = _mm_cvtps_epi32(_mm_mul_ps(left, scale));
+            __m128i r = _mm_cvtps_epi32(_mm_mul_ps(right, scale));
+            __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), packed);
+        }
+    } else if (channels == 1) {
+        for (; i + 8 <= samples; i += 8) {
+            __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(planes[0] + i), minValue), maxValue);
+            __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(planes[0] + i + 4), minValue), maxValue);
+            __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+                                             _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+        }
+    }
+#endif
+    
+    for (; i < samples; i++) {
+        for (int ch = 0; ch < channels; ch++) {
+            float sample = qBound(-1.0f, planes[ch][i], 1.0f);
+            dst[i * channels + ch] = static_cast<int16_t>(lrintf(sample * 32767.0f));
+        }
+    }
+}
+
+double AudioMixer::averageNsPerSample() const
+{
+    if (m_mixedSamples <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(m_mixNs) / m_mixedSamples;
+}
+
+QString AudioMixer::getStatusInfo() const
+{
+    if (!isConfigured()) {
+        return QString("Mixer: not configured");
+    }
+    if (m_passthrough) {
+        return QString("Mixer: passthrough %1ch").arg(m_inChannels);
+    }
+    return QString("Mixer: %1ch -> %2ch, %3 ns/sample")
+        .arg(m_inChannels)
+        .arg(m_outChannels)
+        .arg(averageNsPerSample(), 0, 'f', 2);
+}
+
+QString AudioMixer::benchmarkAgainstSwr(const AVChannelLayout *inLayout, const AVChannelLayout *outLayout,
+                                        const DownmixOptions &options, int sampleRate, int seconds)
+{
+    AudioMixer mixer;
+    if (!mixer.configure(inLayout, outLayout, options) || mixer.isPassthrough()) {
+        return QString("benchmark skipped");
+    }
+
+    const int inChannels = inLayout->nb_channels;
+    const int outChannels = outLayout->nb_channels;
+    const int blockSamples = 1024;
+    const int blocks = qMax(1, sampleRate * seconds / blockSamples);
+
+    // 合成输入：每个声道不同频率的正弦波
+    std::vector<std::vector<float>> input(inChannels, std::vector<float>(blockSamples));
+    std::vector<const float*> inPtrs(inChannels);
+    for (int ch = 0; ch < inChannels; ch++) {
+        for (int i = 0; i < blockSamples; i++) {
+            input[ch][i] = 0.5f * std::sin(2.0 * M_PI * (220.0 + 110.0 * ch) * i / sampleRate);
+        }
+        inPtrs[ch] = input[ch].data();
+    }
+
+    std::vector<std::vector<float>> output(outChannels, std::vector<float>(blockSamples));
+    std::vector<float*> outPtrs(outChannels);
+    for (int ch = 0; ch < outChannels; ch++) {
+        outPtrs[ch] = output[ch].data();
+    }
+
+    // 自有内核
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < blocks; b++) {
+        mixer.mix(inPtrs.data(), outPtrs.data(), blockSamples);
+    }
+    qint64 kernelNs = timer.nsecsElapsed();
+
+    // swr重混音：使用相同的矩阵，仅做声道转换
+    SwrContext *swr = nullptr;
+    if (swr_alloc_set_opts2(&swr, outLayout, AV_SAMPLE_FMT_FLTP, sampleRate,
+                            inLayout, AV_SAMPLE_FMT_FLTP, sampleRate, 0, nullptr) < 0 || !swr) {
+        return QString("kernel %1 ns/sample, swr unavailable")
+            .arg(static_cast<double>(kernelNs) / (blocks * blockSamples), 0, 'f', 2);
+    }
+    swr_set_matrix(swr, mixer.m_matrix.data(), inChannels);
+    if (swr_init(swr) < 0) {
+        swr_free(&swr);
+        return QString("kernel %1 ns/sample, swr init failed")
+            .arg(static_cast<double>(kernelNs) / (blocks * blockSamples), 0, 'f', 2);
+    }
+
+    timer.restart();
+    for (int b = 0; b < blocks; b++) {
+        swr_convert(swr, reinterpret_cast<uint8_t**>(outPtrs.data()), blockSamples,
+                    reinterpret_cast<const uint8_t**>(inPtrs.data()), blockSamples);
+    }
+    qint64 swrNs = timer.nsecsElapsed();
+    swr_free(&swr);
+
+    double totalSamples = static_cast<double>(blocks) * blockSamples;
+    return QString("%1ch->%2ch kernel %3 ns/sample, swr %4 ns/sample (x%5)")
+        .arg(inChannels)
+        .arg(outChannels)
+        .arg(kernelNs / totalSamples, 0, 'f', 2)
+        .arg(swrNs / totalSamples, 0, 'f', 2)
+        .arg(kernelNs > 0 ? static_cast<double>(swrNs) / kernelNs : 0.0, 0, 'f', 2);
+}
+
+QString AudioMixer::benchmarkOutputStage(int channels, int sampleRate, int seconds)
+{
+    const int blockSamples = 1024;
+    const int blocks = qMax(1, sampleRate * seconds / blockSamples);
+    const double totalSamples = static_cast<double>(blocks) * blockSamples;
+    
+    std::vector<std::vector<float>> source(channels, std::vector<float>(blockSamples));
+    std::vector<std::vector<float>> work(channels, std::vector<float>(blockSamples));
+    std::vector<float*> workPtrs(channels);
+    std::vector<const float*> sourcePtrs(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < blockSamples; i++) {
+            source[ch][i] = 0.7f * std::sin(2.0 * M_PI * (330.0 + 55.0 * ch) * i / sampleRate);
+        }
+        sourcePtrs[ch] = source[ch].data();
+        workPtrs[ch] = work[ch].data();
+    }
+    
+    std::vector<float> floatOut(blockSamples * channels);
+    std::vector<int16_t> s16Out(blockSamples * channels);
+    QElapsedTimer timer;
+    
+    // 浮点路径：增益 + 软削波 + 浮点交错
+    timer.start();
+    for (int b = 0; b < blocks; b++) {
+        for (int ch = 0; ch < channels; ch++) {
+            memcpy(workPtrs[ch], sourcePtrs[ch], blockSamples * sizeof(float));
+        }
+        applyGain(workPtrs.data(), channels, blockSamples, 1.2f, 1.2f, true);
+        interleaveFloat(workPtrs.data(), channels, blockSamples, floatOut.data());
+    }
+    qint64 floatNs = timer.nsecsElapsed();
+    
+    // 浮点处理后在设备边界转S16
+    timer.restart();
+    for (int b = 0; b < blocks; b++) {
+        for (int ch = 0; ch < channels; ch++) {
+            memcpy(workPtrs[ch], sourcePtrs[ch], blockSamples * sizeof(float));
+        }
+        applyGain(workPtrs.data(), channels, blockSamples, 1.2f, 1.2f, true);
+        interleaveS16(workPtrs.data(), channels, blockSamples, s16Out.data());
+    }
+    qint64 floatToS16Ns = timer.nsecsElapsed();
+    
+    // 原路径：swr直接从FLTP转换为交错S16（音量交给QAudioSink）
+    AVChannelLayout layout;
+    av_channel_layout_default(&layout, channels);
+    SwrContext *swr = nullptr;
+    qint64 swrNs = -1;
+    if (swr_alloc_set_opts2(&swr, &layout, AV_SAMPLE_FMT_S16, sampleRate,
+                            &layout, AV_SAMPLE_FMT_FLTP, sampleRate, 0, nullptr) >= 0 && swr && swr_init(swr) >= 0) {
+        uint8_t *out[1] = { reinterpret_cast<uint8_t*>(s16Out.data()) };
+        timer.restart();
+        for (int b = 0; b < blocks; b++) {
+            swr_convert(swr, out, blockSamples,
+                        reinterpret_cast<const uint8_t**>(sourcePtrs.data()), blockSamples);
+        }
+        swrNs = timer.nsecsElapsed();
+    }
+    swr_free(&swr);
+    av_channel_layout_uninit(&layout);
+    
+    return QString("%1ch float %2 ns/sample, float->S16 %3 ns/sample, legacy swr S16 %4 ns/sample")
+        .arg(channels)
+        .arg(floatNs / totalSamples, 0, 'f', 2)
+        .arg(floatToS16Ns / totalSamples, 0, 'f', 2)
+        .arg(swrNs >= 0 ? QString::number(swrNs / totalSamples, 'f', 2) : QString("n/a"));
+}
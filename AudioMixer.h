@@ -0,0 +1,82 @@
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <QString>
+#include <vector>
+#include <cstdint>
+
+extern "C" {
+    #include <libavutil/channel_layout.h>
+}
+
+// 多声道混音器：预计算下混矩阵，使用向量化内核处理平面浮点数据
+class AudioMixer
+{
+public:
+    // 下混选项（线性增益）
+    struct DownmixOptions {
+        double centerGain;    // 中置声道混入左右声道的增益
+        double surroundGain;  // 环绕声道混入前置声道的增益
+        double lfeGain;       // LFE声道增益，0表示丢弃低音声道
+        bool normalize;       // 归一化矩阵，避免叠加后削波
+    };
+
+    AudioMixer();
+    ~AudioMixer();
+
+    static DownmixOptions defaultOptions();
+
+    // 根据输入/输出声道布局预计算混音矩阵
+    bool configure(const AVChannelLayout *inLayout, const AVChannelLayout *outLayout,
+                   const DownmixOptions &options);
+    void reset();
+
+    bool isConfigured() const { return m_inChannels > 0 && m_outChannels > 0; }
+    bool isPassthrough() const { return m_passthrough; }
+    int inputChannels() const { return m_inChannels; }
+    int outputChannels() const { return m_outChannels; }
+
+    // 混音：in/out 为平面浮点缓冲区，passthrough时不应调用
+    void mix(const float * const *in, float * const *out, int samples);
+
+    // 输出级：增益 + 软削波（原地处理），支持增益渐变避免拉链噪声
+    static void applyGain(float * const *planes, int channels, int samples,
+                          float startGain, float endGain, bool softClip);
+    
+    // 输出级：平面浮点交错打包，仅在设备要求时转换为S16
+    static void interleaveFloat(const float * const *planes, int channels, int samples, float *dst);
+    static void interleaveS16(const float * const *planes, int channels, int samples, int16_t *dst);
+
+    // 性能统计
+    double averageNsPerSample() const;
+    QString getStatusInfo() const;
+
+    // 与swr内置重混音对比的基准测试（合成数据）
+    static QString benchmarkAgainstSwr(const AVChannelLayout *inLayout, const AVChannelLayout *outLayout,
+                                       const DownmixOptions &options, int sampleRate, int seconds = 2);
+    
+    // 浮点输出级与原S16路径（swr直接转S16）的吞吐量对比
+    static QString benchmarkOutputStage(int channels, int sampleRate, int seconds = 2);
+
+private:
+    // 单个输出声道的非零系数列表
+    struct MixTap {
+        int input;
+        float gain;
+    };
+
+    static void mixChannel(const float * const *in, float *out, const MixTap *taps, int tapCount, int samples);
+    static float softClipSample(float sample);
+
+    std::vector<std::vector<MixTap>> m_taps;
+    std::vector<double> m_matrix;   // 行优先：输出声道 x 输入声道
+    int m_inChannels;
+    int m_outChannels;
+    bool m_passthrough;
+
+    // 性能监控
+    qint64 m_mixNs;
+    qint64 m_mixedSamples;
+};
+
+#endif // AUDIOMIXER_H
@@ -1,6 +1,12 @@
 #include "AudioProcessor.h"
 #include <QApplication>
 #include <cstring>
+#include <cmath>
+
+namespace {
+    const int kFeedIntervalMs = 10;       // 设备供数周期
+    const int kShrinkQuietMs = 5000;      // 无欠载持续该时长后开始收缩缓冲
+}
 
 AudioProcessor::AudioProcessor(QObject *parent)
     : QObject(parent)
@@ -15,12 +21,30 @@ AudioProcessor::AudioProcessor(QObject *parent)
     , m_isPaused(false)
     , m_isSeeking(false)
     , m_volume(0.8f)
-    , m_masterClock(0)
+    , m_clock(nullptr)
     , m_audioBasePts(AV_NOPTS_VALUE)
-    , m_maxQueueSize(60)
+    , m_maxQueuedUs(2000000)
     , m_minQueueSize(8)
     , m_optimalBufferSize(4096)
     , m_bufferCheckTimer(nullptr)
+    , m_feedTimer(nullptr)
+    , m_pendingBytes(0)
+    , m_writtenPtsUs(AV_NOPTS_VALUE)
+    , m_writtenTempo(1.0)
+    , m_nextQueuedPtsUs(AV_NOPTS_VALUE)
+    , m_underrunCount(0)
+    , m_underrunsSinceCheck(0)
+    , m_sinkStarved(false)
+    , m_jitterUs(0)
+    , m_jitterPeakUs(0)
+    , m_minLatency(30)
+    , m_compensationWindowUs(0)
+    , m_mediaDevices(nullptr)
+    , m_followDefaultDevice(true)
+    , m_replayWritePos(0)
+    , m_replayFill(0)
+    , m_lastSinkQueuedBytes(0)
+    , m_deviceSwitchCount(0)
     , m_droppedFrames(0)
     , m_processedFrames(0)
     , m_errorCount(0)
@@ -30,17 +54,22 @@ AudioProcessor::AudioProcessor(QObject *parent)
     , m_channels(2)
     , m_bytesPerSample(2)
     , m_inputSampleFormat(AV_SAMPLE_FMT_NONE)
+    , m_downmixOptions(AudioMixer::defaultOptions())
+    , m_mixInputLayout()
+    , m_outputLayout()
+    , m_planarCapacity(0)
+    , m_preferFloatOutput(true)
+    , m_appliedGain(0.8f)
+    , m_outputStageNs(0)
+    , m_outputStageSamples(0)
     , m_enableQualityControl(true)
-    , m_maxLatency(200)
+    , m_maxLatency(500)
     , m_targetLatency(100)
 {
     m_audioFrame = av_frame_alloc();
     
     // 新增：初始化精确时间同步变量
-    m_lastAudioPts = AV_NOPTS_VALUE;
-    m_audioClockBase = 0;
     m_deviceLatency = 0;
-    m_accumulatedSamples = 0;
     m_sampleDuration = 0.0;
     
     // 初始化定时器
@@ -48,11 +77,20 @@ AudioProcessor::AudioProcessor(QObject *parent)
     m_bufferCheckTimer->setInterval(100);
     connect(m_bufferCheckTimer, &QTimer::timeout, this, &AudioProcessor::checkBufferStatus);
     
+    m_feedTimer = new QTimer(this);
+    m_feedTimer->setTimerType(Qt::PreciseTimer);
+    m_feedTimer->setInterval(kFeedIntervalMs);
+    connect(m_feedTimer, &QTimer::timeout, this, &AudioProcessor::onFeedTimer);
+    
     m_recoveryTimer = new QTimer(this);
     m_recoveryTimer->setSingleShot(true);
-    m_recoveryTimer->setInterval(1000);
+    m_recoveryTimer->setInterval(200);
     connect(m_recoveryTimer, &QTimer::timeout, this, &AudioProcessor::attemptRecovery);
     
+    // 监听输出设备变化（耳机插拔、默认设备切换）
+    m_mediaDevices = new QMediaDevices(this);
+    connect(m_mediaDevices, &QMediaDevices::audioOutputsChanged, this, &AudioProcessor::onAudioOutputsChanged);
+    
     qDebug() << "AudioProcessor created - simplified version";
 }
 
@@ -76,14 +114,6 @@ bool AudioProcessor::initialize(AVCodecContext* audioCodecContext)
     
     m_audioCodecContext = audioCodecContext;
     
-    // 设置音频格式
-    m_audioFormat.setSampleRate(audioCodecContext->sample_rate);
-    m_audioFormat.setChannelCount(qMin(audioCodecContext->ch_layout.nb_channels, 2));
-    m_audioFormat.setSampleFormat(QAudioFormat::Int16);
-    
-    qDebug() << "Audio format - Rate:" << m_audioFormat.sampleRate() 
-             << "Channels:" << m_audioFormat.channelCount();
-    
     // 获取默认输出设备
     m_outputDevice = QMediaDevices::defaultAudioOutput();
     if (m_outputDevice.isNull()) {
@@ -91,14 +121,24 @@ bool AudioProcessor::initialize(AVCodecContext* audioCodecContext)
         return false;
     }
     
-    // 检查格式支持
-    if (!m_outputDevice.isFormatSupported(m_audioFormat)) {
-        qDebug() << "Trying alternative sample rate...";
-        m_audioFormat.setSampleRate(44100);
-        if (!m_outputDevice.isFormatSupported(m_audioFormat)) {
-            emit audioError("Audio format not supported");
-            return false;
-        }
+    // 协商设备声道配置：声道一致时直通，否则下混
+    if (!negotiateOutputFormat()) {
+        emit audioError("Audio format not supported");
+        return false;
+    }
+    
+    m_sampleRate = m_audioFormat.sampleRate();
+    m_channels = m_audioFormat.channelCount();
+    m_bytesPerSample = m_audioFormat.bytesPerSample();
+    
+    qDebug() << "Audio format - Rate:" << m_audioFormat.sampleRate() 
+             << "Channels:" << m_audioFormat.channelCount()
+             << "Source channels:" << audioCodecContext->ch_layout.nb_channels;
+    
+    // 预计算下混矩阵
+    if (!m_mixer.configure(&m_mixInputLayout, &m_outputLayout, m_downmixOptions)) {
+        emit audioError("Failed to setup downmix matrix");
+        return false;
     }
     
     // 设置重采样器
@@ -137,12 +177,147 @@ void AudioProcessor::cleanup()
     
     m_audioCodecContext = nullptr;
     m_initialized = false;
-    m_masterClock = 0;
     m_audioBasePts = AV_NOPTS_VALUE;
     
+    m_mixer.reset();
+    av_channel_layout_uninit(&m_mixInputLayout);
+    av_channel_layout_uninit(&m_outputLayout);
+    
     qDebug() << "AudioProcessor cleaned up";
 }
 
+QAudioFormat::ChannelConfig AudioProcessor::toQtChannelConfig(const AVChannelLayout &layout)
+{
+    if (layout.order != AV_CHANNEL_ORDER_NATIVE) {
+        return QAudioFormat::ChannelConfigUnknown;
+    }
+    
+    // FFmpeg声道位与Qt声道位置的对应关系（两者的交错顺序一致）
+    static const struct {
+        uint64_t ffmpegMask;
+        QAudioFormat::AudioChannelPosition position;
+    } channelMap[] = {
+        { AV_CH_FRONT_LEFT, QAudioFormat::FrontLeft },
+        { AV_CH_FRONT_RIGHT, QAudioFormat::FrontRight },
+        { AV_CH_FRONT_CENTER, QAudioFormat::FrontCenter },
+        { AV_CH_LOW_FREQUENCY, QAudioFormat::LFE },
+        { AV_CH_BACK_LEFT, QAudioFormat::BackLeft },
+        { AV_CH_BACK_RIGHT, QAudioFormat::BackRight },
+        { AV_CH_FRONT_LEFT_OF_CENTER, QAudioFormat::FrontLeftOfCenter },
+        { AV_CH_FRONT_RIGHT_OF_CENTER, QAudioFormat::FrontRightOfCenter },
+        { AV_CH_BACK_CENTER, QAudioFormat::BackCenter },
+        { AV_CH_SIDE_LEFT, QAudioFormat::SideLeft },
+        { AV_CH_SIDE_RIGHT, QAudioFormat::SideRight },
+    };
+    
+    uint64_t remaining = layout.u.mask;
+    quint32 config = 0;
+    for (const auto &entry : channelMap) {
+        if (remaining & entry.ffmpegMask) {
+            config |= (1u << entry.position);
+            remaining &= ~entry.ffmpegMask;
+        }
+    }
+    
+    // 存在无法映射的声道时不允许直通
+    if (remaining != 0 || config == 0) {
+        return QAudioFormat::ChannelConfigUnknown;
+    }
+    return static_cast<QAudioFormat::ChannelConfig>(config);
+}
+
+bool AudioProcessor::negotiateOutputFormat()
+{
+    const AVChannelLayout &sourceLayout = m_audioCodecContext->ch_layout;
+    int sourceChannels = qMax(1, sourceLayout.nb_channels);
+    
+    // 源布局没有明确声道顺序时，使用该声道数的默认布局
+    av_channel_layout_uninit(&m_mixInputLayout);
+    if (sourceLayout.order == AV_CHANNEL_ORDER_NATIVE) {
+        av_channel_layout_copy(&m_mixInputLayout, &sourceLayout);
+    } else {
+        av_channel_layout_default(&m_mixInputLayout, sourceChannels);
+    }
+    
+    // 候选声道数：源声道数（直通） -> 设备首选 -> 立体声 -> 单声道
+    QAudioFormat preferred = m_outputDevice.preferredFormat();
+    QList<int> channelCandidates;
+    channelCandidates << sourceChannels;
+    if (preferred.channelCount() > 0 && preferred.channelCount() < sourceChannels) {
+        channelCandidates << preferred.channelCount();
+    }
+    channelCandidates << 2 << 1;
+    
+    QList<int> rateCandidates;
+    rateCandidates << m_audioCodecContext->sample_rate << preferred.sampleRate() << 48000 << 44100;
+    
+    for (int channels : channelCandidates) {
+        if (channels > sourceChannels && channels > 2) {
+            continue;
+        }
+        if (channels > m_outputDevice.maximumChannelCount() || channels < m_outputDevice.minimumChannelCount()) {
+            continue;
+        }
+        
+        AVChannelLayout layout;
+        if (channels == sourceChannels) {
+            av_channel_layout_copy(&layout, &m_mixInputLayout);
+        } else {
+            av_channel_layout_default(&layout, channels);
+        }
+        
+        QAudioFormat::ChannelConfig config = toQtChannelConfig(layout);
+        if (config == QAudioFormat::ChannelConfigUnknown) {
+            av_channel_layout_uninit(&layout);
+            continue;
+        }
+        
+        QList<QAudioFormat::SampleFormat> sampleFormats;
+        if (m_preferFloatOutput) {
+            sampleFormats << QAudioFormat::Float;
+        }
+        sampleFormats << QAudioFormat::Int16;
+        
+        QAudioFormat format;
+        format.setChannelConfig(config);
+        
+        for (int rate : rateCandidates) {
+            if (rate <= 0) {
+                continue;
+            }
+            format.setSampleRate(rate);
+            for (QAudioFormat::SampleFormat sampleFormat : sampleFormats) {
+                format.setSampleFormat(sampleFormat);
+                if (m_outputDevice.isFormatSupported(format)) {
+                    m_audioFormat = format;
+                    av_channel_layout_uninit(&m_outputLayout);
+                    av_channel_layout_copy(&m_outputLayout, &layout);
+                    av_channel_layout_uninit(&layout);
+                    
+                    qDebug() << "Audio output negotiated -" << channels << "channels @" << rate << "Hz"
+                             << (sampleFormat == QAudioFormat::Float ? "Float32" : "Int16")
+                             << (channels == sourceChannels ? "(passthrough)" : "(downmix)");
+                    return true;
+                }
+            }
+        }
+        
+        av_channel_layout_uninit(&layout);
+    }
+    
+    return false;
+}
+
+void AudioProcessor::setDownmixOptions(const AudioMixer::DownmixOptions &options)
+{
+    m_downmixOptions = options;
+    
+    // 已初始化时立即重新计算矩阵
+    if (m_initialized) {
+        m_mixer.configure(&m_mixInputLayout, &m_outputLayout, m_downmixOptions);
+    }
+}
+
 bool AudioProcessor::setupResampler()
 {
     cleanupResampler();
@@ -153,30 +328,30 @@ bool AudioProcessor::setupResampler()
         return false;
     }
     
-    AVChannelLayout out_ch_layout;
-    if (m_audioFormat.channelCount() == 1) {
-        out_ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    } else {
-        out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+    // 重采样器只负责采样率和格式转换（输出平面浮点），声道混音由AudioMixer完成
+    const AVChannelLayout *inLayout = &m_audioCodecContext->ch_layout;
+    if (inLayout->order != AV_CHANNEL_ORDER_NATIVE) {
+        inLayout = &m_mixInputLayout;
     }
     
     int ret = swr_alloc_set_opts2(&m_swrContext,
-                                  &out_ch_layout,
-                                  AV_SAMPLE_FMT_S16,
+                                  &m_mixInputLayout,
+                                  AV_SAMPLE_FMT_FLTP,
                                   m_audioFormat.sampleRate(),
-                                  &m_audioCodecContext->ch_layout,
+                                  inLayout,
                                   m_audioCodecContext->sample_fmt,
                                   m_audioCodecContext->sample_rate,
                                   0, nullptr);
     
-    av_channel_layout_uninit(&out_ch_layout);
-    
     if (ret < 0) {
         qDebug() << "Failed to set resampler options";
         swr_free(&m_swrContext);
         return false;
     }
     
+    // 始终启用重采样引擎，漂移补偿时无需重新初始化（会清空内部缓冲）
+    av_opt_set_int(m_swrContext, "flags", SWR_FLAG_RESAMPLE, 0);
+    
     // 使用标准重采样设置，避免复杂配置导致的问题
     // av_opt_set_int(m_swrContext, "resampler", SWR_ENGINE_SOXR, 0);
     // av_opt_set_double(m_swrContext, "cutoff", 0.98, 0);
@@ -188,6 +363,9 @@ bool AudioProcessor::setupResampler()
         return false;
     }
     
+    // 变速处理在混音之后，声道数与设备输出一致
+    m_stretcher.configure(m_audioFormat.channelCount(), m_audioFormat.sampleRate());
+    
     qDebug() << "Audio resampler setup successfully";
     return true;
 }
@@ -205,7 +383,17 @@ bool AudioProcessor::setupAudioDevice()
     cleanupAudioDevice();
     
     m_audioSink = new QAudioSink(m_outputDevice, m_audioFormat, this);
-    m_audioSink->setVolume(m_volume);
+    // 音量在浮点输出级以软件增益实现，设备音量固定为1.0
+    m_audioSink->setVolume(1.0);
+    
+    // 设备缓冲按最大延迟分配，实际延迟由供数目标控制，无需重建设备
+    m_audioSink->setBufferSize(m_audioFormat.bytesForDuration((qint64)m_maxLatency * 1000));
+    
+    connect(m_audioSink, &QAudioSink::stateChanged, this, &AudioProcessor::handleAudioStateChanged);
+    
+    // 重放环形缓冲容量与设备缓冲一致
+    m_replayRing.assign(static_cast<size_t>(m_audioFormat.bytesForDuration((qint64)m_maxLatency * 1000)), 0);
+    resetReplayHistory();
     
     qDebug() << "Audio device setup completed";
     return true;
@@ -242,13 +430,12 @@ void AudioProcessor::start()
         }
     }
     
-    // 启动缓冲区监控
+    // 启动缓冲区监控和设备供数
     m_bufferCheckTimer->start();
-    
-    // 新增：启动高精度计时器
-    m_audioTimer.start();
-    m_audioClockBase = 0;
-    m_accumulatedSamples = 0;
+    m_feedTimer->start();
+    m_feedIntervalTimer.invalidate();
+    m_sinceUnderrunTimer.start();
+    m_sinkStarved = false;
     
     // Audio playback started
 }
@@ -269,6 +456,7 @@ void AudioProcessor::pause()
     }
     
     m_bufferCheckTimer->stop();
+    m_feedTimer->stop();
     
     qDebug() << "Audio playback paused";
 }
@@ -301,8 +489,11 @@ void AudioProcessor::resume()
     // 重新调整音频时间基准
     m_audioStartTime = QTime::currentTime();
     
-    // 重新启动缓冲区监控
+    // 重新启动缓冲区监控和设备供数
     m_bufferCheckTimer->start();
+    m_feedTimer->start();
+    m_feedIntervalTimer.invalidate();
+    m_sinkStarved = false;
     
     qDebug() << "Audio playback resumed";
 }
@@ -321,12 +512,16 @@ void AudioProcessor::stop()
     clearAudioQueue();
     
     m_audioBasePts = AV_NOPTS_VALUE;
-    m_masterClock = 0;
+    m_writtenPtsUs = AV_NOPTS_VALUE;
+    m_nextQueuedPtsUs = AV_NOPTS_VALUE;
     
     // 停止定时器
     if (m_bufferCheckTimer) {
         m_bufferCheckTimer->stop();
     }
+    if (m_feedTimer) {
+        m_feedTimer->stop();
+    }
     if (m_recoveryTimer) {
         m_recoveryTimer->stop();
     }
@@ -341,9 +536,12 @@ void AudioProcessor::seek(int64_t timestamp)
     m_isSeeking = true;
     clearAudioQueue();
     
-    m_masterClock = timestamp;
     m_audioBasePts = AV_NOPTS_VALUE;
+    m_writtenPtsUs = AV_NOPTS_VALUE;
+    m_nextQueuedPtsUs = AV_NOPTS_VALUE;
+    m_sinkStarved = false;
     m_audioStartTime = QTime::currentTime();
+    resetDriftCompensation();
     
     if (m_isPlaying && m_audioSink) {
         restartAudioDevice();
@@ -373,148 +571,352 @@ void AudioProcessor::processAudioPacket(AVPacket* packet)
             break;
         }
         
-        // 重采样音频帧
+        // 重采样音频帧（变速时输出的是变速处理器缓冲之后的数据，时间戳改为接续计算）
+        bool stretched = m_stretcher.isActive();
+        double tempo = m_stretcher.tempo();
         uint8_t* outputBuffer = nullptr;
         int outputSize = resampleAudioFrame(m_audioFrame, &outputBuffer);
         
         if (outputSize > 0 && outputBuffer) {
-            // 直接写入音频设备
-            qint64 written = m_audioDevice->write(
-                reinterpret_cast<const char*>(outputBuffer), outputSize);
-            
-            if (written > 0 && m_audioFrame->pts != AV_NOPTS_VALUE) {
+            if (m_audioFrame->pts != AV_NOPTS_VALUE) {
                 if (m_audioBasePts == AV_NOPTS_VALUE) {
                     qDebug() << "[AUDIO] First audio PTS:" << m_audioFrame->pts;
                 }
                 
-                // 持续更新音频PTS以反映当前播放位置
+                // 持续更新音频PTS以反映当前解码位置
                 m_audioBasePts = m_audioFrame->pts;
                 
-                // 新增：更新精确的音频时钟
-                updateAudioClock(m_audioFrame->pts, m_audioFrame->nb_samples);
+                // 动态调整设备延迟估算
+                adjustDeviceLatency();
                 
                 emit audioTimeChanged(m_audioFrame->pts);
-            } else if (written > 0) {
+            } else {
                 static int noPtsCount = 0;
                 if (++noPtsCount <= 3) {
                     qDebug() << "[WARN] Audio frame without PTS, count:" << noPtsCount;
                 }
             }
             
-            av_free(outputBuffer);
+            // 放入待播放队列，由供数定时器按目标延迟写入设备（队列接管缓冲区所有权）
+            enqueueAudioData(outputBuffer, outputSize,
+                             stretched ? AV_NOPTS_VALUE : framePtsToUs(m_audioFrame->pts), tempo);
             m_processedFrames++;
         }
     }
+    
+    feedAudioDevice();
 }
 
-void AudioProcessor::setVolume(float volume)
+int64_t AudioProcessor::framePtsToUs(int64_t pts) const
 {
-    m_volume = qBound(0.0f, volume, 1.0f);
+    if (pts == AV_NOPTS_VALUE) {
+        return AV_NOPTS_VALUE;
+    }
     
-    if (m_audioSink) {
-        m_audioSink->setVolume(m_volume);
+    if (m_audioStream) {
+        return av_rescale_q(pts, m_audioStream->time_base, AV_TIME_BASE_Q);
+    }
+    
+    // 回退方案：假设标准音频时间基准
+    return av_rescale_q(pts, {1, m_audioFormat.sampleRate()}, AV_TIME_BASE_Q);
+}
+
+int64_t AudioProcessor::bytesToUs(qint64 bytes) const
+{
+    if (bytes <= 0 || !m_audioFormat.isValid()) {
+        return 0;
     }
+    return m_audioFormat.durationForBytes(static_cast<qint32>(bytes));
 }
 
-int64_t AudioProcessor::getCurrentAudioTime() const
+qint64 AudioProcessor::sinkQueuedBytes() const
 {
-    if (m_audioBasePts == AV_NOPTS_VALUE || !m_isPlaying) {
-        return m_masterClock;
+    if (!m_audioSink || !m_audioDevice) {
+        return 0;
+    }
+    return qMax<qint64>(0, m_audioSink->bufferSize() - m_audioSink->bytesFree());
+}
+
+void AudioProcessor::enqueueAudioData(uint8_t* data, int size, int64_t ptsUs, double tempo)
+{
+    AudioPacket* packet = new AudioPacket();
+    packet->data = data;
+    packet->size = size;
+    packet->tempo = tempo;
+    
+    // 没有PTS的帧接续上一帧的结束时间；变速时每秒输出推进 tempo 秒媒体时间
+    int64_t durationUs = bytesToUs(size);
+    packet->pts = (ptsUs != AV_NOPTS_VALUE) ? ptsUs : m_nextQueuedPtsUs;
+    packet->duration = static_cast<int>(durationUs / 1000);
+    if (packet->pts != AV_NOPTS_VALUE) {
+        m_nextQueuedPtsUs = packet->pts + static_cast<int64_t>(durationUs * tempo);
     }
     
-    return m_audioBasePts;
+    QMutexLocker locker(&m_queueMutex);
+    m_audioQueue.enqueue(packet);
+    m_pendingBytes += size;
+    
+    // 正常情况下由调用方按 isQueueFull() 暂停解复用，已解码的音频不丢弃；
+    // 只有设备停止消耗（出错、恢复中）时才丢弃最旧的数据，此时本来就听不到
+    if (isSinkConsuming()) {
+        return;
+    }
+    while (m_audioQueue.size() > 1 && bytesToUs(m_pendingBytes) > m_maxQueuedUs) {
+        AudioPacket* dropped = m_audioQueue.dequeue();
+        m_pendingBytes -= (dropped->size - dropped->offset);
+        delete dropped;
+        m_droppedFrames++;
+    }
 }
 
-void AudioProcessor::setMasterClock(int64_t timestamp)
+bool AudioProcessor::isQueueFull() const
 {
-    m_masterClock = timestamp;
+    QMutexLocker locker(&m_queueMutex);
+    return isSinkConsuming() && bytesToUs(m_pendingBytes) >= m_maxQueuedUs;
 }
 
-// 新增：更精确的音频时间计算
-int64_t AudioProcessor::getAccurateAudioTime() const
+bool AudioProcessor::isSinkConsuming() const
 {
-    if (!m_isPlaying) {
-        return m_masterClock;
+    return m_audioSink && m_audioDevice && m_isPlaying && !m_isPaused &&
+           m_audioSink->state() != QAudio::StoppedState;
+}
+
+void AudioProcessor::onFeedTimer()
+{
+    adjustPlaybackTiming();
+    feedAudioDevice();
+    publishClock();
+}
+
+void AudioProcessor::publishClock()
+{
+    if (!m_clock || m_clock->mode() != MasterClock::Mode::AudioMaster) {
+        return;
     }
     
-    // 优先使用最新的音频PTS，转换为微秒
-    if (m_audioBasePts != AV_NOPTS_VALUE) {
-        if (m_audioStream) {
-            // 使用正确的音频流时间基准
-            int64_t audioTimeUs = av_rescale_q(m_audioBasePts, 
-                                              m_audioStream->time_base, 
-                                              AV_TIME_BASE_Q);
-            
-            // 使用音频流时间基准进行转换
-            return audioTimeUs;
-        } else {
-            // 回退方案：假设标准音频时间基准
-            int64_t audioTimeUs = av_rescale_q(m_audioBasePts, 
-                                              {1, m_audioFormat.sampleRate()}, 
-                                              AV_TIME_BASE_Q);
-            // 使用回退方案：标准音频时间基准
-            return audioTimeUs;
-        }
-    } else {
-                // 没有有效的音频PTS，使用备用时钟
+    // 设备尚未播放任何数据时不驱动时钟
+    if (m_writtenPtsUs == AV_NOPTS_VALUE || !m_isPlaying || m_isPaused) {
+        return;
+    }
+    
+    // 设备已播完（音频结束或供数不足）：播放位置停在最后写入处，继续上报会把时钟拉住；
+    // 不再上报时主时钟按墙上时钟外推，视频照常显示，恢复供数后重新由音频校正
+    if (m_sinkStarved) {
+        return;
+    }
+    
+    m_clock->update(getAccurateAudioTime());
+}
+
+void AudioProcessor::feedAudioDevice()
+{
+    if (!m_audioSink || !m_audioDevice || !m_isPlaying || m_isPaused) {
+        return;
+    }
+    
+    qint64 queued = sinkQueuedBytes();
+    const qint64 targetBytes = getOptimalBufferSize();
+    const int frameBytes = qMax(1, m_audioFormat.bytesPerFrame());
+    
+    // 欠载检测（边沿触发）：设备已播放过数据且缓冲被耗尽
+    bool starved = (queued == 0 || m_audioSink->state() == QAudio::IdleState);
+    if (starved && m_writtenPtsUs != AV_NOPTS_VALUE && !m_sinkStarved) {
+        m_sinkStarved = true;
+        m_underrunCount++;
+        m_underrunsSinceCheck++;
+        m_sinceUnderrunTimer.restart();
     }
     
-    // 如果有精确的音频时钟基准，使用它
-    if (m_audioClockBase > 0 && m_audioTimer.isValid()) {
-        // 计算从播放开始到现在的实际时间
-        int64_t elapsedTime = m_audioTimer.elapsed() * 1000; // 转换为微秒
+    QMutexLocker locker(&m_queueMutex);
+    
+    while (!m_audioQueue.isEmpty() && queued < targetBytes) {
+        AudioPacket* packet = m_audioQueue.head();
+        
+        // 只写到目标延迟为止，并按整帧对齐
+        qint64 room = qMin<qint64>(targetBytes - queued, m_audioSink->bytesFree());
+        qint64 chunk = qMin<qint64>(packet->size - packet->offset, room);
+        chunk -= chunk % frameBytes;
+        if (chunk <= 0) {
+            break;
+        }
         
-        // 加上基准时间，减去设备延迟
-        int64_t actualAudioTime = m_audioClockBase + elapsedTime - m_deviceLatency;
+        qint64 written = m_audioDevice->write(
+            reinterpret_cast<const char*>(packet->data + packet->offset), chunk);
+        if (written <= 0) {
+            break;
+        }
+        
+        appendReplayHistory(packet->data + packet->offset, written);
+        packet->offset += written;
+        m_pendingBytes -= written;
+        queued += written;
         
-        // 确保时间不会是负数
-        return qMax(0LL, actualAudioTime);
+        if (packet->pts != AV_NOPTS_VALUE) {
+            m_writtenPtsUs = packet->pts + static_cast<int64_t>(bytesToUs(packet->offset) * packet->tempo);
+            m_writtenTempo = packet->tempo;
+        }
+        
+        if (packet->offset >= packet->size) {
+            m_audioQueue.dequeue();
+            delete packet;
+        }
     }
     
-    // 最后回退到主时钟
-    return qMax(0LL, m_masterClock);
+    if (queued > 0) {
+        m_sinkStarved = false;
+    }
+    m_lastSinkQueuedBytes = queued;
 }
 
-int64_t AudioProcessor::getAudioDeviceLatency() const
+void AudioProcessor::setVolume(float volume)
 {
-    return m_deviceLatency;
+    // 增益在下一个音频块中渐变到新值
+    m_volume = qBound(0.0f, volume, kMaxVolume);
+}
+
+bool AudioProcessor::compensateDrift(int64_t driftUs)
+{
+    if (!m_swrContext || driftUs == 0) {
+        return false;
+    }
+    
+    const int rate = m_audioFormat.sampleRate();
+    
+    // 视频超前（drift>0）时压缩音频使其追上，反之拉伸音频
+    int sampleDelta = static_cast<int>(-driftUs * rate / 1000000);
+    if (sampleDelta == 0) {
+        return false;
+    }
+    
+    // 补偿窗口：保证伸缩比例不超过上限，且至少覆盖100ms
+    int distance = static_cast<int>(std::abs(sampleDelta) / kMaxCompensationRatio);
+    distance = qMax(distance, rate / 10);
+    
+    int ret = swr_set_compensation(m_swrContext, sampleDelta, distance);
+    if (ret < 0) {
+        qDebug() << "[SYNC] swr_set_compensation failed:" << ret;
+        return false;
+    }
+    
+    m_compensationWindowUs = static_cast<int64_t>(distance) * 1000000 / rate;
+    m_compensationTimer.restart();
+    return true;
+}
+
+bool AudioProcessor::isCompensating() const
+{
+    return m_compensationTimer.isValid() &&
+           m_compensationTimer.nsecsElapsed() / 1000 < m_compensationWindowUs;
+}
+
+void AudioProcessor::resetDriftCompensation()
+{
+    if (m_swrContext) {
+        swr_set_compensation(m_swrContext, 0, 0);
+    }
+    m_compensationTimer.invalidate();
+    m_compensationWindowUs = 0;
 }
 
-void AudioProcessor::updateAudioClock(int64_t pts, int sampleCount)
+int64_t AudioProcessor::hardResync(int64_t targetUs)
 {
-    if (pts != AV_NOPTS_VALUE) {
-        m_lastAudioPts = pts;
+    resetDriftCompensation();
+    
+    int64_t audioNow = getAccurateAudioTime();
+    int64_t diff = targetUs - audioNow;
+    const int frameBytes = qMax(1, m_audioFormat.bytesPerFrame());
+    qint64 appliedBytes = 0;
+    
+    QMutexLocker locker(&m_queueMutex);
+    
+    if (diff > 0) {
+        // 音频落后：丢弃队首待播放数据（设备中已排队部分无法撤回）
+        qint64 dropBytes = m_audioFormat.bytesForDuration(diff);
+        dropBytes -= dropBytes % frameBytes;
         
-        // 如果是第一帧或者时间基准需要重置
-        if (m_audioClockBase == 0 || abs(pts - (m_audioClockBase + m_audioTimer.elapsed() * 1000)) > 100000) {
-            m_audioClockBase = pts;
-            m_audioTimer.restart();
-            m_accumulatedSamples = 0;
+        while (dropBytes > 0 && !m_audioQueue.isEmpty()) {
+            AudioPacket* packet = m_audioQueue.head();
+            qint64 remaining = packet->size - packet->offset;
+            if (remaining <= dropBytes) {
+                m_audioQueue.dequeue();
+                m_pendingBytes -= remaining;
+                dropBytes -= remaining;
+                appliedBytes += remaining;
+                delete packet;
+                m_droppedFrames++;
+            } else {
+                packet->offset += dropBytes;
+                m_pendingBytes -= dropBytes;
+                appliedBytes += dropBytes;
+                dropBytes = 0;
+            }
         }
+    } else if (diff < 0) {
+        // 音频超前：在队首插入静音，等待视频追上
+        qint64 silenceBytes = m_audioFormat.bytesForDuration(-diff);
+        silenceBytes -= silenceBytes % frameBytes;
         
-        // 累积采样数用于精确计算
-        m_accumulatedSamples += sampleCount;
-        
-        // 动态调整设备延迟估算
-        adjustDeviceLatency();
+        if (silenceBytes > 0) {
+            int64_t headPts = m_nextQueuedPtsUs;
+            if (!m_audioQueue.isEmpty()) {
+                AudioPacket* head = m_audioQueue.head();
+                headPts = (head->pts != AV_NOPTS_VALUE) ? head->pts + bytesToUs(head->offset) : AV_NOPTS_VALUE;
+            }
+            
+            AudioPacket* silence = new AudioPacket();
+            silence->data = static_cast<uint8_t*>(av_mallocz(silenceBytes));
+            silence->size = static_cast<int>(silenceBytes);
+            silence->duration = static_cast<int>(-diff / 1000);
+            // 静音的时间戳位于队首数据之前，使音频时钟相应回退
+            silence->pts = (headPts != AV_NOPTS_VALUE) ? headPts - bytesToUs(silenceBytes) : AV_NOPTS_VALUE;
+            
+            if (silence->data) {
+                m_audioQueue.prepend(silence);
+                m_pendingBytes += silenceBytes;
+                appliedBytes = -silenceBytes;
+            } else {
+                delete silence;
+            }
+        }
     }
+    
+    return (appliedBytes >= 0) ? bytesToUs(appliedBytes) : -bytesToUs(-appliedBytes);
+}
+
+// 音频实际播放位置
+int64_t AudioProcessor::getAccurateAudioTime() const
+{
+    // 已写入设备的末尾时间减去设备中尚未播放的数据时长
+    if (m_writtenPtsUs != AV_NOPTS_VALUE) {
+        return qMax<int64_t>(0, m_writtenPtsUs - static_cast<int64_t>(getAudioDeviceLatency() * m_writtenTempo));
+    }
+    
+    // 尚未写入设备：回退到最新解码的音频PTS
+    if (m_audioBasePts != AV_NOPTS_VALUE) {
+        return framePtsToUs(m_audioBasePts);
+    }
+    
+    return 0;
+}
+
+int64_t AudioProcessor::getAudioDeviceLatency() const
+{
+    // 设备运行时直接测量缓冲中未播放的数据时长
+    if (m_audioSink && m_audioDevice) {
+        return bytesToUs(sinkQueuedBytes());
+    }
+    return m_deviceLatency;
 }
 
 void AudioProcessor::adjustDeviceLatency()
 {
     if (!m_audioSink) return;
     
-    // 基于音频设备的实际缓冲状态调整延迟估算
-    int bufferSize = m_audioSink->bufferSize();
-    int byteRate = m_audioFormat.sampleRate() * m_audioFormat.channelCount() * 2; // 16-bit samples
+    // 基于音频设备中实际排队的数据调整延迟估算
+    int64_t calculatedLatency = bytesToUs(sinkQueuedBytes());
     
-    if (byteRate > 0) {
-        // 计算缓冲区对应的时间延迟
-        int64_t calculatedLatency = (int64_t)(bufferSize * 1000000.0 / byteRate);
-        
-        // 平滑调整延迟值，避免突变
-        m_deviceLatency = (m_deviceLatency * 3 + calculatedLatency) / 4;
-    }
+    // 平滑调整延迟值，避免突变
+    m_deviceLatency = (m_deviceLatency * 3 + calculatedLatency) / 4;
 }
 
 void AudioProcessor::setAudioStreamInfo(AVStream* audioStream)
@@ -524,15 +926,27 @@ void AudioProcessor::setAudioStreamInfo(AVStream* audioStream)
 
 QString AudioProcessor::getStatusInfo() const
 {
-    return QString("Audio Status - Playing: %1, Processed: %2, Dropped: %3")
+    double stageNsPerSample = m_outputStageSamples > 0
+        ? static_cast<double>(m_outputStageNs) / m_outputStageSamples : 0.0;
+    
+    return QString("Audio Status - Playing: %1, Processed: %2, Dropped: %3, %4, Output: %5 %6 ns/sample, "
+                   "Latency: %7/%8 ms, Underruns: %9, Jitter: %10 ms, Device switches: %11")
         .arg(m_isPlaying ? "Yes" : "No")
         .arg(m_processedFrames)
-        .arg(m_droppedFrames);
+        .arg(m_droppedFrames)
+        .arg(m_mixer.getStatusInfo())
+        .arg(isFloatOutput() ? "Float32" : "Int16")
+        .arg(stageNsPerSample, 0, 'f', 2)
+        .arg(getAudioDeviceLatency() / 1000)
+        .arg(m_targetLatency)
+        .arg(m_underrunCount)
+        .arg(m_jitterUs / 1000.0, 0, 'f', 1)
+        .arg(m_deviceSwitchCount);
 }
 
 int AudioProcessor::resampleAudioFrame(AVFrame* frame, uint8_t** outputBuffer)
 {
-    if (!frame || !m_swrContext) {
+    if (!frame || !m_swrContext || !m_mixer.isConfigured()) {
         return 0;
     }
     
@@ -541,26 +955,89 @@ int AudioProcessor::resampleAudioFrame(AVFrame* frame, uint8_t** outputBuffer)
         return 0;
     }
     
+    ensurePlanarCapacity(outSamples);
+    
+    int convertedSamples = swr_convert(
+        m_swrContext, reinterpret_cast<uint8_t**>(m_planarPtrs.data()), outSamples,
+        const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples);
+    
+    if (convertedSamples <= 0) {
+        return 0;
+    }
+    
+    // 直通时直接使用重采样输出，否则经过下混矩阵
+    float * const *mixed = m_planarPtrs.data();
+    if (!m_mixer.isPassthrough()) {
+        m_mixer.mix(m_planarPtrs.data(), m_mixPtrs.data(), convertedSamples);
+        mixed = m_mixPtrs.data();
+    }
+    
+    // 变速不变调：输出长度随速度变化，变速处理器积累满一个窗口前可能没有输出
+    if (m_stretcher.isActive()) {
+        convertedSamples = m_stretcher.process(mixed, convertedSamples);
+        mixed = m_stretcher.output();
+        if (convertedSamples <= 0) {
+            return 0;
+        }
+    }
+    
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    
+    // 浮点输出级：增益（渐变）+ 软削波，保持平面浮点直到设备边界
+    const int channels = m_audioFormat.channelCount();
+    AudioMixer::applyGain(mixed, channels, convertedSamples, m_appliedGain, m_volume, true);
+    m_appliedGain = m_volume;
+    
+    const bool floatOutput = isFloatOutput();
     int outBufferSize = av_samples_get_buffer_size(
-        nullptr, m_audioFormat.channelCount(), outSamples, AV_SAMPLE_FMT_S16, 0);
+        nullptr, channels, convertedSamples, floatOutput ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16, 1);
     
     *outputBuffer = static_cast<uint8_t*>(av_malloc(outBufferSize));
     if (!*outputBuffer) {
         return 0;
     }
     
-    int convertedSamples = swr_convert(
-        m_swrContext, outputBuffer, outSamples,
-        const_cast<const uint8_t**>(frame->data), frame->nb_samples);
+    // 只有设备要求S16时才在此处量化
+    if (floatOutput) {
+        AudioMixer::interleaveFloat(mixed, channels, convertedSamples,
+                                    reinterpret_cast<float*>(*outputBuffer));
+    } else {
+        AudioMixer::interleaveS16(mixed, channels, convertedSamples,
+                                  reinterpret_cast<int16_t*>(*outputBuffer));
+    }
     
-    if (convertedSamples < 0) {
-        av_free(*outputBuffer);
-        *outputBuffer = nullptr;
-        return 0;
+    m_outputStageNs += stageTimer.nsecsElapsed();
+    m_outputStageSamples += convertedSamples;
+    
+    return outBufferSize;
+}
+
+void AudioProcessor::ensurePlanarCapacity(int samples)
+{
+    int inChannels = m_mixer.inputChannels();
+    int outChannels = m_mixer.outputChannels();
+    
+    if (samples <= m_planarCapacity &&
+        (int)m_planarBuffer.size() == inChannels &&
+        (int)m_mixBuffer.size() == outChannels) {
+        return;
     }
     
-    return av_samples_get_buffer_size(
-        nullptr, m_audioFormat.channelCount(), convertedSamples, AV_SAMPLE_FMT_S16, 0);
+    // 预留余量，减少重新分配
+    m_planarCapacity = qMax(samples, m_planarCapacity) + 256;
+    
+    m_planarBuffer.assign(inChannels, std::vector<float>(m_planarCapacity));
+    m_mixBuffer.assign(outChannels, std::vector<float>(m_planarCapacity));
+    
+    m_planarPtrs.resize(inChannels);
+    for (int ch = 0; ch < inChannels; ch++) {
+        m_planarPtrs[ch] = m_planarBuffer[ch].data();
+    }
+    m_mixPtrs.resize(outChannels);
+    for (int ch = 0; ch < outChannels; ch++) {
+        m_mixPtrs[ch] = m_mixBuffer[ch].data();
+    }
 }
 
 void AudioProcessor::clearAudioQueue()
@@ -571,6 +1048,9 @@ void AudioProcessor::clearAudioQueue()
         AudioPacket* packet = m_audioQueue.dequeue();
         delete packet;
     }
+    m_pendingBytes = 0;
+    resetReplayHistory();
+    m_stretcher.reset();
 }
 
 void AudioProcessor::processAudioQueue()
@@ -585,37 +1065,13 @@ void AudioProcessor::checkBufferStatus()
         return;
     }
     
-    // 使用音频设备的实际状态而不是空的队列
     if (m_audioSink) {
-        int bufferLevel = 0;
-        QAudio::State state = m_audioSink->state();
+        // 报告实际缓冲量：设备中未播放数据 + 待写入队列
+        int bufferedMs = static_cast<int>((bytesToUs(sinkQueuedBytes()) + bytesToUs(m_pendingBytes)) / 1000);
+        emit bufferStatusChanged(bufferedMs, m_targetLatency);
         
-        // 基于音频设备状态判断缓冲区情况
-        if (state == QAudio::ActiveState) {
-            // 音频设备正常工作，估算缓冲区级别
-            bufferLevel = qMax(1, m_processedFrames % 10); // 简单的估算
-        } else if (state == QAudio::IdleState) {
-            bufferLevel = 0; // 设备空闲，可能缓冲区不足
-        }
-        
-        emit bufferStatusChanged(bufferLevel, 10); // 使用更合理的最大值
-        
-        // 大幅减少日志输出 - 只在严重问题时输出
-        static int underrunCount = 0;
-        static int lastLogTime = 0;
-        int currentTime = QTime::currentTime().msecsSinceStartOfDay();
-        
-        if (bufferLevel == 0 && state == QAudio::IdleState) {
-            underrunCount++;
-            // 每5秒最多输出一次，且只在连续问题时输出
-            if (underrunCount > 50 && (currentTime - lastLogTime) > 5000) {
-                qDebug() << "[WARN] Audio buffer issues detected";
-                lastLogTime = currentTime;
-                underrunCount = 0;
-            }
-        } else {
-            underrunCount = 0; // 重置计数器
-        }
+        // 根据欠载和抖动统计调整目标延迟
+        manageDynamicBuffer();
     }
 }
 
@@ -626,6 +1082,13 @@ void AudioProcessor::handleAudioStateChanged()
         if (state == QAudio::IdleState || state == QAudio::StoppedState) {
             qDebug() << "Audio device state changed to:" << state;
         }
+        
+        // 播放中设备意外停止（拔出、驱动错误）：稍后在同一设备或默认设备上恢复
+        if (state == QAudio::StoppedState && m_audioSink->error() != QAudio::NoError &&
+            m_isPlaying && !m_recoveryInProgress) {
+            qDebug() << "Audio device error:" << m_audioSink->error();
+            m_recoveryTimer->start();
+        }
     }
 }
 
@@ -651,24 +1114,335 @@ bool AudioProcessor::restartAudioDevice()
     return true;
 }
 
+void AudioProcessor::appendReplayHistory(const uint8_t* data, qint64 size)
+{
+    const qint64 capacity = static_cast<qint64>(m_replayRing.size());
+    if (capacity <= 0 || size <= 0) {
+        return;
+    }
+    
+    // 超过容量时只保留最后 capacity 字节
+    if (size > capacity) {
+        data += size - capacity;
+        size = capacity;
+    }
+    
+    qint64 first = qMin(size, capacity - m_replayWritePos);
+    memcpy(m_replayRing.data() + m_replayWritePos, data, first);
+    if (size > first) {
+        memcpy(m_replayRing.data(), data + first, size - first);
+    }
+    
+    m_replayWritePos = (m_replayWritePos + size) % capacity;
+    m_replayFill = qMin(capacity, m_replayFill + size);
+}
+
+void AudioProcessor::requeueUnplayedTail(qint64 unplayedBytes)
+{
+    const int frameBytes = qMax(1, m_audioFormat.bytesPerFrame());
+    qint64 tailBytes = qMin(unplayedBytes, m_replayFill);
+    tailBytes -= tailBytes % frameBytes;
+    
+    if (tailBytes <= 0 || m_writtenPtsUs == AV_NOPTS_VALUE) {
+        return;
+    }
+    
+    AudioPacket* tail = new AudioPacket();
+    tail->data = static_cast<uint8_t*>(av_malloc(tailBytes));
+    if (!tail->data) {
+        delete tail;
+        return;
+    }
+    
+    // 从环形缓冲中取出最后 tailBytes 字节
+    const qint64 capacity = static_cast<qint64>(m_replayRing.size());
+    qint64 start = (m_replayWritePos - tailBytes + capacity) % capacity;
+    qint64 first = qMin(tailBytes, capacity - start);
+    memcpy(tail->data, m_replayRing.data() + start, first);
+    if (tailBytes > first) {
+        memcpy(tail->data + first, m_replayRing.data(), tailBytes - first);
+    }
+    
+    tail->size = static_cast<int>(tailBytes);
+    tail->duration = static_cast<int>(bytesToUs(tailBytes) / 1000);
+    tail->tempo = m_writtenTempo;
+    tail->pts = m_writtenPtsUs - static_cast<int64_t>(bytesToUs(tailBytes) * m_writtenTempo);
+    
+    QMutexLocker locker(&m_queueMutex);
+    m_audioQueue.prepend(tail);
+    m_pendingBytes += tailBytes;
+    
+    // 写入位置回退到尾部起点，时钟保持在切换前正在播放的位置
+    m_writtenPtsUs = tail->pts;
+    
+    qDebug() << "[AUDIO] Requeued unplayed tail:" << tail->duration << "ms";
+}
+
+void AudioProcessor::resetReplayHistory()
+{
+    m_replayWritePos = 0;
+    m_replayFill = 0;
+    m_lastSinkQueuedBytes = 0;
+}
+
+bool AudioProcessor::convertQueuedAudio(const QAudioFormat& fromFormat, const AVChannelLayout* fromLayout)
+{
+    auto sampleFormatOf = [](const QAudioFormat& format) {
+        return (format.sampleFormat() == QAudioFormat::Float) ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16;
+    };
+    
+    // 一次性转换：整个队列作为连续的一段送入，重采样器的延迟样本在末尾冲刷到最后一个包
+    SwrContext* converter = nullptr;
+    if (swr_alloc_set_opts2(&converter,
+                            &m_outputLayout, sampleFormatOf(m_audioFormat), m_audioFormat.sampleRate(),
+                            fromLayout, sampleFormatOf(fromFormat), fromFormat.sampleRate(),
+                            0, nullptr) < 0 || swr_init(converter) < 0) {
+        qDebug() << "[AUDIO] Cannot create converter for queued audio";
+        swr_free(&converter);
+        return false;
+    }
+    
+    const int fromFrameBytes = qMax(1, fromFormat.bytesPerFrame());
+    const int toFrameBytes = qMax(1, m_audioFormat.bytesPerFrame());
+    bool ok = true;
+    
+    QMutexLocker locker(&m_queueMutex);
+    qint64 pendingBytes = 0;
+    for (AudioPacket* packet : m_audioQueue) {
+        int inSamples = (packet->size - packet->offset) / fromFrameBytes;
+        int outCapacity = swr_get_out_samples(converter, inSamples);
+        uint8_t* out = static_cast<uint8_t*>(av_malloc(static_cast<size_t>(qMax(outCapacity, 1)) * toFrameBytes));
+        const uint8_t* in = packet->data + packet->offset;
+        int converted = out ? swr_convert(converter, &out, outCapacity, &in, inSamples) : AVERROR(ENOMEM);
+        if (converted < 0) {
+            av_free(out);
+            ok = false;
+            break;
+        }
+        
+        // 时间戳移到未播放部分的起点
+        if (packet->pts != AV_NOPTS_VALUE && packet->offset > 0) {
+            packet->pts += static_cast<int64_t>(packet->offset / fromFrameBytes) * 1000000 / fromFormat.sampleRate();
+        }
+        av_free(packet->data);
+        packet->data = out;
+        packet->size = converted * toFrameBytes;
+        packet->offset = 0;
+        pendingBytes += packet->size;
+    }
+    
+    // 冲刷重采样器内部剩余的样本
+    if (ok && !m_audioQueue.isEmpty()) {
+        int flushCapacity = swr_get_out_samples(converter, 0);
+        if (flushCapacity > 0) {
+            AudioPacket* last = m_audioQueue.last();
+            uint8_t* grown = static_cast<uint8_t*>(av_realloc(last->data,
+                static_cast<size_t>(last->size) + static_cast<size_t>(flushCapacity) * toFrameBytes));
+            if (grown) {
+                last->data = grown;
+                uint8_t* out = grown + last->size;
+                int flushed = swr_convert(converter, &out, flushCapacity, nullptr, 0);
+                if (flushed > 0) {
+                    last->size += flushed * toFrameBytes;
+                    pendingBytes += flushed * toFrameBytes;
+                }
+            }
+        }
+    }
+    swr_free(&converter);
+    
+    if (!ok) {
+        return false;
+    }
+    m_pendingBytes = pendingBytes;
+    qDebug() << "[AUDIO] Converted" << m_audioQueue.size() << "queued buffers to the new output format,"
+             << (bytesToUs(pendingBytes) / 1000) << "ms";
+    return true;
+}
+
+bool AudioProcessor::switchOutputDevice(const QAudioDevice& device)
+{
+    if (!m_initialized || device.isNull()) {
+        return false;
+    }
+    
+    qDebug() << "Switching audio output to:" << device.description();
+    
+    // 设备已失效时测量值不可靠，使用最近一次供数时的测量结果
+    qint64 unplayedBytes = m_lastSinkQueuedBytes;
+    if (m_audioSink && m_audioDevice && m_audioSink->error() == QAudio::NoError) {
+        unplayedBytes = sinkQueuedBytes();
+    }
+    
+    QAudioFormat previousFormat = m_audioFormat;
+    m_feedTimer->stop();
+    cleanupAudioDevice();
+    
+    // 拔出设备时设备错误和设备列表变化会先后触发切换：这次切换之后，
+    // 之前（以及停止旧设备时）排队的恢复已经过时，不再切换第二次
+    m_recoveryTimer->stop();
+    
+    // 未播放的尾部放回队首，之后在新设备上重放
+    requeueUnplayedTail(unplayedBytes);
+    
+    AVChannelLayout previousLayout = {};
+    av_channel_layout_copy(&previousLayout, &m_outputLayout);
+    
+    m_outputDevice = device;
+    if (!negotiateOutputFormat()) {
+        av_channel_layout_uninit(&previousLayout);
+        emit audioError("Audio format not supported by new device");
+        return false;
+    }
+    
+    if (m_audioFormat != previousFormat) {
+        // 设备格式不同：重建下混和重采样；已转换的PCM（包括放回的尾部）转换为新格式后继续播放
+        qDebug() << "Output format changed, rebuilding mixer and resampler";
+        m_sampleRate = m_audioFormat.sampleRate();
+        m_channels = m_audioFormat.channelCount();
+        m_bytesPerSample = m_audioFormat.bytesPerSample();
+        m_sampleDuration = 1000000.0 / m_audioFormat.sampleRate();
+        
+        if (convertQueuedAudio(previousFormat, &previousLayout)) {
+            // 重放历史是旧格式的数据，变速器的内部缓冲也按旧声道数排列
+            resetReplayHistory();
+            m_stretcher.reset();
+        } else {
+            // 无法转换时只能丢弃，时钟保持在切换前的位置
+            int64_t preservedPts = m_writtenPtsUs;
+            clearAudioQueue();
+            m_writtenPtsUs = preservedPts;
+            m_nextQueuedPtsUs = AV_NOPTS_VALUE;
+        }
+        av_channel_layout_uninit(&previousLayout);
+        
+        if (!m_mixer.configure(&m_mixInputLayout, &m_outputLayout, m_downmixOptions) || !setupResampler()) {
+            emit audioError("Failed to rebuild audio pipeline");
+            return false;
+        }
+    }
+    av_channel_layout_uninit(&previousLayout);
+    
+    if (!setupAudioDevice()) {
+        emit audioError("Failed to setup audio device");
+        return false;
+    }
+    
+    if (m_isPlaying) {
+        m_audioDevice = m_audioSink->start();
+        if (!m_audioDevice) {
+            qDebug() << "Failed to start new audio device";
+            return false;
+        }
+        
+        // 新设备从空缓冲开始，不计为欠载
+        m_sinkStarved = true;
+        m_feedIntervalTimer.invalidate();
+        
+        if (m_isPaused) {
+            m_audioSink->suspend();
+        } else {
+            feedAudioDevice();
+            m_feedTimer->start();
+        }
+    }
+    
+    m_deviceSwitchCount++;
+    m_errorCount = 0;
+    return true;
+}
+
+void AudioProcessor::onAudioOutputsChanged()
+{
+    if (!m_initialized) {
+        return;
+    }
+    
+    QAudioDevice defaultDevice = QMediaDevices::defaultAudioOutput();
+    
+    // 当前设备是否仍然存在
+    bool currentAvailable = false;
+    const QList<QAudioDevice> outputs = QMediaDevices::audioOutputs();
+    for (const QAudioDevice& output : outputs) {
+        if (output.id() == m_outputDevice.id()) {
+            currentAvailable = true;
+            break;
+        }
+    }
+    
+    if (!currentAvailable || (m_followDefaultDevice && defaultDevice.id() != m_outputDevice.id())) {
+        if (defaultDevice.isNull()) {
+            qDebug() << "No audio output device available";
+            return;
+        }
+        switchOutputDevice(defaultDevice);
+    }
+}
+
 void AudioProcessor::manageDynamicBuffer()
 {
-    // 简化版本：不进行动态缓冲区管理
+    if (!m_enableQualityControl) {
+        return;
+    }
+    
+    int previousTarget = m_targetLatency;
+    
+    // 抖动决定的下限：两倍抖动峰值 + 一个供数周期
+    int floorMs = qBound(m_minLatency,
+                         static_cast<int>(m_jitterPeakUs * 2 / 1000) + kFeedIntervalMs,
+                         m_maxLatency);
+    
+    if (m_underrunsSinceCheck > 0) {
+        // 发生欠载：快速增大缓冲
+        m_targetLatency = qMin(m_maxLatency, m_targetLatency * 3 / 2 + 10);
+        m_underrunsSinceCheck = 0;
+        qDebug() << "[AUDIO] Underrun detected, total:" << m_underrunCount
+                 << "target latency:" << previousTarget << "->" << m_targetLatency << "ms";
+    } else if (m_targetLatency < floorMs) {
+        // 抖动变大：直接抬高到下限
+        m_targetLatency = floorMs;
+    } else if (m_sinceUnderrunTimer.isValid() && m_sinceUnderrunTimer.elapsed() > kShrinkQuietMs &&
+               m_targetLatency > floorMs) {
+        // 系统平稳：缓慢向低延迟目标收缩
+        m_targetLatency = qMax(floorMs, m_targetLatency - qMax(1, m_targetLatency / 50));
+    }
+    
+    if (m_targetLatency != previousTarget) {
+        m_optimalBufferSize = getOptimalBufferSize();
+        emit latencyChanged(static_cast<int64_t>(m_targetLatency) * 1000);
+    }
 }
 
 int AudioProcessor::getOptimalBufferSize() const
 {
-    return m_optimalBufferSize;
+    if (!m_audioFormat.isValid()) {
+        return m_optimalBufferSize;
+    }
+    return m_audioFormat.bytesForDuration(static_cast<qint64>(m_targetLatency) * 1000);
 }
 
 void AudioProcessor::adjustPlaybackTiming()
 {
-    // 简化版本：不进行播放时序调整
+    // 统计供数定时器的调度抖动
+    if (!m_feedIntervalTimer.isValid()) {
+        m_feedIntervalTimer.start();
+        return;
+    }
+    
+    int64_t intervalUs = m_feedIntervalTimer.nsecsElapsed() / 1000;
+    m_feedIntervalTimer.restart();
+    
+    int64_t deviation = qAbs(intervalUs - kFeedIntervalMs * 1000);
+    m_jitterUs = (m_jitterUs * 7 + deviation) / 8;
+    
+    // 峰值缓慢衰减，使偶发的长停顿在一段时间内仍影响下限
+    m_jitterPeakUs = qMax(deviation, m_jitterPeakUs - m_jitterPeakUs / 256);
 }
 
 int64_t AudioProcessor::calculateAudioDelay() const
 {
-    return 0; // 简化版本：返回0延迟
+    // 从解码到输出的总延迟：待写入队列 + 设备缓冲
+    return bytesToUs(m_pendingBytes) + bytesToUs(sinkQueuedBytes());
 }
 
 bool AudioProcessor::shouldDropFrame(int64_t framePts) const
@@ -689,24 +1463,28 @@ void AudioProcessor::handleAudioDeviceError()
 
 void AudioProcessor::attemptRecovery()
 {
-    if (m_recoveryInProgress) {
+    if (m_recoveryInProgress || !m_initialized) {
         return;
     }
     
     m_recoveryInProgress = true;
     qDebug() << "Attempting audio recovery...";
     
-    bool wasPlaying = m_isPlaying;
-    
-    // 停止播放
-    stop();
-    
-    // 重新设置音频设备
-    if (setupAudioDevice()) {
-        if (wasPlaying) {
-            start();
+    // 只重建设备，保留队列和时钟；原设备已消失时改用默认设备
+    QAudioDevice device = m_outputDevice;
+    bool deviceAvailable = false;
+    const QList<QAudioDevice> outputs = QMediaDevices::audioOutputs();
+    for (const QAudioDevice& output : outputs) {
+        if (output.id() == device.id()) {
+            deviceAvailable = true;
+            break;
         }
-        m_errorCount = 0;
+    }
+    if (!deviceAvailable) {
+        device = QMediaDevices::defaultAudioOutput();
+    }
+    
+    if (switchOutputDevice(device)) {
         qDebug() << "Audio recovery successful";
     } else {
         qDebug() << "Audio recovery failed";
@@ -715,5 +1493,3 @@ void AudioProcessor::attemptRecovery()
     
     m_recoveryInProgress = false;
 }
-
-
@@ -15,22 +15,30 @@
 #include <QAudioDevice>
 #include <QMediaDevices>
 #include <QElapsedTimer> // Added for QElapsedTimer
+#include <vector>
+
+#include "AudioMixer.h"
+#include "MasterClock.h"
+#include "TimeStretcher.h"
 
 extern "C" {
     #include <libavformat/avformat.h>
     #include <libavcodec/avcodec.h>
     #include <libswresample/swresample.h>
     #include <libavutil/time.h>
+    #include <libavutil/opt.h>
 }
 
-// 音频包结构
+// 音频包结构（已转换为设备格式的PCM数据）
 struct AudioPacket {
     uint8_t* data;
     int size;
-    int64_t pts;  // 显示时间戳
+    int offset;   // 已写入设备的字节数
+    int64_t pts;  // 显示时间戳(微秒)
     int duration; // 包持续时间(ms)
+    double tempo; // 每播放1秒推进的媒体时长（变速播放时不为1）
     
-    AudioPacket() : data(nullptr), size(0), pts(AV_NOPTS_VALUE), duration(0) {}
+    AudioPacket() : data(nullptr), size(0), offset(0), pts(AV_NOPTS_VALUE), duration(0), tempo(1.0) {}
     ~AudioPacket() { 
         if (data) {
             av_free(data);
@@ -61,29 +69,61 @@ public:
     // 音频数据处理
     void processAudioPacket(AVPacket* packet);
     
-    // 音量控制
+    // 音量控制（软件增益，允许超过1.0，由软削波保护）
+    static constexpr float kMaxVolume = 2.0f;
     void setVolume(float volume);
     float getVolume() const { return m_volume; }
     
-    // 同步控制
-    int64_t getCurrentAudioTime() const;
-    void setMasterClock(int64_t timestamp);
+    // 输出格式：优先Float32，设备不支持时在输出边界转换为S16
+    void setPreferFloatOutput(bool prefer) { m_preferFloatOutput = prefer; }
+    bool isFloatOutput() const { return m_audioFormat.sampleFormat() == QAudioFormat::Float; }
+    
+    // 下混控制（中置/LFE增益等）
+    void setDownmixOptions(const AudioMixer::DownmixOptions &options);
+    AudioMixer::DownmixOptions getDownmixOptions() const { return m_downmixOptions; }
+    
+    // 同步控制：音频主时钟模式下由设备播放位置驱动主时钟
+    void setClock(MasterClock* clock) { m_clock = clock; }
     bool isPlaying() const { return m_isPlaying; }
     
     // 新增：更精确的时间计算
+    // 返回设备当前实际播放到的位置：已写入位置减去设备缓冲中尚未播放的时长（即输出延迟），
+    // 主时钟和同步判断直接使用，调用方不需要再扣除延迟
     int64_t getAccurateAudioTime() const;
     int64_t getAudioDeviceLatency() const;
-    void updateAudioClock(int64_t pts, int sampleCount);
+    int getTargetLatency() const { return m_targetLatency; }
+    int64_t getBufferedDuration() const { return calculateAudioDelay(); }  // 待播放+设备缓冲(微秒)
+    int64_t getQueuedEndPts() const { return m_nextQueuedPtsUs; }          // 已入队数据末尾PTS(微秒)
+    bool isQueueFull() const;  // 队列待播放时长达到上限：调用方暂停解复用，等待设备消耗
+    int getUnderrunCount() const { return m_underrunCount; }
+    
+    // 漂移校正：小漂移通过重采样补偿平滑伸缩音频，大误差才硬同步
+    // driftUs > 0 表示主时钟超前音频
+    static constexpr double kMaxCompensationRatio = 0.01;  // 最大伸缩比例1%
+    bool compensateDrift(int64_t driftUs);
+    bool isCompensating() const;
+    int64_t hardResync(int64_t targetUs);  // 返回实际校正的时长(微秒)：正为丢弃，负为插入静音，0为未校正
+    void resetDriftCompensation();
+    
+    // 变速不变调播放（直播延迟追赶），主时钟需同步设置相同速度
+    void setTempo(double tempo) { m_stretcher.setTempo(tempo); }
+    double getTempo() const { return m_stretcher.tempo(); }
     void setAudioStreamInfo(AVStream* audioStream);  // 新增：设置音频流信息
     
     // 状态查询
     bool isInitialized() const { return m_initialized; }
     QString getStatusInfo() const;
+    
+    // 输出设备热切换：只重建设备，保留已缓冲音频和时钟
+    bool switchOutputDevice(const QAudioDevice& device);
+    QAudioDevice getOutputDevice() const { return m_outputDevice; }
+    int getDeviceSwitchCount() const { return m_deviceSwitchCount; }
 
 signals:
     void audioTimeChanged(int64_t timestamp);
     void bufferStatusChanged(int bufferLevel, int maxBuffer);
     void audioError(const QString& error);
+    void latencyChanged(int64_t latencyUs);  // 输出缓冲目标延迟变化
 
 public slots:
     void processAudioQueue();
@@ -91,28 +131,47 @@ public slots:
 private slots:
     void checkBufferStatus();
     void handleAudioStateChanged();
+    void onFeedTimer();      // 供数定时器：统计抖动并补充数据
+    void onAudioOutputsChanged();
 
 private:
     // 音频设备管理
     bool setupAudioDevice();
     void cleanupAudioDevice();
     bool restartAudioDevice();
+    void appendReplayHistory(const uint8_t* data, qint64 size);
+    void requeueUnplayedTail(qint64 unplayedBytes);
+    void resetReplayHistory();
+    // 设备格式变化后把队列中尚未播放的PCM（含放回的尾部）一次性转换为新格式
+    bool convertQueuedAudio(const QAudioFormat& fromFormat, const AVChannelLayout* fromLayout);
+    
+    // 输出格式协商：直通或下混到设备声道数
+    bool negotiateOutputFormat();
+    static QAudioFormat::ChannelConfig toQtChannelConfig(const AVChannelLayout &layout);
     
     // 重采样管理
     bool setupResampler();
     void cleanupResampler();
     int resampleAudioFrame(AVFrame* frame, uint8_t** outputBuffer);
+    void ensurePlanarCapacity(int samples);
     
     // 缓冲区管理
     void manageDynamicBuffer();
     void clearAudioQueue();
     int getOptimalBufferSize() const;
+    void enqueueAudioData(uint8_t* data, int size, int64_t ptsUs, double tempo);
+    void feedAudioDevice();  // 按目标延迟向设备补充数据
+    int64_t framePtsToUs(int64_t pts) const;
+    int64_t bytesToUs(qint64 bytes) const;
+    qint64 sinkQueuedBytes() const;
+    bool isSinkConsuming() const;  // 设备正在播放（队列会被消耗）
     
     // 同步控制
     void adjustPlaybackTiming();
     int64_t calculateAudioDelay() const;
     bool shouldDropFrame(int64_t framePts) const;
     void adjustDeviceLatency();  // 新增：动态调整设备延迟
+    void publishClock();         // 音频主时钟模式下上报实际播放位置
     
     // 错误处理
     void handleAudioDeviceError();
@@ -144,24 +203,48 @@ private:
     float m_volume;
     
     // 同步控制
-    int64_t m_masterClock;
+    MasterClock* m_clock;
     int64_t m_audioBasePts;
     QTime m_playbackStartTime;
     QTime m_audioStartTime;
     
     // 新增：精确时间同步
-    int64_t m_lastAudioPts;          // 最后一个音频帧的PTS
-    int64_t m_audioClockBase;        // 音频时钟基准
-    QElapsedTimer m_audioTimer;      // 高精度计时器
     int64_t m_deviceLatency;         // 音频设备延迟
-    int64_t m_accumulatedSamples;    // 累积采样数
     double m_sampleDuration;         // 每个采样的时长(微秒)
     
     // 缓冲区管理
-    int m_maxQueueSize;
+    int64_t m_maxQueuedUs;           // 队列待播放时长上限(微秒)，超过后反压解复用
     int m_minQueueSize;
     int m_optimalBufferSize;
     QTimer* m_bufferCheckTimer;
+    QTimer* m_feedTimer;             // 设备供数定时器
+    qint64 m_pendingBytes;           // 队列中尚未写入设备的字节数
+    int64_t m_writtenPtsUs;          // 已写入设备数据末尾的PTS(微秒)
+    double m_writtenTempo;           // 最近写入设备的数据的速度，换算设备缓冲对应的媒体时长
+    int64_t m_nextQueuedPtsUs;       // 无PTS帧的续接时间戳
+    
+    // 自适应缓冲：欠载与调度抖动统计
+    int m_underrunCount;             // 累计欠载次数
+    int m_underrunsSinceCheck;       // 上次调整后的欠载次数
+    bool m_sinkStarved;              // 当前是否处于欠载状态（边沿检测）
+    QElapsedTimer m_feedIntervalTimer;
+    QElapsedTimer m_sinceUnderrunTimer;
+    int64_t m_jitterUs;              // 供数间隔抖动(EWMA)
+    int64_t m_jitterPeakUs;          // 抖动峰值（缓慢衰减）
+    int m_minLatency;                // 最小延迟(ms)
+    
+    // 漂移补偿窗口
+    QElapsedTimer m_compensationTimer;
+    int64_t m_compensationWindowUs;
+    
+    // 设备热切换：最近写入设备的数据（环形），切换时重放尚未播放的尾部
+    QMediaDevices* m_mediaDevices;
+    bool m_followDefaultDevice;      // 是否跟随系统默认输出设备
+    std::vector<uint8_t> m_replayRing;
+    qint64 m_replayWritePos;
+    qint64 m_replayFill;
+    qint64 m_lastSinkQueuedBytes;    // 最近一次测得的设备未播放字节数
+    int m_deviceSwitchCount;
     
     // 性能监控
     int m_droppedFrames;
@@ -183,6 +266,26 @@ private:
     int m_bytesPerSample;
     AVSampleFormat m_inputSampleFormat;
     
+    // 多声道下混
+    AudioMixer m_mixer;
+    AudioMixer::DownmixOptions m_downmixOptions;
+    AVChannelLayout m_mixInputLayout;   // 重采样输出布局（混音输入）
+    AVChannelLayout m_outputLayout;     // 设备输出布局
+    std::vector<std::vector<float>> m_planarBuffer;  // 重采样输出（平面浮点）
+    std::vector<std::vector<float>> m_mixBuffer;     // 混音输出（平面浮点）
+    std::vector<float*> m_planarPtrs;
+    std::vector<float*> m_mixPtrs;
+    int m_planarCapacity;
+    
+    // 变速不变调
+    TimeStretcher m_stretcher;
+    
+    // 浮点输出级
+    bool m_preferFloatOutput;
+    float m_appliedGain;             // 上一块实际使用的增益（用于渐变）
+    qint64 m_outputStageNs;          // 输出级累计耗时
+    qint64 m_outputStageSamples;     // 输出级累计采样数
+    
     // 质量控制
     bool m_enableQualityControl;
     int m_maxLatency; // 最大延迟(ms)
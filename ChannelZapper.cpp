@@ -0,0 +1,384 @@
+#include "ChannelZapper.h"
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QDebug>
+#include <atomic>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+}
+
+// 一个待机槽：加载器打开并探测频道，就绪后读取线程持续解复用，只保留最近一个GOP
+struct ChannelZapper::Standby
+{
+    int index = -1;                  // 频道序号，-1表示空闲
+    QString url;
+    NetworkStreamLoader *loader = nullptr;
+    bool ready = false;              // 加载完成，info 有效（包由 gop 持有）
+    NetworkStreamLoader::StreamInfo info;
+
+    QThread *reader = nullptr;
+    std::atomic<bool> abort{false};
+    std::atomic<bool> failed{false}; // 加载失败或读取中断开，等待重试
+
+    // 读取线程写入，移交时在主线程取出
+    QMutex mutex;
+    QList<AVPacket*> gop;            // 从最近的视频关键帧开始
+    qint64 gopBytes = 0;
+    bool haveKeyframe = false;
+};
+
+ChannelZapper::ChannelZapper(QObject *parent)
+    : QObject(parent)
+    , m_currentIndex(-1)
+    , m_qualityControl(false)
+    , m_maxBitrateKbps(0)
+{
+    // 待机加载只在换台后偶尔发生，不需要播放器加载器那样的常驻线程，空闲即回收
+    // RTSP传输方式竞速时每次加载同时运行两个任务，每槽两个线程，避免一个槽的竞速任务排队等待另一个槽
+    m_loaderPool.setMaxThreadCount(kStandbyCount * kJobsPerLoad);
+
+    for (int i = 0; i < kStandbyCount; ++i) {
+        Standby *standby = new Standby;
+        standby->loader = new NetworkStreamLoader(&m_loaderPool, this);
+        // 待机流移交时从最近的GOP解码显示，加载时不需要预解码首帧
+        standby->loader->setFirstFramePreroll(false);
+        connect(standby->loader, &NetworkStreamLoader::streamReady, this,
+                [this, standby](const NetworkStreamLoader::StreamInfo &streamInfo) {
+            onStandbyReady(standby, streamInfo);
+        });
+        connect(standby->loader, &NetworkStreamLoader::loadingFailed, this, [this, standby](const QString &error) {
+            onStandbyFailed(standby, error);
+        });
+        m_standbys.append(standby);
+    }
+}
+
+ChannelZapper::~ChannelZapper()
+{
+    // 先取消所有待机的加载，加载器析构时等待的是共用线程池中的全部任务
+    for (Standby *standby : m_standbys) {
+        releaseStandby(standby);
+    }
+    for (Standby *standby : m_standbys) {
+        delete standby->loader;
+        delete standby;
+    }
+    m_standbys.clear();
+}
+
+void ChannelZapper::setChannels(const QStringList &urls)
+{
+    m_channels = urls;
+    m_currentIndex = -1;
+    refreshStandbys();
+    qDebug() << "[ZAP] Channel list with" << m_channels.size() << "channels";
+}
+
+QString ChannelZapper::channelUrl(int index) const
+{
+    return (index >= 0 && index < m_channels.size()) ? m_channels.at(index) : QString();
+}
+
+void ChannelZapper::setQualityControl(bool enabled, int maxBitrateKbps)
+{
+    m_qualityControl = enabled;
+    m_maxBitrateKbps = maxBitrateKbps;
+}
+
+int ChannelZapper::neighbourIndex(int delta) const
+{
+    int count = m_channels.size();
+    if (count == 0) {
+        return -1;
+    }
+    // 不在列表中时，下一个是第一个频道，上一个是最后一个
+    if (m_currentIndex < 0) {
+        return (delta > 0) ? 0 : count - 1;
+    }
+    return ((m_currentIndex + delta) % count + count) % count;
+}
+
+void ChannelZapper::setCurrentIndex(int index)
+{
+    if (index >= m_channels.size()) {
+        index = -1;
+    }
+    m_currentIndex = index;
+    refreshStandbys();
+}
+
+bool ChannelZapper::takeStandby(int index, NetworkStreamLoader::StreamInfo *streamInfo)
+{
+    for (Standby *standby : m_standbys) {
+        if (standby->index != index || !standby->ready || standby->failed) {
+            continue;
+        }
+
+        // 停止读取后上下文只属于调用方
+        if (standby->reader) {
+            standby->abort = true;
+            standby->reader->wait();
+            delete standby->reader;
+            standby->reader = nullptr;
+        }
+        standby->info.formatContext->interrupt_callback.callback = nullptr;
+        standby->info.formatContext->interrupt_callback.opaque = nullptr;
+
+        *streamInfo = standby->info;
+        {
+            QMutexLocker locker(&standby->mutex);
+            streamInfo->prerollPackets = standby->gop;
+            standby->gop.clear();
+            standby->gopBytes = 0;
+            standby->haveKeyframe = false;
+        }
+        // 换台不需要连接和探测
+        streamInfo->connectMs = 0;
+        streamInfo->loadMs = 0;
+
+        // GOP跨度即移交后解码器需要追赶的时长
+        int64_t spanMs = 0;
+        int videoIndex = streamInfo->videoStreamIndex;
+        if (videoIndex >= 0 && !streamInfo->prerollPackets.isEmpty()) {
+            int64_t firstDts = streamInfo->prerollPackets.first()->dts;
+            int64_t lastDts = firstDts;
+            for (const AVPacket *packet : streamInfo->prerollPackets) {
+                if (packet->stream_index == videoIndex && packet->dts != AV_NOPTS_VALUE) {
+                    lastDts = packet->dts;
+                }
+            }
+            if (firstDts != AV_NOPTS_VALUE && lastDts > firstDts) {
+                AVRational msBase = {1, 1000};
+                spanMs = av_rescale_q(lastDts - firstDts, streamInfo->formatContext->streams[videoIndex]->time_base, msBase);
+            }
+        }
+        qDebug() << "[ZAP] Handing over channel" << (index + 1) << "from standby with"
+                 << streamInfo->prerollPackets.size() << "buffered packets, GOP span" << spanMs << "ms";
+
+        standby->ready = false;
+        standby->index = -1;
+        standby->url.clear();
+        return true;
+    }
+    return false;
+}
+
+void ChannelZapper::refreshStandbys()
+{
+    // 当前频道的后一个和前一个（频道数少时可能重合或就是当前频道）
+    QList<int> wanted;
+    if (m_currentIndex >= 0) {
+        for (int delta : {1, -1}) {
+            int index = neighbourIndex(delta);
+            if (index != m_currentIndex && !wanted.contains(index)) {
+                wanted.append(index);
+            }
+        }
+    }
+
+    // 仍然相邻的待机保留，其余释放后分配给新的相邻频道
+    QList<Standby*> idle;
+    for (Standby *standby : m_standbys) {
+        if (standby->index >= 0 && wanted.contains(standby->index) && !standby->failed) {
+            wanted.removeOne(standby->index);
+            continue;
+        }
+        releaseStandby(standby);
+        idle.append(standby);
+    }
+    for (int i = 0; i < wanted.size() && i < idle.size(); ++i) {
+        startStandby(idle.at(i), wanted.at(i));
+    }
+}
+
+void ChannelZapper::startStandby(Standby *standby, int index)
+{
+    standby->index = index;
+    standby->url = m_channels.at(index);
+    standby->ready = false;
+    standby->failed = false;
+
+    qDebug() << "[ZAP] Preparing channel" << (index + 1) << "on standby";
+    standby->loader->setQualityControl(m_qualityControl, m_maxBitrateKbps);
+    standby->loader->loadStreamAsync(standby->url, kLoadTimeoutMs);
+}
+
+void ChannelZapper::releaseStandby(Standby *standby)
+{
+    if (standby->loader->isLoading()) {
+        standby->loader->cancelLoading();
+    }
+
+    if (standby->reader) {
+        standby->abort = true;
+        standby->reader->wait();
+        delete standby->reader;
+        standby->reader = nullptr;
+    }
+
+    if (standby->ready) {
+        {
+            QMutexLocker locker(&standby->mutex);
+            clearGopLocked(standby);
+            standby->haveKeyframe = false;
+        }
+        freeStream(standby->info);
+    }
+
+    standby->ready = false;
+    standby->failed = false;
+    standby->index = -1;
+    standby->url.clear();
+}
+
+void ChannelZapper::scheduleRetry(Standby *standby)
+{
+    int index = standby->index;
+    QTimer::singleShot(kRetryDelayMs, this, [this, standby, index]() {
+        // 期间已换台或已释放
+        if (standby->index != index || !standby->failed) {
+            return;
+        }
+        releaseStandby(standby);
+        startStandby(standby, index);
+    });
+}
+
+void ChannelZapper::onStandbyReady(Standby *standby, const NetworkStreamLoader::StreamInfo &streamInfo)
+{
+    // 加载完成前待机已被释放
+    if (standby->index < 0 || streamInfo.url != standby->url) {
+        NetworkStreamLoader::StreamInfo stale = streamInfo;
+        freeStream(stale);
+        return;
+    }
+
+    standby->info = streamInfo;
+    standby->info.prerollPackets.clear();
+    standby->ready = true;
+    {
+        QMutexLocker locker(&standby->mutex);
+        for (AVPacket *packet : streamInfo.prerollPackets) {
+            appendPacketLocked(standby, packet);
+        }
+    }
+
+    // 点播频道不预读，移交后从头播放
+    if (standby->info.duration > 0) {
+        qDebug() << "[ZAP] Channel" << (standby->index + 1) << "ready in" << streamInfo.loadMs << "ms (on demand)";
+        return;
+    }
+
+    standby->abort = false;
+    standby->info.formatContext->interrupt_callback.callback = &ChannelZapper::interruptCallback;
+    standby->info.formatContext->interrupt_callback.opaque = standby;
+    standby->reader = QThread::create([this, standby]() { readLoop(standby); });
+    standby->reader->start();
+    qDebug() << "[ZAP] Channel" << (standby->index + 1) << "on standby after" << streamInfo.loadMs << "ms";
+}
+
+void ChannelZapper::onStandbyFailed(Standby *standby, const QString &error)
+{
+    if (standby->index < 0) {
+        return;
+    }
+    qDebug() << "[ZAP] Channel" << (standby->index + 1) << "standby failed:" << error;
+    standby->failed = true;
+    scheduleRetry(standby);
+}
+
+int ChannelZapper::interruptCallback(void *opaque)
+{
+    return static_cast<Standby*>(opaque)->abort ? 1 : 0;
+}
+
+void ChannelZapper::readLoop(Standby *standby)
+{
+    AVFormatContext *formatContext = standby->info.formatContext;
+    AVPacket *packet = av_packet_alloc();
+
+    while (!standby->abort) {
+        int ret = av_read_frame(formatContext, packet);
+        if (ret == AVERROR(EAGAIN)) {
+            QThread::msleep(10);
+            continue;
+        }
+        if (ret < 0) {
+            // 被释放中断时的返回值不是断开；断开时在主线程重新连接
+            if (!standby->abort) {
+                standby->failed = true;
+                int index = standby->index;
+                QMetaObject::invokeMethod(this, [this, standby, index]() {
+                    if (standby->index == index && standby->failed) {
+                        qDebug() << "[ZAP] Channel" << (index + 1) << "standby disconnected";
+                        scheduleRetry(standby);
+                    }
+                }, Qt::QueuedConnection);
+            }
+            break;
+        }
+
+        AVPacket *stored = av_packet_alloc();
+        av_packet_move_ref(stored, packet);
+        QMutexLocker locker(&standby->mutex);
+        appendPacketLocked(standby, stored);
+    }
+
+    av_packet_free(&packet);
+}
+
+void ChannelZapper::appendPacketLocked(Standby *standby, AVPacket *packet)
+{
+    int videoIndex = standby->info.videoStreamIndex;
+    bool keyframe = packet->stream_index == videoIndex && (packet->flags & AV_PKT_FLAG_KEY);
+
+    // 新的关键帧开始新的GOP，之前的包移交后用不到
+    if (keyframe) {
+        clearGopLocked(standby);
+        standby->haveKeyframe = true;
+    }
+    if (videoIndex >= 0 && !standby->haveKeyframe) {
+        av_packet_free(&packet);
+        return;
+    }
+
+    standby->gop.append(packet);
+    standby->gopBytes += packet->size;
+
+    if (videoIndex < 0) {
+        while (standby->gop.size() > kMaxAudioOnlyPackets) {
+            AVPacket *oldest = standby->gop.takeFirst();
+            standby->gopBytes -= oldest->size;
+            av_packet_free(&oldest);
+        }
+    } else if (standby->gopBytes > kMaxGopBytes) {
+        qDebug() << "[ZAP] GOP over" << (kMaxGopBytes / 1024 / 1024) << "MB, waiting for next keyframe";
+        clearGopLocked(standby);
+        standby->haveKeyframe = false;
+    }
+}
+
+void ChannelZapper::clearGopLocked(Standby *standby)
+{
+    for (AVPacket *packet : standby->gop) {
+        av_packet_free(&packet);
+    }
+    standby->gop.clear();
+    standby->gopBytes = 0;
+}
+
+void ChannelZapper::freeStream(NetworkStreamLoader::StreamInfo &streamInfo)
+{
+    avcodec_free_context(&streamInfo.videoCodecContext);
+    avcodec_free_context(&streamInfo.audioCodecContext);
+    for (AVPacket *packet : streamInfo.prerollPackets) {
+        av_packet_free(&packet);
+    }
+    streamInfo.prerollPackets.clear();
+    av_frame_free(&streamInfo.firstFrame);
+    NetworkStreamLoader::closeInput(&streamInfo.formatContext);
+}
@@ -0,0 +1,72 @@
+#ifndef CHANNELZAPPER_H
+#define CHANNELZAPPER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include "NetworkStreamLoader.h"
+
+// 频道列表换台：当前频道的前后两个频道在后台保持连接（待机），解复用线程持续读取，只保留最近一个GOP
+// 换台时直接移交待机流（已探测、解码器已打开），播放器只需从GOP的关键帧开始解码
+// 待机流各占一路带宽和连接；没有就绪的待机流时由调用方按普通方式连接
+class ChannelZapper : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChannelZapper(QObject *parent = nullptr);
+    ~ChannelZapper();
+
+    // 设置频道列表，释放原有的待机流；当前频道为-1，由 setCurrentIndex 开始待机
+    void setChannels(const QStringList &urls);
+    QStringList channels() const { return m_channels; }
+    int channelCount() const { return m_channels.size(); }
+    QString channelUrl(int index) const;
+    int currentIndex() const { return m_currentIndex; }
+
+    // 待机流加载时的HLS码率控制，对之后开始的待机生效
+    void setQualityControl(bool enabled, int maxBitrateKbps);
+
+    // 相对当前频道偏移 delta 的频道（首尾循环），列表为空时返回-1
+    int neighbourIndex(int delta) const;
+
+    // 取出就绪的待机流，所有权转移给调用方（包括GOP包）；没有就绪时返回false
+    bool takeStandby(int index, NetworkStreamLoader::StreamInfo *streamInfo);
+
+    // 切换当前频道：释放不再相邻的待机流，为新的前后频道开始待机；-1表示不在列表中，释放全部待机
+    void setCurrentIndex(int index);
+
+private:
+    struct Standby;
+
+    void refreshStandbys();
+    void startStandby(Standby *standby, int index);
+    void releaseStandby(Standby *standby);
+    void scheduleRetry(Standby *standby);
+    void onStandbyReady(Standby *standby, const NetworkStreamLoader::StreamInfo &streamInfo);
+    void onStandbyFailed(Standby *standby, const QString &error);
+
+    // 待机读取线程
+    void readLoop(Standby *standby);
+    static void appendPacketLocked(Standby *standby, AVPacket *packet);  // 接管包，维护最近GOP
+    static void clearGopLocked(Standby *standby);
+    static void freeStream(NetworkStreamLoader::StreamInfo &streamInfo);
+    static int interruptCallback(void *opaque);
+
+    QStringList m_channels;
+    int m_currentIndex;
+    bool m_qualityControl;
+    int m_maxBitrateKbps;
+    QVector<Standby*> m_standbys;       // 固定的待机槽（前、后），各自持有加载器
+    QThreadPool m_loaderPool;           // 待机加载器共用，线程空闲后按默认时间回收（析构晚于加载器）
+
+    static const int kStandbyCount = 2;
+    static const int kJobsPerLoad = 2;            // RTSP竞速时一次加载的并行任务数（UDP和TCP各一个）
+    static const int kLoadTimeoutMs = 15000;
+    static const int kRetryDelayMs = 5000;        // 待机连接失败或断开后重试的间隔
+    static const qint64 kMaxGopBytes = 16 * 1024 * 1024;  // 关键帧间隔异常长时丢弃GOP，等待下一个关键帧
+    static const int kMaxAudioOnlyPackets = 100;  // 纯音频频道只保留最近的包
+};
+
+#endif // CHANNELZAPPER_H
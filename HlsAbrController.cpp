@@ -0,0 +1,419 @@
+#include "HlsAbrController.h"
+#include <QMutexLocker>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+extern "C" {
+    #include <libavutil/dict.h>
+    #include <libavutil/log.h>
+    #include <libavutil/mem.h>
+}
+
+namespace {
+    // 分片IO的opaque可能被FFmpeg当作带AVClass的对象查询选项（如HLS更新cookies），
+    // 提供一个没有选项的类，查询直接返回未找到
+    const AVClass *segmentMeterClass()
+    {
+        static const AVClass avClass = [] {
+            AVClass c = {};
+            c.class_name = "HlsSegmentMeter";
+            c.item_name = av_default_item_name;
+            c.version = LIBAVUTIL_VERSION_INT;
+            return c;
+        }();
+        return &avClass;
+    }
+}
+
+struct HlsAbrController::SegmentMeter
+{
+    const AVClass *avClass;          // 必须是第一个成员
+    AVIOContext *inner;              // FFmpeg打开的分片连接
+    HlsAbrController *controller;
+    qint64 bytes;
+    qint64 activeNs;                 // 实际等待网络数据的时间，不含抖动缓冲满时的停顿
+};
+
+HlsAbrController::HlsAbrController(int maxBitrateKbps)
+    : m_formatContext(nullptr)
+    , m_defaultIoOpen(nullptr)
+    , m_defaultIoClose(nullptr)
+    , m_maxBitrateKbps(maxBitrateKbps)
+    , m_current(0)
+    , m_pending(-1)
+    , m_switchSampleCount(0)
+    , m_throughputBps(0.0)
+    , m_sampleCount(0)
+    , m_discardDirty(false)
+{
+}
+
+HlsAbrController::~HlsAbrController()
+{
+}
+
+bool HlsAbrController::isHlsUrl(const QString &url)
+{
+    QUrl parsed(url);
+    QString scheme = parsed.scheme().toLower();
+    return (scheme == "http" || scheme == "https") && parsed.path().endsWith(".m3u8", Qt::CaseInsensitive);
+}
+
+HlsAbrController *HlsAbrController::install(AVFormatContext *formatContext, AVDictionary **options, int maxBitrateKbps)
+{
+    HlsAbrController *controller = new HlsAbrController(maxBitrateKbps);
+    controller->m_formatContext = formatContext;
+    controller->m_defaultIoOpen = formatContext->io_open;
+    controller->m_defaultIoClose = formatContext->io_close2;
+
+    formatContext->opaque = controller;
+    formatContext->io_open = &HlsAbrController::ioOpen;
+    formatContext->io_close2 = &HlsAbrController::ioClose;
+
+    // 持久连接下后续分片复用连接而不经过io_open，无法逐个测量
+    av_dict_set(options, "http_persistent", "0", 0);
+    return controller;
+}
+
+HlsAbrController *HlsAbrController::fromContext(const AVFormatContext *formatContext)
+{
+    if (!formatContext || formatContext->io_open != &HlsAbrController::ioOpen) {
+        return nullptr;
+    }
+    return static_cast<HlsAbrController*>(formatContext->opaque);
+}
+
+int HlsAbrController::ioOpen(AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options)
+{
+    HlsAbrController *self = static_cast<HlsAbrController*>(s->opaque);
+    int ret = self->m_defaultIoOpen(s, pb, url, flags, options);
+
+    // 播放列表很小，只测量分片
+    if (ret < 0 || QUrl(QString::fromUtf8(url)).path().endsWith(".m3u8", Qt::CaseInsensitive)) {
+        return ret;
+    }
+
+    unsigned char *buffer = static_cast<unsigned char*>(av_malloc(kMeterBufferSize));
+    if (!buffer) {
+        return ret;   // 不测量，直接使用原始连接
+    }
+    SegmentMeter *meter = new SegmentMeter{ segmentMeterClass(), *pb, self, 0, 0 };
+    AVIOContext *wrapped = avio_alloc_context(buffer, kMeterBufferSize, 0, meter,
+                                              &HlsAbrController::meterRead, nullptr, &HlsAbrController::meterSeek);
+    if (!wrapped) {
+        av_free(buffer);
+        delete meter;
+        return ret;
+    }
+    wrapped->seekable = (*pb)->seekable;
+    *pb = wrapped;
+    return ret;
+}
+
+int HlsAbrController::ioClose(AVFormatContext *s, AVIOContext *pb)
+{
+    HlsAbrController *self = static_cast<HlsAbrController*>(s->opaque);
+    if (!pb || pb->read_packet != &HlsAbrController::meterRead) {
+        return self->m_defaultIoClose(s, pb);
+    }
+
+    SegmentMeter *meter = static_cast<SegmentMeter*>(pb->opaque);
+    self->recordSegment(meter->bytes, meter->activeNs);
+
+    int ret = self->m_defaultIoClose(s, meter->inner);
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    delete meter;
+    return ret;
+}
+
+int HlsAbrController::meterRead(void *opaque, uint8_t *buf, int bufSize)
+{
+    SegmentMeter *meter = static_cast<SegmentMeter*>(opaque);
+
+    QElapsedTimer timer;
+    timer.start();
+    int ret = avio_read_partial(meter->inner, buf, bufSize);
+    meter->activeNs += timer.nsecsElapsed();
+
+    if (ret > 0) {
+        meter->bytes += ret;
+        return ret;
+    }
+    return (ret == 0) ? AVERROR_EOF : ret;
+}
+
+int64_t HlsAbrController::meterSeek(void *opaque, int64_t offset, int whence)
+{
+    SegmentMeter *meter = static_cast<SegmentMeter*>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return avio_size(meter->inner);
+    }
+    return avio_seek(meter->inner, offset, whence & ~AVSEEK_FORCE);
+}
+
+void HlsAbrController::recordSegment(qint64 bytes, qint64 activeNs)
+{
+    if (bytes < kMinSampleBytes || activeNs < 1000000) {
+        return;
+    }
+
+    double sample = bytes * 8.0 * 1e9 / activeNs;
+
+    QMutexLocker locker(&m_mutex);
+    m_throughputBps = (m_sampleCount == 0) ? sample : m_throughputBps * 0.7 + sample * 0.3;
+    m_sampleCount++;
+
+    qDebug() << "[ABR] Segment" << (bytes / 1024) << "KB in" << (activeNs / 1000000) << "ms,"
+             << static_cast<qint64>(sample / 1000) << "kbps, estimate"
+             << static_cast<qint64>(m_throughputBps / 1000) << "kbps";
+}
+
+int64_t HlsAbrController::maxBitrate() const
+{
+    return (m_maxBitrateKbps > 0) ? static_cast<int64_t>(m_maxBitrateKbps) * 1000
+                                  : std::numeric_limits<int64_t>::max();
+}
+
+void HlsAbrController::prepare(AVFormatContext *formatContext)
+{
+    QVector<Variant> variants;
+    for (unsigned int p = 0; p < formatContext->nb_programs; p++) {
+        AVProgram *program = formatContext->programs[p];
+        AVDictionaryEntry *entry = av_dict_get(program->metadata, "variant_bitrate", nullptr, 0);
+
+        Variant variant = { static_cast<int>(p), entry ? strtoll(entry->value, nullptr, 10) : 0, -1, -1, 0 };
+        for (unsigned int k = 0; k < program->nb_stream_indexes; k++) {
+            int index = program->stream_index[k];
+            const AVCodecParameters *par = formatContext->streams[index]->codecpar;
+            if (par->codec_type == AVMEDIA_TYPE_VIDEO && variant.videoStream < 0) {
+                variant.videoStream = index;
+                variant.height = par->height;
+            } else if (par->codec_type == AVMEDIA_TYPE_AUDIO && variant.audioStream < 0) {
+                variant.audioStream = index;
+            }
+        }
+        if (variant.videoStream >= 0 && variant.bitrate > 0) {
+            variants.append(variant);
+        }
+    }
+
+    std::sort(variants.begin(), variants.end(), [](const Variant &a, const Variant &b) {
+        return a.bitrate < b.bitrate;
+    });
+    if (variants.size() < 2) {
+        return;
+    }
+
+    // 起始档位：上限和起始码率以内的最高档
+    int64_t startBudget = qMin<int64_t>(maxBitrate(), int64_t(kStartupBitrate));
+    int initial = 0;
+    for (int i = 0; i < variants.size(); ++i) {
+        if (variants[i].bitrate <= startBudget) {
+            initial = i;
+        }
+    }
+
+    // 切换时沿用同一个解码器，只保留编码格式与起始档位相同的档位
+    auto codecOf = [formatContext](int index) {
+        return (index >= 0) ? formatContext->streams[index]->codecpar->codec_id : AV_CODEC_ID_NONE;
+    };
+    const Variant start = variants[initial];
+    for (const Variant &variant : variants) {
+        if (codecOf(variant.videoStream) == codecOf(start.videoStream) &&
+            codecOf(variant.audioStream) == codecOf(start.audioStream)) {
+            if (variant.programIndex == start.programIndex) {
+                m_current = m_variants.size();
+            }
+            m_variants.append(variant);
+        }
+    }
+
+    if (!isActive()) {
+        m_variants.clear();
+        return;
+    }
+
+    // 还没有开始读取，在加载线程中直接应用
+    requestDiscard();
+    syncDiscard();
+
+    qDebug() << "[ABR]" << m_variants.size() << "variants, starting at"
+             << (m_variants[m_current].bitrate / 1000) << "kbps, cap"
+             << (m_maxBitrateKbps > 0 ? QString::number(m_maxBitrateKbps) + " kbps" : QString("none"));
+}
+
+void HlsAbrController::requestDiscard()
+{
+    // 当前档位和切换中的目标档位需要下载，其他档位的流全部丢弃
+    // HLS解复用器在打开下一个分片前检查，因此停止下载发生在分片边界
+    const AVFormatContext *formatContext = m_formatContext;
+    QVector<bool> inVariant(formatContext->nb_streams, false);
+    QVector<bool> needed(formatContext->nb_streams, false);
+
+    for (unsigned int p = 0; p < formatContext->nb_programs; p++) {
+        const AVProgram *program = formatContext->programs[p];
+        bool selected = false;
+        for (int i = 0; i < m_variants.size(); ++i) {
+            if (m_variants[i].programIndex == static_cast<int>(p) && (i == m_current || i == m_pending)) {
+                selected = true;
+            }
+        }
+        for (unsigned int k = 0; k < program->nb_stream_indexes; k++) {
+            int index = program->stream_index[k];
+            inVariant[index] = true;
+            needed[index] = needed[index] || selected;
+        }
+    }
+
+    QVector<int> wanted(formatContext->nb_streams, -1);
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        if (inVariant[i]) {
+            wanted[i] = needed[i] ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_wantedDiscard = wanted;
+    m_discardDirty = true;
+}
+
+void HlsAbrController::syncDiscard()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_discardDirty) {
+        return;
+    }
+    m_discardDirty = false;
+
+    int count = qMin(m_wantedDiscard.size(), static_cast<int>(m_formatContext->nb_streams));
+    for (int i = 0; i < count; i++) {
+        if (m_wantedDiscard[i] >= 0) {
+            m_formatContext->streams[i]->discard = static_cast<AVDiscard>(m_wantedDiscard[i]);
+        }
+    }
+}
+
+int HlsAbrController::currentVideoStream() const
+{
+    return isActive() ? m_variants[m_current].videoStream : -1;
+}
+
+int HlsAbrController::currentAudioStream() const
+{
+    return isActive() ? m_variants[m_current].audioStream : -1;
+}
+
+int HlsAbrController::pendingVideoStream() const
+{
+    return (m_pending >= 0) ? m_variants[m_pending].videoStream : -1;
+}
+
+int HlsAbrController::pendingAudioStream() const
+{
+    return (m_pending >= 0) ? m_variants[m_pending].audioStream : -1;
+}
+
+bool HlsAbrController::evaluate(int64_t bufferedUs, int64_t bufferTargetUs)
+{
+    if (!isActive()) {
+        return false;
+    }
+
+    if (m_pending >= 0) {
+        if (m_pendingTimer.elapsed() > kPendingTimeoutMs) {
+            qDebug() << "[ABR] No keyframe from" << (m_variants[m_pending].bitrate / 1000) << "kbps variant, switch abandoned";
+            m_pending = -1;
+            requestDiscard();
+        }
+        return false;
+    }
+
+    double throughput;
+    int sampleCount;
+    {
+        QMutexLocker locker(&m_mutex);
+        throughput = m_throughputBps;
+        sampleCount = m_sampleCount;
+    }
+    if (sampleCount == 0) {
+        return false;
+    }
+
+    // 缓冲不足时只按吞吐量的一半选择，尽快降档避免卡顿
+    bool bufferLow = bufferedUs < bufferTargetUs / 4;
+    double safety = bufferLow ? 0.5 : 0.8;
+    int64_t budget = qMin(maxBitrate(), static_cast<int64_t>(throughput * safety));
+
+    int candidate = 0;
+    for (int i = 0; i < m_variants.size(); ++i) {
+        if (m_variants[i].bitrate <= budget) {
+            candidate = i;
+        }
+    }
+
+    if (candidate > m_current) {
+        // 升档：缓冲充足且切换后有新的测量，每次只升一档
+        if (bufferedUs < bufferTargetUs / 2 || sampleCount - m_switchSampleCount < 2) {
+            return false;
+        }
+        candidate = m_current + 1;
+    } else if (candidate == m_current) {
+        return false;
+    }
+
+    qDebug() << "[ABR] Switching" << (m_variants[m_current].bitrate / 1000) << "->"
+             << (m_variants[candidate].bitrate / 1000) << "kbps, throughput"
+             << static_cast<qint64>(throughput / 1000) << "kbps, buffer" << (bufferedUs / 1000) << "ms";
+
+    m_pending = candidate;
+    m_pendingTimer.start();
+    requestDiscard();
+    return true;
+}
+
+void HlsAbrController::commitSwitch()
+{
+    if (m_pending < 0) {
+        return;
+    }
+
+    m_current = m_pending;
+    m_pending = -1;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_switchSampleCount = m_sampleCount;
+    }
+    requestDiscard();
+
+    qDebug() << "[ABR] Now playing" << (m_variants[m_current].bitrate / 1000) << "kbps variant";
+}
+
+QString HlsAbrController::description() const
+{
+    if (!isActive()) {
+        return QString();
+    }
+
+    const Variant &variant = m_variants[m_current];
+    double throughput;
+    {
+        QMutexLocker locker(&m_mutex);
+        throughput = m_throughputBps;
+    }
+
+    QString text = QString("%1 Mbps (%2/%3)")
+        .arg(variant.bitrate / 1e6, 0, 'f', 1)
+        .arg(m_current + 1)
+        .arg(m_variants.size());
+    if (variant.height > 0) {
+        text.prepend(QString("%1p ").arg(variant.height));
+    }
+    if (throughput > 0) {
+        text += QString("，吞吐 %1 Mbps").arg(throughput / 1e6, 0, 'f', 1);
+    }
+    return text;
+}
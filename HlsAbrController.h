@@ -0,0 +1,94 @@
+#ifndef HLSABRCONTROLLER_H
+#define HLSABRCONTROLLER_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+// HLS自适应码率：按实测分片下载吞吐量和抖动缓冲水位选择码率档位
+// FFmpeg的HLS解复用器为每个档位建立一个AVProgram，只下载有未丢弃流的播放列表，
+// 并在打开下一个分片前重新检查，因此切换档位即在分片边界切换丢弃标志
+class HlsAbrController
+{
+public:
+    ~HlsAbrController();
+
+    static bool isHlsUrl(const QString &url);
+
+    // avformat_open_input 之前安装：接管分片IO以测量下载吞吐量，maxBitrateKbps为码率上限
+    static HlsAbrController *install(AVFormatContext *formatContext, AVDictionary **options, int maxBitrateKbps);
+    static HlsAbrController *fromContext(const AVFormatContext *formatContext);
+
+    // 打开后读取档位列表并只保留起始档位，档位少于2个时不生效
+    void prepare(AVFormatContext *formatContext);
+    bool isActive() const { return m_variants.size() >= 2; }
+
+    int currentVideoStream() const;
+    int currentAudioStream() const;
+
+    // 主线程周期调用：决定是否切换，需要切换时启用新档位并返回true
+    bool evaluate(int64_t bufferedUs, int64_t bufferTargetUs);
+    bool hasPendingSwitch() const { return m_pending >= 0; }
+    int pendingVideoStream() const;
+    int pendingAudioStream() const;
+    // 新档位的第一个关键帧已到达：切换完成，旧档位在下一个分片边界停止下载
+    void commitSwitch();
+
+    // 解复用线程在两次 av_read_frame 之间调用：应用主线程切换档位时请求的丢弃标志
+    // （AVStream::discard 由读取中的解复用器访问，不能在主线程直接修改）
+    void syncDiscard();
+
+    QString description() const;   // 当前档位与吞吐量（信息面板）
+
+private:
+    struct Variant {
+        int programIndex;
+        int64_t bitrate;     // 播放列表声明的码率(bps)
+        int videoStream;
+        int audioStream;
+        int height;
+    };
+
+    struct SegmentMeter;
+
+    explicit HlsAbrController(int maxBitrateKbps);
+
+    static int ioOpen(AVFormatContext *s, AVIOContext **pb, const char *url, int flags, AVDictionary **options);
+    static int ioClose(AVFormatContext *s, AVIOContext *pb);
+    static int meterRead(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t meterSeek(void *opaque, int64_t offset, int whence);
+
+    void recordSegment(qint64 bytes, qint64 activeNs);
+    void requestDiscard();   // 按当前和目标档位计算各流的丢弃标志，由 syncDiscard 应用
+    int64_t maxBitrate() const;
+
+    AVFormatContext *m_formatContext;
+    int (*m_defaultIoOpen)(AVFormatContext *, AVIOContext **, const char *, int, AVDictionary **);
+    int (*m_defaultIoClose)(AVFormatContext *, AVIOContext *);
+
+    int m_maxBitrateKbps;
+    QVector<Variant> m_variants;     // 按码率从低到高
+    int m_current;
+    int m_pending;                   // 等待关键帧的目标档位，-1表示没有
+    QElapsedTimer m_pendingTimer;
+    int m_switchSampleCount;         // 上次切换时的测量次数，升档前需要新的测量
+
+    // 分片在解复用线程中下载，吞吐量和待应用的丢弃标志由两个线程访问
+    mutable QMutex m_mutex;
+    double m_throughputBps;          // 分片下载吞吐量(bps, 指数平滑)
+    int m_sampleCount;
+    QVector<int> m_wantedDiscard;    // 各流的丢弃标志，-1表示不属于任何档位，不修改
+    bool m_discardDirty;
+
+    static const int64_t kStartupBitrate = 1500000;   // 没有测量值时的起始档位上限
+    static const int kPendingTimeoutMs = 10000;       // 新档位迟迟没有关键帧时放弃切换
+    static const int kMeterBufferSize = 32 * 1024;
+    static const int kMinSampleBytes = 16 * 1024;     // 太小的分片测不准吞吐量
+};
+
+#endif // HLSABRCONTROLLER_H
@@ -0,0 +1,476 @@
+#include "HttpRangeCache.h"
+#include "HttpValidator.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+#include <memory>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/mem.h>
+}
+
+namespace {
+    const int kMapVersion = 2;
+}
+
+QMutex HttpRangeCache::s_activeMutex;
+QSet<QString> HttpRangeCache::s_activeUrls;
+
+HttpRangeCache::HttpRangeCache(const QString &url, AVFormatContext *formatContext, qint64 maxBytes)
+    : m_url(url)
+    , m_formatContext(formatContext)
+    , m_source(nullptr)
+    , m_ioContext(nullptr)
+    , m_maxBytes(maxBytes)
+    , m_size(0)
+    , m_position(0)
+    , m_sourcePosition(0)
+    , m_slotCount(0)
+    , m_useCounter(0)
+    , m_otherBytes(0)
+    , m_hitBytes(0)
+    , m_fetchedBytes(0)
+{
+}
+
+HttpRangeCache::~HttpRangeCache()
+{
+    if (m_dataFile.isOpen()) {
+        qDebug() << "[HTTPCACHE] Closing" << QUrl(m_url).fileName() << "- served"
+                 << (m_hitBytes / 1024) << "KB from disk, fetched" << (m_fetchedBytes / 1024) << "KB,"
+                 << rangeSummary();
+        saveRangeMap();
+        m_dataFile.close();
+    }
+
+    if (m_ioContext) {
+        av_freep(&m_ioContext->buffer);
+        avio_context_free(&m_ioContext);
+    }
+    // 连接关闭时不再有格式上下文，中断回调不转发
+    m_formatContext = nullptr;
+    avio_closep(&m_source);
+
+    QMutexLocker locker(&s_activeMutex);
+    s_activeUrls.remove(m_url);
+}
+
+bool HttpRangeCache::isCacheable(const QString &url, const LatencyProfile &profile)
+{
+    if (profile.isLowLatency()) {
+        return false;
+    }
+
+    QUrl parsed(url);
+    QString scheme = parsed.scheme().toLower();
+    if (scheme != "http" && scheme != "https") {
+        return false;
+    }
+    return !parsed.path().endsWith(".m3u8", Qt::CaseInsensitive);
+}
+
+HttpRangeCache *HttpRangeCache::open(const QString &url, AVFormatContext *formatContext,
+                                     const AVDictionary *options, qint64 maxBytes, HttpValidator *validator)
+{
+    {
+        // 被取消的任务可能仍在读取同一URL，让新任务直接走网络
+        QMutexLocker locker(&s_activeMutex);
+        if (s_activeUrls.contains(url)) {
+            qDebug() << "[HTTPCACHE] Cache busy, opening without cache";
+            return nullptr;
+        }
+        s_activeUrls.insert(url);
+    }
+
+    std::unique_ptr<HttpRangeCache> cache(new HttpRangeCache(url, formatContext, maxBytes));
+
+    // HTTP连接使用与普通打开相同的参数（超时、UA、重连），seek时由HTTP协议发起Range请求
+    AVDictionary *ioOptions = nullptr;
+    av_dict_copy(&ioOptions, options, 0);
+    AVIOInterruptCB interrupt = { &HttpRangeCache::interruptCallback, cache.get() };
+    int ret = avio_open2(&cache->m_source, url.toUtf8().constData(), AVIO_FLAG_READ, &interrupt, &ioOptions);
+    av_dict_free(&ioOptions);
+    if (ret < 0) {
+        return nullptr;
+    }
+
+    cache->m_size = avio_size(cache->m_source);
+    if (cache->m_size <= 0 || !(cache->m_source->seekable & AVIO_SEEKABLE_NORMAL)) {
+        qDebug() << "[HTTPCACHE] Source has no length or cannot seek, not caching";
+        return nullptr;
+    }
+
+    if (!cache->openStorage(validator)) {
+        return nullptr;
+    }
+
+    unsigned char *buffer = static_cast<unsigned char*>(av_malloc(kIoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    cache->m_ioContext = avio_alloc_context(buffer, kIoBufferSize, 0, cache.get(),
+                                            &HttpRangeCache::readPacket, nullptr, &HttpRangeCache::seekPacket);
+    if (!cache->m_ioContext) {
+        av_free(buffer);
+        return nullptr;
+    }
+
+    formatContext->pb = cache->m_ioContext;
+    qDebug() << "[HTTPCACHE] Opened" << QUrl(url).fileName() << "size" << (cache->m_size / 1024) << "KB,"
+             << cache->rangeSummary();
+    return cache.release();
+}
+
+HttpRangeCache *HttpRangeCache::fromContext(const AVFormatContext *formatContext)
+{
+    const AVIOContext *pb = formatContext ? formatContext->pb : nullptr;
+    if (!pb || pb->read_packet != &HttpRangeCache::readPacket) {
+        return nullptr;
+    }
+    return static_cast<HttpRangeCache*>(pb->opaque);
+}
+
+int HttpRangeCache::interruptCallback(void *opaque)
+{
+    // 跟随格式上下文当前的中断回调：加载期间是加载任务，播放期间是抖动缓冲
+    AVFormatContext *formatContext = static_cast<HttpRangeCache*>(opaque)->m_formatContext;
+    if (!formatContext || !formatContext->interrupt_callback.callback) {
+        return 0;
+    }
+    return formatContext->interrupt_callback.callback(formatContext->interrupt_callback.opaque);
+}
+
+int HttpRangeCache::readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    return static_cast<HttpRangeCache*>(opaque)->read(buf, bufSize);
+}
+
+int64_t HttpRangeCache::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    return static_cast<HttpRangeCache*>(opaque)->seek(offset, whence);
+}
+
+int HttpRangeCache::read(uint8_t *buf, int bufSize)
+{
+    if (m_position >= m_size) {
+        return AVERROR_EOF;
+    }
+
+    qint64 block = m_position / kBlockSize;
+    bool cached = m_blockSlots.contains(block);
+    int slot = ensureBlock(block);
+    if (slot < 0) {
+        return slot;
+    }
+
+    qint64 offset = m_position - block * kBlockSize;
+    qint64 length = qMin<qint64>(bufSize, blockLength(block) - offset);
+    if (!m_dataFile.seek(static_cast<qint64>(slot) * kBlockSize + offset)) {
+        return AVERROR(EIO);
+    }
+    qint64 bytesRead = m_dataFile.read(reinterpret_cast<char*>(buf), length);
+    if (bytesRead <= 0) {
+        return AVERROR(EIO);
+    }
+
+    if (cached) {
+        m_hitBytes += bytesRead;
+    }
+    m_position += bytesRead;
+    return static_cast<int>(bytesRead);
+}
+
+int64_t HttpRangeCache::seek(int64_t offset, int whence)
+{
+    if (whence & AVSEEK_SIZE) {
+        return m_size;
+    }
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = m_position + offset; break;
+        case SEEK_END: target = m_size + offset; break;
+        default: return AVERROR(EINVAL);
+    }
+    if (target < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    // 只移动读位置，读取时未命中才发起Range请求
+    m_position = target;
+    return target;
+}
+
+qint64 HttpRangeCache::blockLength(qint64 block) const
+{
+    return qMin<qint64>(kBlockSize, m_size - block * kBlockSize);
+}
+
+int HttpRangeCache::ensureBlock(qint64 block)
+{
+    auto it = m_blockSlots.constFind(block);
+    if (it != m_blockSlots.constEnd()) {
+        m_slotLastUse[it.value()] = ++m_useCounter;
+        return it.value();
+    }
+
+    // 顺序播放时HTTP连接已在块起点，不需要重新请求
+    qint64 start = block * kBlockSize;
+    if (m_sourcePosition != start) {
+        int64_t ret = avio_seek(m_source, start, SEEK_SET);
+        if (ret < 0) {
+            m_sourcePosition = -1;
+            return static_cast<int>(ret);
+        }
+        m_sourcePosition = start;
+    }
+
+    qint64 length = blockLength(block);
+    QByteArray data(static_cast<int>(length), Qt::Uninitialized);
+    qint64 filled = 0;
+    while (filled < length) {
+        int ret = avio_read(m_source, reinterpret_cast<unsigned char*>(data.data()) + filled,
+                            static_cast<int>(length - filled));
+        if (ret <= 0) {
+            m_sourcePosition = -1;
+            return (ret < 0) ? ret : AVERROR_EOF;
+        }
+        filled += ret;
+    }
+    m_sourcePosition += filled;
+    m_fetchedBytes += filled;
+
+    int slot = allocateSlot();
+    if (!m_dataFile.seek(static_cast<qint64>(slot) * kBlockSize) || m_dataFile.write(data) != length) {
+        qDebug() << "[HTTPCACHE] Cannot write cache file:" << m_dataFile.errorString();
+        return AVERROR(EIO);
+    }
+
+    m_blockSlots.insert(block, slot);
+    m_slotBlocks[slot] = block;
+    m_slotLastUse[slot] = ++m_useCounter;
+    return slot;
+}
+
+int HttpRangeCache::allocateSlot()
+{
+    // 优先用空闲槽位，满后淘汰最久未读的块
+    int victim = 0;
+    for (int slot = 0; slot < m_slotCount; ++slot) {
+        if (m_slotBlocks[slot] < 0) {
+            reserveSpace(qMax(m_dataFile.size(), static_cast<qint64>(slot + 1) * kBlockSize));
+            return slot;
+        }
+        if (m_slotLastUse[slot] < m_slotLastUse[victim]) {
+            victim = slot;
+        }
+    }
+
+    m_blockSlots.remove(m_slotBlocks[victim]);
+    m_slotBlocks[victim] = -1;
+    return victim;
+}
+
+QString HttpRangeCache::cacheDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/http";
+}
+
+QString HttpRangeCache::baseNameFor(const QString &url)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+bool HttpRangeCache::openStorage(HttpValidator *validator)
+{
+    QString dirPath = cacheDir();
+    if (!QDir().mkpath(dirPath)) {
+        qDebug() << "[HTTPCACHE] Cannot create cache directory:" << dirPath;
+        return false;
+    }
+
+    QString baseName = baseNameFor(m_url);
+    scanOtherEntries(dirPath, baseName);
+
+    m_slotCount = static_cast<int>(qMax<qint64>(kMinSlots, m_maxBytes / kBlockSize));
+    m_slotBlocks.fill(-1, m_slotCount);
+    m_slotLastUse.fill(0, m_slotCount);
+
+    m_dataFile.setFileName(dirPath + "/" + baseName + ".data");
+    m_mapPath = dirPath + "/" + baseName + ".json";
+    loadRangeMap(validator);
+
+    if (!m_dataFile.open(QIODevice::ReadWrite)) {
+        qDebug() << "[HTTPCACHE] Cannot open cache file:" << m_dataFile.errorString();
+        return false;
+    }
+
+    // 上限调小后截掉多出的槽位
+    qint64 capacity = static_cast<qint64>(m_slotCount) * kBlockSize;
+    if (m_blockSlots.isEmpty()) {
+        m_dataFile.resize(0);
+    } else if (m_dataFile.size() > capacity) {
+        m_dataFile.resize(capacity);
+    }
+    reserveSpace(m_dataFile.size());
+    return true;
+}
+
+void HttpRangeCache::scanOtherEntries(const QString &dirPath, const QString &baseName)
+{
+    // 表文件在关闭时写入，数据文件在下载时写入，较新的修改时间即最近使用时间
+    struct Entry {
+        QString path;
+        qint64 bytes = 0;
+        QDateTime lastUse;
+    };
+    QHash<QString, Entry> entries;
+
+    QDir dir(dirPath);
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.data" << "*.json", QDir::Files);
+    for (const QFileInfo &file : files) {
+        QString name = file.completeBaseName();
+        if (name == baseName) {
+            continue;
+        }
+        Entry &entry = entries[name];
+        entry.path = dir.filePath(name);
+        if (file.suffix() == "data") {
+            entry.bytes = file.size();
+        }
+        if (!entry.lastUse.isValid() || file.lastModified() > entry.lastUse) {
+            entry.lastUse = file.lastModified();
+        }
+    }
+
+    QList<Entry> sorted = entries.values();
+    std::sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) { return a.lastUse < b.lastUse; });
+
+    m_otherEntries.clear();
+    m_otherBytes = 0;
+    for (const Entry &entry : sorted) {
+        m_otherEntries.append(qMakePair(entry.path, entry.bytes));
+        m_otherBytes += entry.bytes;
+    }
+}
+
+void HttpRangeCache::reserveSpace(qint64 fileBytes)
+{
+    if (m_otherEntries.isEmpty() || m_otherBytes + fileBytes <= m_maxBytes) {
+        return;
+    }
+
+    // 仍在使用的缓存（另一个加载任务或待机频道）不删除
+    QSet<QString> activeNames;
+    {
+        QMutexLocker locker(&s_activeMutex);
+        for (const QString &url : s_activeUrls) {
+            activeNames.insert(baseNameFor(url));
+        }
+    }
+
+    for (int i = 0; i < m_otherEntries.size() && m_otherBytes + fileBytes > m_maxBytes; ) {
+        const QString path = m_otherEntries.at(i).first;
+        if (activeNames.contains(QFileInfo(path).fileName())) {
+            ++i;
+            continue;
+        }
+        QFile::remove(path + ".json");
+        QFile::remove(path + ".data");
+        qDebug() << "[HTTPCACHE] Evicted least recently used entry," << (m_otherEntries.at(i).second / 1024) << "KB";
+        m_otherBytes -= m_otherEntries.at(i).second;
+        m_otherEntries.removeAt(i);
+    }
+}
+
+void HttpRangeCache::loadRangeMap(HttpValidator *validator)
+{
+    // 没有上次的块表时不请求版本标识，以占位值保存，下次打开时不会沿用这些块
+    m_validator = HttpValidator::unverified();
+
+    QFile mapFile(m_mapPath);
+    if (!mapFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonObject root = QJsonDocument::fromJson(mapFile.readAll()).object();
+    mapFile.close();
+
+    // 播放中槽位会被覆盖：读取后删除，正常关闭时再写回，异常退出后不会使用过期的表
+    QFile::remove(m_mapPath);
+
+    if (root.value("version").toInt() != kMapVersion ||
+        root.value("url").toString() != m_url ||
+        root.value("size").toVariant().toLongLong() != m_size ||
+        root.value("blockSize").toInt() != kBlockSize) {
+        return;
+    }
+
+    // 长度相同的内容也可能已经替换，版本标识变化说明服务器上的文件已更新
+    m_validator = validator ? validator->value() : QString();
+    if (root.value("validator").toString() != m_validator) {
+        return;
+    }
+
+    const QJsonArray blocks = root.value("blocks").toArray();
+    for (const QJsonValue &value : blocks) {
+        QJsonArray pair = value.toArray();
+        qint64 block = pair[0].toVariant().toLongLong();
+        int slot = pair[1].toInt(-1);
+        if (slot < 0 || slot >= m_slotCount || block < 0 || block * kBlockSize >= m_size ||
+            m_slotBlocks[slot] >= 0) {
+            continue;
+        }
+        m_blockSlots.insert(block, slot);
+        m_slotBlocks[slot] = block;
+    }
+}
+
+void HttpRangeCache::saveRangeMap() const
+{
+    QJsonArray blocks;
+    for (auto it = m_blockSlots.constBegin(); it != m_blockSlots.constEnd(); ++it) {
+        blocks.append(QJsonArray{ static_cast<qint64>(it.key()), it.value() });
+    }
+
+    QJsonObject root;
+    root["version"] = kMapVersion;
+    root["url"] = m_url;
+    root["validator"] = m_validator;
+    root["size"] = static_cast<qint64>(m_size);
+    root["blockSize"] = kBlockSize;
+    root["blocks"] = blocks;
+
+    QSaveFile file(m_mapPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
+
+QString HttpRangeCache::rangeSummary() const
+{
+    // 相邻的块合并为连续范围
+    QList<qint64> blocks = m_blockSlots.keys();
+    std::sort(blocks.begin(), blocks.end());
+
+    int ranges = 0;
+    for (int i = 0; i < blocks.size(); ++i) {
+        if (i == 0 || blocks[i] != blocks[i - 1] + 1) {
+            ranges++;
+        }
+    }
+    return QString("%1 cached ranges (%2 MB)").arg(ranges).arg(static_cast<qint64>(blocks.size()) * kBlockSize / (1024 * 1024));
+}
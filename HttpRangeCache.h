@@ -0,0 +1,100 @@
+#ifndef HTTPRANGECACHE_H
+#define HTTPRANGECACHE_H
+
+#include <QString>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QSet>
+#include <QMutex>
+#include "LatencyProfile.h"
+
+struct AVFormatContext;
+struct AVIOContext;
+struct AVDictionary;
+class HttpValidator;
+
+// HTTP点播字节范围缓存：自定义AVIOContext，按块从HTTP连接取数据并写入磁盘缓存文件
+// 缓存文件按固定大小的槽位存放数据块，块号->槽位表记录已下载的范围；
+// seek只移动读位置，已下载区域直接从磁盘读取，未命中时才让HTTP连接发起Range请求
+// 所有URL的缓存文件共用 NetworkConfig::httpCacheBytes 的磁盘预算：当前文件增长时先删除其他URL中最久未用的缓存，
+// 仍然不够时淘汰当前文件中最久未读的块；上次缓存的ETag(或Last-Modified)与服务器不一致时作废
+class HttpRangeCache
+{
+public:
+    ~HttpRangeCache();
+
+    // 只缓存HTTP(S)点播：HLS播放列表由分片自行打开，低延迟实时源不缓存
+    static bool isCacheable(const QString &url, const LatencyProfile &profile);
+
+    // 打开HTTP连接并关联磁盘缓存，成功时把自定义IO设置到 formatContext->pb
+    // 直播（无长度或不可seek）或同一URL已有缓存在使用时返回nullptr，调用方按普通方式打开
+    // validator 与探测缓存共用，只在有上次的块表需要校验时才请求
+    static HttpRangeCache *open(const QString &url, AVFormatContext *formatContext,
+                                const AVDictionary *options, qint64 maxBytes, HttpValidator *validator);
+
+    // 格式上下文使用的缓存；自定义IO不会被 avformat_close_input 关闭，由 NetworkStreamLoader::closeInput 释放
+    static HttpRangeCache *fromContext(const AVFormatContext *formatContext);
+
+    // 格式上下文已释放（如 avformat_open_input 失败）后调用，不再转发其中断回调
+    void detach() { m_formatContext = nullptr; }
+
+private:
+    HttpRangeCache(const QString &url, AVFormatContext *formatContext, qint64 maxBytes);
+
+    static int readPacket(void *opaque, uint8_t *buf, int bufSize);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+    static int interruptCallback(void *opaque);
+
+    int read(uint8_t *buf, int bufSize);
+    int64_t seek(int64_t offset, int whence);
+    int ensureBlock(qint64 block);   // 返回槽位，失败返回FFmpeg错误码
+    int allocateSlot();
+    qint64 blockLength(qint64 block) const;
+
+    bool openStorage(HttpValidator *validator);
+    void loadRangeMap(HttpValidator *validator);
+    void saveRangeMap() const;
+    void scanOtherEntries(const QString &dirPath, const QString &baseName);
+    void reserveSpace(qint64 fileBytes);  // 当前文件增长到 fileBytes 前，按最近使用时间淘汰其他URL的缓存
+    QString rangeSummary() const;
+
+    static QString cacheDir();
+    static QString baseNameFor(const QString &url);
+
+    QString m_url;
+    AVFormatContext *m_formatContext;  // 转发其中断回调（加载任务或抖动缓冲设置）
+    AVIOContext *m_source;             // FFmpeg HTTP连接
+    AVIOContext *m_ioContext;          // 交给解复用器的自定义IO
+    qint64 m_maxBytes;
+
+    QFile m_dataFile;
+    QString m_mapPath;
+    QString m_validator;               // ETag或Last-Modified，服务器都不提供时为空（只比较长度），未请求时为占位值
+    int64_t m_size;
+    int64_t m_position;                // 解复用器的读位置
+    int64_t m_sourcePosition;          // HTTP连接的读位置，-1表示未知
+
+    // 同一时刻只有一个线程读取（加载线程、抖动缓冲线程或seek时的播放线程），不需要加锁
+    int m_slotCount;
+    QHash<qint64, int> m_blockSlots;   // 块号 -> 槽位
+    QVector<qint64> m_slotBlocks;      // 槽位 -> 块号，-1表示空闲
+    QVector<quint64> m_slotLastUse;    // 最近读取序号，用于淘汰
+    quint64 m_useCounter;
+
+    // 其他URL的缓存（不含扩展名的路径，数据字节数），最久未用的在前
+    QList<QPair<QString, qint64>> m_otherEntries;
+    qint64 m_otherBytes;
+
+    qint64 m_hitBytes;                 // 从磁盘读取的字节数
+    qint64 m_fetchedBytes;             // 从网络下载的字节数
+
+    static QMutex s_activeMutex;
+    static QSet<QString> s_activeUrls;   // 正在使用缓存的URL，避免两个任务同时写同一个文件
+
+    static const int kBlockSize = 256 * 1024;
+    static const int kIoBufferSize = 64 * 1024;
+    static const int kMinSlots = 8;
+};
+
+#endif // HTTPRANGECACHE_H
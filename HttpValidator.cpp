@@ -0,0 +1,110 @@
+#include "HttpValidator.h"
+#include <QUrl>
+#include <QTimer>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QScopedPointer>
+#include <QDebug>
+
+extern "C" {
+    #include <libavformat/avio.h>
+    #include <libavutil/dict.h>
+}
+
+HttpValidator::HttpValidator(const QString &url, const AVDictionary *options, const AVIOInterruptCB *interrupt,
+                             int timeoutMs)
+    : m_url(url)
+    , m_interruptCallback(interrupt ? interrupt->callback : nullptr)
+    , m_interruptOpaque(interrupt ? interrupt->opaque : nullptr)
+    , m_timeoutMs(timeoutMs)
+    , m_fetched(false)
+{
+    // 打开参数在打开后即释放，先复制要转发的请求头
+    AVDictionaryEntry *entry = av_dict_get(options, "user_agent", nullptr, 0);
+    if (entry) {
+        m_userAgent = entry->value;
+    }
+    entry = av_dict_get(options, "headers", nullptr, 0);
+    if (entry) {
+        m_headers = entry->value;
+    }
+}
+
+QString HttpValidator::value()
+{
+    if (!m_fetched) {
+        m_value = fetch();
+        m_fetched = true;
+    }
+    return m_value;
+}
+
+bool HttpValidator::interrupted() const
+{
+    return m_interruptCallback && m_interruptCallback(m_interruptOpaque);
+}
+
+QString HttpValidator::fetch() const
+{
+    QUrl target(m_url);
+    QString scheme = target.scheme().toLower();
+    if (scheme != "http" && scheme != "https") {
+        return QString();
+    }
+    if (interrupted()) {
+        return QString();
+    }
+
+    // 与FFmpeg的HTTP连接使用相同的UA和附加请求头，否则部分服务器返回的是另一份内容
+    QNetworkRequest request(target);
+    request.setTransferTimeout(m_timeoutMs);
+    if (!m_userAgent.isEmpty()) {
+        request.setHeader(QNetworkRequest::UserAgentHeader, QString::fromUtf8(m_userAgent));
+    }
+    const QList<QByteArray> lines = m_headers.split('\n');
+    for (const QByteArray &line : lines) {
+        int colon = line.indexOf(':');
+        if (colon > 0) {
+            request.setRawHeader(line.left(colon).trimmed(), line.mid(colon + 1).trimmed());
+        }
+    }
+
+    // 加载任务在线程池线程中运行，没有事件循环，用局部事件循环等待应答
+    QNetworkAccessManager manager;
+    QScopedPointer<QNetworkReply> reply(manager.head(request));
+
+    QEventLoop loop;
+    QObject::connect(reply.data(), &QNetworkReply::finished, &loop, &QEventLoop::quit);
+
+    // 加载任务取消或超过截止时间时中止请求，不等到传输超时
+    QTimer interruptTimer;
+    QObject::connect(&interruptTimer, &QTimer::timeout, &loop, [this, &reply]() {
+        if (interrupted()) {
+            reply->abort();
+        }
+    });
+    interruptTimer.start(kInterruptPollMs);
+
+    if (!reply->isFinished()) {
+        loop.exec();
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        if (interrupted()) {
+            qDebug() << "[HTTPCACHE] Validator request aborted";
+        }
+        return QString();
+    }
+
+    QByteArray etag = reply->rawHeader("ETag");
+    if (!etag.isEmpty()) {
+        return "etag:" + QString::fromLatin1(etag);
+    }
+    QByteArray lastModified = reply->rawHeader("Last-Modified");
+    if (!lastModified.isEmpty()) {
+        return "modified:" + QString::fromLatin1(lastModified);
+    }
+    return QString();
+}
@@ -0,0 +1,45 @@
+#ifndef HTTPVALIDATOR_H
+#define HTTPVALIDATOR_H
+
+#include <QString>
+#include <QByteArray>
+
+struct AVDictionary;
+struct AVIOInterruptCB;
+
+// HTTP资源的版本标识（ETag，没有时用 Last-Modified），用于判断磁盘缓存是否已过期
+// FFmpeg的HTTP连接不公开响应头，这里单独发一个HEAD请求，在调用线程中同步等待
+// 每次打开创建一个，探测缓存和字节范围缓存共用同一结果；只有存在待校验的缓存时才会请求
+class HttpValidator
+{
+public:
+    // options 中的 user_agent、headers 随请求发送；interrupt 返回非0时中止请求（加载任务取消或超过截止时间）
+    HttpValidator(const QString &url, const AVDictionary *options, const AVIOInterruptCB *interrupt,
+                  int timeoutMs = kDefaultTimeoutMs);
+
+    // 首次调用时请求，之后返回同一结果
+    // 非HTTP(S)地址、请求失败或被中止、服务器两者都不提供时返回空
+    QString value();
+
+    // 没有请求过版本标识时写入缓存的占位值，与任何请求结果都不相同，下次打开时必然视为过期
+    static QString unverified() { return QStringLiteral("unverified"); }
+
+    static const int kDefaultTimeoutMs = 3000;
+
+private:
+    QString fetch() const;
+    bool interrupted() const;
+
+    QString m_url;
+    QByteArray m_userAgent;
+    QByteArray m_headers;                 // FFmpeg的 headers 选项，多行以CRLF分隔
+    int (*m_interruptCallback)(void *);
+    void *m_interruptOpaque;
+    int m_timeoutMs;
+    bool m_fetched;
+    QString m_value;
+
+    static const int kInterruptPollMs = 50;
+};
+
+#endif // HTTPVALIDATOR_H
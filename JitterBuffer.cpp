@@ -0,0 +1,332 @@
+#include "JitterBuffer.h"
+#include "TimeshiftBuffer.h"
+#include "HlsAbrController.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+JitterBuffer::JitterBuffer()
+    : m_formatContext(nullptr)
+    , m_recorder(nullptr)
+    , m_thread(nullptr)
+    , m_abort(false)
+    , m_bytes(0)
+    , m_buffering(true)
+    , m_primed(false)
+    , m_recordOnly(false)
+    , m_readResult(0)
+    , m_rebufferCount(0)
+    , m_targetUs(2000000)
+    , m_lowWatermarkUs(400000)
+    , m_highWatermarkUs(1600000)
+    , m_capacityUs(0)
+    , m_maxBytes(10 * 1024 * 1024)
+{
+}
+
+JitterBuffer::~JitterBuffer()
+{
+    stop();
+}
+
+void JitterBuffer::configure(int targetMs, int lowThresholdPercent, int highThresholdPercent, qint64 maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_targetUs = static_cast<int64_t>(qMax(targetMs, 1)) * 1000;
+    m_lowWatermarkUs = m_targetUs * qBound(0, lowThresholdPercent, 100) / 100;
+    m_highWatermarkUs = m_targetUs * qBound(0, highThresholdPercent, 100) / 100;
+    m_maxBytes = maxBytes;
+    m_rebufferCount = 0;
+
+    qDebug() << "[BUFFER] Jitter buffer target" << targetMs << "ms, watermarks"
+             << (m_lowWatermarkUs / 1000) << "/" << (m_highWatermarkUs / 1000) << "ms";
+}
+
+void JitterBuffer::setCapacityUs(int64_t capacityUs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_capacityUs = capacityUs;
+    m_spaceAvailable.wakeAll();
+}
+
+void JitterBuffer::start(AVFormatContext *formatContext)
+{
+    if (m_thread || !formatContext) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_formatContext = formatContext;
+        m_abort = false;
+        m_readResult = 0;
+        // 启动或seek后先积累到高水位，首次填充不计为卡顿
+        m_buffering = true;
+        m_primed = false;
+        m_streamDurationUs.fill(0, formatContext->nb_streams);
+        m_lastDtsUs.fill(AV_NOPTS_VALUE, formatContext->nb_streams);
+    }
+
+    // 停止时中断阻塞在网络读取中的 av_read_frame
+    formatContext->interrupt_callback.callback = &JitterBuffer::interruptCallback;
+    formatContext->interrupt_callback.opaque = this;
+
+    m_thread = QThread::create([this]() { readLoop(); });
+    m_thread->start();
+}
+
+void JitterBuffer::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_abort = true;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_spaceAvailable.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    m_formatContext->interrupt_callback.callback = nullptr;
+    m_formatContext->interrupt_callback.opaque = nullptr;
+
+    QMutexLocker locker(&m_mutex);
+    clearLocked();
+}
+
+int JitterBuffer::interruptCallback(void *opaque)
+{
+    return static_cast<JitterBuffer*>(opaque)->m_abort ? 1 : 0;
+}
+
+void JitterBuffer::readLoop()
+{
+    AVPacket *packet = av_packet_alloc();
+    HlsAbrController *abrController = HlsAbrController::fromContext(m_formatContext);
+
+    while (!m_abort) {
+        {
+            // 达到容量或字节上限时等待消费
+            QMutexLocker locker(&m_mutex);
+            while (!m_abort && !m_recordOnly && (levelLocked() >= qMax(m_targetUs, m_capacityUs) || m_bytes >= m_maxBytes)) {
+                m_spaceAvailable.wait(&m_mutex);
+            }
+        }
+        if (m_abort) {
+            break;
+        }
+
+        // HLS码率切换：主线程请求的丢弃标志在两次读取之间应用
+        if (abrController) {
+            abrController->syncDiscard();
+        }
+
+        int ret = av_read_frame(m_formatContext, packet);
+        if (ret == AVERROR(EAGAIN)) {
+            QThread::msleep(10);
+            continue;
+        }
+
+        // 写盘在队列锁之外进行，不阻塞播放线程取包
+        if (ret >= 0 && m_recorder) {
+            m_recorder->append(packet);
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (ret < 0) {
+            // 被stop中断时的返回值不是流的结束
+            if (!m_abort) {
+                m_readResult = ret;
+                updateStateLocked();
+            }
+            break;
+        }
+
+        if (m_recordOnly) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        int index = packet->stream_index;
+        if (index >= m_streamDurationUs.size()) {
+            // 部分容器（如MPEG-TS）播放中会出现新的流
+            m_streamDurationUs.resize(index + 1);
+            m_lastDtsUs.resize(index + 1);
+            m_lastDtsUs[index] = AV_NOPTS_VALUE;
+        }
+
+        Entry entry;
+        entry.durationUs = packetDurationUs(packet);
+        entry.packet = av_packet_alloc();
+        av_packet_move_ref(entry.packet, packet);
+
+        m_streamDurationUs[index] += entry.durationUs;
+        m_bytes += entry.packet->size;
+        m_queue.append(entry);
+        updateStateLocked();
+    }
+
+    av_packet_free(&packet);
+}
+
+int64_t JitterBuffer::packetDurationUs(const AVPacket *packet)
+{
+    AVStream *stream = m_formatContext->streams[packet->stream_index];
+    AVMediaType type = stream->codecpar->codec_type;
+    if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO) {
+        return 0;
+    }
+
+    // 用DTS计算包间隔：B帧的PTS不单调
+    int64_t dts = (packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts;
+    int64_t dtsUs = (dts != AV_NOPTS_VALUE) ? av_rescale_q(dts, stream->time_base, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+    int64_t &lastDtsUs = m_lastDtsUs[packet->stream_index];
+
+    int64_t duration = 0;
+    if (packet->duration > 0) {
+        duration = av_rescale_q(packet->duration, stream->time_base, AV_TIME_BASE_Q);
+    } else if (dtsUs != AV_NOPTS_VALUE && lastDtsUs != AV_NOPTS_VALUE) {
+        int64_t delta = dtsUs - lastDtsUs;
+        // 时间戳跳变（直播源重启、回绕）不计入
+        if (delta > 0 && delta < AV_TIME_BASE) {
+            duration = delta;
+        }
+    }
+
+    if (dtsUs != AV_NOPTS_VALUE) {
+        lastDtsUs = dtsUs;
+    }
+    return duration;
+}
+
+int64_t JitterBuffer::levelLocked() const
+{
+    // 取各路流中缓冲最长的：纯音频模式下视频包在解复用层被丢弃，只有音频在缓冲
+    int64_t level = 0;
+    for (int64_t duration : m_streamDurationUs) {
+        level = qMax(level, duration);
+    }
+    return level;
+}
+
+void JitterBuffer::updateStateLocked()
+{
+    if (!m_buffering) {
+        return;
+    }
+
+    // 达到高水位、字节上限（高码率流达不到时长目标）或流已结束时恢复播放
+    int64_t level = levelLocked();
+    if (level >= m_highWatermarkUs || m_bytes >= m_maxBytes || m_readResult < 0) {
+        m_buffering = false;
+        m_primed = true;
+        qDebug() << "[BUFFER] Resume at" << (level / 1000) << "ms buffered," << (m_bytes / 1024) << "KB";
+    }
+}
+
+void JitterBuffer::enterBufferingLocked()
+{
+    m_buffering = true;
+    if (m_primed) {
+        m_rebufferCount++;
+    }
+    qDebug() << "[BUFFER] Underrun at" << (levelLocked() / 1000) << "ms buffered, rebuffer count" << m_rebufferCount;
+}
+
+int JitterBuffer::pop(AVPacket *packet)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_buffering) {
+        return AVERROR(EAGAIN);
+    }
+
+    if (m_queue.isEmpty()) {
+        if (m_readResult < 0) {
+            return m_readResult;
+        }
+        enterBufferingLocked();
+        return AVERROR(EAGAIN);
+    }
+
+    Entry entry = m_queue.takeFirst();
+    int64_t &streamDuration = m_streamDurationUs[entry.packet->stream_index];
+    streamDuration = qMax<int64_t>(0, streamDuration - entry.durationUs);
+    m_bytes -= entry.packet->size;
+
+    av_packet_move_ref(packet, entry.packet);
+    av_packet_free(&entry.packet);
+
+    // 流结束后不再等待，剩余的包全部播放
+    if (m_readResult == 0 && levelLocked() < m_lowWatermarkUs) {
+        enterBufferingLocked();
+    }
+
+    m_spaceAvailable.wakeOne();
+    return 0;
+}
+
+void JitterBuffer::setRecordOnly(bool recordOnly)
+{
+    QMutexLocker locker(&m_mutex);
+    if (recordOnly == m_recordOnly) {
+        return;
+    }
+    m_recordOnly = recordOnly;
+
+    // 队列中的包都已录制：回看从时移缓冲读取，回到直播时重新积累，首次填充不计为卡顿
+    clearLocked();
+    m_primed = false;
+    m_spaceAvailable.wakeAll();
+    qDebug() << "[BUFFER] Record-only" << (recordOnly ? "on" : "off");
+}
+
+bool JitterBuffer::isRecordOnly() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_recordOnly;
+}
+
+void JitterBuffer::clearLocked()
+{
+    for (Entry &entry : m_queue) {
+        av_packet_free(&entry.packet);
+    }
+    m_queue.clear();
+    m_streamDurationUs.fill(0);
+    m_bytes = 0;
+    m_buffering = true;
+}
+
+bool JitterBuffer::isBuffering() const
+{
+    // 只录制时不供包，不算缓冲
+    QMutexLocker locker(&m_mutex);
+    return m_buffering && !m_recordOnly;
+}
+
+int64_t JitterBuffer::bufferedUs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return levelLocked();
+}
+
+qint64 JitterBuffer::bufferedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+int JitterBuffer::fillPercent() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(qBound<int64_t>(0, levelLocked() * 100 / m_targetUs, 100));
+}
+
+int JitterBuffer::rebufferCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rebufferCount;
+}
@@ -0,0 +1,90 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QList>
+#include <QVector>
+#include <atomic>
+
+class TimeshiftBuffer;
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+// 网络抖动缓冲：独立线程解复用，按时长计量缓冲水位
+// 低于低水位进入缓冲状态（播放器暂停呈现），达到高水位后恢复，吸收Wi-Fi等链路的到达抖动
+class JitterBuffer
+{
+public:
+    JitterBuffer();
+    ~JitterBuffer();
+
+    // 目标时长和水位（百分比，相对目标时长），字节上限防止高码率流占用过多内存
+    void configure(int targetMs, int lowThresholdPercent, int highThresholdPercent, qint64 maxBytes);
+    // 直播追赶：允许缓冲超过目标时长到该上限，积压留在本地可测量，由加速播放消化（0表示等于目标时长）
+    void setCapacityUs(int64_t capacityUs);
+
+    // 启动/停止解复用线程；停止时丢弃已缓冲的包，之后才能在播放线程seek或关闭上下文
+    void start(AVFormatContext *formatContext);
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+    // 时移录制：每个读到的包都交给录制器保存，在start之前设置
+    void setRecorder(TimeshiftBuffer *recorder) { m_recorder = recorder; }
+    // 只录制模式（暂停或回看时）：包只写入录制器，不排队，解复用不受水位限制
+    // 退出时丢弃旧的包，重新积累到高水位
+    void setRecordOnly(bool recordOnly);
+    bool isRecordOnly() const;
+
+    // 取出下一个包：缓冲中返回 AVERROR(EAGAIN)，读完返回 AVERROR_EOF 或读取错误
+    int pop(AVPacket *packet);
+
+    bool isBuffering() const;
+    int64_t bufferedUs() const;
+    qint64 bufferedBytes() const;
+    int fillPercent() const;       // 相对目标时长
+    int rebufferCount() const;     // 开始播放后的缓冲次数
+    int64_t targetUs() const { return m_targetUs; }
+
+private:
+    struct Entry {
+        AVPacket *packet;
+        int64_t durationUs;
+    };
+
+    void readLoop();
+    int64_t packetDurationUs(const AVPacket *packet);
+    int64_t levelLocked() const;
+    void updateStateLocked();
+    void enterBufferingLocked();
+    void clearLocked();
+    static int interruptCallback(void *opaque);
+
+    AVFormatContext *m_formatContext;
+    TimeshiftBuffer *m_recorder;
+    QThread *m_thread;
+    std::atomic<bool> m_abort;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_spaceAvailable;
+    QList<Entry> m_queue;
+    QVector<int64_t> m_streamDurationUs;  // 每路流已缓冲时长
+    QVector<int64_t> m_lastDtsUs;         // 每路流上一个包的DTS，用于推算缺失的包时长
+    qint64 m_bytes;
+    bool m_buffering;
+    bool m_primed;           // 首次达到高水位后，再次缓冲才计为卡顿
+    bool m_recordOnly;
+    int m_readResult;        // 解复用结束时的返回值，0表示仍在读取
+    int m_rebufferCount;
+
+    int64_t m_targetUs;
+    int64_t m_lowWatermarkUs;
+    int64_t m_highWatermarkUs;
+    int64_t m_capacityUs;    // 解复用暂停读取的时长，不低于目标时长
+    qint64 m_maxBytes;
+};
+
+#endif // JITTERBUFFER_H
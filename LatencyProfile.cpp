@@ -0,0 +1,131 @@
+#include "LatencyProfile.h"
+#include <QUrl>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/dict.h>
+}
+
+QHash<QString, LatencyProfile::Mode> LatencyProfile::s_protocolModes = {
+    { "rtsp", LatencyProfile::LowLatency },
+    { "rtmp", LatencyProfile::LowLatency },
+    { "rtmps", LatencyProfile::LowLatency },
+    { "udp", LatencyProfile::LowLatency },
+    { "rtp", LatencyProfile::LowLatency },
+    { "srt", LatencyProfile::LowLatency }
+};
+
+LatencyProfile::LatencyProfile()
+    : m_mode(Standard)
+    , m_transport(AutoTransport)
+{
+}
+
+LatencyProfile::LatencyProfile(Mode mode, Transport transport)
+    : m_mode(mode)
+    , m_transport(transport)
+{
+}
+
+LatencyProfile LatencyProfile::forUrl(const QString &url)
+{
+    return LatencyProfile(protocolMode(QUrl(url).scheme()));
+}
+
+void LatencyProfile::setProtocolMode(const QString &scheme, Mode mode)
+{
+    s_protocolModes[scheme.toLower()] = mode;
+}
+
+LatencyProfile::Mode LatencyProfile::protocolMode(const QString &scheme)
+{
+    return s_protocolModes.value(scheme.toLower(), Standard);
+}
+
+QString LatencyProfile::description() const
+{
+    if (m_mode == Standard) {
+        switch (m_transport) {
+            case Tcp: return "标准 (TCP)";
+            case Udp: return "标准 (UDP)";
+            default: return "标准";
+        }
+    }
+
+    switch (m_transport) {
+        case Tcp: return "低延迟 (TCP)";
+        case Udp: return "低延迟 (UDP)";
+        default: return "低延迟";
+    }
+}
+
+void LatencyProfile::applyFormatOptions(AVDictionary **options, const QString &url) const
+{
+    QString scheme = QUrl(url).scheme().toLower();
+
+    // rtmp 的 timeout 是监听模式等待推流的时间（设置后变为等待对方连入），读写超时用 rw_timeout
+    const char *timeoutKey = scheme.startsWith("rtmp") ? "rw_timeout" : "timeout";
+
+    if (m_mode == Standard) {
+        av_dict_set(options, timeoutKey, "10000000", 0);     // 10秒超时
+        av_dict_set(options, "buffer_size", "1024000", 0);   // 1MB缓冲
+        av_dict_set(options, "max_delay", "5000000", 0);     // 5秒最大延迟
+        av_dict_set(options, "user_agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36", 0);
+        av_dict_set(options, "reconnect", "1", 0);           // 启用重连
+        av_dict_set(options, "reconnect_streamed", "1", 0);  // 流式重连
+        av_dict_set(options, "reconnect_delay_max", "5", 0); // 最大重连延迟5秒
+        if (scheme == "rtsp" && m_transport != AutoTransport) {
+            av_dict_set(options, "rtsp_transport", m_transport == Tcp ? "tcp" : "udp", 0);
+        }
+        return;
+    }
+
+    // 不在解复用层缓冲，读到的包直接交给解码器
+    av_dict_set(options, "fflags", "nobuffer", 0);
+    av_dict_set_int(options, "probesize", kLowLatencyProbeSize, 0);
+    av_dict_set_int(options, "analyzeduration", kLowLatencyAnalyzeDurationUs, 0);
+    av_dict_set(options, timeoutKey, "5000000", 0);         // 5秒无数据视为断开
+
+    if (scheme == "rtsp") {
+        if (m_transport == Tcp) {
+            av_dict_set(options, "rtsp_transport", "tcp", 0);
+            // TCP不会乱序，不需要重排序等待
+            av_dict_set(options, "max_delay", "0", 0);
+        } else {
+            if (m_transport == Udp) {
+                av_dict_set(options, "rtsp_transport", "udp", 0);
+            }
+            // UDP只为乱序包等待一个很短的窗口
+            av_dict_set(options, "max_delay", "100000", 0);
+            av_dict_set(options, "reorder_queue_size", "16", 0);
+            av_dict_set(options, "buffer_size", "1024000", 0);  // 接收缓冲，避免突发丢包
+        }
+    } else if (scheme == "udp" || scheme == "rtp") {
+        av_dict_set(options, "max_delay", "100000", 0);
+        av_dict_set(options, "buffer_size", "1024000", 0);
+    } else {
+        av_dict_set(options, "max_delay", "0", 0);
+    }
+}
+
+void LatencyProfile::applyCodecOptions(AVCodecContext *codecContext) const
+{
+    if (!codecContext || m_mode == Standard) {
+        return;
+    }
+
+    // 解码器不为B帧重排序额外缓存帧
+    codecContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    // 帧级多线程每个线程延迟一帧，改用片级多线程
+    codecContext->thread_type = FF_THREAD_SLICE;
+}
+
+int LatencyProfile::jitterBufferMs(int configuredMs) const
+{
+    return (m_mode == LowLatency) ? qMin(configuredMs, int(kLowLatencyJitterBufferMs)) : configuredMs;
+}
+
+int LatencyProfile::maxLatencyMs(int configuredMs) const
+{
+    return (m_mode == LowLatency) ? qMin(configuredMs, int(kLowLatencyMaxLatencyMs)) : configuredMs;
+}
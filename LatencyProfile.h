@@ -0,0 +1,60 @@
+#ifndef LATENCYPROFILE_H
+#define LATENCYPROFILE_H
+
+#include <QString>
+#include <QHash>
+
+struct AVDictionary;
+struct AVCodecContext;
+
+// 延迟配置：按URL或协议选择打开参数
+// 标准模式保留原有的大缓冲+自动重连，低延迟模式用于RTSP/RTMP/UDP等实时源
+class LatencyProfile
+{
+public:
+    enum Mode {
+        Standard,     // 点播/HTTP：大缓冲，优先稳定
+        LowLatency    // 实时源：不缓冲，快速探测，最小重排序延迟
+    };
+
+    enum Transport {
+        AutoTransport,  // RTSP由加载器并行竞速UDP/TCP（或沿用该主机上次的结果）
+        Tcp,            // 交织在RTSP连接中，无丢包，适合跨网段
+        Udp             // 延迟最低，丢包时花屏
+    };
+
+    LatencyProfile();
+    explicit LatencyProfile(Mode mode, Transport transport = AutoTransport);
+
+    // 按协议默认值（可被 setProtocolMode 覆盖）生成配置
+    static LatencyProfile forUrl(const QString &url);
+    static void setProtocolMode(const QString &scheme, Mode mode);
+    static Mode protocolMode(const QString &scheme);
+
+    Mode mode() const { return m_mode; }
+    Transport transport() const { return m_transport; }
+    bool isLowLatency() const { return m_mode == LowLatency; }
+    QString description() const;
+
+    // 应用到 avformat_open_input 选项
+    void applyFormatOptions(AVDictionary **options, const QString &url) const;
+    // 应用到解码器（avcodec_open2之前调用）
+    void applyCodecOptions(AVCodecContext *codecContext) const;
+    // 抖动缓冲目标时长：低延迟模式下缓冲深度直接计入端到端延迟，限制在较小值
+    int jitterBufferMs(int configuredMs) const;
+    // 直播最大积压：超过后加速追赶，低延迟模式保持在1秒以内
+    int maxLatencyMs(int configuredMs) const;
+
+    static const int kLowLatencyProbeSize = 32768;            // 32KB
+    static const int kLowLatencyAnalyzeDurationUs = 500000;   // 0.5秒
+    static const int kLowLatencyJitterBufferMs = 300;
+    static const int kLowLatencyMaxLatencyMs = 800;
+
+private:
+    Mode m_mode;
+    Transport m_transport;
+
+    static QHash<QString, Mode> s_protocolModes;  // 协议默认模式（小写scheme）
+};
+
+#endif // LATENCYPROFILE_H
@@ -0,0 +1,86 @@
+#include "LiveCatchUp.h"
+#include <QtGlobal>
+#include <QDebug>
+
+LiveCatchUp::LiveCatchUp()
+    : m_enabled(false)
+    , m_targetUs(0)
+    , m_maxUs(0)
+    , m_standingUs(0)
+    , m_catchingUp(false)
+    , m_speed(1.0)
+    , m_catchUpCount(0)
+{
+}
+
+void LiveCatchUp::configure(bool enabled, int64_t targetUs, int64_t maxUs)
+{
+    m_enabled = enabled && maxUs > 0;
+    m_maxUs = maxUs;
+    // 目标必须低于上限，否则追赶刚开始就结束
+    m_targetUs = qMin(targetUs, maxUs / 2);
+    m_catchUpCount = 0;
+    reset();
+
+    if (m_enabled) {
+        qDebug() << "[CATCHUP] Target" << (m_targetUs / 1000) << "ms, limit" << (m_maxUs / 1000) << "ms";
+    }
+}
+
+void LiveCatchUp::reset()
+{
+    m_samples.clear();
+    m_timer.invalidate();
+    m_standingUs = 0;
+    m_catchingUp = false;
+    m_speed = 1.0;
+}
+
+double LiveCatchUp::update(int64_t backlogUs)
+{
+    if (!m_enabled) {
+        return 1.0;
+    }
+
+    if (!m_timer.isValid()) {
+        m_timer.start();
+    }
+    qint64 nowMs = m_timer.elapsed();
+    m_samples.enqueue(qMakePair(nowMs, backlogUs));
+    while (!m_samples.isEmpty() && nowMs - m_samples.head().first > kWindowMs) {
+        m_samples.dequeue();
+    }
+
+    m_standingUs = backlogUs;
+    for (const auto &sample : m_samples) {
+        m_standingUs = qMin(m_standingUs, sample.second);
+    }
+
+    // 窗口未满时不开始追赶，刚开始播放时的积压还不稳定
+    bool windowFull = nowMs >= kWindowMs;
+    if (!m_catchingUp && windowFull && m_standingUs > m_maxUs) {
+        m_catchingUp = true;
+        m_catchUpCount++;
+        qDebug() << "[CATCHUP] Backlog" << (m_standingUs / 1000) << "ms over limit, speeding up";
+    } else if (m_catchingUp && m_standingUs <= m_targetUs) {
+        m_catchingUp = false;
+        qDebug() << "[CATCHUP] Backlog back to" << (m_standingUs / 1000) << "ms, returning to normal speed";
+    }
+
+    // 超出越多加速越多，速度每次只移动一小步
+    double desired = 1.0;
+    if (m_catchingUp) {
+        double excess = static_cast<double>(m_standingUs - m_targetUs) / kHorizonUs;
+        desired = 1.0 + qBound(kMinSpeedUp, excess, kMaxSpeedUp);
+    }
+    if (desired > m_speed) {
+        m_speed = qMin(desired, m_speed + kSpeedStep);
+    } else {
+        m_speed = qMax(desired, m_speed - kSpeedStep);
+    }
+    // 消除浮点累积误差，原速时严格为1.0
+    if (qAbs(m_speed - 1.0) < 1e-6) {
+        m_speed = 1.0;
+    }
+    return m_speed;
+}
@@ -0,0 +1,52 @@
+#ifndef LIVECATCHUP_H
+#define LIVECATCHUP_H
+
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QPair>
+#include <cstdint>
+
+// 直播延迟追赶：每次网络波动后本地积压都会变多，积压超过上限时小幅加速播放，回到目标后恢复原速
+// 积压取最近一段时间内的最小值，只反映持续的排队，不随分片到达的突发波动
+class LiveCatchUp
+{
+public:
+    LiveCatchUp();
+
+    // targetUs 为恢复原速的目标积压，maxUs 为开始追赶的上限
+    void configure(bool enabled, int64_t targetUs, int64_t maxUs);
+    bool isEnabled() const { return m_enabled; }
+
+    // 测量中断（暂停、缓冲、回看、重连）：清空测量窗口，立即回到原速
+    void reset();
+
+    // 输入一次积压测量(微秒)，返回应使用的播放速度
+    double update(int64_t backlogUs);
+
+    double speed() const { return m_speed; }
+    bool isCatchingUp() const { return m_catchingUp; }
+    int64_t standingBacklogUs() const { return m_standingUs; }
+    int64_t targetUs() const { return m_targetUs; }
+    int64_t maxUs() const { return m_maxUs; }
+    int catchUpCount() const { return m_catchUpCount; }
+
+private:
+    bool m_enabled;
+    int64_t m_targetUs;
+    int64_t m_maxUs;
+
+    QElapsedTimer m_timer;
+    QQueue<QPair<qint64, int64_t>> m_samples;   // (ms, 积压) 测量窗口
+    int64_t m_standingUs;
+    bool m_catchingUp;
+    double m_speed;
+    int m_catchUpCount;
+
+    static const int kWindowMs = 5000;            // 最小值窗口
+    static constexpr double kMinSpeedUp = 0.02;   // 追赶时至少加速2%，保证能收敛
+    static constexpr double kMaxSpeedUp = 0.05;   // 最多加速5%，听感上不明显
+    static constexpr double kSpeedStep = 0.005;   // 每次测量最多调整0.5%，速度平滑变化
+    static const int64_t kHorizonUs = 10000000;   // 按约10秒消化超出部分计算期望速度
+};
+
+#endif // LIVECATCHUP_H
@@ -0,0 +1,141 @@
+#include "MasterClock.h"
+#include <QDebug>
+#include <cstdlib>
+
+namespace {
+    const int64_t kJumpThresholdUs = 40000;  // 超过该偏差直接跳变
+    const int kSmoothingDivisor = 8;         // 小偏差每次吸收1/8
+}
+
+MasterClock::MasterClock()
+    : m_mode(Mode::AudioMaster)
+    , m_anchorPts(AV_NOPTS_VALUE)
+    , m_anchorWallNs(0)
+    , m_paused(false)
+    , m_speed(1.0)
+    , m_lastUpdateError(0)
+    , m_jumpCount(0)
+{
+    m_wallClock.start();
+}
+
+void MasterClock::setMode(Mode mode)
+{
+    if (m_mode == mode) {
+        return;
+    }
+
+    // 切换模式时保持当前时间连续
+    int64_t current = now();
+    m_mode = mode;
+    if (current != AV_NOPTS_VALUE) {
+        reanchor(current);
+    }
+
+    qDebug() << "[CLOCK] Mode:" << modeName(mode);
+}
+
+const char* MasterClock::modeName(Mode mode)
+{
+    switch (mode) {
+        case Mode::AudioMaster: return "Audio";
+        case Mode::VideoMaster: return "Video";
+        case Mode::External: return "External";
+    }
+    return "Unknown";
+}
+
+int64_t MasterClock::now() const
+{
+    if (m_anchorPts == AV_NOPTS_VALUE) {
+        return AV_NOPTS_VALUE;
+    }
+
+    if (m_paused) {
+        return m_anchorPts;
+    }
+
+    qint64 elapsedNs = m_wallClock.nsecsElapsed() - m_anchorWallNs;
+    return m_anchorPts + static_cast<int64_t>(elapsedNs / 1000 * m_speed);
+}
+
+void MasterClock::set(int64_t ptsUs)
+{
+    reanchor(ptsUs);
+    m_lastUpdateError = 0;
+}
+
+void MasterClock::update(int64_t ptsUs)
+{
+    if (ptsUs == AV_NOPTS_VALUE) {
+        return;
+    }
+
+    int64_t predicted = now();
+    if (predicted == AV_NOPTS_VALUE || m_paused) {
+        reanchor(ptsUs);
+        return;
+    }
+
+    m_lastUpdateError = ptsUs - predicted;
+
+    if (std::llabs(m_lastUpdateError) > kJumpThresholdUs) {
+        // 时钟源不连续（seek、设备切换、丢包）：直接跳变
+        reanchor(ptsUs);
+        m_jumpCount++;
+    } else {
+        // 上报值本身有量化抖动（设备缓冲按周期读取），平滑吸收
+        reanchor(predicted + m_lastUpdateError / kSmoothingDivisor);
+    }
+}
+
+void MasterClock::reset()
+{
+    m_anchorPts = AV_NOPTS_VALUE;
+    m_anchorWallNs = 0;
+    m_paused = false;
+    m_lastUpdateError = 0;
+    m_jumpCount = 0;
+}
+
+void MasterClock::pause()
+{
+    if (m_paused) {
+        return;
+    }
+
+    // 冻结在暂停时刻
+    if (m_anchorPts != AV_NOPTS_VALUE) {
+        reanchor(now());
+    }
+    m_paused = true;
+}
+
+void MasterClock::resume()
+{
+    if (!m_paused) {
+        return;
+    }
+
+    m_paused = false;
+    m_anchorWallNs = m_wallClock.nsecsElapsed();
+}
+
+void MasterClock::setSpeed(double speed)
+{
+    if (speed <= 0.0 || speed == m_speed) {
+        return;
+    }
+
+    // 以当前时间为锚点切换速度，保证时间连续
+    if (m_anchorPts != AV_NOPTS_VALUE) {
+        reanchor(now());
+    }
+    m_speed = speed;
+}
+
+void MasterClock::reanchor(int64_t ptsUs)
+{
+    m_anchorPts = ptsUs;
+    m_anchorWallNs = m_wallClock.nsecsElapsed();
+}
@@ -0,0 +1,63 @@
+#ifndef MASTERCLOCK_H
+#define MASTERCLOCK_H
+
+#include <QElapsedTimer>
+#include <cstdint>
+
+extern "C" {
+    #include <libavutil/avutil.h>
+}
+
+// 统一主时钟：音频主/视频主/外部时钟三种模式，支持暂停和变速
+// 时钟源通过 update() 上报时间，呈现器、音频输出和统计都通过 now() 读取
+class MasterClock
+{
+public:
+    enum class Mode {
+        AudioMaster,   // 以音频设备实际播放位置为准
+        VideoMaster,   // 以视频帧显示时间为准
+        External       // 以系统单调时钟为准（无音频文件、直播流）
+    };
+
+    MasterClock();
+
+    void setMode(Mode mode);
+    Mode mode() const { return m_mode; }
+    static const char* modeName(Mode mode);
+
+    // 当前时间(微秒)，未设置时返回 AV_NOPTS_VALUE
+    int64_t now() const;
+    bool isValid() const { return m_anchorPts != AV_NOPTS_VALUE; }
+
+    // 直接设置时钟（开始播放、seek）
+    void set(int64_t ptsUs);
+    // 时钟源上报：小偏差平滑吸收，大偏差直接跳变
+    void update(int64_t ptsUs);
+    void reset();
+
+    void pause();
+    void resume();
+    bool isPaused() const { return m_paused; }
+
+    void setSpeed(double speed);
+    double speed() const { return m_speed; }
+
+    // 统计
+    int64_t lastUpdateError() const { return m_lastUpdateError; }
+    int jumpCount() const { return m_jumpCount; }
+
+private:
+    void reanchor(int64_t ptsUs);
+
+    Mode m_mode;
+    QElapsedTimer m_wallClock;   // 单调时钟
+    int64_t m_anchorPts;         // 锚点时间(微秒)
+    qint64 m_anchorWallNs;       // 锚点对应的单调时钟(纳秒)
+    bool m_paused;
+    double m_speed;
+
+    int64_t m_lastUpdateError;   // 最近一次上报与预测值的偏差
+    int m_jumpCount;             // 跳变次数
+};
+
+#endif // MASTERCLOCK_H
@@ -0,0 +1,242 @@
+#include "MpegTsMonitor.h"
+#include <QUrl>
+#include <QDebug>
+#include <cstring>
+#include <memory>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/mem.h>
+}
+
+MpegTsMonitor::MpegTsMonitor(AVFormatContext *formatContext)
+    : m_formatContext(formatContext)
+    , m_source(nullptr)
+    , m_ioContext(nullptr)
+    , m_partialSize(0)
+    , m_inSync(false)
+    , m_lastCounter(kPidCount, -1)
+    , m_duplicated(kPidCount, false)
+    , m_loggedErrors(0)
+    , m_packets(0)
+    , m_continuityErrors(0)
+    , m_lostPackets(0)
+    , m_transportErrors(0)
+    , m_syncLosses(0)
+{
+}
+
+MpegTsMonitor::~MpegTsMonitor()
+{
+    if (m_source) {
+        qDebug() << "[MPEGTS] Closing -" << summary() << "over" << m_packets << "packets";
+    }
+
+    if (m_ioContext) {
+        av_freep(&m_ioContext->buffer);
+        avio_context_free(&m_ioContext);
+    }
+    // 连接关闭时不再有格式上下文，中断回调不转发
+    m_formatContext = nullptr;
+    avio_closep(&m_source);
+}
+
+bool MpegTsMonitor::isMonitorable(const QString &url)
+{
+    QString scheme = QUrl(url).scheme().toLower();
+    return scheme == "udp" || scheme == "tcp";
+}
+
+MpegTsMonitor *MpegTsMonitor::open(const QString &url, AVFormatContext *formatContext, const AVDictionary *options)
+{
+    std::unique_ptr<MpegTsMonitor> monitor(new MpegTsMonitor(formatContext));
+
+    // 连接使用与普通打开相同的参数（套接字缓冲、FIFO、组播源、超时）
+    AVDictionary *ioOptions = nullptr;
+    av_dict_copy(&ioOptions, options, 0);
+    AVIOInterruptCB interrupt = { &MpegTsMonitor::interruptCallback, monitor.get() };
+    int ret = avio_open2(&monitor->m_source, url.toUtf8().constData(), AVIO_FLAG_READ, &interrupt, &ioOptions);
+    av_dict_free(&ioOptions);
+    if (ret < 0) {
+        return nullptr;
+    }
+
+    unsigned char *buffer = static_cast<unsigned char*>(av_malloc(kIoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    monitor->m_ioContext = avio_alloc_context(buffer, kIoBufferSize, 0, monitor.get(),
+                                              &MpegTsMonitor::readPacket, nullptr, nullptr);
+    if (!monitor->m_ioContext) {
+        av_free(buffer);
+        return nullptr;
+    }
+    // 实时传输流不可seek
+    monitor->m_ioContext->seekable = 0;
+
+    formatContext->pb = monitor->m_ioContext;
+    qDebug() << "[MPEGTS] Monitoring continuity on" << QUrl(url).scheme() << QUrl(url).host();
+    return monitor.release();
+}
+
+MpegTsMonitor *MpegTsMonitor::fromContext(const AVFormatContext *formatContext)
+{
+    const AVIOContext *pb = formatContext ? formatContext->pb : nullptr;
+    if (!pb || pb->read_packet != &MpegTsMonitor::readPacket) {
+        return nullptr;
+    }
+    return static_cast<MpegTsMonitor*>(pb->opaque);
+}
+
+int MpegTsMonitor::interruptCallback(void *opaque)
+{
+    // 跟随格式上下文当前的中断回调：加载期间是加载任务，播放期间是抖动缓冲
+    AVFormatContext *formatContext = static_cast<MpegTsMonitor*>(opaque)->m_formatContext;
+    if (!formatContext || !formatContext->interrupt_callback.callback) {
+        return 0;
+    }
+    return formatContext->interrupt_callback.callback(formatContext->interrupt_callback.opaque);
+}
+
+int MpegTsMonitor::readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    return static_cast<MpegTsMonitor*>(opaque)->read(buf, bufSize);
+}
+
+int MpegTsMonitor::read(uint8_t *buf, int bufSize)
+{
+    int ret = avio_read_partial(m_source, buf, bufSize);
+    if (ret > 0) {
+        inspect(buf, ret);
+        return ret;
+    }
+    return (ret == 0) ? AVERROR_EOF : ret;
+}
+
+void MpegTsMonitor::inspect(const uint8_t *data, int size)
+{
+    int pos = 0;
+
+    // 先补齐上次读取末尾的不完整包
+    if (m_partialSize > 0) {
+        int take = qMin(kPacketSize - m_partialSize, size);
+        memcpy(m_partial + m_partialSize, data, take);
+        m_partialSize += take;
+        pos = take;
+        if (m_partialSize < kPacketSize) {
+            return;
+        }
+        inspectPacket(m_partial);
+        m_partialSize = 0;
+    }
+
+    while (pos < size) {
+        // 失步后要求下一个包的位置也是同步字节，避免把负载中的0x47当作包头
+        bool synced = data[pos] == 0x47 &&
+                      (m_inSync || pos + kPacketSize >= size || data[pos + kPacketSize] == 0x47);
+        if (!synced) {
+            if (m_inSync) {
+                m_inSync = false;
+                m_syncLosses++;
+                qDebug() << "[MPEGTS] Lost sync, searching for next packet start";
+            }
+            pos++;
+            continue;
+        }
+
+        if (size - pos < kPacketSize) {
+            memcpy(m_partial, data + pos, size - pos);
+            m_partialSize = size - pos;
+            return;
+        }
+        m_inSync = true;
+        inspectPacket(data + pos);
+        pos += kPacketSize;
+    }
+}
+
+void MpegTsMonitor::inspectPacket(const uint8_t *packet)
+{
+    m_packets++;
+
+    // 传输错误标志：上游已知包已损坏，计数器也不可信
+    if (packet[1] & 0x80) {
+        m_transportErrors++;
+        return;
+    }
+
+    int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    if (pid == kNullPid) {
+        return;
+    }
+
+    int adaptation = (packet[3] >> 4) & 0x03;
+    int counter = packet[3] & 0x0F;
+
+    // 不连续标志：源有意重置计数器（如切换节目），不算丢包
+    if ((adaptation & 0x02) && packet[4] > 0 && (packet[5] & 0x80)) {
+        m_lastCounter[pid] = -1;
+    }
+
+    // 只有带负载的包递增计数器
+    if (!(adaptation & 0x01)) {
+        return;
+    }
+
+    int last = m_lastCounter[pid];
+    m_lastCounter[pid] = static_cast<int8_t>(counter);
+    if (last < 0) {
+        m_duplicated[pid] = false;
+        return;
+    }
+
+    if (counter == last) {
+        // 允许连续重复一次，再重复即为错误
+        if (m_duplicated[pid]) {
+            m_continuityErrors++;
+        }
+        m_duplicated[pid] = true;
+        return;
+    }
+    m_duplicated[pid] = false;
+
+    int expected = (last + 1) & 0x0F;
+    if (counter == expected) {
+        return;
+    }
+
+    m_continuityErrors++;
+    m_lostPackets += (counter - expected) & 0x0F;
+
+    // 突发丢包时每个PID都会报错，按间隔汇总输出
+    if (!m_logTimer.isValid() || m_logTimer.elapsed() >= kLogIntervalMs) {
+        qint64 errors = m_continuityErrors;
+        qDebug() << "[MPEGTS] Continuity error on PID" << pid << "expected" << expected << "got" << counter
+                 << "-" << (errors - m_loggedErrors) << "new errors," << summary();
+        m_loggedErrors = errors;
+        m_logTimer.start();
+    }
+}
+
+double MpegTsMonitor::lossPercent() const
+{
+    qint64 lost = m_lostPackets;
+    qint64 total = m_packets + lost;
+    return (total > 0) ? lost * 100.0 / total : 0.0;
+}
+
+QString MpegTsMonitor::summary() const
+{
+    QString text = QString("CC错误 %1，丢包 %2（%3%）")
+        .arg(m_continuityErrors.load())
+        .arg(m_lostPackets.load())
+        .arg(lossPercent(), 0, 'f', 3);
+    if (m_transportErrors > 0) {
+        text += QString("，传输错误 %1").arg(m_transportErrors.load());
+    }
+    if (m_syncLosses > 0) {
+        text += QString("，失步 %1").arg(m_syncLosses.load());
+    }
+    return text;
+}
@@ -0,0 +1,78 @@
+#ifndef MPEGTSMONITOR_H
+#define MPEGTSMONITOR_H
+
+#include <QString>
+#include <QElapsedTimer>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+struct AVFormatContext;
+struct AVIOContext;
+struct AVDictionary;
+
+// MPEG-TS传输质量监测：自定义AVIOContext，把UDP/TCP连接读到的字节转交解复用器前逐个检查188字节TS包
+// 每个PID的连续计数器(CC)应逐包加1，跳变即为丢包，跳过的计数差即丢失的包数（模16，丢失超过15个包时会少计）
+// 同时统计传输错误标志和同步字节丢失；统计值可在其他线程读取
+class MpegTsMonitor
+{
+public:
+    ~MpegTsMonitor();
+
+    // UDP/TCP上的原始传输流
+    static bool isMonitorable(const QString &url);
+
+    // 打开连接并关联监测，成功时把自定义IO设置到 formatContext->pb；失败返回nullptr，调用方按普通方式打开
+    static MpegTsMonitor *open(const QString &url, AVFormatContext *formatContext, const AVDictionary *options);
+
+    // 格式上下文使用的监测；自定义IO不会被 avformat_close_input 关闭，由打开者在关闭上下文后释放
+    static MpegTsMonitor *fromContext(const AVFormatContext *formatContext);
+
+    // 格式上下文已释放（如 avformat_open_input 失败）后调用，不再转发其中断回调
+    void detach() { m_formatContext = nullptr; }
+
+    qint64 packetCount() const { return m_packets; }
+    qint64 continuityErrors() const { return m_continuityErrors; }
+    qint64 lostPackets() const { return m_lostPackets; }
+    qint64 transportErrors() const { return m_transportErrors; }
+    qint64 syncLosses() const { return m_syncLosses; }
+    double lossPercent() const;
+    QString summary() const;
+
+private:
+    explicit MpegTsMonitor(AVFormatContext *formatContext);
+
+    static int readPacket(void *opaque, uint8_t *buf, int bufSize);
+    static int interruptCallback(void *opaque);
+
+    int read(uint8_t *buf, int bufSize);
+    void inspect(const uint8_t *data, int size);
+    void inspectPacket(const uint8_t *packet);
+
+    AVFormatContext *m_formatContext;  // 转发其中断回调（加载任务或抖动缓冲设置）
+    AVIOContext *m_source;             // FFmpeg UDP/TCP连接
+    AVIOContext *m_ioContext;          // 交给解复用器的自定义IO
+
+    // 只在读取线程访问
+    uint8_t m_partial[188];            // 跨读取边界的不完整TS包（TCP按字节流到达）
+    int m_partialSize;
+    bool m_inSync;
+    std::vector<int8_t> m_lastCounter; // 各PID上一个带负载包的CC，-1表示未知
+    std::vector<bool> m_duplicated;    // 上一个包是重复包（标准允许连续出现一次）
+    QElapsedTimer m_logTimer;
+    qint64 m_loggedErrors;
+
+    std::atomic<qint64> m_packets;
+    std::atomic<qint64> m_continuityErrors;
+    std::atomic<qint64> m_lostPackets;
+    std::atomic<qint64> m_transportErrors;
+    std::atomic<qint64> m_syncLosses;
+
+    static const int kPacketSize = 188;
+    static const int kPidCount = 8192;
+    static const int kNullPid = 0x1FFF;
+    static const int kIoBufferSize = 64 * kPacketSize;
+    static const int kLogIntervalMs = 2000;   // 丢包严重时日志汇总输出
+};
+
+#endif // MPEGTSMONITOR_H
@@ -6,10 +6,15 @@ NetworkConfig::NetworkConfig()
     , readTimeout(5000)
     , maxRetries(3)
     , retryDelay(1000)
+    , autoReconnect(true)
     , bufferSize(1024 * 1024)  // 1MB
     , maxBufferSize(10 * 1024 * 1024)  // 10MB
     , minBufferThreshold(20)
     , maxBufferThreshold(80)
+    , jitterBufferMs(2000)  // 2秒
+    , timeshiftSeconds(600)  // 10分钟
+    , timeshiftBytes(512LL * 1024 * 1024)  // 512MB，约10分钟6Mbps直播
+    , httpCacheBytes(256LL * 1024 * 1024)  // 256MB
     , userAgent("Qt Video Player")
     , referer("")
     , followRedirects(true)
@@ -29,10 +34,15 @@ NetworkConfig::NetworkConfig(const NetworkConfig &other)
     , readTimeout(other.readTimeout)
     , maxRetries(other.maxRetries)
     , retryDelay(other.retryDelay)
+    , autoReconnect(other.autoReconnect)
     , bufferSize(other.bufferSize)
     , maxBufferSize(other.maxBufferSize)
     , minBufferThreshold(other.minBufferThreshold)
     , maxBufferThreshold(other.maxBufferThreshold)
+    , jitterBufferMs(other.jitterBufferMs)
+    , timeshiftSeconds(other.timeshiftSeconds)
+    , timeshiftBytes(other.timeshiftBytes)
+    , httpCacheBytes(other.httpCacheBytes)
     , userAgent(other.userAgent)
     , referer(other.referer)
     , followRedirects(other.followRedirects)
@@ -54,10 +64,15 @@ NetworkConfig& NetworkConfig::operator=(const NetworkConfig &other)
         readTimeout = other.readTimeout;
         maxRetries = other.maxRetries;
         retryDelay = other.retryDelay;
+        autoReconnect = other.autoReconnect;
         bufferSize = other.bufferSize;
         maxBufferSize = other.maxBufferSize;
         minBufferThreshold = other.minBufferThreshold;
         maxBufferThreshold = other.maxBufferThreshold;
+        jitterBufferMs = other.jitterBufferMs;
+        timeshiftSeconds = other.timeshiftSeconds;
+        timeshiftBytes = other.timeshiftBytes;
+        httpCacheBytes = other.httpCacheBytes;
         userAgent = other.userAgent;
         referer = other.referer;
         followRedirects = other.followRedirects;
@@ -108,6 +123,18 @@ bool NetworkConfig::isValid() const
         return false;
     }
     
+    if (jitterBufferMs <= 0 || jitterBufferMs > 30000) {
+        return false;
+    }
+    
+    if (timeshiftSeconds < 0 || timeshiftSeconds > 7200) {
+        return false;
+    }
+    
+    if (timeshiftBytes < 0 || httpCacheBytes < 0) {
+        return false;
+    }
+    
     if (maxRedirects < 0 || maxRedirects > 20) {
         return false;
     }
@@ -142,10 +169,15 @@ QString NetworkConfig::toString() const
     parts << QString("readTimeout=%1").arg(readTimeout);
     parts << QString("maxRetries=%1").arg(maxRetries);
     parts << QString("retryDelay=%1").arg(retryDelay);
+    parts << QString("autoReconnect=%1").arg(autoReconnect ? "true" : "false");
     parts << QString("bufferSize=%1").arg(bufferSize);
     parts << QString("maxBufferSize=%1").arg(maxBufferSize);
     parts << QString("minBufferThreshold=%1").arg(minBufferThreshold);
     parts << QString("maxBufferThreshold=%1").arg(maxBufferThreshold);
+    parts << QString("jitterBufferMs=%1").arg(jitterBufferMs);
+    parts << QString("timeshiftSeconds=%1").arg(timeshiftSeconds);
+    parts << QString("timeshiftBytes=%1").arg(timeshiftBytes);
+    parts << QString("httpCacheBytes=%1").arg(httpCacheBytes);
     parts << QString("userAgent=%1").arg(userAgent);
     parts << QString("referer=%1").arg(referer);
     parts << QString("followRedirects=%1").arg(followRedirects ? "true" : "false");
@@ -182,6 +214,8 @@ bool NetworkConfig::fromString(const QString &configString)
             maxRetries = value.toInt();
         } else if (key == "retryDelay") {
             retryDelay = value.toInt();
+        } else if (key == "autoReconnect") {
+            autoReconnect = (value.toLower() == "true");
         } else if (key == "bufferSize") {
             bufferSize = value.toInt();
         } else if (key == "maxBufferSize") {
@@ -190,6 +224,14 @@ bool NetworkConfig::fromString(const QString &configString)
             minBufferThreshold = value.toInt();
         } else if (key == "maxBufferThreshold") {
             maxBufferThreshold = value.toInt();
+        } else if (key == "jitterBufferMs") {
+            jitterBufferMs = value.toInt();
+        } else if (key == "timeshiftSeconds") {
+            timeshiftSeconds = value.toInt();
+        } else if (key == "timeshiftBytes") {
+            timeshiftBytes = value.toLongLong();
+        } else if (key == "httpCacheBytes") {
+            httpCacheBytes = value.toLongLong();
         } else if (key == "userAgent") {
             userAgent = value;
         } else if (key == "referer") {
@@ -14,13 +14,18 @@ public:
     int connectionTimeout;      // 连接超时时间(ms)
     int readTimeout;           // 读取超时时间(ms)
     int maxRetries;            // 最大重试次数
-    int retryDelay;            // 重试延迟(ms)
+    int retryDelay;            // 重试延迟(ms)，断线重连的初始退避时间
+    bool autoReconnect;        // 播放中断线时自动重连
     
     // 缓冲区配置
     int bufferSize;            // 缓冲区大小(bytes)
-    int maxBufferSize;         // 最大缓冲区大小(bytes)
+    int maxBufferSize;         // 最大缓冲区大小(bytes)，抖动缓冲的字节上限
     int minBufferThreshold;    // 最小缓冲阈值(%)
     int maxBufferThreshold;    // 最大缓冲阈值(%)
+    int jitterBufferMs;        // 抖动缓冲目标时长(ms)，阈值按此时长计算
+    int timeshiftSeconds;      // 直播时移可回看时长(s)，0表示关闭
+    qint64 timeshiftBytes;     // 直播时移的磁盘上限(bytes)
+    qint64 httpCacheBytes;     // HTTP点播磁盘缓存的总上限(bytes)，0表示不缓存
     
     // 网络配置
     QString userAgent;         // 用户代理字符串
@@ -1,7 +1,15 @@
 #include "NetworkStreamLoader.h"
+#include "HttpRangeCache.h"
+#include "HttpValidator.h"
+#include "HlsAbrController.h"
+#include "MpegTsMonitor.h"
+#include "StreamProtocolHandler.h"
 #include <QDebug>
 #include <QApplication>
 #include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <chrono>
 
 extern "C" {
     #include <libavformat/avformat.h>
@@ -9,19 +17,100 @@ extern "C" {
     #include <libavutil/error.h>
 }
 
+namespace {
+    // 网络流快速探测：视频参数确定即可开始显示（FFmpeg默认5MB/5秒）
+    const int64_t kFastProbeSize = 512 * 1024;
+    const int64_t kFastAnalyzeDurationUs = 1000000;
+    const int64_t kFullProbeSize = 5000000;
+    const int64_t kFullAnalyzeDurationUs = 5000000;
+    
+    // 竞速等待关键帧时最多暂存的包数：数据已经在流动，不再继续等待
+    const int kMaxRacePackets = 300;
+    const int kMaxFirstFramePackets = 500;   // 首帧预读最多读取的包数（包括其他流的包）
+    
+    qint64 monotonicMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    bool videoParamsReady(const AVCodecParameters *par)
+    {
+        return par->width > 0 && par->height > 0 && par->format != -1;
+    }
+    
+    bool audioParamsReady(const AVCodecParameters *par)
+    {
+        return par->sample_rate > 0 && par->ch_layout.nb_channels > 0;
+    }
+}
+
+struct NetworkStreamLoader::LoadJob
+{
+    quint64 id = 0;
+    QString url;
+    bool isNetworkSource = true;
+    LatencyProfile profile;
+    std::atomic<qint64> deadlineMs{0};  // 单调时钟截止时间，超过后中断FFmpeg调用；接管预连接时延后
+    qint64 httpCacheBytes = 0;       // HTTP点播磁盘缓存上限，0表示不缓存
+    bool qualityControl = false;     // HLS自适应码率
+    int maxBitrateKbps = 0;
+    bool racing = false;             // RTSP传输方式竞速，读到第一个关键帧才算成功
+    bool firstFramePreroll = true;   // 就绪前解码第一个视频帧
+    bool rememberedTransport = false;  // 传输方式来自该主机上次的竞速结果
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> warmPending{false};  // 预连接：打开输入后等待接管，不继续探测
+    bool warmOpened = false;         // 预连接已打开输入（仅主线程访问）
+    QElapsedTimer queuedTimer;       // 提交到线程池的时间
+    QElapsedTimer cancelTimer;       // 取消的时间（在设置cancelled之前启动）
+    
+    // 加载过程中创建的上下文，移交后置空
+    AVFormatContext *formatContext = nullptr;
+    AVCodecContext *videoCodecContext = nullptr;
+    AVCodecContext *audioCodecContext = nullptr;
+    int videoStreamIndex = -1;
+    int audioStreamIndex = -1;
+    bool audioPending = false;
+    QList<AVPacket*> prerollPackets;
+    AVFrame *firstFrame = nullptr;   // 首帧预读解码的帧
+    qint64 connectMs = -1;           // 打开输入的耗时
+    std::unique_ptr<HttpValidator> validator;  // HTTP点播的版本标识，本次打开的各个缓存共用
+    
+    bool timedOut() const { return monotonicMs() > deadlineMs; }
+    bool shouldInterrupt() const { return cancelled || timedOut(); }
+    
+    ~LoadJob()
+    {
+        // 被取消、失败或被新任务取代的结果在这里释放
+        for (AVPacket *packet : prerollPackets) {
+            av_packet_free(&packet);
+        }
+        av_frame_free(&firstFrame);
+        avcodec_free_context(&videoCodecContext);
+        avcodec_free_context(&audioCodecContext);
+        NetworkStreamLoader::closeInput(&formatContext);
+    }
+};
+
 NetworkStreamLoader::NetworkStreamLoader(QObject *parent)
+    : NetworkStreamLoader(nullptr, parent)
+{
+}
+
+NetworkStreamLoader::NetworkStreamLoader(QThreadPool *threadPool, QObject *parent)
     : QObject(parent)
     , m_status(Idle)
     , m_timeoutMs(15000)
-    , m_formatContext(nullptr)
-    , m_videoCodecContext(nullptr)
-    , m_audioCodecContext(nullptr)
-    , m_videoStreamIndex(-1)
-    , m_audioStreamIndex(-1)
     , m_timeoutTimer(new QTimer(this))
     , m_progressTimer(new QTimer(this))
-    , m_workerThread(nullptr)
-    , m_shouldCancel(false)
+    , m_warmExpiryTimer(new QTimer(this))
+    , m_pool(threadPool ? threadPool : &m_threadPool)
+    , m_nextJobId(0)
+    , m_threadStartupUs(0)
+    , m_httpCacheBytes(0)
+    , m_qualityControl(false)
+    , m_firstFramePreroll(true)
+    , m_maxBitrateKbps(0)
 {
     // 设置超时定时器
     m_timeoutTimer->setSingleShot(true);
@@ -30,36 +119,108 @@ NetworkStreamLoader::NetworkStreamLoader(QObject *parent)
     // 设置进度定时器
     m_progressTimer->setInterval(500);  // 每500ms更新一次进度
     connect(m_progressTimer, &QTimer::timeout, this, &NetworkStreamLoader::onProgressTimer);
+    
+    // 预连接长时间未被接管时释放连接
+    m_warmExpiryTimer->setSingleShot(true);
+    connect(m_warmExpiryTimer, &QTimer::timeout, this, &NetworkStreamLoader::cancelPreconnect);
+    
+    // 外部线程池的线程数和回收时间由其所有者决定，也不预热
+    if (threadPool) {
+        return;
+    }
+    
+    // 线程常驻不过期；同时可并行探测4路（RTSP竞速两路，换台时被取消的任务可能仍在退出）
+    m_threadPool.setMaxThreadCount(4);
+    m_threadPool.setExpiryTimeout(-1);
+    
+    // 预热一个线程，并测量创建线程的耗时作为每次换台节省的参考
+    auto prewarmTimer = std::make_shared<QElapsedTimer>();
+    prewarmTimer->start();
+    m_pool->start([this, prewarmTimer]() {
+        m_threadStartupUs = prewarmTimer->nsecsElapsed() / 1000;
+    });
 }
 
 NetworkStreamLoader::~NetworkStreamLoader()
 {
     cancelLoading();
-    cleanup();
+    cancelPreconnect();
+    
+    // 中断回调保证被取消的任务很快返回；共用的池中其他加载器的任务也会被等待，
+    // 所有者应先取消全部加载器再逐个释放
+    m_pool->waitForDone();
 }
 
 void NetworkStreamLoader::loadStreamAsync(const QString &url, int timeoutMs)
 {
-    if (isLoading()) {
+    loadStreamAsync(url, LatencyProfile::forUrl(url), timeoutMs);
+}
+
+void NetworkStreamLoader::loadStreamAsync(const QString &url, const LatencyProfile &profile, int timeoutMs)
+{
+    if (m_currentJob) {
         qDebug() << "NetworkStreamLoader: Already loading, cancelling previous operation";
         cancelLoading();
     }
     
     m_url = url;
     m_timeoutMs = timeoutMs;
-    m_shouldCancel = false;
-    
-    // Starting async load
-    
-    // 清理之前的资源
-    cleanup();
-    
-    // 创建工作线程，但不移动this对象
-    m_workerThread = new QThread();
     
-    // 连接信号 - 使用队列连接确保线程安全
-    connect(m_workerThread, &QThread::started, this, &NetworkStreamLoader::startLoading, Qt::QueuedConnection);
-    connect(m_workerThread, &QThread::finished, m_workerThread, &QThread::deleteLater);
+    // 同一URL和设置的预连接：接管已打开（或正在打开）的输入
+    JobPtr job;
+    bool adopted = matchesWarmJob(url, profile);
+    if (adopted) {
+        job = m_warmJob;
+        m_warmJob.reset();
+        m_warmExpiryTimer->stop();
+        job->warmPending = false;
+        job->deadlineMs = monotonicMs() + timeoutMs;
+        qDebug() << "[PRECONNECT] Load adopts job" << job->id
+                 << (job->warmOpened ? QString("with open connection (saved %1 ms)").arg(job->connectMs)
+                                     : QString("still connecting"));
+        job->queuedTimer.start();
+    } else {
+        cancelPreconnect();
+        
+        job = std::make_shared<LoadJob>();
+        job->id = ++m_nextJobId;
+        job->url = url;
+        job->isNetworkSource = url.contains("://") && !url.startsWith("file://", Qt::CaseInsensitive);
+        job->profile = profile;
+        job->deadlineMs = monotonicMs() + timeoutMs;
+        job->httpCacheBytes = m_httpCacheBytes;
+        job->qualityControl = m_qualityControl;
+        job->maxBitrateKbps = m_maxBitrateKbps;
+        job->firstFramePreroll = m_firstFramePreroll;
+        job->queuedTimer.start();
+    }
+    m_currentJob = job;
+    
+    // RTSP未指定传输方式：使用该主机上次胜出的方式；没有记录时UDP和TCP并行连接，
+    // 先收到关键帧的一路胜出，UDP被拦截时不必等到超时才回退TCP
+    QUrl parsedUrl(url);
+    if (job->isNetworkSource && parsedUrl.scheme().compare("rtsp", Qt::CaseInsensitive) == 0 &&
+        profile.transport() == LatencyProfile::AutoTransport) {
+        auto remembered = m_rtspTransports.constFind(parsedUrl.host());
+        if (remembered != m_rtspTransports.constEnd()) {
+            job->profile = LatencyProfile(profile.mode(), remembered.value());
+            job->rememberedTransport = true;
+        } else {
+            job->profile = LatencyProfile(profile.mode(), LatencyProfile::Udp);
+            job->racing = true;
+            
+            auto rival = std::make_shared<LoadJob>();
+            rival->id = ++m_nextJobId;
+            rival->url = url;
+            rival->isNetworkSource = true;
+            rival->profile = LatencyProfile(profile.mode(), LatencyProfile::Tcp);
+            rival->deadlineMs = job->deadlineMs.load();
+            rival->racing = true;
+            rival->queuedTimer.start();
+            m_raceJob = rival;
+            qDebug() << "[RACE] Racing RTSP over UDP (job" << job->id << ") and TCP (job" << rival->id << ")";
+        }
+    }
     
     // 设置状态并启动
     setStatus(Connecting);
@@ -69,36 +230,133 @@ void NetworkStreamLoader::loadStreamAsync(const QString &url, int timeoutMs)
     m_timeoutTimer->start(m_timeoutMs);
     m_progressTimer->start();
     
-    // 启动线程
-    m_workerThread->start();
+    // 提交到常驻线程池；仍在打开的预连接由其工作线程继续探测
+    if (!adopted || job->warmOpened) {
+        m_pool->start([this, job]() {
+            runJob(job);
+        });
+    }
+    if (m_raceJob) {
+        JobPtr rival = m_raceJob;
+        m_pool->start([this, rival]() {
+            runJob(rival);
+        });
+    }
     
     emit loadingStarted();
 }
 
 void NetworkStreamLoader::cancelLoading()
 {
-    QMutexLocker locker(&m_cancelMutex);
-    m_shouldCancel = true;
-    
     // 停止定时器
     m_timeoutTimer->stop();
     m_progressTimer->stop();
     
-    if (m_workerThread && m_workerThread->isRunning()) {
-        qDebug() << "NetworkStreamLoader: Cancelling loading operation";
-        
-        // 等待线程完成
-        m_workerThread->quit();
-        if (!m_workerThread->wait(3000)) {
-            qDebug() << "NetworkStreamLoader: Force terminating worker thread";
-            m_workerThread->terminate();
-            m_workerThread->wait(1000);
-        }
-        
-        m_workerThread = nullptr;
-        setStatus(Cancelled);
-        emit loadingCancelled();
+    if (!m_currentJob) {
+        return;
+    }
+    
+    qDebug() << "NetworkStreamLoader: Cancelling job" << m_currentJob->id;
+    cancelJobs();
+    
+    setStatus(Cancelled);
+    emit loadingCancelled();
+}
+
+void NetworkStreamLoader::preconnect(const QString &url, const LatencyProfile &profile)
+{
+    // 其他协议打开后立即开始接收媒体数据，不预先打开
+    QUrl parsedUrl(url);
+    QString scheme = parsedUrl.scheme().toLower();
+    if ((scheme != "http" && scheme != "https") || profile.isLowLatency()) {
+        cancelPreconnect();
+        return;
+    }
+    
+    if (matchesWarmJob(url, profile)) {
+        return;
+    }
+    cancelPreconnect();
+    
+    auto job = std::make_shared<LoadJob>();
+    job->id = ++m_nextJobId;
+    job->url = url;
+    job->isNetworkSource = true;
+    job->profile = profile;
+    job->deadlineMs = monotonicMs() + kPreconnectTimeoutMs;
+    job->httpCacheBytes = m_httpCacheBytes;
+    job->qualityControl = m_qualityControl;
+    job->maxBitrateKbps = m_maxBitrateKbps;
+    job->firstFramePreroll = m_firstFramePreroll;
+    job->warmPending = true;
+    job->queuedTimer.start();
+    m_warmJob = job;
+    
+    qDebug() << "[PRECONNECT] Opening" << parsedUrl.host() << "ahead of load (job" << job->id << ")";
+    m_pool->start([this, job]() {
+        runJob(job);
+    });
+}
+
+void NetworkStreamLoader::cancelPreconnect()
+{
+    m_warmExpiryTimer->stop();
+    if (!m_warmJob) {
+        return;
+    }
+    
+    // 打开中的由中断回调返回；已打开的连接随最后一个引用释放
+    qDebug() << "[PRECONNECT] Discarding job" << m_warmJob->id;
+    m_warmJob->cancelTimer.start();
+    m_warmJob->cancelled = true;
+    m_warmJob.reset();
+}
+
+void NetworkStreamLoader::deliverStream(const StreamInfo &streamInfo)
+{
+    if (m_currentJob) {
+        cancelLoading();
     }
+    cancelPreconnect();
+    
+    m_url = streamInfo.url;
+    setStatus(Ready);
+    emit streamReady(streamInfo);
+}
+
+bool NetworkStreamLoader::matchesWarmJob(const QString &url, const LatencyProfile &profile) const
+{
+    return m_warmJob && m_warmJob->url == url &&
+           m_warmJob->profile.mode() == profile.mode() && m_warmJob->profile.transport() == profile.transport() &&
+           m_warmJob->httpCacheBytes == m_httpCacheBytes && m_warmJob->qualityControl == m_qualityControl &&
+           m_warmJob->maxBitrateKbps == m_maxBitrateKbps;
+}
+
+void NetworkStreamLoader::parkWarmJob(const JobPtr &job)
+{
+    if (job->cancelled) {
+        return;
+    }
+    
+    // 打开期间已被加载接管：继续探测
+    if (job == m_currentJob) {
+        m_pool->start([this, job]() {
+            runJob(job);
+        });
+        return;
+    }
+    
+    if (job != m_warmJob) {
+        return;
+    }
+    if (!job->formatContext) {
+        qDebug() << "[PRECONNECT] Job" << job->id << "failed to connect, load will start from scratch";
+        m_warmJob.reset();
+        return;
+    }
+    job->warmOpened = true;
+    m_warmExpiryTimer->start(kWarmMaxAgeMs);
+    qDebug() << "[PRECONNECT] Job" << job->id << "connected in" << job->connectMs << "ms, waiting for load";
 }
 
 bool NetworkStreamLoader::isLoading() const
@@ -128,161 +386,275 @@ QString NetworkStreamLoader::getStatusText() const
     }
 }
 
-void NetworkStreamLoader::startLoading()
+void NetworkStreamLoader::setHttpCacheLimit(qint64 bytes)
 {
-    // Starting loading in worker thread
+    m_httpCacheBytes = bytes;
+}
+
+void NetworkStreamLoader::setQualityControl(bool enabled, int maxBitrateKbps)
+{
+    m_qualityControl = enabled;
+    m_maxBitrateKbps = maxBitrateKbps;
+}
+
+void NetworkStreamLoader::setFirstFramePreroll(bool enabled)
+{
+    m_firstFramePreroll = enabled;
+}
+
+void NetworkStreamLoader::closeInput(AVFormatContext **formatContext)
+{
+    if (!*formatContext) {
+        return;
+    }
     
-    // 创建一个在工作线程中运行的QObject
-    auto worker = new QObject();
-    worker->moveToThread(m_workerThread);
+    // 自定义IO和IO回调的所有者不随上下文释放；关闭时仍会回调，关闭后再释放
+    HttpRangeCache *rangeCache = HttpRangeCache::fromContext(*formatContext);
+    HlsAbrController *abrController = HlsAbrController::fromContext(*formatContext);
+    MpegTsMonitor *tsMonitor = MpegTsMonitor::fromContext(*formatContext);
     
-    // 连接信号，在工作线程中执行实际的加载工作
-    connect(this, &NetworkStreamLoader::doAsyncWork, worker, [this, worker]() {
-        performAsyncLoading();
-        worker->deleteLater();
-    }, Qt::QueuedConnection);
+    avformat_close_input(formatContext);
     
-    // 发送信号开始工作
-    emit doAsyncWork();
+    if (rangeCache) {
+        rangeCache->detach();
+        delete rangeCache;
+    }
+    delete abrController;
+    if (tsMonitor) {
+        tsMonitor->detach();
+        delete tsMonitor;
+    }
 }
 
-void NetworkStreamLoader::performAsyncLoading()
+void NetworkStreamLoader::cancelJobs()
 {
-    qDebug() << "NetworkStreamLoader: Performing async loading in worker thread";
-    
-    try {
-        // 检查取消状态
-        {
-            QMutexLocker locker(&m_cancelMutex);
-            if (m_shouldCancel) {
-                setStatus(Cancelled);
-                emit loadingCancelled();
-                return;
+    // 中断回调检测到取消标志后，阻塞中的FFmpeg调用立即返回
+    // 不等待工作线程：任务自行结束，上下文随任务释放
+    for (const JobPtr &job : { m_currentJob, m_raceJob }) {
+        if (job) {
+            job->cancelTimer.start();
+            job->cancelled = true;
+        }
+    }
+    m_currentJob.reset();
+    m_raceJob.reset();
+}
+
+void NetworkStreamLoader::retireJob(const JobPtr &job)
+{
+    if (job == m_currentJob) {
+        m_currentJob = m_raceJob;
+    }
+    m_raceJob.reset();
+}
+
+void NetworkStreamLoader::runJob(const JobPtr &job)
+{
+    // 线程池中已有常驻线程时，调度耗时远小于创建线程
+    qint64 dispatchUs = job->queuedTimer.nsecsElapsed() / 1000;
+    qint64 threadStartupUs = m_threadStartupUs;
+    qDebug() << "[LOADER] Job" << job->id << "dispatched after" << dispatchUs << "us, saved ~"
+             << qMax<qint64>(0, threadStartupUs - dispatchUs) << "us of thread startup";
+    
+    if (!job->cancelled) {
+        // 打开输入流、查找流信息、设置解码器，失败时错误已投递到主线程
+        // 接管的预连接已打开输入，直接从探测开始
+        bool opened = (job->formatContext != nullptr);
+        if (!opened) {
+            postProgress(job, 10, "正在建立连接...");
+            QElapsedTimer connectTimer;
+            connectTimer.start();
+            opened = openInputStream(job);
+            if (opened) {
+                job->connectMs = connectTimer.elapsed();
             }
         }
         
-        emitProgress(10, "正在建立连接...");
-        
-        // 第一步：打开输入流
-        if (!openInputStream()) {
-            // 使用QMetaObject::invokeMethod在主线程中停止定时器
-            QMetaObject::invokeMethod(this, [this]() {
-                m_timeoutTimer->stop();
-                m_progressTimer->stop();
+        // 预连接未被接管：停在打开输入之后，失败时也交回主线程丢弃
+        if (job->warmPending) {
+            QMetaObject::invokeMethod(this, [this, job]() {
+                parkWarmJob(job);
             }, Qt::QueuedConnection);
-            return;  // 错误已经在函数内部处理
+            opened = false;
         }
         
-        // 检查取消状态
-        {
-            QMutexLocker locker(&m_cancelMutex);
-            if (m_shouldCancel) {
-                setStatus(Cancelled);
-                emit loadingCancelled();
-                return;
+        if (opened) {
+            postStatus(job, LoadingStreamInfo);
+            postProgress(job, 40, "正在获取流信息...");
+            
+            if (findStreamInfo(job)) {
+                postProgress(job, 70, "正在设置解码器...");
+                
+                if (setupCodecs(job) && (!job->racing || waitForKeyframe(job)) &&
+                    (!job->firstFramePreroll || decodeFirstFrame(job))) {
+                    postProgress(job, 100, "连接成功");
+                    
+                    // 在主线程中移交；届时已被取消或取代则随任务释放
+                    QMetaObject::invokeMethod(this, [this, job]() {
+                        finishJob(job);
+                    }, Qt::QueuedConnection);
+                }
             }
         }
-        
-        emitProgress(40, "正在获取流信息...");
-        setStatus(LoadingStreamInfo);
-        
-        // 第二步：查找流信息
-        if (!findStreamInfo()) {
-            // 使用QMetaObject::invokeMethod在主线程中停止定时器
-            QMetaObject::invokeMethod(this, [this]() {
-                m_timeoutTimer->stop();
-                m_progressTimer->stop();
-            }, Qt::QueuedConnection);
-            return;  // 错误已经在函数内部处理
+    }
+    
+    if (job->cancelled && job->cancelTimer.isValid()) {
+        qDebug() << "[LOADER] Job" << job->id << "released" << job->cancelTimer.elapsed() << "ms after cancel";
+    }
+}
+
+void NetworkStreamLoader::finishJob(const JobPtr &job)
+{
+    if (!isCurrentJob(job)) {
+        qDebug() << "NetworkStreamLoader: Discarding superseded job" << job->id;
+        return;
+    }
+    
+    // 竞速胜出：中断另一路，记住该主机的胜出方式
+    if (job->racing) {
+        JobPtr rival = (job == m_currentJob) ? m_raceJob : m_currentJob;
+        if (rival) {
+            rival->cancelTimer.start();
+            rival->cancelled = true;
         }
-        
-        // 检查取消状态
-        {
-            QMutexLocker locker(&m_cancelMutex);
-            if (m_shouldCancel) {
-                setStatus(Cancelled);
-                emit loadingCancelled();
-                return;
-            }
+        LatencyProfile::Transport transport = job->profile.transport();
+        m_rtspTransports.insert(QUrl(job->url).host(), transport);
+        qDebug() << "[RACE]" << (transport == LatencyProfile::Tcp ? "TCP" : "UDP")
+                 << "won after" << job->queuedTimer.elapsed() << "ms, remembered for" << QUrl(job->url).host();
+    }
+    
+    m_currentJob.reset();
+    m_raceJob.reset();
+    m_timeoutTimer->stop();
+    m_progressTimer->stop();
+    
+    // 上下文交给播放器后不再引用任务，移除中断回调
+    job->formatContext->interrupt_callback.callback = nullptr;
+    job->formatContext->interrupt_callback.opaque = nullptr;
+    
+    // 创建流信息结构
+    StreamInfo streamInfo;
+    streamInfo.url = job->url;
+    streamInfo.isNetworkSource = job->isNetworkSource;
+    streamInfo.latencyProfile = job->profile;
+    streamInfo.videoStreamIndex = job->videoStreamIndex;
+    streamInfo.audioStreamIndex = job->audioStreamIndex;
+    streamInfo.audioPending = job->audioPending;
+    streamInfo.videoCodecContext = job->videoCodecContext;
+    streamInfo.audioCodecContext = job->audioCodecContext;
+    streamInfo.formatContext = job->formatContext;
+    streamInfo.prerollPackets = job->prerollPackets;
+    streamInfo.firstFrame = job->firstFrame;
+    streamInfo.duration = job->formatContext->duration;
+    streamInfo.connectMs = static_cast<int>(job->connectMs);
+    streamInfo.loadMs = static_cast<int>(job->queuedTimer.elapsed());
+    streamInfo.width = job->videoCodecContext ? job->videoCodecContext->width : 0;
+    streamInfo.height = job->videoCodecContext ? job->videoCodecContext->height : 0;
+    
+    if (job->videoStreamIndex >= 0) {
+        AVStream *videoStream = job->formatContext->streams[job->videoStreamIndex];
+        streamInfo.fps = av_q2d(videoStream->r_frame_rate);
+    } else {
+        streamInfo.fps = 0.0;
+    }
+    
+    // 所有权转移给接收者
+    job->formatContext = nullptr;
+    job->videoCodecContext = nullptr;
+    job->audioCodecContext = nullptr;
+    job->prerollPackets.clear();
+    job->firstFrame = nullptr;
+    
+    // 设置成功状态
+    setStatus(Ready);
+    
+    // 发送成功信号
+    emit streamReady(streamInfo);
+    
+    qDebug() << "NetworkStreamLoader: Stream loaded successfully in" << job->queuedTimer.elapsed() << "ms";
+}
+
+bool NetworkStreamLoader::isCurrentJob(const JobPtr &job) const
+{
+    return (job == m_currentJob || job == m_raceJob) && !job->cancelled;
+}
+
+void NetworkStreamLoader::postStatus(const JobPtr &job, LoadingStatus status)
+{
+    QMetaObject::invokeMethod(this, [this, job, status]() {
+        if (isCurrentJob(job)) {
+            setStatus(status);
         }
-        
-        emitProgress(70, "正在设置解码器...");
-        
-        // 第三步：设置解码器
-        if (!setupCodecs()) {
-            // 使用QMetaObject::invokeMethod在主线程中停止定时器
-            QMetaObject::invokeMethod(this, [this]() {
-                m_timeoutTimer->stop();
-                m_progressTimer->stop();
-            }, Qt::QueuedConnection);
-            return;  // 错误已经在函数内部处理
+    }, Qt::QueuedConnection);
+}
+
+void NetworkStreamLoader::postProgress(const JobPtr &job, int percentage, const QString &message)
+{
+    QMetaObject::invokeMethod(this, [this, job, percentage, message]() {
+        if (isCurrentJob(job)) {
+            emitProgress(percentage, message);
         }
-        
-        emitProgress(100, "连接成功");
-        
-        // 创建流信息结构
-        StreamInfo streamInfo;
-        streamInfo.url = m_url;
-        streamInfo.videoStreamIndex = m_videoStreamIndex;
-        streamInfo.audioStreamIndex = m_audioStreamIndex;
-        streamInfo.videoCodecContext = m_videoCodecContext;
-        streamInfo.audioCodecContext = m_audioCodecContext;
-        streamInfo.formatContext = m_formatContext;
-        streamInfo.duration = m_formatContext->duration;
-        streamInfo.width = m_videoCodecContext ? m_videoCodecContext->width : 0;
-        streamInfo.height = m_videoCodecContext ? m_videoCodecContext->height : 0;
-        
-        if (m_videoStreamIndex >= 0) {
-            AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
-            streamInfo.fps = av_q2d(videoStream->r_frame_rate);
-        } else {
-            streamInfo.fps = 0.0;
+    }, Qt::QueuedConnection);
+}
+
+void NetworkStreamLoader::postFailure(const JobPtr &job, const QString &error)
+{
+    QMetaObject::invokeMethod(this, [this, job, error]() {
+        // 取消或超时导致的中断已由主线程报告
+        if (!isCurrentJob(job)) {
+            qDebug() << "NetworkStreamLoader: Job" << job->id << "interrupted:" << error;
+            return;
         }
         
-        // 停止所有定时器
-        QMetaObject::invokeMethod(this, [this]() {
-            m_timeoutTimer->stop();
-            m_progressTimer->stop();
-        }, Qt::QueuedConnection);
+        // 竞速中一路失败：等待另一路
+        bool rivalRunning = m_raceJob && m_currentJob && !job->timedOut();
+        retireJob(job);
+        if (rivalRunning) {
+            qDebug() << "[RACE] Job" << job->id << "lost:" << error;
+            return;
+        }
         
-        // 设置成功状态
-        setStatus(Ready);
+        // 上次胜出的传输方式不再可用：下次重新竞速
+        if (job->rememberedTransport) {
+            m_rtspTransports.remove(QUrl(job->url).host());
+        }
         
-        // 发送成功信号
-        emit streamReady(streamInfo);
+        m_currentJob.reset();
+        m_timeoutTimer->stop();
+        m_progressTimer->stop();
         
-        qDebug() << "NetworkStreamLoader: Stream loaded successfully";
-        return;  // 明确返回，避免后续错误处理
+        // 截止时间到达而超时定时器尚未触发
+        if (job->timedOut()) {
+            setStatus(Timeout);
+            emit loadingFailed("连接超时");
+            return;
+        }
         
-    } catch (const std::exception &e) {
-        QString error = QString("加载过程中发生异常: %1").arg(e.what());
-        qDebug() << "NetworkStreamLoader: Exception:" << error;
-        setStatus(Failed);
-        emit loadingFailed(error);
-    } catch (...) {
-        QString error = "加载过程中发生未知异常";
-        qDebug() << "NetworkStreamLoader: Unknown exception";
         setStatus(Failed);
         emit loadingFailed(error);
-    }
+    }, Qt::QueuedConnection);
+}
+
+int NetworkStreamLoader::interruptCallback(void *opaque)
+{
+    auto *job = static_cast<LoadJob*>(opaque);
+    return job->shouldInterrupt() ? 1 : 0;
 }
 
 void NetworkStreamLoader::onTimeoutTimer()
 {
     qDebug() << "NetworkStreamLoader: Timeout occurred";
     
-    {
-        QMutexLocker locker(&m_cancelMutex);
-        m_shouldCancel = true;
+    m_progressTimer->stop();
+    if (!m_currentJob) {
+        return;
     }
     
+    // 中断回调随即让工作线程中的FFmpeg调用返回
+    cancelJobs();
+    
     setStatus(Timeout);
     emit loadingFailed("连接超时");
-    
-    if (m_workerThread && m_workerThread->isRunning()) {
-        m_workerThread->quit();
-        m_workerThread->wait(2000);
-    }
 }
 
 void NetworkStreamLoader::onProgressTimer()
@@ -330,134 +702,223 @@ void NetworkStreamLoader::setStatus(LoadingStatus status)
     }
 }
 
-void NetworkStreamLoader::cleanup()
-{
-    // 注意：这些指针的所有权将转移给调用者，这里不释放
-    // 只重置本地指针
-    m_formatContext = nullptr;
-    m_videoCodecContext = nullptr;
-    m_audioCodecContext = nullptr;
-    m_videoStreamIndex = -1;
-    m_audioStreamIndex = -1;
-}
-
-bool NetworkStreamLoader::setupNetworkOptions(AVDictionary **options)
-{
-    av_dict_set(options, "timeout", "10000000", 0);      // 10秒超时
-    av_dict_set(options, "buffer_size", "1024000", 0);   // 1MB缓冲
-    av_dict_set(options, "max_delay", "5000000", 0);     // 5秒最大延迟
-    av_dict_set(options, "user_agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36", 0);
-    av_dict_set(options, "reconnect", "1", 0);           // 启用重连
-    av_dict_set(options, "reconnect_streamed", "1", 0);  // 流式重连
-    av_dict_set(options, "reconnect_delay_max", "5", 0); // 最大重连延迟5秒
-    
-    return true;
-}
-
-bool NetworkStreamLoader::openInputStream()
+bool NetworkStreamLoader::openInputStream(const JobPtr &job)
 {
     AVDictionary *options = nullptr;
-    setupNetworkOptions(&options);
+    QString openUrl = job->url;
+    // 本地文件不需要连接参数（部分协议选项会被文件协议报告为未使用）
+    if (job->isNetworkSource) {
+        job->profile.applyFormatOptions(&options, job->url);
+        qDebug() << "NetworkStreamLoader: Latency profile:" << job->profile.description();
+        
+        // UDP/TCP上的MPEG-TS：大接收缓冲，UDP另设接收FIFO和源特定组播
+        QString scheme = QUrl(job->url).scheme().toLower();
+        if (scheme == "udp") {
+            openUrl = UdpStreamHandler::applySocketOptions(&options, job->url, 0);
+        } else if (scheme == "tcp") {
+            TcpStreamHandler::applySocketOptions(&options, 0);
+        }
+    }
     
-    m_formatContext = avformat_alloc_context();
-    if (!m_formatContext) {
+    job->formatContext = avformat_alloc_context();
+    if (!job->formatContext) {
         av_dict_free(&options);
-        setStatus(Failed);
-        emit loadingFailed("无法分配格式上下文");
+        postFailure(job, "无法分配格式上下文");
         return false;
     }
     
-    QByteArray urlBytes = m_url.toUtf8();
-    int ret = avformat_open_input(&m_formatContext, urlBytes.constData(), nullptr, &options);
+    // 取消或超过截止时间时让所有阻塞的FFmpeg调用立即返回
+    job->formatContext->interrupt_callback.callback = &NetworkStreamLoader::interruptCallback;
+    job->formatContext->interrupt_callback.opaque = job.get();
+    
+    // 版本标识请求使用相同的UA、请求头和中断条件，需要时才发出
+    if (job->isNetworkSource) {
+        job->validator.reset(new HttpValidator(job->url, options, &job->formatContext->interrupt_callback));
+    }
+    
+    // HTTP点播经磁盘字节范围缓存读取，seek回已下载的区域不再请求网络
+    HttpRangeCache *rangeCache = nullptr;
+    if (job->isNetworkSource && job->httpCacheBytes > 0 && HttpRangeCache::isCacheable(job->url, job->profile)) {
+        rangeCache = HttpRangeCache::open(job->url, job->formatContext, options, job->httpCacheBytes,
+                                          job->validator.get());
+    }
+    
+    // HLS自适应码率接管分片IO以测量下载吞吐量
+    HlsAbrController *abrController = nullptr;
+    if (job->isNetworkSource && job->qualityControl && HlsAbrController::isHlsUrl(job->url)) {
+        abrController = HlsAbrController::install(job->formatContext, &options, job->maxBitrateKbps);
+    }
+    
+    // UDP/TCP传输流经监测读取，统计连续计数器错误和丢包
+    MpegTsMonitor *tsMonitor = nullptr;
+    if (job->isNetworkSource && MpegTsMonitor::isMonitorable(job->url)) {
+        tsMonitor = MpegTsMonitor::open(openUrl, job->formatContext, options);
+    }
+    
+    QByteArray urlBytes = openUrl.toUtf8();
+    int ret = avformat_open_input(&job->formatContext, urlBytes.constData(), nullptr, &options);
     av_dict_free(&options);
     
     if (ret != 0) {
+        // 自定义IO和码率控制不随上下文释放
+        if (rangeCache) {
+            rangeCache->detach();
+            delete rangeCache;
+        }
+        delete abrController;
+        if (tsMonitor) {
+            tsMonitor->detach();
+            delete tsMonitor;
+        }
+        
         char error_buf[AV_ERROR_MAX_STRING_SIZE];
         av_strerror(ret, error_buf, sizeof(error_buf));
-        QString error = QString("无法打开网络流: %1").arg(error_buf);
+        QString error = QString(job->isNetworkSource ? "无法打开网络流: %1" : "无法打开文件: %1").arg(error_buf);
         
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-        
-        setStatus(Failed);
-        emit loadingFailed(error);
+        // 打开失败时FFmpeg已释放上下文并置空
+        postFailure(job, error);
         return false;
     }
     
+    // 在探测前只保留起始档位，其他档位不再下载分片
+    if (abrController) {
+        abrController->prepare(job->formatContext);
+    }
+    
     return true;
 }
 
-bool NetworkStreamLoader::findStreamInfo()
+bool NetworkStreamLoader::findStreamInfo(const JobPtr &job)
 {
-    if (avformat_find_stream_info(m_formatContext, nullptr) < 0) {
-        setStatus(Failed);
-        emit loadingFailed("无法获取流信息");
+    AVFormatContext *formatContext = job->formatContext;
+    
+    // 缓存命中：预先填入上次完整探测的参数，只需很小的探测量，并跳过从文件末尾估计时长
+    QString cacheKey = m_probeCache.keyFor(job->url, formatContext, job->validator.get());
+    bool warm = m_probeCache.apply(cacheKey, formatContext);
+    
+    // 网络流先快速探测，低延迟配置已在打开参数中设置了更小的探测量
+    bool limitedProbe = job->isNetworkSource || warm;
+    if (warm) {
+        formatContext->probesize = ProbeCache::kWarmProbeSize;
+        formatContext->max_analyze_duration = ProbeCache::kWarmAnalyzeDurationUs;
+        formatContext->skip_estimate_duration_from_pts = 1;
+    } else if (limitedProbe && !job->profile.isLowLatency()) {
+        formatContext->probesize = kFastProbeSize;
+        formatContext->max_analyze_duration = kFastAnalyzeDurationUs;
+    }
+    
+    QElapsedTimer probeTimer;
+    probeTimer.start();
+    
+    if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+        postFailure(job, "无法获取流信息");
         return false;
     }
     
     // 查找视频流和音频流
-    m_videoStreamIndex = -1;
-    m_audioStreamIndex = -1;
-    
-    for (unsigned int i = 0; i < m_formatContext->nb_streams; i++) {
-        if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && m_videoStreamIndex == -1) {
-            m_videoStreamIndex = i;
-        } else if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && m_audioStreamIndex == -1) {
-            m_audioStreamIndex = i;
+    auto selectStreams = [job, formatContext]() {
+        // HLS多档位：使用码率控制选择的档位中的流
+        HlsAbrController *abrController = HlsAbrController::fromContext(formatContext);
+        if (abrController && abrController->isActive()) {
+            job->videoStreamIndex = abrController->currentVideoStream();
+            job->audioStreamIndex = abrController->currentAudioStream();
+            return;
+        }
+        
+        job->videoStreamIndex = -1;
+        job->audioStreamIndex = -1;
+        for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+            if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && job->videoStreamIndex == -1) {
+                job->videoStreamIndex = i;
+            } else if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && job->audioStreamIndex == -1) {
+                job->audioStreamIndex = i;
+            }
+        }
+    };
+    selectStreams();
+    
+    // 快速探测不足以确定视频参数时继续完整探测（已读取的数据不会重复读取）
+    bool videoReady = job->videoStreamIndex >= 0 &&
+                      videoParamsReady(formatContext->streams[job->videoStreamIndex]->codecpar);
+    if (limitedProbe && !videoReady && !job->shouldInterrupt()) {
+        qDebug() << "[TTFF] Fast probe incomplete after" << probeTimer.elapsed() << "ms, probing further";
+        formatContext->probesize = kFullProbeSize;
+        formatContext->max_analyze_duration = kFullAnalyzeDurationUs;
+        if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+            postFailure(job, "无法获取流信息");
+            return false;
         }
+        selectStreams();
     }
     
-    if (m_videoStreamIndex == -1) {
-        setStatus(Failed);
-        emit loadingFailed("未找到视频流");
+    if (job->videoStreamIndex == -1) {
+        postFailure(job, "未找到视频流");
         return false;
     }
     
+    // 音频参数未确定时不阻塞首帧，由播放器在收到音频后接入
+    job->audioPending = job->audioStreamIndex >= 0 &&
+                        !audioParamsReady(formatContext->streams[job->audioStreamIndex]->codecpar);
+    
+    if (warm) {
+        m_probeCache.restoreTimings(cacheKey, formatContext);
+    } else if (!job->audioPending) {
+        // 只保存参数完整的探测结果
+        m_probeCache.store(cacheKey, formatContext);
+    }
+    
+    qint64 probeMs = probeTimer.elapsed();
+    if (!cacheKey.isEmpty()) {
+        m_probeCache.recordProbeTime(warm, probeMs);
+        qDebug() << "[PROBE]" << (warm ? "Warm" : "Cold") << "probe" << probeMs << "ms -"
+                 << m_probeCache.benchmarkSummary();
+    }
+    
+    qDebug() << "[TTFF] Probe finished in" << probeMs << "ms"
+             << (job->audioPending ? "(audio pending)" : "");
+    
     return true;
 }
 
-bool NetworkStreamLoader::setupCodecs()
+bool NetworkStreamLoader::setupCodecs(const JobPtr &job)
 {
     // 设置视频解码器
-    if (m_videoStreamIndex >= 0) {
-        AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
+    if (job->videoStreamIndex >= 0) {
+        AVStream *videoStream = job->formatContext->streams[job->videoStreamIndex];
         const AVCodec *videoCodec = avcodec_find_decoder(videoStream->codecpar->codec_id);
         if (!videoCodec) {
-            setStatus(Failed);
-            emit loadingFailed("未找到视频解码器");
+            postFailure(job, "未找到视频解码器");
             return false;
         }
         
-        m_videoCodecContext = avcodec_alloc_context3(videoCodec);
-        if (avcodec_parameters_to_context(m_videoCodecContext, videoStream->codecpar) < 0) {
-            setStatus(Failed);
-            emit loadingFailed("无法设置视频解码器参数");
+        job->videoCodecContext = avcodec_alloc_context3(videoCodec);
+        if (avcodec_parameters_to_context(job->videoCodecContext, videoStream->codecpar) < 0) {
+            postFailure(job, "无法设置视频解码器参数");
             return false;
         }
         
-        if (avcodec_open2(m_videoCodecContext, videoCodec, nullptr) < 0) {
-            setStatus(Failed);
-            emit loadingFailed("无法打开视频解码器");
+        job->profile.applyCodecOptions(job->videoCodecContext);
+        
+        if (avcodec_open2(job->videoCodecContext, videoCodec, nullptr) < 0) {
+            postFailure(job, "无法打开视频解码器");
             return false;
         }
     }
     
-    // 设置音频解码器（如果有音频流）
-    if (m_audioStreamIndex >= 0) {
-        AVStream *audioStream = m_formatContext->streams[m_audioStreamIndex];
+    // 设置音频解码器（如果有音频流且参数已确定）
+    if (job->audioStreamIndex >= 0 && !job->audioPending) {
+        AVStream *audioStream = job->formatContext->streams[job->audioStreamIndex];
         const AVCodec *audioCodec = avcodec_find_decoder(audioStream->codecpar->codec_id);
         if (audioCodec) {
-            m_audioCodecContext = avcodec_alloc_context3(audioCodec);
-            if (avcodec_parameters_to_context(m_audioCodecContext, audioStream->codecpar) >= 0) {
-                if (avcodec_open2(m_audioCodecContext, audioCodec, nullptr) < 0) {
+            job->audioCodecContext = avcodec_alloc_context3(audioCodec);
+            if (avcodec_parameters_to_context(job->audioCodecContext, audioStream->codecpar) >= 0) {
+                if (avcodec_open2(job->audioCodecContext, audioCodec, nullptr) < 0) {
                     qDebug() << "NetworkStreamLoader: Cannot open audio decoder, video only";
-                    avcodec_free_context(&m_audioCodecContext);
-                    m_audioCodecContext = nullptr;
+                    avcodec_free_context(&job->audioCodecContext);
                 }
             } else {
                 qDebug() << "NetworkStreamLoader: Cannot set audio decoder parameters, video only";
-                avcodec_free_context(&m_audioCodecContext);
-                m_audioCodecContext = nullptr;
+                avcodec_free_context(&job->audioCodecContext);
             }
         } else {
             qDebug() << "NetworkStreamLoader: Audio decoder not found, video only";
@@ -467,8 +928,86 @@ bool NetworkStreamLoader::setupCodecs()
     return true;
 }
 
+bool NetworkStreamLoader::waitForKeyframe(const JobPtr &job)
+{
+    // UDP被拦截时RTSP握手仍然成功，但收不到媒体数据，所以以收到关键帧为准
+    // 探测时已缓冲的包最先返回，读到的包随上下文交给播放器
+    AVPacket *packet = av_packet_alloc();
+    while (job->prerollPackets.size() < kMaxRacePackets) {
+        int ret = av_read_frame(job->formatContext, packet);
+        if (ret < 0) {
+            av_packet_free(&packet);
+            postFailure(job, "未收到媒体数据");
+            return false;
+        }
+        
+        bool keyframe = packet->stream_index == job->videoStreamIndex && (packet->flags & AV_PKT_FLAG_KEY);
+        AVPacket *stored = av_packet_alloc();
+        av_packet_move_ref(stored, packet);
+        job->prerollPackets.append(stored);
+        if (keyframe) {
+            break;
+        }
+    }
+    
+    av_packet_free(&packet);
+    return true;
+}
+
+bool NetworkStreamLoader::decodeFirstFrame(const JobPtr &job)
+{
+    // 在工作线程中读到第一个能解码出画面的视频帧：直播等待关键帧时界面不阻塞，
+    // 阻塞读取由中断回调按取消和截止时间中断；读到的包全部保留，随上下文交给播放器从头解码
+    if (job->videoStreamIndex < 0 || !job->videoCodecContext) {
+        return true;
+    }
+    
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    int index = 0;
+    int readCount = 0;
+    while (readCount < kMaxFirstFramePackets) {
+        // 竞速或探测时已读到的包先解码
+        if (index >= job->prerollPackets.size()) {
+            int ret = av_read_frame(job->formatContext, packet);
+            if (ret < 0) {
+                break;
+            }
+            AVPacket *stored = av_packet_alloc();
+            av_packet_move_ref(stored, packet);
+            job->prerollPackets.append(stored);
+            readCount++;
+        }
+        
+        const AVPacket *current = job->prerollPackets.at(index++);
+        if (current->stream_index != job->videoStreamIndex) {
+            continue;
+        }
+        if (avcodec_send_packet(job->videoCodecContext, current) >= 0 &&
+            avcodec_receive_frame(job->videoCodecContext, frame) == 0) {
+            job->firstFrame = frame;
+            frame = nullptr;
+            break;
+        }
+    }
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    
+    // 解码器复位：播放器从第一个包重新解码，与没有预读时的状态一致
+    avcodec_flush_buffers(job->videoCodecContext);
+    
+    if (job->shouldInterrupt()) {
+        postFailure(job, "未收到视频帧");
+        return false;
+    }
+    if (!job->firstFrame) {
+        // 文件很短或前面的包都无法解码：不影响播放，只是没有预览
+        qDebug() << "[TTFF] Job" << job->id << "decoded no preview frame from" << job->prerollPackets.size() << "packets";
+    }
+    return true;
+}
+
 void NetworkStreamLoader::emitProgress(int percentage, const QString &message)
 {
-    // 直接发送信号，Qt会自动处理跨线程信号
     emit loadingProgress(percentage, message);
-} 
\ No newline at end of file
+}
\ No newline at end of file
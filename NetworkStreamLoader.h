@@ -2,16 +2,24 @@
 #define NETWORKSTREAMLOADER_H
 
 #include <QObject>
-#include <QThread>
+#include <QThreadPool>
 #include <QMutex>
 #include <QTimer>
 #include <QTime>
 #include <QString>
+#include <QHash>
+#include <QList>
+#include <atomic>
+#include <memory>
+#include "LatencyProfile.h"
+#include "ProbeCache.h"
 
 // Forward declarations for FFmpeg types
 struct AVFormatContext;
 struct AVCodecContext;
 struct AVDictionary;
+struct AVPacket;
+struct AVFrame;
 
 class NetworkStreamLoader : public QObject
 {
@@ -30,26 +38,56 @@ public:
 
     struct StreamInfo {
         QString url;
+        bool isNetworkSource;   // false表示本地文件
+        LatencyProfile latencyProfile;
         int videoStreamIndex;
         int audioStreamIndex;
+        bool audioPending;      // 快速探测时音频参数未确定，由播放器解码第一帧后接入
         AVCodecContext* videoCodecContext;
         AVCodecContext* audioCodecContext;
         AVFormatContext* formatContext;
+        QList<AVPacket*> prerollPackets;  // 加载时已读取的包（竞速的第一个关键帧、首帧预读读到的包），随上下文移交
+        AVFrame* firstFrame = nullptr;    // 工作线程解码的第一个视频帧（用于立即显示），接收者释放；解码器已复位，预读的包都在 prerollPackets 中
         int64_t duration;
+        int connectMs;          // 建立连接（打开输入）的耗时
+        int loadMs;             // 从提交加载到就绪的总耗时
         double fps;
         int width;
         int height;
     };
 
     explicit NetworkStreamLoader(QObject *parent = nullptr);
+    // 任务提交到外部线程池（如换台的待机加载器共用一个按需回收的池），池须比加载器存在得久
+    explicit NetworkStreamLoader(QThreadPool *threadPool, QObject *parent = nullptr);
     ~NetworkStreamLoader();
 
     // 主要接口
-    void loadStreamAsync(const QString &url, int timeoutMs = 15000);
+    void loadStreamAsync(const QString &url, int timeoutMs = 15000);  // 按协议选择延迟配置
+    void loadStreamAsync(const QString &url, const LatencyProfile &profile, int timeoutMs = 15000);
     void cancelLoading();
     bool isLoading() const;
+    
+    // 输入地址时预连接：HTTP(S)在后台打开输入（DNS、TCP/TLS握手、请求），之后对同一URL和设置的
+    // loadStreamAsync 直接接管已打开的连接，只需探测；低延迟源不预连接（数据会在套接字中积压）
+    // URL变化、设置不同或超过 kWarmMaxAgeMs 未被接管时丢弃
+    void preconnect(const QString &url, const LatencyProfile &profile);
+    void cancelPreconnect();
+    
+    // 移交在其他加载器中已就绪的流（换台待机），取消进行中的加载，与加载完成一样经 streamReady 发出
+    void deliverStream(const StreamInfo &streamInfo);
+    
     LoadingStatus getStatus() const;
     QString getStatusText() const;
+    
+    // HTTP点播磁盘缓存上限（字节），0表示不缓存；对之后开始的加载生效
+    void setHttpCacheLimit(qint64 bytes);
+    // HLS自适应码率开关和码率上限(kbps, 0表示不限)；对之后开始的加载生效
+    void setQualityControl(bool enabled, int maxBitrateKbps);
+    // 就绪前在工作线程中解码第一个视频帧（默认开启）；换台待机不显示，关闭以免白白解码
+    void setFirstFramePreroll(bool enabled);
+    
+    // 关闭加载器打开的格式上下文，连同附加在上面的磁盘缓存和码率控制
+    static void closeInput(AVFormatContext **formatContext);
 
 signals:
     void loadingStarted();
@@ -58,51 +96,70 @@ signals:
     void loadingFailed(const QString &error);
     void loadingCancelled();
     void statusChanged(LoadingStatus status);
-    void doAsyncWork();  // 内部信号，用于启动工作线程中的工作
-
-public slots:
-    void startLoading();
 
 private slots:
     void onTimeoutTimer();
     void onProgressTimer();
 
 private:
-    void performAsyncLoading();  // 实际的异步加载工作
-
-private:
+    // 一次加载任务：在线程池中执行，持有加载过程中创建的上下文
+    // 未交给播放器的上下文随最后一个引用释放
+    struct LoadJob;
+    using JobPtr = std::shared_ptr<LoadJob>;
+    
+    void runJob(const JobPtr &job);  // 工作线程中执行
+    void finishJob(const JobPtr &job);  // 主线程：移交结果或丢弃
+    void postStatus(const JobPtr &job, LoadingStatus status);
+    void postProgress(const JobPtr &job, int percentage, const QString &message);
+    void postFailure(const JobPtr &job, const QString &error);
+    bool isCurrentJob(const JobPtr &job) const;
+    void retireJob(const JobPtr &job);   // 任务不再是当前任务；竞速中另一路成为当前任务
+    void cancelJobs();                   // 中断当前任务（包括竞速中的另一路）
+    void parkWarmJob(const JobPtr &job); // 主线程：预连接已打开输入，等待接管
+    bool matchesWarmJob(const QString &url, const LatencyProfile &profile) const;
+    
+    static int interruptCallback(void *opaque);  // FFmpeg阻塞调用中周期性检查
+    bool openInputStream(const JobPtr &job);
+    bool findStreamInfo(const JobPtr &job);
+    bool setupCodecs(const JobPtr &job);
+    bool waitForKeyframe(const JobPtr &job);  // 竞速：读到第一个视频关键帧才算连接成功
+    bool decodeFirstFrame(const JobPtr &job); // 首帧预读：读包受中断回调和截止时间约束
+    
     void setStatus(LoadingStatus status);
-    void cleanup();
-    bool setupNetworkOptions(AVDictionary **options);
-    bool openInputStream();
-    bool findStreamInfo();
-    bool setupCodecs();
     void emitProgress(int percentage, const QString &message);
-
+    
     // 状态管理
     LoadingStatus m_status;
     mutable QMutex m_statusMutex;
     
-    // 网络加载参数
+    // 加载参数
     QString m_url;
     int m_timeoutMs;
     QTime m_startTime;
     
-    // FFmpeg 上下文
-    AVFormatContext* m_formatContext;
-    AVCodecContext* m_videoCodecContext;
-    AVCodecContext* m_audioCodecContext;
-    int m_videoStreamIndex;
-    int m_audioStreamIndex;
-    
     // 定时器
     QTimer* m_timeoutTimer;
     QTimer* m_progressTimer;
+    QTimer* m_warmExpiryTimer;           // 预连接打开后等待接管的时限
+    
+    // 常驻加载线程池：换台时不再创建线程，被取消的任务退出期间新任务可以并行探测
+    QThreadPool m_threadPool;
+    QThreadPool *m_pool;                 // 实际使用的线程池：m_threadPool 或外部共用的池
+    JobPtr m_currentJob;                 // 当前加载任务（仅主线程访问）
+    JobPtr m_raceJob;                    // RTSP传输方式竞速中的另一路（TCP）
+    JobPtr m_warmJob;                    // 预连接任务，被接管前不是当前任务
+    quint64 m_nextJobId;
+    std::atomic<qint64> m_threadStartupUs;  // 创建线程的实测耗时（预热时测得）
+    
+    ProbeCache m_probeCache;             // 探测结果缓存（加载任务间共享）
+    qint64 m_httpCacheBytes;             // HTTP点播磁盘缓存上限
+    bool m_qualityControl;               // HLS自适应码率
+    bool m_firstFramePreroll;            // 就绪前解码第一个视频帧
+    int m_maxBitrateKbps;
+    QHash<QString, LatencyProfile::Transport> m_rtspTransports;  // 各主机上次竞速胜出的RTSP传输方式
     
-    // 线程安全
-    QThread* m_workerThread;
-    bool m_shouldCancel;
-    mutable QMutex m_cancelMutex;
+    static const int kPreconnectTimeoutMs = 8000;  // 预连接打开输入的时限
+    static const int kWarmMaxAgeMs = 10000;        // 打开后未读取的连接可能被服务器关闭
 };
 
-#endif // NETWORKSTREAMLOADER_H 
\ No newline at end of file
+#endif // NETWORKSTREAMLOADER_H
\ No newline at end of file
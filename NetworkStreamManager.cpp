@@ -1,9 +1,10 @@
 #include "NetworkStreamManager.h"
 #include "NetworkConfig.h"
 #include "StreamProtocolHandler.h"
+#include "JitterBuffer.h"
+#include <QHostInfo>
+#include <QHostAddress>
 #include <QDebug>
-#include <QTime>
-#include <QNetworkRequest>
 
 NetworkStreamManager::NetworkStreamManager(QObject *parent)
     : QObject(parent)
@@ -11,82 +12,96 @@ NetworkStreamManager::NetworkStreamManager(QObject *parent)
     , m_protocol(Unknown)
     , m_formatContext(nullptr)
     , m_config(new NetworkConfig(NetworkConfig::defaultConfig()))
-    , m_protocolHandler(nullptr)
-    , m_connectionTimer(new QTimer(this))
+    , m_loader(nullptr)
+    , m_startingLoad(false)
     , m_statusTimer(new QTimer(this))
-    , m_networkManager(new QNetworkAccessManager(this))
-    , m_currentReply(nullptr)
+    , m_jitterBuffer(nullptr)
     , m_bufferSize(0)
-    , m_connectionLatency(0)
+    , m_connectionLatency(-1)
+    , m_startupLatency(-1)
 {
-    // 设置连接超时定时器
-    m_connectionTimer->setSingleShot(true);
-    connect(m_connectionTimer, &QTimer::timeout, this, &NetworkStreamManager::handleConnectionTimeout);
-    
     // 设置状态更新定时器
     m_statusTimer->setInterval(1000); // 每秒更新一次状态
     connect(m_statusTimer, &QTimer::timeout, this, &NetworkStreamManager::updateConnectionStatus);
-    
-    // 网络管理器信号连接
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, &NetworkStreamManager::handleNetworkReply);
 }
 
 NetworkStreamManager::~NetworkStreamManager()
 {
     disconnectStream();
     delete m_config;
-    if (m_protocolHandler) {
-        delete m_protocolHandler;
+}
+
+void NetworkStreamManager::attachLoader(NetworkStreamLoader *loader)
+{
+    if (m_loader) {
+        m_loader->disconnect(this);
     }
+    
+    m_loader = loader;
+    if (!m_loader) {
+        return;
+    }
+    
+    connect(m_loader, &NetworkStreamLoader::statusChanged, this, &NetworkStreamManager::handleLoaderStatus);
+    connect(m_loader, &NetworkStreamLoader::loadingProgress, this, &NetworkStreamManager::handleLoaderProgress);
+    connect(m_loader, &NetworkStreamLoader::streamReady, this, &NetworkStreamManager::handleStreamReady);
+    connect(m_loader, &NetworkStreamLoader::loadingFailed, this, &NetworkStreamManager::handleLoadingFailed);
+    connect(m_loader, &NetworkStreamLoader::loadingCancelled, this, &NetworkStreamManager::handleLoadingCancelled);
 }
 
 bool NetworkStreamManager::connectToStream(const QString &url)
+{
+    return connectToStream(url, LatencyProfile::forUrl(url));
+}
+
+bool NetworkStreamManager::connectToStream(const QString &url, const LatencyProfile &profile)
 {
     if (url.isEmpty()) {
         emit streamError("Empty URL provided");
         return false;
     }
     
-    // 断开现有连接
+    QUrl qurl(url);
+    if (!qurl.isValid() || qurl.scheme().isEmpty()) {
+        emit streamError("Invalid URL");
+        return false;
+    }
+    
+    if (!m_loader) {
+        emit streamError("No stream loader attached");
+        return false;
+    }
+    
+    // 断开现有连接（取消进行中的加载）
     disconnectStream();
     
     m_currentUrl = url;
-    m_status = Connecting;
-    emit statusChanged();
-    
-    // 检测协议类型
+    m_profile = profile;
+    // 协议枚举之外的协议（如rtp、srt）同样交给FFmpeg打开
     m_protocol = detectProtocol(url);
     
-    // 创建协议处理器
-    StreamProtocolHandler::ProtocolType protocolType =
-        static_cast<StreamProtocolHandler::ProtocolType>(m_protocol);
-    m_protocolHandler = StreamProtocolHandler::createHandler(protocolType, this);
-    
-    if (!m_protocolHandler) {
-        emit streamError("Unsupported protocol");
+    setStatus(Connecting);
+    startLoading();
+    return true;
+}
+
+bool NetworkStreamManager::connectToStandby(const NetworkStreamLoader::StreamInfo &streamInfo)
+{
+    if (!m_loader) {
         return false;
     }
     
-    // 连接协议处理器信号
-    connect(m_protocolHandler, &StreamProtocolHandler::connectionProgress,
-            this, &NetworkStreamManager::connectionProgress);
-    
-    // 连接错误信号
-    connect(m_protocolHandler, &StreamProtocolHandler::connectionError,
-            this, &NetworkStreamManager::streamError);
-    
-    // 开始连接
-    m_connectionTimer->start(m_config->connectionTimeout);
-    m_statusTimer->start();
+    disconnectStream();
     
-    // 这里可以添加实际的连接逻辑
-    // 为了演示，我们模拟一个成功的连接
-    QTimer::singleShot(1000, this, [this]() {
-        m_status = Connected;
-        emit streamConnected();
-        emit statusChanged();
-    });
+    m_currentUrl = streamInfo.url;
+    m_profile = streamInfo.latencyProfile;
+    m_protocol = detectProtocol(m_currentUrl);
     
+    setStatus(Connecting);
+    m_attemptTimer.start();
+    m_startingLoad = true;
+    m_loader->deliverStream(streamInfo);
+    m_startingLoad = false;
     return true;
 }
 
@@ -96,37 +111,175 @@ void NetworkStreamManager::disconnectStream()
         return;
     }
     
-    m_connectionTimer->stop();
-    m_statusTimer->stop();
-    
-    if (m_currentReply) {
-        m_currentReply->abort();
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
-    }
-    
-    if (m_protocolHandler) {
-        m_protocolHandler->disconnectFromStream();
-        delete m_protocolHandler;
-        m_protocolHandler = nullptr;
+    // 先更新状态，取消加载时的回调不再按连接被取消处理
+    bool loading = isLoadingStatus();
+    m_status = Disconnected;
+    if (loading && m_loader) {
+        m_loader->cancelLoading();
     }
     
-    cleanupFFmpegContext();
-    
-    m_status = Disconnected;
     m_currentUrl.clear();
+    m_formatContext = nullptr;
     m_bufferSize = 0;
-    m_connectionLatency = 0;
     
     emit streamDisconnected();
     emit statusChanged();
 }
 
+void NetworkStreamManager::handleConnectionLost()
+{
+    if (m_status != Connected && m_status != Buffering) {
+        return;
+    }
+    
+    qDebug() << "[CONNECT] Connection lost after" << m_attemptTimer.elapsed() << "ms, reconnecting";
+    m_formatContext = nullptr;
+    setStatus(Reconnecting);
+}
+
 void NetworkStreamManager::reconnect()
 {
-    if (!m_currentUrl.isEmpty()) {
-        connectToStream(m_currentUrl);
+    if (m_currentUrl.isEmpty() || !m_loader) {
+        return;
+    }
+    
+    m_formatContext = nullptr;
+    setStatus(Reconnecting);
+    startLoading();
+}
+
+void NetworkStreamManager::warmUp(const QString &url)
+{
+    QUrl qurl(url);
+    QString host = qurl.host();
+    if (!m_loader || !qurl.isValid() || qurl.scheme().isEmpty() || host.isEmpty()) {
+        return;
+    }
+    if (url == m_warmUrl) {
+        return;
+    }
+    m_warmUrl = url;
+    
+    // 预连接使用与连接时相同的缓存和码率设置，否则不会被接管
+    applyLoaderConfig();
+    
+    // IP地址无需解析
+    if (!QHostAddress(host).isNull()) {
+        m_loader->preconnect(url, LatencyProfile::forUrl(url));
+        return;
+    }
+    
+    QElapsedTimer resolveTimer;
+    resolveTimer.start();
+    QHostInfo::lookupHost(host, this, [this, url, resolveTimer](const QHostInfo &info) {
+        if (info.error() != QHostInfo::NoError) {
+            qDebug() << "[PRECONNECT] Resolving" << info.hostName() << "failed:" << info.errorString();
+            return;
+        }
+        qDebug() << "[PRECONNECT] Resolved" << info.hostName() << "in" << resolveTimer.elapsed() << "ms,"
+                 << info.addresses().size() << "addresses";
+        
+        // 解析期间地址已改变或已开始连接
+        if (url != m_warmUrl || !m_loader) {
+            return;
+        }
+        m_loader->preconnect(url, LatencyProfile::forUrl(url));
+    });
+}
+
+bool NetworkStreamManager::isLoadingStatus() const
+{
+    return m_status == Connecting || m_status == Probing || m_status == Reconnecting;
+}
+
+void NetworkStreamManager::applyLoaderConfig()
+{
+    // HTTP点播的磁盘缓存上限和HLS码率上限取自网络配置
+    m_loader->setHttpCacheLimit(m_config->httpCacheBytes);
+    m_loader->setQualityControl(m_config->enableQualityControl, m_config->targetBitrate);
+}
+
+void NetworkStreamManager::startLoading()
+{
+    applyLoaderConfig();
+    m_warmUrl.clear();
+    
+    m_attemptTimer.start();
+    m_startingLoad = true;
+    m_loader->loadStreamAsync(m_currentUrl, m_profile, kLoadTimeoutMs);
+    m_startingLoad = false;
+}
+
+void NetworkStreamManager::setStatus(StreamStatus status)
+{
+    if (m_status == status) {
+        return;
+    }
+    m_status = status;
+    emit statusChanged();
+}
+
+void NetworkStreamManager::handleLoaderStatus(NetworkStreamLoader::LoadingStatus status)
+{
+    // 输入已打开：连接建立，开始探测
+    if (m_status == Connecting && status == NetworkStreamLoader::LoadingStreamInfo) {
+        setStatus(Probing);
+    }
+}
+
+void NetworkStreamManager::handleLoaderProgress(int percentage, const QString &message)
+{
+    Q_UNUSED(message);
+    if (isLoadingStatus()) {
+        emit connectionProgress(percentage);
+    }
+}
+
+void NetworkStreamManager::handleStreamReady(const NetworkStreamLoader::StreamInfo &streamInfo)
+{
+    // 加载器也打开本地文件；被取代的连接结果由播放器丢弃
+    if (!isLoadingStatus() || streamInfo.url != m_currentUrl) {
+        return;
     }
+    
+    bool recovered = (m_status == Reconnecting);
+    m_formatContext = streamInfo.formatContext;
+    // 竞速胜出的传输方式在重连时沿用
+    m_profile = streamInfo.latencyProfile;
+    m_connectionLatency = streamInfo.connectMs;
+    m_startupLatency = streamInfo.loadMs;
+    
+    qDebug() << "[CONNECT]" << (recovered ? "Reconnected" : "Connected") << "- open" << m_connectionLatency
+             << "ms, ready" << m_startupLatency << "ms," << m_profile.description();
+    
+    setStatus(Connected);
+    emit streamConnected();
+}
+
+void NetworkStreamManager::handleLoadingFailed(const QString &error)
+{
+    if (!isLoadingStatus()) {
+        return;
+    }
+    
+    // 重连失败由调用方按退避决定是否再次尝试，保持重连状态
+    if (m_status == Reconnecting) {
+        qDebug() << "[CONNECT] Reconnect attempt failed after" << m_attemptTimer.elapsed() << "ms:" << error;
+        return;
+    }
+    
+    qDebug() << "[CONNECT] Connection failed after" << m_attemptTimer.elapsed() << "ms:" << error;
+    setStatus(Error);
+    emit streamError(error);
+}
+
+void NetworkStreamManager::handleLoadingCancelled()
+{
+    // 加载被其他调用取消（如改为打开本地文件）
+    if (m_startingLoad || !isLoadingStatus()) {
+        return;
+    }
+    disconnectStream();
 }
 
 bool NetworkStreamManager::isConnected() const
@@ -144,8 +297,10 @@ QString NetworkStreamManager::getStatusText() const
     switch (m_status) {
     case Disconnected: return "未连接";
     case Connecting: return "连接中...";
+    case Probing: return "正在获取流信息...";
     case Connected: return "已连接";
     case Buffering: return "缓冲中...";
+    case Reconnecting: return "重连中...";
     case Error: return "连接错误";
     default: return "未知状态";
     }
@@ -181,41 +336,62 @@ int NetworkStreamManager::getConnectionLatency() const
     return m_connectionLatency;
 }
 
-AVFormatContext* NetworkStreamManager::getFormatContext() const
+int NetworkStreamManager::getStartupLatency() const
 {
-    return m_formatContext;
+    return m_startupLatency;
 }
 
-void NetworkStreamManager::handleConnectionTimeout()
+AVFormatContext* NetworkStreamManager::getFormatContext() const
 {
-    m_status = Error;
-    emit streamError("Connection timeout");
-    emit statusChanged();
+    return m_formatContext;
 }
 
-void NetworkStreamManager::updateConnectionStatus()
+void NetworkStreamManager::attachJitterBuffer(const JitterBuffer *buffer)
 {
-    // 更新连接状态和缓冲区信息
-    if (m_status == Connected) {
-        // 模拟缓冲区状态更新
-        static int bufferLevel = 0;
-        bufferLevel = (bufferLevel + 10) % 100;
-        emit bufferStatusChanged(bufferLevel);
+    if (m_jitterBuffer == buffer) {
+        return;
+    }
+    
+    m_jitterBuffer = buffer;
+    
+    if (m_jitterBuffer) {
+        // 缓冲状态需要及时反映，比连接状态更新得更频繁
+        m_statusTimer->start(200);
+        updateConnectionStatus();
+    } else {
+        m_statusTimer->stop();
+        m_statusTimer->setInterval(1000);
+        m_bufferSize = 0;
+        emit bufferStatusChanged(0);
+        
+        if (m_status == Buffering) {
+            m_status = m_currentUrl.isEmpty() ? Disconnected : Connected;
+            emit statusChanged();
+        }
     }
 }
 
-void NetworkStreamManager::handleNetworkReply()
+void NetworkStreamManager::updateConnectionStatus()
 {
-    if (!m_currentReply) {
+    // 更新连接状态和缓冲区信息
+    if (!m_jitterBuffer) {
         return;
     }
     
-    if (m_currentReply->error() != QNetworkReply::NoError) {
-        emit streamError(m_currentReply->errorString());
+    m_bufferSize = m_jitterBuffer->bufferedBytes();
+    emit bufferStatusChanged(m_jitterBuffer->fillPercent());
+    
+    // 重连期间抖动缓冲在等待新输入，不改变连接状态
+    if (m_status != Connected && m_status != Buffering) {
+        return;
     }
     
-    m_currentReply->deleteLater();
-    m_currentReply = nullptr;
+    // 抖动缓冲低于低水位时进入缓冲状态，达到高水位后恢复
+    StreamStatus status = m_jitterBuffer->isBuffering() ? Buffering : Connected;
+    if (status != m_status) {
+        m_status = status;
+        emit statusChanged();
+    }
 }
 
 NetworkStreamManager::StreamProtocol NetworkStreamManager::detectProtocol(const QString &url)
@@ -229,36 +405,7 @@ NetworkStreamManager::StreamProtocol NetworkStreamManager::detectProtocol(const
     case StreamProtocolHandler::RTSP_PROTOCOL: return RTSP;
     case StreamProtocolHandler::UDP_PROTOCOL: return UDP;
     case StreamProtocolHandler::TCP_PROTOCOL: return TCP;
+    case StreamProtocolHandler::RTP_PROTOCOL: return RTP;
     default: return Unknown;
     }
 }
-
-bool NetworkStreamManager::setupFFmpegContext()
-{
-    // FFmpeg 上下文设置
-    m_formatContext = avformat_alloc_context();
-    return m_formatContext != nullptr;
-}
-
-void NetworkStreamManager::cleanupFFmpegContext()
-{
-    if (m_formatContext) {
-        avformat_free_context(m_formatContext);
-        m_formatContext = nullptr;
-    }
-}
-
-void NetworkStreamManager::resetConnection()
-{
-    disconnectStream();
-    // 可以在这里添加重置逻辑
-}
-
-void NetworkStreamManager::updateLatency()
-{
-    // 更新连接延迟
-    static QTime lastUpdate = QTime::currentTime();
-    QTime now = QTime::currentTime();
-    m_connectionLatency = lastUpdate.msecsTo(now);
-    lastUpdate = now;
-} 
\ No newline at end of file
@@ -3,18 +3,22 @@
 
 #include <QObject>
 #include <QTimer>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QElapsedTimer>
 #include <QUrl>
 #include <QDebug>
+#include "NetworkStreamLoader.h"
+#include "LatencyProfile.h"
 
 extern "C" {
     #include <libavformat/avformat.h>
 }
 
 class NetworkConfig;
-class StreamProtocolHandler;
+class JitterBuffer;
 
+// 网络流连接状态机：连接由 NetworkStreamLoader 执行，加载器打开并验证（探测、打开解码器）唯一的格式上下文后移交给播放器
+// Disconnected -> Connecting -> Probing -> Connected <-> Buffering
+// 播放中断线 -> Reconnecting -> Connected；首次连接失败 -> Error
 class NetworkStreamManager : public QObject
 {
     Q_OBJECT
@@ -22,9 +26,11 @@ class NetworkStreamManager : public QObject
 public:
     enum StreamStatus {
         Disconnected,
-        Connecting,
+        Connecting,      // 正在建立连接
+        Probing,         // 连接已建立，正在探测流信息、打开解码器
         Connected,
         Buffering,
+        Reconnecting,    // 播放中断线，正在重连
         Error
     };
 
@@ -35,16 +41,29 @@ public:
         RTMP,
         RTSP,
         UDP,
-        TCP
+        TCP,
+        RTP
     };
 
     explicit NetworkStreamManager(QObject *parent = nullptr);
     ~NetworkStreamManager();
 
-    // 连接管理
-    bool connectToStream(const QString &url);
+    // 加载器由播放器持有（也用于打开本地文件），连接前必须设置
+    void attachLoader(NetworkStreamLoader *loader);
+
+    // 连接管理：就绪的流经加载器的 streamReady 信号交给播放器
+    bool connectToStream(const QString &url);  // 按协议选择延迟配置
+    bool connectToStream(const QString &url, const LatencyProfile &profile);
+    // 接管换台待机的流：不再连接，经加载器移交给播放器
+    bool connectToStandby(const NetworkStreamLoader::StreamInfo &streamInfo);
     void disconnectStream();
-    void reconnect();
+    // 播放器读到连接断开：移交的上下文随即关闭，进入重连状态，之后每次尝试调用 reconnect()
+    void handleConnectionLost();
+    void reconnect();  // 使用上次连接成功时的延迟配置（含竞速胜出的传输方式）
+    
+    // 地址输入中预热：解析主机名（填充系统解析缓存，之后FFmpeg的解析直接命中），
+    // 解析成功后由加载器预连接（仅HTTP点播）；连接时URL一致即接管
+    void warmUp(const QString &url);
 
     // 状态查询
     bool isConnected() const;
@@ -59,8 +78,12 @@ public:
     // 流信息
     QString getCurrentUrl() const;
     qint64 getBufferSize() const;
-    int getConnectionLatency() const;
-    AVFormatContext* getFormatContext() const;
+    int getConnectionLatency() const;   // 上次建立连接（打开输入）的实测耗时(ms)，-1表示未知
+    int getStartupLatency() const;      // 上次从发起连接到流就绪的实测耗时(ms)，-1表示未知
+    AVFormatContext* getFormatContext() const;  // 已移交给播放器的上下文，仅在连接状态下有效
+    
+    // 播放器的抖动缓冲：由它报告真实缓冲水位和缓冲状态，传nullptr解除
+    void attachJitterBuffer(const JitterBuffer *buffer);
 
 signals:
     void streamConnected();
@@ -71,38 +94,46 @@ signals:
     void connectionProgress(int percentage);
 
 private slots:
-    void handleConnectionTimeout();
     void updateConnectionStatus();
-    void handleNetworkReply();
+    
+    // 加载器信号
+    void handleLoaderStatus(NetworkStreamLoader::LoadingStatus status);
+    void handleLoaderProgress(int percentage, const QString &message);
+    void handleStreamReady(const NetworkStreamLoader::StreamInfo &streamInfo);
+    void handleLoadingFailed(const QString &error);
+    void handleLoadingCancelled();
 
 private:
     // 协议检测
     StreamProtocol detectProtocol(const QString &url);
     
-    // FFmpeg 上下文管理
-    bool setupFFmpegContext();
-    void cleanupFFmpegContext();
-    
     // 连接管理
-    void resetConnection();
-    void updateLatency();
+    bool isLoadingStatus() const;
+    void startLoading();
+    void applyLoaderConfig();
+    void setStatus(StreamStatus status);
 
     // 成员变量
     StreamStatus m_status;
     StreamProtocol m_protocol;
     QString m_currentUrl;
-    AVFormatContext* m_formatContext;
+    LatencyProfile m_profile;
+    AVFormatContext* m_formatContext;   // 不持有，由播放器关闭
     
     NetworkConfig* m_config;
-    StreamProtocolHandler* m_protocolHandler;
+    NetworkStreamLoader* m_loader;
+    bool m_startingLoad;                // 发起加载时加载器取消之前的任务，不是本次连接被取消
+    QString m_warmUrl;                  // 最近一次预热的地址，解析完成时地址已变化则不预连接
     
-    QTimer* m_connectionTimer;
     QTimer* m_statusTimer;
-    QNetworkAccessManager* m_networkManager;
-    QNetworkReply* m_currentReply;
+    QElapsedTimer m_attemptTimer;       // 本次连接尝试的开始时间
     
+    const JitterBuffer* m_jitterBuffer;
     qint64 m_bufferSize;
     int m_connectionLatency;
+    int m_startupLatency;
+    
+    static const int kLoadTimeoutMs = 15000;   // 连接、探测、打开解码器的总超时
 };
 
 #endif // NETWORKSTREAMMANAGER_H 
\ No newline at end of file
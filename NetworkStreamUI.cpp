@@ -11,12 +11,14 @@
 #include <QFocusEvent>
 #include <QShowEvent>
 #include <QMouseEvent>
+#include <QUrl>
 #include <QDebug>
 
 NetworkStreamUI::NetworkStreamUI(QWidget *parent)
     : QDialog(parent)
     , m_urlEdit(new QLineEdit(this))
     , m_autoCloseTimer(new QTimer(this))
+    , m_warmUpTimer(new QTimer(this))
 {
     setWindowTitle("网络流");
     setFixedSize(500, 50);
@@ -38,6 +40,11 @@ NetworkStreamUI::NetworkStreamUI(QWidget *parent)
     m_autoCloseTimer->setSingleShot(true);
     connect(m_autoCloseTimer, &QTimer::timeout, this, &NetworkStreamUI::onAutoCloseTimeout);
     
+    // 设置预热定时器
+    m_warmUpTimer->setSingleShot(true);
+    m_warmUpTimer->setInterval(kWarmUpDelayMs);
+    connect(m_warmUpTimer, &QTimer::timeout, this, &NetworkStreamUI::onWarmUpTimeout);
+    
     // 安装全局事件过滤器来检测外部点击
     qApp->installEventFilter(this);
 }
@@ -98,6 +105,9 @@ void NetworkStreamUI::setupConnections()
     connect(m_urlEdit, &QLineEdit::returnPressed, this, &NetworkStreamUI::onConnectClicked);
     
     connect(m_urlEdit, &QLineEdit::textChanged, this, &NetworkStreamUI::validateInput);
+    
+    // 每次输入重新计时
+    connect(m_urlEdit, &QLineEdit::textChanged, m_warmUpTimer, qOverload<>(&QTimer::start));
 }
 
 void NetworkStreamUI::setUrl(const QString &url)
@@ -148,6 +158,7 @@ void NetworkStreamUI::onConnectClicked()
     if (validateInput()) {
         // 停止自动关闭定时器
         stopAutoCloseTimer();
+        m_warmUpTimer->stop();
         
         // 立即关闭对话框
         accept();
@@ -237,6 +248,16 @@ void NetworkStreamUI::onAutoCloseTimeout()
     reject();  // 自动关闭，使用reject表示超时
 }
 
+void NetworkStreamUI::onWarmUpTimeout()
+{
+    // 只为已具备协议和主机的地址预热
+    QUrl url(getUrl());
+    if (!m_urlEdit->isEnabled() || !url.isValid() || url.scheme().isEmpty() || url.host().isEmpty()) {
+        return;
+    }
+    emit warmUpRequested(getUrl());
+}
+
 void NetworkStreamUI::keyPressEvent(QKeyEvent *event)
 {
     if (event->key() == Qt::Key_Escape) {
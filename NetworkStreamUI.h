@@ -36,11 +36,13 @@ public:
 
 signals:
     void connectRequested(const StreamSettings &settings);
+    void warmUpRequested(const QString &url);  // 输入停顿时请求预热（解析主机名、预连接）
 
 private slots:
     void onConnectClicked();
     bool validateInput();
     void onAutoCloseTimeout();
+    void onWarmUpTimeout();
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
@@ -55,6 +57,9 @@ private:
     // UI 组件
     QLineEdit* m_urlEdit;
     QTimer* m_autoCloseTimer;
+    QTimer* m_warmUpTimer;   // 输入停顿后才预热，不为输入中途的地址发起解析
+    
+    static const int kWarmUpDelayMs = 400;
 };
 
 #endif // NETWORKSTREAMUI_H
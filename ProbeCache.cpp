@@ -0,0 +1,342 @@
+#include "ProbeCache.h"
+#include "HttpValidator.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cstring>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+}
+
+namespace {
+    const int kCacheVersion = 1;
+
+    QJsonArray rationalToJson(AVRational r)
+    {
+        return QJsonArray{ r.num, r.den };
+    }
+
+    AVRational rationalFromJson(const QJsonValue &value)
+    {
+        QJsonArray array = value.toArray();
+        if (array.size() != 2) {
+            return AVRational{0, 1};
+        }
+        return AVRational{ array[0].toInt(), array[1].toInt() };
+    }
+}
+
+ProbeCache::ProbeCache()
+    : m_coldCount(0)
+    , m_coldTotalMs(0)
+    , m_warmCount(0)
+    , m_warmTotalMs(0)
+{
+}
+
+QString ProbeCache::keyFor(const QString &url, const AVFormatContext *formatContext, HttpValidator *validator) const
+{
+    bool isUrl = url.contains("://") && !url.startsWith("file://", Qt::CaseInsensitive);
+
+    if (!isUrl) {
+        QFileInfo fileInfo(url);
+        if (!fileInfo.exists()) {
+            return QString();
+        }
+        return QString("file|%1|%2|%3")
+            .arg(fileInfo.absoluteFilePath())
+            .arg(fileInfo.lastModified().toMSecsSinceEpoch())
+            .arg(fileInfo.size());
+    }
+
+    // 网络点播：没有长度的直播流和无字节流的协议（RTSP等）不缓存
+    if (!formatContext->pb || !validator) {
+        return QString();
+    }
+    int64_t size = avio_size(formatContext->pb);
+    if (size <= 0) {
+        return QString();
+    }
+
+    // 没有条目时不必校验，保存的未校验条目在下次打开时被替换，只打开一次的地址不发HEAD请求
+    QString entryKey = QString("url|%1|%2").arg(url, QString::number(size));
+    QString entryPath = filePathFor(entryKey + "|");
+    if (!QFile::exists(entryPath)) {
+        return entryKey + "|" + HttpValidator::unverified();
+    }
+
+    // 同样长度的内容可能已经替换；服务器不提供版本标识时无法判断是否过期，不缓存
+    // 删除条目，之后的打开不再为它请求
+    QString version = validator->value();
+    if (version.isEmpty()) {
+        QFile::remove(entryPath);
+        return QString();
+    }
+    return entryKey + "|" + version;
+}
+
+QString ProbeCache::cacheDir() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/probe";
+}
+
+QString ProbeCache::filePathFor(const QString &key) const
+{
+    // 网络点播的版本标识不参与文件名，只在文件内与键比较，过期的条目被新结果覆盖
+    QString name = key.startsWith("url|") ? key.left(key.lastIndexOf('|')) : key;
+    QByteArray hash = QCryptographicHash::hash(name.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDir() + "/" + QString::fromLatin1(hash) + ".json";
+}
+
+QJsonObject ProbeCache::load(const QString &key) const
+{
+    QFile file(filePathFor(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    // 哈希冲突或版本变化视为未命中
+    if (root.value("version").toInt() != kCacheVersion || root.value("key").toString() != key) {
+        return QJsonObject();
+    }
+    return root;
+}
+
+bool ProbeCache::apply(const QString &key, AVFormatContext *formatContext)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    QJsonObject root = load(key);
+    QJsonArray streams = root.value("streams").toArray();
+    if (streams.isEmpty() || streams.size() != static_cast<int>(formatContext->nb_streams)) {
+        return false;
+    }
+
+    // 先校验布局，确认一致后才修改参数
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        QJsonObject cached = streams[i].toObject();
+        const AVCodecParameters *par = formatContext->streams[i]->codecpar;
+        if (cached.value("type").toInt() != par->codec_type) {
+            return false;
+        }
+        if (par->codec_id != AV_CODEC_ID_NONE && cached.value("codecId").toInt() != par->codec_id) {
+            return false;
+        }
+    }
+
+    // 只填入容器头中没有给出的参数
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        QJsonObject cached = streams[i].toObject();
+        AVStream *stream = formatContext->streams[i];
+        AVCodecParameters *par = stream->codecpar;
+
+        if (par->codec_id == AV_CODEC_ID_NONE) {
+            par->codec_id = static_cast<AVCodecID>(cached.value("codecId").toInt());
+        }
+        if (par->format == -1) {
+            par->format = cached.value("format").toInt(-1);
+        }
+        if (par->bit_rate <= 0) {
+            par->bit_rate = cached.value("bitRate").toVariant().toLongLong();
+        }
+        if (par->profile < 0) {
+            par->profile = cached.value("profile").toInt(par->profile);
+        }
+        if (par->level < 0) {
+            par->level = cached.value("level").toInt(par->level);
+        }
+
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            if (par->width <= 0 || par->height <= 0) {
+                par->width = cached.value("width").toInt();
+                par->height = cached.value("height").toInt();
+            }
+            if (par->sample_aspect_ratio.num == 0) {
+                par->sample_aspect_ratio = rationalFromJson(cached.value("sar"));
+            }
+            if (stream->r_frame_rate.num == 0) {
+                stream->r_frame_rate = rationalFromJson(cached.value("rFrameRate"));
+            }
+            if (stream->avg_frame_rate.num == 0) {
+                stream->avg_frame_rate = rationalFromJson(cached.value("avgFrameRate"));
+            }
+        } else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+            if (par->sample_rate <= 0) {
+                par->sample_rate = cached.value("sampleRate").toInt();
+            }
+            if (par->ch_layout.nb_channels <= 0) {
+                int channels = cached.value("channels").toInt();
+                quint64 mask = cached.value("channelMask").toVariant().toULongLong();
+                av_channel_layout_uninit(&par->ch_layout);
+                if (mask != 0) {
+                    av_channel_layout_from_mask(&par->ch_layout, mask);
+                } else if (channels > 0) {
+                    av_channel_layout_default(&par->ch_layout, channels);
+                }
+            }
+            if (par->frame_size <= 0) {
+                par->frame_size = cached.value("frameSize").toInt();
+            }
+            if (par->block_align <= 0) {
+                par->block_align = cached.value("blockAlign").toInt();
+            }
+        }
+
+        QByteArray extradata = QByteArray::fromBase64(cached.value("extradata").toString().toLatin1());
+        if (par->extradata_size == 0 && !extradata.isEmpty()) {
+            par->extradata = static_cast<uint8_t*>(av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+            if (par->extradata) {
+                memcpy(par->extradata, extradata.constData(), extradata.size());
+                par->extradata_size = extradata.size();
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ProbeCache::restoreTimings(const QString &key, AVFormatContext *formatContext)
+{
+    QJsonObject root = load(key);
+    if (root.isEmpty()) {
+        return false;
+    }
+
+    // 命中时跳过了从文件末尾估计时长，使用完整探测时的结果
+    if (root.contains("duration")) {
+        formatContext->duration = root.value("duration").toVariant().toLongLong();
+    }
+    if (root.contains("startTime") && formatContext->start_time == AV_NOPTS_VALUE) {
+        formatContext->start_time = root.value("startTime").toVariant().toLongLong();
+    }
+    if (formatContext->bit_rate <= 0) {
+        formatContext->bit_rate = root.value("bitRate").toVariant().toLongLong();
+    }
+    return true;
+}
+
+QJsonObject ProbeCache::serialize(const AVFormatContext *formatContext)
+{
+    QJsonArray streams;
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        const AVStream *stream = formatContext->streams[i];
+        const AVCodecParameters *par = stream->codecpar;
+
+        QJsonObject cached;
+        cached["type"] = static_cast<int>(par->codec_type);
+        cached["codecId"] = static_cast<int>(par->codec_id);
+        cached["format"] = par->format;
+        cached["bitRate"] = static_cast<qint64>(par->bit_rate);
+        cached["profile"] = par->profile;
+        cached["level"] = par->level;
+
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            cached["width"] = par->width;
+            cached["height"] = par->height;
+            cached["sar"] = rationalToJson(par->sample_aspect_ratio);
+            cached["rFrameRate"] = rationalToJson(stream->r_frame_rate);
+            cached["avgFrameRate"] = rationalToJson(stream->avg_frame_rate);
+        } else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+            cached["sampleRate"] = par->sample_rate;
+            cached["channels"] = par->ch_layout.nb_channels;
+            if (par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE) {
+                cached["channelMask"] = QString::number(par->ch_layout.u.mask);
+            }
+            cached["frameSize"] = par->frame_size;
+            cached["blockAlign"] = par->block_align;
+        }
+
+        if (par->extradata_size > 0) {
+            cached["extradata"] = QString::fromLatin1(
+                QByteArray(reinterpret_cast<const char*>(par->extradata), par->extradata_size).toBase64());
+        }
+        streams.append(cached);
+    }
+
+    QJsonObject root;
+    root["version"] = kCacheVersion;
+    // AV_NOPTS_VALUE 无法用JSON数值精确表示，未知时不保存
+    if (formatContext->duration != AV_NOPTS_VALUE) {
+        root["duration"] = static_cast<qint64>(formatContext->duration);
+    }
+    if (formatContext->start_time != AV_NOPTS_VALUE) {
+        root["startTime"] = static_cast<qint64>(formatContext->start_time);
+    }
+    root["bitRate"] = static_cast<qint64>(formatContext->bit_rate);
+    root["streams"] = streams;
+    return root;
+}
+
+void ProbeCache::store(const QString &key, const AVFormatContext *formatContext)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+
+    QString dirPath = cacheDir();
+    if (!QDir().mkpath(dirPath)) {
+        qDebug() << "[PROBE] Cannot create cache directory:" << dirPath;
+        return;
+    }
+
+    QJsonObject root = serialize(formatContext);
+    root["key"] = key;
+
+    // 并行任务可能写同一个键，QSaveFile保证文件完整
+    QSaveFile file(filePathFor(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qDebug() << "[PROBE] Cannot write cache entry";
+        return;
+    }
+
+    prune(dirPath);
+}
+
+void ProbeCache::prune(const QString &dirPath)
+{
+    QDir dir(dirPath);
+    QFileInfoList entries = dir.entryInfoList(QStringList() << "*.json", QDir::Files, QDir::Time);
+    // 按修改时间从新到旧排列，删除超出上限的旧条目
+    for (int i = kMaxEntries; i < entries.size(); ++i) {
+        QFile::remove(entries[i].absoluteFilePath());
+    }
+}
+
+void ProbeCache::recordProbeTime(bool warm, qint64 elapsedMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (warm) {
+        m_warmCount++;
+        m_warmTotalMs += elapsedMs;
+    } else {
+        m_coldCount++;
+        m_coldTotalMs += elapsedMs;
+    }
+}
+
+QString ProbeCache::benchmarkSummary() const
+{
+    QMutexLocker locker(&m_mutex);
+    auto average = [](qint64 total, int count) {
+        return count > 0 ? QString::number(static_cast<double>(total) / count, 'f', 1) : QString("-");
+    };
+    return QString("cold avg %1 ms (%2 opens), warm avg %3 ms (%4 opens)")
+        .arg(average(m_coldTotalMs, m_coldCount)).arg(m_coldCount)
+        .arg(average(m_warmTotalMs, m_warmCount)).arg(m_warmCount);
+}
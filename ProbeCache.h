@@ -0,0 +1,54 @@
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <QString>
+#include <QMutex>
+#include <QJsonObject>
+
+struct AVFormatContext;
+class HttpValidator;
+
+// 探测结果磁盘缓存：保存流布局、编解码参数、extradata、时长和起始时间
+// 本地文件以 路径+修改时间+大小 为键，网络点播以 URL+内容长度+ETag(或Last-Modified) 为键，直播流不缓存
+// 命中时预先填入编解码参数，avformat_find_stream_info 只需很小的探测量
+// 网络点播的条目按 URL+内容长度 存放：没有条目时不请求版本标识，先保存一个未校验的条目，再次打开时才校验并替换
+class ProbeCache
+{
+public:
+    ProbeCache();
+
+    // 打开输入后计算缓存键，不可缓存时返回空；validator 为本次打开共用的版本标识，网络点播需要
+    QString keyFor(const QString &url, const AVFormatContext *formatContext, HttpValidator *validator) const;
+
+    // 命中且与当前流布局一致时填入参数并返回true
+    bool apply(const QString &key, AVFormatContext *formatContext);
+    // 缓存命中后补全跳过的时长估计
+    bool restoreTimings(const QString &key, AVFormatContext *formatContext);
+    // 完整探测后保存结果
+    void store(const QString &key, const AVFormatContext *formatContext);
+
+    // 冷/热探测耗时统计
+    void recordProbeTime(bool warm, qint64 elapsedMs);
+    QString benchmarkSummary() const;
+
+    static const int kWarmProbeSize = 65536;              // 命中时的探测量
+    static const int kWarmAnalyzeDurationUs = 200000;     // 命中时的分析时长
+
+private:
+    QString cacheDir() const;
+    QString filePathFor(const QString &key) const;
+    QJsonObject load(const QString &key) const;
+    void prune(const QString &dirPath);
+
+    static QJsonObject serialize(const AVFormatContext *formatContext);
+
+    mutable QMutex m_mutex;   // 多个加载任务可并行访问
+    int m_coldCount;
+    qint64 m_coldTotalMs;
+    int m_warmCount;
+    qint64 m_warmTotalMs;
+
+    static const int kMaxEntries = 500;
+};
+
+#endif // PROBECACHE_H
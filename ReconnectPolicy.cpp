@@ -0,0 +1,70 @@
+#include "ReconnectPolicy.h"
+#include <QRandomGenerator>
+#include <QtGlobal>
+#include <cerrno>
+
+extern "C" {
+    #include <libavutil/error.h>
+}
+
+ReconnectPolicy::ReconnectPolicy()
+    : m_enabled(true)
+    , m_maxRetries(3)
+    , m_initialDelayMs(1000)
+    , m_attempt(0)
+{
+}
+
+void ReconnectPolicy::configure(bool enabled, int maxRetries, int initialDelayMs)
+{
+    m_enabled = enabled;
+    m_maxRetries = qMax(maxRetries, 0);
+    m_initialDelayMs = qMax(initialDelayMs, 0);
+}
+
+void ReconnectPolicy::beginOutage()
+{
+    m_attempt = 0;
+    m_outageTimer.start();
+}
+
+int ReconnectPolicy::nextDelayMs()
+{
+    if (m_attempt >= m_maxRetries) {
+        return -1;
+    }
+
+    // 基准等待按尝试次数翻倍；取其一半固定加一半随机（equal jitter），保证退避仍然递增
+    qint64 delay = qMin<qint64>(static_cast<qint64>(m_initialDelayMs) << qMin(m_attempt, 16), kMaxDelayMs);
+    m_attempt++;
+
+    qint64 half = delay / 2;
+    return static_cast<int>(half + QRandomGenerator::global()->bounded(delay - half + 1));
+}
+
+qint64 ReconnectPolicy::finishOutage()
+{
+    qint64 elapsed = m_outageTimer.isValid() ? m_outageTimer.elapsed() : 0;
+    m_outageTimer.invalidate();
+    return elapsed;
+}
+
+bool ReconnectPolicy::isConnectionError(int error)
+{
+    switch (error) {
+        case AVERROR(EIO):
+        case AVERROR(ETIMEDOUT):
+        case AVERROR(ECONNRESET):
+        case AVERROR(ECONNABORTED):
+        case AVERROR(ECONNREFUSED):
+        case AVERROR(EPIPE):
+        case AVERROR(ENETDOWN):
+        case AVERROR(ENETUNREACH):
+        case AVERROR(EHOSTUNREACH):
+        case AVERROR_EXIT:              // 读取超时由中断回调终止
+        case AVERROR_HTTP_SERVER_ERROR:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef RECONNECTPOLICY_H
+#define RECONNECTPOLICY_H
+
+#include <QElapsedTimer>
+
+// 断线重连策略：指数退避加随机抖动
+// 抖动让同一服务下的大量客户端在服务恢复时错开重连，避免同时涌入
+class ReconnectPolicy
+{
+public:
+    ReconnectPolicy();
+
+    // maxRetries 为一次断线内的最大尝试次数，initialDelayMs 为第一次尝试前的基准等待
+    void configure(bool enabled, int maxRetries, int initialDelayMs);
+    bool isEnabled() const { return m_enabled && m_maxRetries > 0; }
+
+    // 检测到断线：开始计时，重置尝试次数
+    void beginOutage();
+    bool inOutage() const { return m_outageTimer.isValid(); }
+
+    // 下一次尝试前的等待时间(ms)，尝试次数用尽时返回-1
+    int nextDelayMs();
+    int attempt() const { return m_attempt; }
+    int maxRetries() const { return m_maxRetries; }
+
+    // 断线结束（成功或放弃），返回断线持续时间(ms)
+    qint64 finishOutage();
+
+    // 读取错误是否为连接中断（I/O错误、超时、连接重置、中断回调退出、服务器5xx）
+    // 文件结束和数据错误不是断线，由调用方按流的类型判断
+    static bool isConnectionError(int error);
+
+private:
+    bool m_enabled;
+    int m_maxRetries;
+    int m_initialDelayMs;
+    int m_attempt;
+    QElapsedTimer m_outageTimer;
+
+    static const int kMaxDelayMs = 30000;   // 退避上限
+};
+
+#endif // RECONNECTPOLICY_H
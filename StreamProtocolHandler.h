@@ -1,22 +1,16 @@
 #ifndef STREAMPROTOCOLHANDLER_H
 #define STREAMPROTOCOLHANDLER_H
 
-#include <QObject>
 #include <QString>
 #include <QUrl>
-#include <QNetworkAccessManager>
 
 extern "C" {
     #include <libavformat/avformat.h>
 }
 
-class NetworkConfig;
-
-// 基础协议处理器
-class StreamProtocolHandler : public QObject
+// 协议识别：播放器判断网络地址、网络流管理器选择连接方式都以此为准
+class StreamProtocolHandler
 {
-    Q_OBJECT
-
 public:
     enum ProtocolType {
         UNKNOWN_PROTOCOL = 0,
@@ -25,99 +19,31 @@ public:
         RTMP_PROTOCOL,
         RTSP_PROTOCOL,
         UDP_PROTOCOL,
-        TCP_PROTOCOL
+        TCP_PROTOCOL,
+        RTP_PROTOCOL
     };
 
-    explicit StreamProtocolHandler(QObject *parent = nullptr);
-    virtual ~StreamProtocolHandler() = default;
-
     // 协议检测
     static ProtocolType detectProtocol(const QString &url);
     static QString protocolToString(ProtocolType protocol);
-
-    // 工厂方法
-    static StreamProtocolHandler* createHandler(ProtocolType protocol, QObject *parent = nullptr);
-
-    // 纯虚函数 - 子类必须实现
-    virtual bool connectToStream(const QString &url, const NetworkConfig &config) = 0;
-    virtual void disconnectFromStream() = 0;
-    virtual bool isConnected() const = 0;
-
-    // 通用方法
-    virtual bool validateUrl(const QString &url) const;
-    virtual QString normalizeUrl(const QString &url) const;
-    virtual int getDefaultPort() const;
-    virtual void setCommonOptions(AVDictionary** options, const NetworkConfig &config);
-    virtual bool isSecureProtocol() const;
-
-signals:
-    void connectionProgress(int percentage);
-    void connectionError(const QString &error);
-    void connectionEstablished();
-    void connectionLost();
-
-protected:
-    QString m_currentUrl;
-    bool m_isConnected;
-    ProtocolType m_protocolType;
-};
-
-// HTTP/HTTPS 协议处理器
-class HttpStreamHandler : public StreamProtocolHandler
-{
-    Q_OBJECT
-
-public:
-    explicit HttpStreamHandler(QObject *parent = nullptr);
-    ~HttpStreamHandler() override;
-
-    bool connectToStream(const QString &url, const NetworkConfig &config) override;
-    void disconnectFromStream() override;
-    bool isConnected() const override;
-    bool isSecureProtocol() const override;
-
-private slots:
-    void handleNetworkReply();
-
-private:
-    QNetworkAccessManager* m_networkManager;
-    QNetworkReply* m_currentReply;
 };
 
-// RTMP 协议处理器
-class RtmpStreamHandler : public StreamProtocolHandler
+// UDP 传输参数：单播/组播 MPEG-TS，支持源特定组播(SSM)
+class UdpStreamHandler
 {
-    Q_OBJECT
-
 public:
-    explicit RtmpStreamHandler(QObject *parent = nullptr);
-    ~RtmpStreamHandler() override;
-
-    bool connectToStream(const QString &url, const NetworkConfig &config) override;
-    void disconnectFromStream() override;
-    bool isConnected() const override;
-    int getDefaultPort() const override;
-
-private:
-    AVFormatContext* m_formatContext;
+    // 接收参数：大套接字接收缓冲、接收FIFO、FIFO溢出不中断读取
+    // URL用户信息中的源地址(udp://源1,源2@组:端口)转为源特定组播，返回去掉源地址后实际打开的URL
+    // 加载器打开UDP源时使用
+    static QString applySocketOptions(AVDictionary** options, const QString &url, int bufferSize);
 };
 
-// RTSP 协议处理器
-class RtspStreamHandler : public StreamProtocolHandler
+// TCP 传输参数：TCP 上的 MPEG-TS 字节流
+class TcpStreamHandler
 {
-    Q_OBJECT
-
 public:
-    explicit RtspStreamHandler(QObject *parent = nullptr);
-    ~RtspStreamHandler() override;
-
-    bool connectToStream(const QString &url, const NetworkConfig &config) override;
-    void disconnectFromStream() override;
-    bool isConnected() const override;
-    int getDefaultPort() const override;
-
-private:
-    AVFormatContext* m_formatContext;
+    // 大套接字接收缓冲，加载器打开TCP源时使用
+    static void applySocketOptions(AVDictionary** options, int bufferSize);
 };
 
 #endif // STREAMPROTOCOLHANDLER_H 
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "SyncTelemetry.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QDebug>
+#include <cstdlib>
+
+namespace {
+    // A/V偏差分桶边界(ms)，[-5,5]为中心桶
+    const int kOffsetEdgesMs[SyncTelemetry::kOffsetBuckets - 1] = {
+        -200, -100, -50, -20, -10, -5, 5, 10, 20, 50, 100, 200
+    };
+    const int kCenterBucket = 6;
+
+    // |偏差| 分桶上界(ms)，由有符号桶对称合并得到；-1表示无穷
+    const int kAbsOffsetBoundsMs[] = { 5, 10, 20, 50, 100, 200, -1 };
+
+    // 校正幅度分桶上界(ms)
+    const int kMagnitudeBoundsMs[SyncTelemetry::kMagnitudeBuckets] = { 10, 20, 50, 100, 200, 500, -1 };
+
+    QJsonValue boundValue(int ms)
+    {
+        return ms < 0 ? QJsonValue() : QJsonValue(ms);
+    }
+}
+
+SyncTelemetry::SyncTelemetry()
+{
+    beginSession(QString(), QString());
+}
+
+void SyncTelemetry::beginSession(const QString &source, const QString &clockMode)
+{
+    for (auto &bucket : m_offsetHistogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    for (auto &bucket : m_magnitudeHistogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_compensations.store(0, std::memory_order_relaxed);
+    m_hardResyncs.store(0, std::memory_order_relaxed);
+    m_presentedFrames.store(0, std::memory_order_relaxed);
+    m_lateFrames.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    m_outages.store(0, std::memory_order_relaxed);
+    m_recovered.store(0, std::memory_order_relaxed);
+    m_reconnectAttempts.store(0, std::memory_order_relaxed);
+    m_recoveredOutageMs.store(0, std::memory_order_relaxed);
+    m_maxOutageMs.store(0, std::memory_order_relaxed);
+
+    m_source = source;
+    m_clockMode = clockMode;
+    m_startedAt = QDateTime::currentDateTimeUtc();
+}
+
+bool SyncTelemetry::hasSamples() const
+{
+    return offsetSamples() > 0 || presentedFrames() > 0 || outageCount() > 0;
+}
+
+int SyncTelemetry::offsetBucket(int64_t offsetUs)
+{
+    if (std::llabs(offsetUs) <= 5000) {
+        return kCenterBucket;
+    }
+
+    int bucket = 0;
+    for (int edge : kOffsetEdgesMs) {
+        if (static_cast<int64_t>(edge) * 1000 < offsetUs) {
+            bucket++;
+        }
+    }
+    return bucket;
+}
+
+int SyncTelemetry::magnitudeBucket(int64_t magnitudeUs)
+{
+    int64_t magnitudeMs = std::llabs(magnitudeUs) / 1000;
+    for (int i = 0; i < kMagnitudeBuckets - 1; ++i) {
+        if (magnitudeMs <= kMagnitudeBoundsMs[i]) {
+            return i;
+        }
+    }
+    return kMagnitudeBuckets - 1;
+}
+
+void SyncTelemetry::recordOffset(int64_t offsetUs)
+{
+    m_offsetHistogram[offsetBucket(offsetUs)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SyncTelemetry::recordCorrection(Correction type, int64_t magnitudeUs)
+{
+    if (type == Correction::HardResync) {
+        m_hardResyncs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_compensations.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_magnitudeHistogram[magnitudeBucket(magnitudeUs)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SyncTelemetry::recordPresentedFrame(int64_t presentErrorUs, int64_t lateThresholdUs)
+{
+    m_presentedFrames.fetch_add(1, std::memory_order_relaxed);
+
+    // 显示时已落后主时钟超过阈值
+    if (-presentErrorUs > lateThresholdUs) {
+        m_lateFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SyncTelemetry::recordDroppedFrame()
+{
+    m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SyncTelemetry::recordReconnect(bool recovered, qint64 outageMs, int attempts)
+{
+    m_outages.fetch_add(1, std::memory_order_relaxed);
+    m_reconnectAttempts.fetch_add(attempts, std::memory_order_relaxed);
+    if (recovered) {
+        m_recovered.fetch_add(1, std::memory_order_relaxed);
+        m_recoveredOutageMs.fetch_add(outageMs, std::memory_order_relaxed);
+    }
+
+    qint64 maxMs = m_maxOutageMs.load(std::memory_order_relaxed);
+    while (outageMs > maxMs && !m_maxOutageMs.compare_exchange_weak(maxMs, outageMs, std::memory_order_relaxed)) {
+    }
+}
+
+qint64 SyncTelemetry::averageReconnectMs() const
+{
+    quint64 recovered = recoveredCount();
+    return recovered > 0 ? m_recoveredOutageMs.load(std::memory_order_relaxed) / static_cast<qint64>(recovered) : 0;
+}
+
+quint64 SyncTelemetry::offsetSamples() const
+{
+    quint64 total = 0;
+    for (const auto &bucket : m_offsetHistogram) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double SyncTelemetry::ratioWithinMs(int ms) const
+{
+    quint64 total = offsetSamples();
+    if (total == 0) {
+        return 0.0;
+    }
+
+    quint64 within = 0;
+    for (int i = 0; i < kOffsetBuckets; ++i) {
+        int absIndex = std::abs(i - kCenterBucket);
+        int bound = kAbsOffsetBoundsMs[absIndex];
+        if (bound >= 0 && bound <= ms) {
+            within += m_offsetHistogram[i].load(std::memory_order_relaxed);
+        }
+    }
+    return static_cast<double>(within) / total;
+}
+
+int SyncTelemetry::absOffsetPercentileMs(double p) const
+{
+    // 合并正负对称桶得到 |偏差| 直方图
+    quint64 absHistogram[kCenterBucket + 1] = {};
+    quint64 total = 0;
+    for (int i = 0; i < kOffsetBuckets; ++i) {
+        quint64 count = m_offsetHistogram[i].load(std::memory_order_relaxed);
+        absHistogram[std::abs(i - kCenterBucket)] += count;
+        total += count;
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    quint64 target = static_cast<quint64>(total * p);
+    quint64 cumulative = 0;
+    for (int i = 0; i <= kCenterBucket; ++i) {
+        cumulative += absHistogram[i];
+        if (cumulative > target) {
+            return kAbsOffsetBoundsMs[i];
+        }
+    }
+    return kAbsOffsetBoundsMs[kCenterBucket];
+}
+
+QString SyncTelemetry::toOverlayHtml() const
+{
+    int p95 = absOffsetPercentileMs(0.95);
+    QString p95Text = (p95 < 0) ? QString(">200 ms") : QString("≤%1 ms").arg(p95);
+
+    return QString(
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>偏差分布：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>±20ms内 %1%，P95 %2（%3 样本）</span>"
+        "</div>"
+
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>校正统计：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>补偿 %4 次，硬同步 %5 次</span>"
+        "</div>"
+
+        "<div style='margin-bottom: 0px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>帧统计：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>显示 %6，迟到 %7，丢弃 %8</span>"
+        "</div>"
+    ).arg(ratioWithinMs(20) * 100.0, 0, 'f', 1)
+     .arg(p95Text)
+     .arg(offsetSamples())
+     .arg(compensationCount())
+     .arg(hardResyncCount())
+     .arg(presentedFrames())
+     .arg(lateFrames())
+     .arg(droppedFrames());
+}
+
+QJsonObject SyncTelemetry::toJson() const
+{
+    QJsonArray offsetHistogram;
+    for (int i = 0; i < kOffsetBuckets; ++i) {
+        QJsonObject bucket;
+        if (i == kCenterBucket) {
+            bucket["minMs"] = -5;
+            bucket["maxMs"] = 5;
+        } else {
+            bucket["minMs"] = (i == 0) ? QJsonValue() : QJsonValue(kOffsetEdgesMs[i - 1]);
+            bucket["maxMs"] = (i == kOffsetBuckets - 1) ? QJsonValue() : QJsonValue(kOffsetEdgesMs[i]);
+        }
+        bucket["count"] = static_cast<qint64>(m_offsetHistogram[i].load(std::memory_order_relaxed));
+        offsetHistogram.append(bucket);
+    }
+
+    QJsonArray magnitudeHistogram;
+    for (int i = 0; i < kMagnitudeBuckets; ++i) {
+        QJsonObject bucket;
+        bucket["maxMs"] = boundValue(kMagnitudeBoundsMs[i]);
+        bucket["count"] = static_cast<qint64>(m_magnitudeHistogram[i].load(std::memory_order_relaxed));
+        magnitudeHistogram.append(bucket);
+    }
+
+    QJsonObject offset;
+    offset["samples"] = static_cast<qint64>(offsetSamples());
+    offset["within20msRatio"] = ratioWithinMs(20);
+    offset["p50Ms"] = boundValue(absOffsetPercentileMs(0.50));
+    offset["p95Ms"] = boundValue(absOffsetPercentileMs(0.95));
+    offset["histogram"] = offsetHistogram;
+
+    QJsonObject corrections;
+    corrections["compensation"] = static_cast<qint64>(compensationCount());
+    corrections["hardResync"] = static_cast<qint64>(hardResyncCount());
+    corrections["magnitudeHistogram"] = magnitudeHistogram;
+
+    QJsonObject frames;
+    frames["presented"] = static_cast<qint64>(presentedFrames());
+    frames["late"] = static_cast<qint64>(lateFrames());
+    frames["dropped"] = static_cast<qint64>(droppedFrames());
+
+    QJsonObject reconnect;
+    quint64 outages = outageCount();
+    reconnect["outages"] = static_cast<qint64>(outages);
+    reconnect["recovered"] = static_cast<qint64>(recoveredCount());
+    reconnect["attempts"] = static_cast<qint64>(m_reconnectAttempts.load(std::memory_order_relaxed));
+    reconnect["successRate"] = outages > 0 ? QJsonValue(static_cast<double>(recoveredCount()) / outages) : QJsonValue();
+    reconnect["avgReconnectMs"] = averageReconnectMs();
+    reconnect["maxOutageMs"] = m_maxOutageMs.load(std::memory_order_relaxed);
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["source"] = m_source;
+    root["clockMode"] = m_clockMode;
+    root["startedAt"] = m_startedAt.toString(Qt::ISODate);
+    root["durationSec"] = m_startedAt.secsTo(QDateTime::currentDateTimeUtc());
+    root["offset"] = offset;
+    root["corrections"] = corrections;
+    root["frames"] = frames;
+    root["reconnect"] = reconnect;
+    return root;
+}
+
+QString SyncTelemetry::exportJson() const
+{
+    QString dirPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/telemetry";
+    if (!QDir().mkpath(dirPath)) {
+        qDebug() << "[TELEMETRY] Cannot create directory:" << dirPath;
+        return QString();
+    }
+
+    QString stem = QString("%1/sync-%2")
+        .arg(dirPath, m_startedAt.toLocalTime().toString("yyyyMMdd-HHmmss-zzz"));
+
+    // 同一毫秒内开始的会话（快速换台、多个实例）加序号，不覆盖已有的文件
+    QFile file;
+    for (int suffix = 0; suffix < 100 && !file.isOpen(); ++suffix) {
+        file.setFileName(suffix == 0 ? stem + ".json" : QString("%1-%2.json").arg(stem).arg(suffix));
+        file.open(QIODevice::WriteOnly | QIODevice::NewOnly);
+    }
+    QString filePath = file.fileName();
+    if (!file.isOpen()) {
+        qDebug() << "[TELEMETRY] Cannot write:" << filePath;
+        return QString();
+    }
+
+    file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Indented));
+    file.close();
+
+    qDebug() << "[TELEMETRY] Sync session exported:" << filePath;
+    return filePath;
+}
@@ -0,0 +1,80 @@
+#ifndef SYNCTELEMETRY_H
+#define SYNCTELEMETRY_H
+
+#include <QString>
+#include <QDateTime>
+#include <QJsonObject>
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+// 音视频同步遥测：每个播放会话的偏差直方图、校正次数/幅度、迟到/丢弃帧数，以及网络流的断线重连
+// 计数器为定长无锁原子数组，可在任意线程记录
+class SyncTelemetry
+{
+public:
+    enum class Correction {
+        Compensation,  // 重采样补偿
+        HardResync     // 硬同步
+    };
+
+    // A/V偏差分桶边界(ms)：(-inf,-200) ... [-5,5] ... (200,+inf)，共13个桶
+    static const int kOffsetBuckets = 13;
+    // 校正幅度分桶上界(ms)：10,20,50,100,200,500,+inf
+    static const int kMagnitudeBuckets = 7;
+
+    SyncTelemetry();
+
+    // 会话管理
+    void beginSession(const QString &source, const QString &clockMode);
+    bool hasSamples() const;
+
+    // 记录
+    void recordOffset(int64_t offsetUs);
+    void recordCorrection(Correction type, int64_t magnitudeUs);
+    void recordPresentedFrame(int64_t presentErrorUs, int64_t lateThresholdUs);
+    void recordDroppedFrame();
+    void recordReconnect(bool recovered, qint64 outageMs, int attempts);  // 一次断线的结果
+
+    // 查询
+    quint64 offsetSamples() const;
+    quint64 compensationCount() const { return m_compensations.load(std::memory_order_relaxed); }
+    quint64 hardResyncCount() const { return m_hardResyncs.load(std::memory_order_relaxed); }
+    quint64 presentedFrames() const { return m_presentedFrames.load(std::memory_order_relaxed); }
+    quint64 lateFrames() const { return m_lateFrames.load(std::memory_order_relaxed); }
+    quint64 droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+    quint64 outageCount() const { return m_outages.load(std::memory_order_relaxed); }
+    quint64 recoveredCount() const { return m_recovered.load(std::memory_order_relaxed); }
+    qint64 averageReconnectMs() const;      // 重连成功的平均断线时长
+    double ratioWithinMs(int ms) const;     // |偏差| 不超过 ms 的样本比例
+    int absOffsetPercentileMs(double p) const;  // |偏差| 百分位所在桶的上界(ms)，-1表示无穷
+
+    // 输出
+    QString toOverlayHtml() const;
+    QJsonObject toJson() const;
+    QString exportJson() const;  // 写入 AppDataLocation/telemetry，返回文件路径，失败返回空
+
+private:
+    static int offsetBucket(int64_t offsetUs);
+    static int magnitudeBucket(int64_t magnitudeUs);
+
+    std::array<std::atomic<quint64>, kOffsetBuckets> m_offsetHistogram;
+    std::array<std::atomic<quint64>, kMagnitudeBuckets> m_magnitudeHistogram;
+    std::atomic<quint64> m_compensations;
+    std::atomic<quint64> m_hardResyncs;
+    std::atomic<quint64> m_presentedFrames;
+    std::atomic<quint64> m_lateFrames;
+    std::atomic<quint64> m_droppedFrames;
+    std::atomic<quint64> m_outages;
+    std::atomic<quint64> m_recovered;
+    std::atomic<quint64> m_reconnectAttempts;
+    std::atomic<qint64> m_recoveredOutageMs;  // 重连成功的断线时长累计
+    std::atomic<qint64> m_maxOutageMs;
+
+    // 会话信息（仅在GUI线程开始会话时设置）
+    QString m_source;
+    QString m_clockMode;
+    QDateTime m_startedAt;
+};
+
+#endif // SYNCTELEMETRY_H
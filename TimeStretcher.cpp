@@ -0,0 +1,218 @@
+#include "TimeStretcher.h"
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // 窗口参数（毫秒）：40ms窗口、8ms交叉淡化、12ms搜索范围，兼顾语音和音乐
+    const int kWindowMs = 40;
+    const int kOverlapMs = 8;
+    const int kSeekMs = 12;
+    const int kCoarseStep = 4;   // 先按步长粗搜，再在最佳位置附近细搜
+}
+
+TimeStretcher::TimeStretcher()
+    : m_channels(0)
+    , m_windowSamples(0)
+    , m_overlapSamples(0)
+    , m_seekSamples(0)
+    , m_tempo(1.0)
+    , m_active(false)
+    , m_primed(false)
+    , m_skipFraction(0.0)
+    , m_inputFill(0)
+    , m_outCapacity(0)
+{
+}
+
+void TimeStretcher::configure(int channels, int sampleRate)
+{
+    m_channels = qMax(channels, 1);
+    m_windowSamples = sampleRate * kWindowMs / 1000;
+    m_overlapSamples = sampleRate * kOverlapMs / 1000;
+    m_seekSamples = sampleRate * kSeekMs / 1000;
+
+    m_input.assign(m_channels, std::vector<float>());
+    m_mid.assign(m_channels, std::vector<float>(m_overlapSamples));
+    m_outBuffer.assign(m_channels, std::vector<float>());
+    m_outPtrs.assign(m_channels, nullptr);
+    m_outCapacity = 0;
+    reset();
+}
+
+void TimeStretcher::reset()
+{
+    m_inputFill = 0;
+    m_primed = false;
+    m_skipFraction = 0.0;
+    m_active = (m_tempo != 1.0);
+}
+
+void TimeStretcher::setTempo(double tempo)
+{
+    tempo = qBound(kMinTempo, tempo, kMaxTempo);
+    if (tempo == m_tempo) {
+        return;
+    }
+    m_tempo = tempo;
+    // 回到原速时保持激活，下一次处理时把缓冲的数据衔接输出后再退出
+    if (tempo != 1.0) {
+        m_active = true;
+    }
+}
+
+void TimeStretcher::ensureOutputCapacity(int samples)
+{
+    if (samples <= m_outCapacity) {
+        return;
+    }
+    m_outCapacity = samples + 1024;
+    for (int ch = 0; ch < m_channels; ch++) {
+        m_outBuffer[ch].resize(m_outCapacity);
+        m_outPtrs[ch] = m_outBuffer[ch].data();
+    }
+}
+
+void TimeStretcher::consumeInput(int samples)
+{
+    samples = qMin(samples, m_inputFill);
+    for (int ch = 0; ch < m_channels; ch++) {
+        float *data = m_input[ch].data();
+        memmove(data, data + samples, (m_inputFill - samples) * sizeof(float));
+    }
+    m_inputFill -= samples;
+}
+
+int TimeStretcher::bestOffset() const
+{
+    // 归一化互相关：上一窗口的延续与候选位置的开头越相似，拼接处越平滑
+    auto score = [this](int offset) {
+        double corr = 0.0;
+        double energy = 1e-9;
+        for (int ch = 0; ch < m_channels; ch++) {
+            const float *mid = m_mid[ch].data();
+            const float *in = m_input[ch].data() + offset;
+            for (int i = 0; i < m_overlapSamples; i++) {
+                corr += mid[i] * in[i];
+                energy += in[i] * in[i];
+            }
+        }
+        return corr / std::sqrt(energy);
+    };
+
+    int best = 0;
+    double bestScore = score(0);
+    for (int offset = kCoarseStep; offset < m_seekSamples; offset += kCoarseStep) {
+        double s = score(offset);
+        if (s > bestScore) {
+            bestScore = s;
+            best = offset;
+        }
+    }
+
+    int coarse = best;
+    int first = qMax(0, coarse - kCoarseStep + 1);
+    int last = qMin(m_seekSamples - 1, coarse + kCoarseStep - 1);
+    for (int offset = first; offset <= last; offset++) {
+        if (offset == coarse) {
+            continue;
+        }
+        double s = score(offset);
+        if (s > bestScore) {
+            bestScore = s;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+int TimeStretcher::process(const float * const *in, int samples)
+{
+    if (m_channels == 0 || m_windowSamples <= 0) {
+        return 0;
+    }
+
+    // 追加到待处理输入
+    int needed = m_inputFill + samples;
+    for (int ch = 0; ch < m_channels; ch++) {
+        if (static_cast<int>(m_input[ch].size()) < needed) {
+            m_input[ch].resize(needed + m_windowSamples);
+        }
+        memcpy(m_input[ch].data() + m_inputFill, in[ch], samples * sizeof(float));
+    }
+    m_inputFill = needed;
+
+    // 变慢时输出多于输入，按最大比例预留
+    ensureOutputCapacity(static_cast<int>(m_inputFill / kMinTempo) + m_windowSamples);
+    int outCount = 0;
+
+    if (m_tempo == 1.0) {
+        // 回到原速：上一窗口的延续与剩余输入交叉淡化，之后全部直通
+        if (m_primed && m_inputFill < m_overlapSamples) {
+            return 0;
+        }
+        int start = 0;
+        if (m_primed) {
+            for (int ch = 0; ch < m_channels; ch++) {
+                const float *mid = m_mid[ch].data();
+                const float *src = m_input[ch].data();
+                float *dst = m_outPtrs[ch];
+                for (int i = 0; i < m_overlapSamples; i++) {
+                    float w = static_cast<float>(i) / m_overlapSamples;
+                    dst[i] = mid[i] * (1.0f - w) + src[i] * w;
+                }
+            }
+            start = m_overlapSamples;
+        }
+        for (int ch = 0; ch < m_channels; ch++) {
+            memcpy(m_outPtrs[ch] + start, m_input[ch].data() + start, (m_inputFill - start) * sizeof(float));
+        }
+        outCount = m_inputFill;
+
+        m_inputFill = 0;
+        m_primed = false;
+        m_skipFraction = 0.0;
+        m_active = false;
+        return outCount;
+    }
+
+    // 每个窗口输出 (窗口-重叠) 个采样，输入前进 tempo 倍
+    const int hop = m_windowSamples - m_overlapSamples;
+    const double nominalSkip = m_tempo * hop;
+    const int required = m_seekSamples + qMax(m_windowSamples, static_cast<int>(nominalSkip) + 1);
+
+    while (m_inputFill >= required) {
+        int offset = 0;
+        int copyStart = 0;
+        if (m_primed) {
+            offset = bestOffset();
+            for (int ch = 0; ch < m_channels; ch++) {
+                const float *mid = m_mid[ch].data();
+                const float *src = m_input[ch].data() + offset;
+                float *dst = m_outPtrs[ch] + outCount;
+                for (int i = 0; i < m_overlapSamples; i++) {
+                    float w = static_cast<float>(i) / m_overlapSamples;
+                    dst[i] = mid[i] * (1.0f - w) + src[i] * w;
+                }
+            }
+            copyStart = m_overlapSamples;
+        }
+        // 第一个窗口从输入起点直接输出，与之前的原速输出无缝衔接
+
+        for (int ch = 0; ch < m_channels; ch++) {
+            const float *src = m_input[ch].data() + offset;
+            memcpy(m_outPtrs[ch] + outCount + copyStart, src + copyStart, (hop - copyStart) * sizeof(float));
+            // 保存本窗口之后的延续
+            memcpy(m_mid[ch].data(), src + hop, m_overlapSamples * sizeof(float));
+        }
+        outCount += hop;
+        m_primed = true;
+
+        m_skipFraction += nominalSkip;
+        int skip = static_cast<int>(m_skipFraction);
+        m_skipFraction -= skip;
+        consumeInput(skip);
+    }
+
+    return outCount;
+}
@@ -0,0 +1,52 @@
+#ifndef TIMESTRETCHER_H
+#define TIMESTRETCHER_H
+
+#include <vector>
+
+// 变速不变调（WSOLA）：按窗口切分平面浮点音频，在搜索范围内找与上一窗口末尾最相似的位置交叉淡化拼接
+// 只改变播放速度不改变音高，用于直播延迟追赶的小幅加速；原速时不参与处理
+class TimeStretcher
+{
+public:
+    TimeStretcher();
+
+    void configure(int channels, int sampleRate);
+    void reset();   // 丢弃缓冲的数据（seek、清空队列时）
+
+    // 速度倍率，限制在 [kMinTempo, kMaxTempo]，1.0为原速
+    void setTempo(double tempo);
+    double tempo() const { return m_tempo; }
+    // 变速中，或刚回到原速、还有缓冲数据需要与原速输出衔接
+    bool isActive() const { return m_active; }
+
+    // 处理平面浮点数据，返回输出采样数；输出在 output() 中，下次调用前有效
+    int process(const float * const *in, int samples);
+    float * const *output() { return m_outPtrs.data(); }
+
+    static constexpr double kMinTempo = 0.75;
+    static constexpr double kMaxTempo = 1.25;
+
+private:
+    int bestOffset() const;
+    void consumeInput(int samples);
+    void ensureOutputCapacity(int samples);
+
+    int m_channels;
+    int m_windowSamples;     // 窗口长度
+    int m_overlapSamples;    // 交叉淡化长度
+    int m_seekSamples;       // 相似位置搜索范围
+
+    double m_tempo;
+    bool m_active;
+    bool m_primed;           // 已输出过窗口，m_mid 有效
+    double m_skipFraction;   // 输入步进的小数部分累积
+
+    std::vector<std::vector<float>> m_input;   // 待处理输入
+    int m_inputFill;
+    std::vector<std::vector<float>> m_mid;     // 上一窗口之后的自然延续，与下一窗口开头交叉淡化
+    std::vector<std::vector<float>> m_outBuffer;
+    std::vector<float*> m_outPtrs;
+    int m_outCapacity;
+};
+
+#endif // TIMESTRETCHER_H
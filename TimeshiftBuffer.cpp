@@ -0,0 +1,461 @@
+#include "TimeshiftBuffer.h"
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDebug>
+
+TimeshiftBuffer::TimeshiftBuffer()
+    : m_formatContext(nullptr)
+    , m_hasVideo(false)
+    , m_maxDurationUs(0)
+    , m_maxBytes(0)
+    , m_writeStartUs(AV_NOPTS_VALUE)
+    , m_writeBytes(0)
+    , m_lastEntryUs(AV_NOPTS_VALUE)
+    , m_totalBytes(0)
+    , m_nextSegmentId(0)
+    , m_readSegmentId(0)
+    , m_readOffset(0)
+    , m_orphanBytes(0)
+{
+}
+
+TimeshiftBuffer::~TimeshiftBuffer()
+{
+    close();
+}
+
+QString TimeshiftBuffer::storageDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/timeshift";
+}
+
+bool TimeshiftBuffer::open(const AVFormatContext *formatContext, int64_t maxDurationUs, qint64 maxBytes)
+{
+    close();
+    if (!formatContext || maxDurationUs <= 0 || maxBytes <= 0) {
+        return false;
+    }
+
+    // 分段只属于当前实例：多个播放器（或换台待机）同时时移时互不影响
+    QString parentPath = storageDir();
+    if (!QDir().mkpath(parentPath)) {
+        qDebug() << "[TIMESHIFT] Cannot create directory:" << parentPath;
+        return false;
+    }
+    std::unique_ptr<QTemporaryDir> tempDir(new QTemporaryDir(parentPath + "/XXXXXX"));
+    if (!tempDir->isValid()) {
+        qDebug() << "[TIMESHIFT] Cannot create session directory:" << tempDir->errorString();
+        return false;
+    }
+
+    // 有视频时入口必须是视频关键帧；纯音频流每个包都能独立解码
+    bool hasVideo = false;
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            hasVideo = true;
+            break;
+        }
+    }
+
+    QMutexLocker readLocker(&m_readMutex);
+    QMutexLocker locker(&m_mutex);
+    m_formatContext = formatContext;
+    m_hasVideo = hasVideo;
+    m_maxDurationUs = maxDurationUs;
+    m_maxBytes = maxBytes;
+    m_tempDir = std::move(tempDir);
+    m_writeStartUs = AV_NOPTS_VALUE;
+    m_writeBytes = 0;
+    m_lastEntryUs = AV_NOPTS_VALUE;
+    m_totalBytes = 0;
+    m_nextSegmentId = 1;
+    m_readSegmentId = 0;
+    m_readOffset = 0;
+    m_readPath.clear();
+
+    qDebug() << "[TIMESHIFT] Opened, window" << (maxDurationUs / AV_TIME_BASE) << "s, disk cap"
+             << (maxBytes / (1024 * 1024)) << "MB";
+    return true;
+}
+
+void TimeshiftBuffer::close()
+{
+    QMutexLocker readLocker(&m_readMutex);
+    QMutexLocker locker(&m_mutex);
+    if (!m_formatContext) {
+        return;
+    }
+
+    m_writeFile.close();
+    m_readFile.close();
+
+    qDebug() << "[TIMESHIFT] Closed," << m_segments.size() << "segments," << (m_totalBytes / 1024) << "KB";
+
+    // 删除临时目录即删除所有分段（包括等待读取方离开的孤立分段）
+    m_tempDir.reset();
+    m_orphanPath.clear();
+    m_orphanBytes = 0;
+    m_segments.clear();
+    m_writeStartUs = AV_NOPTS_VALUE;
+    m_writeBytes = 0;
+    m_totalBytes = 0;
+    m_readSegmentId = 0;
+    m_readOffset = 0;
+    m_readPath.clear();
+    m_formatContext = nullptr;
+}
+
+bool TimeshiftBuffer::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_formatContext != nullptr;
+}
+
+void TimeshiftBuffer::append(const AVPacket *packet)
+{
+    // 上下文在 open/close 之间不变，且 open/close 不与解复用线程并发，这里不需要锁
+    if (!m_formatContext || packet->stream_index >= static_cast<int>(m_formatContext->nb_streams)) {
+        return;
+    }
+
+    const AVStream *stream = m_formatContext->streams[packet->stream_index];
+    AVMediaType type = stream->codecpar->codec_type;
+    if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO) {
+        return;
+    }
+
+    int64_t ts = (packet->pts != AV_NOPTS_VALUE) ? packet->pts : packet->dts;
+    if (ts == AV_NOPTS_VALUE) {
+        return;
+    }
+    int64_t timeUs = av_rescale_q(ts, stream->time_base, AV_TIME_BASE_Q);
+
+    bool entryPoint = m_hasVideo ? (type == AVMEDIA_TYPE_VIDEO && (packet->flags & AV_PKT_FLAG_KEY))
+                                 : (packet->flags & AV_PKT_FLAG_KEY) != 0;
+
+    if (m_writeStartUs == AV_NOPTS_VALUE) {
+        if (!entryPoint) {
+            return;
+        }
+        startSegment(timeUs);
+    } else {
+        int64_t length = timeUs - m_writeStartUs;
+        // 时间戳回退（直播源重启）时也切分，保证每个分段内时间单调
+        if ((entryPoint && (length >= kSegmentUs || length < 0)) || length >= kMaxSegmentUs) {
+            startSegment(timeUs);
+        }
+    }
+    if (!m_writeFile.isOpen()) {
+        return;
+    }
+
+    // 先写盘再提交索引：读取方只读到已提交的字节数，不会看到写了一半的记录
+    qint64 offset = m_writeBytes;
+    qint64 written = writeRecord(packet);
+    if (written < 0) {
+        qDebug() << "[TIMESHIFT] Write failed:" << m_writeFile.errorString();
+        m_writeFile.close();
+        return;
+    }
+    m_writeBytes += written;
+
+    bool newEntry = entryPoint && (m_lastEntryUs == AV_NOPTS_VALUE || timeUs > m_lastEntryUs);
+    if (newEntry) {
+        m_lastEntryUs = timeUs;
+    }
+
+    QStringList removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        Segment &segment = m_segments.last();
+        if (newEntry) {
+            Entry entry = {timeUs, offset};
+            segment.entries.append(entry);
+        }
+        segment.bytes += written;
+        segment.endUs = qMax(segment.endUs, timeUs);
+        m_totalBytes += written;
+        evictLocked(&removed);
+    }
+    for (const QString &path : removed) {
+        QFile::remove(path);
+    }
+}
+
+qint64 TimeshiftBuffer::writeRecord(const AVPacket *packet)
+{
+    qint64 sideDataSize = 0;
+    for (int i = 0; i < packet->side_data_elems; i++) {
+        sideDataSize += 2 * sizeof(qint32) + packet->side_data[i].size;
+    }
+
+    RecordHeader header;
+    header.streamIndex = packet->stream_index;
+    header.flags = packet->flags;
+    header.pts = packet->pts;
+    header.dts = packet->dts;
+    header.duration = packet->duration;
+    header.size = packet->size;
+    header.sideDataSize = static_cast<qint32>(sideDataSize);
+
+    const qint64 expected = static_cast<qint64>(sizeof(header)) + packet->size + sideDataSize;
+    qint64 written = m_writeFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (packet->size > 0) {
+        written += m_writeFile.write(reinterpret_cast<const char*>(packet->data), packet->size);
+    }
+    // 附加数据（参数集更新、HDR元数据、跳过采样数等）解码器需要，和负载一起回放
+    for (int i = 0; i < packet->side_data_elems; i++) {
+        const AVPacketSideData &sideData = packet->side_data[i];
+        qint32 item[2] = {static_cast<qint32>(sideData.type), static_cast<qint32>(sideData.size)};
+        written += m_writeFile.write(reinterpret_cast<const char*>(item), sizeof(item));
+        written += m_writeFile.write(reinterpret_cast<const char*>(sideData.data), sideData.size);
+    }
+    // 读取方直接读文件，提交索引前必须刷新
+    m_writeFile.flush();
+    return (written == expected) ? written : -1;
+}
+
+bool TimeshiftBuffer::startSegment(int64_t timeUs)
+{
+    m_writeFile.close();
+
+    Segment segment;
+    segment.path = QString("%1/%2.seg").arg(m_tempDir->path()).arg(m_nextSegmentId);
+    segment.startUs = timeUs;
+    segment.endUs = timeUs;
+    segment.bytes = 0;
+
+    // 创建文件在锁外进行，成功后才加入索引
+    m_writeFile.setFileName(segment.path);
+    if (!m_writeFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "[TIMESHIFT] Cannot open segment:" << m_writeFile.errorString();
+        return false;
+    }
+    m_writeStartUs = timeUs;
+    m_writeBytes = 0;
+    m_lastEntryUs = AV_NOPTS_VALUE;
+
+    QMutexLocker locker(&m_mutex);
+    segment.id = m_nextSegmentId++;
+    m_segments.append(segment);
+    return true;
+}
+
+void TimeshiftBuffer::evictLocked(QStringList *removed)
+{
+    // 至少保留正在写入的分段；文件由调用方在锁外删除
+    while (m_segments.size() > 1
+           && (m_segments.last().endUs - m_segments.first().startUs > m_maxDurationUs || m_totalBytes > m_maxBytes)) {
+        Segment oldest = m_segments.takeFirst();
+        m_totalBytes -= oldest.bytes;
+
+        if (oldest.id == m_readSegmentId) {
+            // 正在读取的文件由读取方离开后删除
+            if (!m_orphanPath.isEmpty()) {
+                removed->append(m_orphanPath);
+            }
+            m_orphanPath = oldest.path;
+            m_orphanBytes = oldest.bytes;
+        } else {
+            removed->append(oldest.path);
+        }
+    }
+}
+
+int TimeshiftBuffer::segmentIndexLocked(quint64 id) const
+{
+    for (int i = 0; i < m_segments.size(); i++) {
+        if (m_segments[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TimeshiftBuffer::moveReaderLocked(quint64 segmentId, qint64 offset, QStringList *removed)
+{
+    // 只记录新的读取位置，文件由调用方释放索引锁后在 syncReadFile 中切换
+    if (segmentId != m_readSegmentId) {
+        if (!m_orphanPath.isEmpty()) {
+            removed->append(m_orphanPath);
+            m_orphanPath.clear();
+        }
+        int index = segmentIndexLocked(segmentId);
+        m_readPath = (index >= 0) ? m_segments[index].path : QString();
+    }
+
+    m_readSegmentId = segmentId;
+    m_readOffset = offset;
+}
+
+bool TimeshiftBuffer::syncReadFile(const QStringList &removed)
+{
+    if (m_readFile.fileName() != m_readPath || !m_readFile.isOpen()) {
+        m_readFile.close();
+        m_readFile.setFileName(m_readPath);
+        // 文件仍在增长，不使用读缓冲
+        if (!m_readPath.isEmpty() && !m_readFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            qDebug() << "[TIMESHIFT] Cannot read segment:" << m_readFile.errorString();
+        }
+    }
+
+    // 离开的孤立分段在读取文件关闭后才删除
+    for (const QString &path : removed) {
+        QFile::remove(path);
+    }
+
+    if (!m_readFile.isOpen()) {
+        return false;
+    }
+    return m_readFile.pos() == m_readOffset || m_readFile.seek(m_readOffset);
+}
+
+int64_t TimeshiftBuffer::seek(int64_t targetUs)
+{
+    QMutexLocker readLocker(&m_readMutex);
+
+    int64_t entryUs = AV_NOPTS_VALUE;
+    QStringList removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        // 从新到旧找到第一个不晚于目标的入口；目标早于整个窗口时取最早的入口
+        const Segment *found = nullptr;
+        const Entry *entry = nullptr;
+        for (int i = m_segments.size() - 1; i >= 0 && !entry; i--) {
+            const Segment &segment = m_segments[i];
+            for (int j = segment.entries.size() - 1; j >= 0; j--) {
+                if (segment.entries[j].timeUs <= targetUs) {
+                    entry = &segment.entries[j];
+                    break;
+                }
+            }
+            if (!segment.entries.isEmpty()) {
+                found = &segment;
+            }
+        }
+        if (!found) {
+            return AV_NOPTS_VALUE;
+        }
+        if (!entry) {
+            entry = &found->entries.first();
+        }
+        moveReaderLocked(found->id, entry->offset, &removed);
+        entryUs = entry->timeUs;
+    }
+
+    syncReadFile(removed);
+    return entryUs;
+}
+
+int TimeshiftBuffer::read(AVPacket *packet)
+{
+    QMutexLocker readLocker(&m_readMutex);
+
+    // 索引锁内只确定读取的分段和已提交的字节数，磁盘读取在锁外进行，不阻塞解复用线程写入
+    qint64 committed = 0;
+    bool caughtUp = false;
+    QStringList removed;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_formatContext || m_segments.isEmpty()) {
+            return AVERROR(EAGAIN);
+        }
+
+        int index = segmentIndexLocked(m_readSegmentId);
+        if (index < 0 && m_orphanPath.isEmpty()) {
+            // 读取位置已被淘汰，从最早分段的开头继续（分段总是从记录边界开始）
+            qDebug() << "[TIMESHIFT] Read position evicted, continuing at oldest segment";
+            moveReaderLocked(m_segments.first().id, 0, &removed);
+            index = 0;
+        }
+
+        // 当前分段读完后进入下一个；孤立分段之后是现存最早的分段
+        committed = (index >= 0) ? m_segments[index].bytes : m_orphanBytes;
+        while (m_readOffset >= committed) {
+            int next = index + 1;
+            if (next >= m_segments.size()) {
+                caughtUp = true;
+                break;
+            }
+            moveReaderLocked(m_segments[next].id, 0, &removed);
+            index = next;
+            committed = m_segments[index].bytes;
+        }
+    }
+
+    // 读取中的分段被淘汰时成为孤立分段，文件在读取方离开前保留
+    bool ready = syncReadFile(removed);
+    if (caughtUp) {
+        return AVERROR(EAGAIN);
+    }
+    if (!ready) {
+        return AVERROR(EIO);
+    }
+
+    RecordHeader header;
+    if (m_readFile.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)
+        || header.size < 0 || header.sideDataSize < 0
+        || m_readOffset + static_cast<qint64>(sizeof(header)) + header.size + header.sideDataSize > committed) {
+        qDebug() << "[TIMESHIFT] Corrupt record at offset" << m_readOffset;
+        return AVERROR_INVALIDDATA;
+    }
+
+    int ret = av_new_packet(packet, header.size);
+    if (ret < 0) {
+        return ret;
+    }
+    if (header.size > 0 && m_readFile.read(reinterpret_cast<char*>(packet->data), header.size) != header.size) {
+        av_packet_unref(packet);
+        return AVERROR(EIO);
+    }
+
+    qint64 sideDataLeft = header.sideDataSize;
+    while (sideDataLeft > 0) {
+        qint32 item[2];
+        if (sideDataLeft < static_cast<qint64>(sizeof(item))
+            || m_readFile.read(reinterpret_cast<char*>(item), sizeof(item)) != sizeof(item)
+            || item[1] < 0 || item[1] > sideDataLeft - static_cast<qint64>(sizeof(item))) {
+            av_packet_unref(packet);
+            return AVERROR_INVALIDDATA;
+        }
+        uint8_t *data = av_packet_new_side_data(packet, static_cast<AVPacketSideDataType>(item[0]), item[1]);
+        if (!data || (item[1] > 0 && m_readFile.read(reinterpret_cast<char*>(data), item[1]) != item[1])) {
+            av_packet_unref(packet);
+            return data ? AVERROR(EIO) : AVERROR(ENOMEM);
+        }
+        sideDataLeft -= sizeof(item) + item[1];
+    }
+
+    packet->stream_index = header.streamIndex;
+    packet->flags = header.flags;
+    packet->pts = header.pts;
+    packet->dts = header.dts;
+    packet->duration = header.duration;
+    m_readOffset += sizeof(header) + header.size + header.sideDataSize;
+    return 0;
+}
+
+int64_t TimeshiftBuffer::startUs() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_segments.isEmpty()) {
+        return AV_NOPTS_VALUE;
+    }
+    return m_segments.first().startUs;
+}
+
+int64_t TimeshiftBuffer::liveEdgeUs() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_segments.isEmpty()) {
+        return AV_NOPTS_VALUE;
+    }
+    return m_segments.last().endUs;
+}
+
+qint64 TimeshiftBuffer::diskBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
@@ -0,0 +1,108 @@
+#ifndef TIMESHIFTBUFFER_H
+#define TIMESHIFTBUFFER_H
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <memory>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+// 直播时移：把解复用得到的包原样写入磁盘上的分段环形缓冲，暂停、回看和回到直播都基于本地数据
+// 包按记录格式保存（不经过封装器），流序号和时间基与直播上下文一致，回放时直接送入现有解码器
+// 每个分段从关键帧开始并带有关键帧索引；总时长或磁盘字节数超出上限时淘汰最早的分段
+// 包的附加数据（side data）随记录一起保存；磁盘读写都不持有索引锁，锁只保护分段列表和读取位置
+class TimeshiftBuffer
+{
+public:
+    TimeshiftBuffer();
+    ~TimeshiftBuffer();
+
+    // 主线程在解复用线程启动前调用；每个实例使用独立的临时目录，关闭时整个目录删除
+    bool open(const AVFormatContext *formatContext, int64_t maxDurationUs, qint64 maxBytes);
+    void close();   // 解复用线程停止后调用
+    bool isOpen() const;
+
+    // 解复用线程：追加一个包，第一个关键帧之前的包无法独立解码，不保存
+    void append(const AVPacket *packet);
+
+    // 播放线程：定位到不晚于 targetUs 的最近入口（关键帧），返回入口时间，没有数据时返回AV_NOPTS_VALUE
+    int64_t seek(int64_t targetUs);
+    // 顺序读取；追上写入位置时返回 AVERROR(EAGAIN)，读取位置被淘汰时从最早的分段继续
+    int read(AVPacket *packet);
+
+    int64_t startUs() const;      // 可回看的最早位置
+    int64_t liveEdgeUs() const;   // 最新写入的位置
+    qint64 diskBytes() const;
+
+private:
+    struct Entry {
+        int64_t timeUs;
+        qint64 offset;
+    };
+
+    struct Segment {
+        quint64 id;
+        QString path;
+        int64_t startUs;
+        int64_t endUs;
+        qint64 bytes;
+        QVector<Entry> entries;   // 入口（关键帧）索引
+    };
+
+    struct RecordHeader {
+        qint32 streamIndex;
+        qint32 flags;
+        qint64 pts;
+        qint64 dts;
+        qint64 duration;
+        qint32 size;
+        qint32 sideDataSize;   // 负载之后的附加数据字节数：每项为类型、长度、数据
+    };
+
+    bool startSegment(int64_t timeUs);
+    qint64 writeRecord(const AVPacket *packet);
+    void evictLocked(QStringList *removed);
+    int segmentIndexLocked(quint64 id) const;
+    void moveReaderLocked(quint64 segmentId, qint64 offset, QStringList *removed);
+    bool syncReadFile(const QStringList &removed);
+    static QString storageDir();
+
+    const AVFormatContext *m_formatContext;  // 写入时查询流类型和时间基（只在解复用线程访问）
+    bool m_hasVideo;
+    int64_t m_maxDurationUs;
+    qint64 m_maxBytes;
+    std::unique_ptr<QTemporaryDir> m_tempDir;
+
+    // 写入状态（只在解复用线程访问，不加锁）：最新分段的起点、已写入字节和最后一个入口
+    int64_t m_writeStartUs;
+    qint64 m_writeBytes;
+    int64_t m_lastEntryUs;
+
+    mutable QMutex m_mutex;
+    QList<Segment> m_segments;   // 从旧到新
+    qint64 m_totalBytes;
+    quint64 m_nextSegmentId;
+    QFile m_writeFile;           // 最新分段（解复用线程写入，不加锁）
+
+    // 读取位置（播放线程）：读取锁保证 seek/read/close 互斥，先于索引锁获取；写入线程只取索引锁
+    // 分段号和孤立分段受索引锁保护，写入线程据此推迟删除正在读取的分段；文件和偏移只受读取锁保护
+    QMutex m_readMutex;
+    quint64 m_readSegmentId;
+    qint64 m_readOffset;
+    QString m_readPath;          // 读取位置所在分段的文件，切换文件在索引锁外进行
+    QFile m_readFile;
+    QString m_orphanPath;        // 已淘汰但仍在读取的分段，读取方离开后删除
+    qint64 m_orphanBytes;        // 孤立分段已写完，长度不再变化
+
+    static const int64_t kSegmentUs = 2000000;      // 分段在此时长后的下一个关键帧处切分
+    static const int64_t kMaxSegmentUs = 10000000;  // 长时间没有关键帧（如纯音频期间）时强制切分
+};
+
+#endif // TIMESHIFTBUFFER_H
@@ -1,5 +1,9 @@
 #include "VideoPlayer.h"
+#include "NetworkConfig.h"
+#include "StreamProtocolHandler.h"
 #include <QDateTime>
+#include <QFile>
+#include <QTextStream>
 #include <QApplication>
 
 VideoPlayer::VideoPlayer(QWidget *parent)
@@ -22,6 +26,10 @@ VideoPlayer::VideoPlayer(QWidget *parent)
     , m_currentPosition(0)
     , m_fps(25.0)
     , m_volume(0.8f) // 默认音量80%
+    , m_firstFrameMs(-1)
+    , m_audioAttachMs(-1)
+    , m_audioPending(false)
+    , m_pendingAudioPackets(0)
     , m_isPlaybackStable(false)
     , m_frameCount(0)
     , m_isDragging(false)
@@ -38,17 +46,61 @@ VideoPlayer::VideoPlayer(QWidget *parent)
     , m_streamManager(new NetworkStreamManager(this))
     , m_streamUI(new NetworkStreamUI(this))
     , m_streamLoader(new NetworkStreamLoader(this))
-    , m_lastSyncTime(0)
+    , m_channelZapper(new ChannelZapper(this))
+    , m_clockModeForced(false)
+    , m_hasPendingFrame(false)
+    , m_pendingFramePts(AV_NOPTS_VALUE)
+    , m_lastPresentError(0)
+    , m_syncCallCount(0)
     , m_syncAdjustmentCount(0)
+    , m_residualSyncError(0)
     , m_isNetworkStream(false)
+    , m_glassToGlassUs(AV_NOPTS_VALUE)
+    , m_isBuffering(false)
+    , m_abrController(nullptr)
+    , m_abrTimer(new QTimer(this))
+    , m_reconnectTimer(new QTimer(this))
+    , m_reconnecting(false)
+    , m_resumePositionUs(AV_NOPTS_VALUE)
+    , m_timeshiftActive(false)
+    , m_catchUpTimer(new QTimer(this))
+    , m_audioOnlyRequested(false)
+    , m_audioOnlyActive(false)
+    , m_backgroundTimer(new QTimer(this))
+    , m_exposeFilterInstalled(false)
+    , m_audioSkipUntilUs(AV_NOPTS_VALUE)
+    , m_videoCatchupUs(AV_NOPTS_VALUE)
+    , m_decodeLoadNs(0)
+    , m_videoDecodeLoad(-1.0)
+    , m_audioOnlyDecodeLoad(-1.0)
 {
     setupUI();
     setupFFmpeg();
     setupHelpOverlay();
     setupVideoInfoOverlay();
     
+    m_timer->setTimerType(Qt::PreciseTimer);
     connect(m_timer, &QTimer::timeout, this, &VideoPlayer::updatePosition);
     
+    // 后台模式防抖：窗口隐藏持续一段时间后才切换到纯音频
+    m_backgroundTimer->setSingleShot(true);
+    m_backgroundTimer->setInterval(500);
+    connect(m_backgroundTimer, &QTimer::timeout, this, [this]() {
+        bool hidden = isMinimized() || (windowHandle() && !windowHandle()->isExposed());
+        if (hidden || m_audioOnlyRequested) {
+            applyAudioOnlyMode(true);
+        }
+    });
+    
+    m_abrTimer->setInterval(1000);
+    connect(m_abrTimer, &QTimer::timeout, this, &VideoPlayer::evaluateAbr);
+    
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &VideoPlayer::attemptReconnect);
+    
+    m_catchUpTimer->setInterval(250);
+    connect(m_catchUpTimer, &QTimer::timeout, this, &VideoPlayer::updateLiveCatchUp);
+    
     // 设置防抖定时器 - 更短的延迟，保持响应性
     m_seekDebounceTimer->setSingleShot(true);
     m_seekDebounceTimer->setInterval(50); // 减少到50ms，提高响应性
@@ -70,6 +122,10 @@ VideoPlayer::VideoPlayer(QWidget *parent)
     
     // 连接网络流UI信号
     connect(m_streamUI, &NetworkStreamUI::connectRequested, this, &VideoPlayer::onNetworkStreamRequested);
+    connect(m_streamUI, &NetworkStreamUI::warmUpRequested, m_streamManager, &NetworkStreamManager::warmUp);
+    
+    // 网络流由管理器通过加载器连接，加载器打开的上下文就绪后直接交给播放器
+    m_streamManager->attachLoader(m_streamLoader);
     
     // 连接异步加载器信号（移除进度更新信号）
     connect(m_streamLoader, &NetworkStreamLoader::loadingStarted, this, &VideoPlayer::onStreamLoadingStarted);
@@ -165,6 +221,20 @@ void VideoPlayer::setupShortcuts()
     QShortcut *openUrlShortcut = new QShortcut(QKeySequence("Ctrl+U"), this);
     connect(openUrlShortcut, &QShortcut::activated, this, &VideoPlayer::openNetworkUrl);
     
+    // 频道列表和换台
+    QShortcut *channelListShortcut = new QShortcut(QKeySequence("Ctrl+L"), this);
+    connect(channelListShortcut, &QShortcut::activated, this, &VideoPlayer::openChannelList);
+    
+    QShortcut *previousChannelShortcut = new QShortcut(QKeySequence(Qt::Key_PageUp), this);
+    connect(previousChannelShortcut, &QShortcut::activated, this, [this]() {
+        zapChannel(-1);
+    });
+    
+    QShortcut *nextChannelShortcut = new QShortcut(QKeySequence(Qt::Key_PageDown), this);
+    connect(nextChannelShortcut, &QShortcut::activated, this, [this]() {
+        zapChannel(1);
+    });
+    
     QShortcut *quitShortcut = new QShortcut(QKeySequence("Ctrl+Q"), this);
     connect(quitShortcut, &QShortcut::activated, this, &QWidget::close);
     
@@ -178,7 +248,7 @@ void VideoPlayer::setupShortcuts()
     // 音量控制快捷键
     QShortcut *volumeUpShortcut = new QShortcut(QKeySequence(Qt::Key_Up), this);
     connect(volumeUpShortcut, &QShortcut::activated, this, [this]() {
-        m_volume = qMin(1.0f, m_volume + 0.05f);
+        m_volume = qMin(AudioProcessor::kMaxVolume, m_volume + 0.05f);
         if (m_audioProcessor) {
             m_audioProcessor->setVolume(m_volume);
         }
@@ -221,7 +291,7 @@ void VideoPlayer::setupShortcuts()
             }
             
             int currentPos = m_currentPosition / AV_TIME_BASE;
-            int newPos = qMin((int)(m_duration / AV_TIME_BASE), currentPos + 10);
+            int newPos = qMin((int)(seekableEndUs() / AV_TIME_BASE), currentPos + 10);
             qDebug() << "Seek forward from" << currentPos << "to" << newPos;
             seek(newPos);
         }
@@ -258,7 +328,7 @@ void VideoPlayer::setupShortcuts()
             }
             
             int currentPos = m_currentPosition / AV_TIME_BASE;
-            int newPos = qMin((int)(m_duration / AV_TIME_BASE), currentPos + 30);
+            int newPos = qMin((int)(seekableEndUs() / AV_TIME_BASE), currentPos + 30);
             qDebug() << "Fast seek forward from" << currentPos << "to" << newPos;
             seek(newPos);
         }
@@ -281,6 +351,14 @@ void VideoPlayer::setupShortcuts()
         }
     });
     
+    // 直播时移：回到直播边缘
+    QShortcut *liveShortcut = new QShortcut(QKeySequence("L"), this);
+    connect(liveShortcut, &QShortcut::activated, this, [this]() {
+        if (m_formatContext && (m_timeshiftActive || m_jitterBuffer.isRecordOnly())) {
+            jumpToLive();
+        }
+    });
+    
     // 窗口控制快捷键
     QShortcut *fullscreenShortcut = new QShortcut(QKeySequence("F"), this);
     connect(fullscreenShortcut, &QShortcut::activated, this, [this]() {
@@ -454,6 +532,12 @@ void VideoPlayer::openNetworkUrl()
 }
 
 void VideoPlayer::openNetworkVideo(const QString &url)
+{
+    // 按协议选择延迟配置：RTSP/RTMP/UDP等实时源默认低延迟
+    openNetworkVideo(url, LatencyProfile::forUrl(url));
+}
+
+void VideoPlayer::openNetworkVideo(const QString &url, const LatencyProfile &profile)
 {
     // Starting async network video loading
     
@@ -463,156 +547,255 @@ void VideoPlayer::openNetworkVideo(const QString &url)
     // 设置网络流标志
     m_isNetworkStream = true;
     
-    // 如果已经在加载，取消之前的加载
-    if (m_streamLoader->isLoading()) {
-        m_streamLoader->cancelLoading();
+    // 设置当前文件URL
+    m_currentFile = url;
+    m_openTimer.start();
+    
+    // 由管理器发起连接（取消之前的加载），加载器打开并验证的上下文在onStreamReady中接管
+    m_streamManager->connectToStream(url, profile);
+    
+    // 列表中的频道：前后频道进入待机；其他地址释放待机流
+    m_channelZapper->setCurrentIndex(m_channelZapper->channels().indexOf(url));
+}
+
+void VideoPlayer::openChannelList()
+{
+    // 临时隐藏覆盖层，避免覆盖文件选择器
+    if (m_helpOverlay) {
+        m_helpOverlay->temporaryHide();
+    }
+    if (m_videoInfoOverlay) {
+        m_videoInfoOverlay->temporaryHide();
     }
     
-    // 设置当前文件URL
+    QString filename = QFileDialog::getOpenFileName(this,
+        "Select Channel List", "",
+        "Channel Lists (*.m3u *.m3u8 *.txt);;All Files (*.*)");
+    
+    // 恢复覆盖层显示状态
+    if (m_helpOverlay) {
+        m_helpOverlay->restoreFromTemporaryHide();
+    }
+    if (m_videoInfoOverlay) {
+        m_videoInfoOverlay->restoreFromTemporaryHide();
+    }
+    
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::critical(this, "Error", QString("Cannot open channel list: %1").arg(filename));
+        return;
+    }
+    
+    // 每行一个地址，#开头的是M3U标签和注释
+    QStringList urls;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#') && line.contains("://")) {
+            urls.append(line);
+        }
+    }
+    if (urls.isEmpty()) {
+        QMessageBox::critical(this, "Error", QString("No stream addresses in channel list: %1").arg(filename));
+        return;
+    }
+    
+    // 待机流与当前连接使用相同的HLS码率控制
+    NetworkConfig config = m_streamManager->getNetworkConfig();
+    m_channelZapper->setQualityControl(config.enableQualityControl, config.targetBitrate);
+    m_channelZapper->setChannels(urls);
+    openNetworkVideo(urls.first());
+}
+
+void VideoPlayer::zapChannel(int delta)
+{
+    int index = m_channelZapper->neighbourIndex(delta);
+    if (index < 0) {
+        return;
+    }
+    QString url = m_channelZapper->channelUrl(index);
+    qDebug() << "[ZAP] Switching to channel" << (index + 1) << "/" << m_channelZapper->channelCount() << url;
+    
+    // 没有就绪的待机流：按普通方式连接
+    NetworkStreamLoader::StreamInfo streamInfo;
+    if (!m_channelZapper->takeStandby(index, &streamInfo)) {
+        openNetworkVideo(url);
+        return;
+    }
+    
+    closeVideo();
+    m_isNetworkStream = true;
     m_currentFile = url;
+    m_openTimer.start();
     
-    // 开始异步加载
-    m_streamLoader->loadStreamAsync(url, 15000);  // 15秒超时
+    // 待机流已探测、解码器已打开，经加载器移交后在onStreamReady中从GOP关键帧开始解码
+    m_streamManager->connectToStandby(streamInfo);
+    m_channelZapper->setCurrentIndex(index);
 }
 
 bool VideoPlayer::isNetworkUrl(const QString &path)
 {
-    return path.startsWith("http://", Qt::CaseInsensitive) || 
-           path.startsWith("https://", Qt::CaseInsensitive) ||
-           path.startsWith("rtmp://", Qt::CaseInsensitive) ||
-           path.startsWith("rtsp://", Qt::CaseInsensitive);
+    // 与网络流管理器使用同一套协议识别（包括 udp/tcp/rtp 直播源）
+    return StreamProtocolHandler::detectProtocol(path) != StreamProtocolHandler::UNKNOWN_PROTOCOL;
 }
 
 bool VideoPlayer::openVideo(const QString &filename)
 {
-    closeVideo();  // 使用正确的方法名
-    
-    // 检测是否为网络流
-    m_isNetworkStream = filename.startsWith("http://") || filename.startsWith("https://") || 
-                       filename.startsWith("rtmp://") || filename.startsWith("rtsp://");
-    
-    if (m_isNetworkStream) {
-        qDebug() << "Opening network stream:" << filename;
-    } else {
-        qDebug() << "Opening local file:" << filename;
+    // 网络流走网络加载流程（带连接参数）
+    if (isNetworkUrl(filename)) {
+        openNetworkVideo(filename);
+        return true;
     }
     
-    QByteArray ba = filename.toUtf8();
+    qDebug() << "Opening local file:" << filename;
     
     closeVideo();
+    m_streamManager->disconnectStream();
+    m_channelZapper->setCurrentIndex(-1);
     
+    m_isNetworkStream = false;
     m_currentFile = filename;
+    m_openTimer.start();
     
-    // 打开视频文件 - 使用UTF-8编码支持中文路径
-    if (avformat_open_input(&m_formatContext, ba.constData(), nullptr, nullptr) != 0) {
-        QMessageBox::critical(this, "Error", QString("Cannot open video file: %1").arg(filename));
-        return false;
-    }
-    
-    // 继续视频打开流程
-    continueVideoOpening();
+    // 本地文件同样在工作线程中打开和探测，避免大文件/网络挂载盘阻塞界面
+    // 之前未完成的加载由加载器取消，结果在onStreamReady中接管
+    m_streamLoader->loadStreamAsync(filename, 30000);  // 网络挂载盘可能较慢，30秒超时
     
     return true;
 }
 
-void VideoPlayer::continueVideoOpening()
+bool VideoPlayer::showFirstFrame(AVFrame *frame)
 {
-    // 获取流信息
-    if (avformat_find_stream_info(m_formatContext, nullptr) < 0) {
-        QMessageBox::critical(this, "Error", "Cannot get stream info");
-        closeVideo();
-        return;
-    }
-    
-    // 查找视频流和音频流
-    m_videoStreamIndex = -1;
-    m_audioStreamIndex = -1;
-    for (unsigned int i = 0; i < m_formatContext->nb_streams; i++) {
-        if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && m_videoStreamIndex == -1) {
-            m_videoStreamIndex = i;
-        } else if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && m_audioStreamIndex == -1) {
-            m_audioStreamIndex = i;
+    // 首帧由加载器在工作线程中解码（读包可被取消、有截止时间），这里只显示，界面线程不读网络
+    // 加载器没有解码时（换台移交的GOP）只解码已在内存中的包，其他包暂存，开始播放后按原顺序处理
+    if (!frame && m_videoStreamIndex >= 0 && m_videoCodecContext) {
+        QList<AVPacket*> loadedPackets;
+        loadedPackets.swap(m_prerollPackets);
+        while (!loadedPackets.isEmpty()) {
+            AVPacket *packet = loadedPackets.takeFirst();
+            if (packet->stream_index != m_videoStreamIndex) {
+                m_prerollPackets.append(packet);
+                continue;
+            }
+            int ret = avcodec_send_packet(m_videoCodecContext, packet);
+            av_packet_free(&packet);
+            if (ret >= 0 && avcodec_receive_frame(m_videoCodecContext, m_videoFrame) == 0) {
+                frame = av_frame_clone(m_videoFrame);
+                av_frame_unref(m_videoFrame);
+                break;
+            }
         }
+        m_prerollPackets.append(loadedPackets);
     }
     
-    if (m_videoStreamIndex == -1) {
-        QMessageBox::critical(this, "Error", "No video stream found");
-        closeVideo();
-        return;
-    }
-    
-    // 设置视频解码器
-    AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
-    const AVCodec *videoCodec = avcodec_find_decoder(videoStream->codecpar->codec_id);
-    if (!videoCodec) {
-        QMessageBox::critical(this, "Error", "Video decoder not found");
-        closeVideo();
-        return;
+    if (!frame) {
+        qDebug() << "[TTFF] No video frame decoded for preview";
+        return false;
     }
     
-    m_videoCodecContext = avcodec_alloc_context3(videoCodec);
-    if (avcodec_parameters_to_context(m_videoCodecContext, videoStream->codecpar) < 0) {
-        QMessageBox::critical(this, "Error", "Cannot set video decoder parameters");
-        closeVideo();
-        return;
-    }
+    m_videoWidget->displayFrame(frame, m_videoCodecContext->width, m_videoCodecContext->height);
     
-    if (avcodec_open2(m_videoCodecContext, videoCodec, nullptr) < 0) {
-        QMessageBox::critical(this, "Error", "Cannot open video decoder");
-        closeVideo();
-        return;
+    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+    if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+        m_currentPosition = av_rescale_q(frame->best_effort_timestamp, stream->time_base, AV_TIME_BASE_Q);
+        // 时钟停在首帧，开始播放时再走，避免音频初始化期间后续帧被判为迟到
+        m_clock.set(m_currentPosition);
+        m_clock.pause();
     }
+    av_frame_free(&frame);
     
-    // 设置音频解码器（如果有音频流）
-    if (m_audioStreamIndex != -1) {
-        AVStream *audioStream = m_formatContext->streams[m_audioStreamIndex];
-        const AVCodec *audioCodec = avcodec_find_decoder(audioStream->codecpar->codec_id);
-        if (audioCodec) {
-            m_audioCodecContext = avcodec_alloc_context3(audioCodec);
-            if (avcodec_parameters_to_context(m_audioCodecContext, audioStream->codecpar) >= 0) {
-                if (avcodec_open2(m_audioCodecContext, audioCodec, nullptr) >= 0) {
-                    setupAudio();
-                } else {
-                    qDebug() << "Cannot open audio decoder, playing video only";
-                    avcodec_free_context(&m_audioCodecContext);
-                    m_audioCodecContext = nullptr;
-                }
-            } else {
-                qDebug() << "Cannot set audio decoder parameters, playing video only";
-                avcodec_free_context(&m_audioCodecContext);
-                m_audioCodecContext = nullptr;
-            }
-        } else {
-            qDebug() << "Audio decoder not found, playing video only";
+    m_firstFrameMs = m_openTimer.elapsed();
+    qDebug() << "[TTFF] First frame shown after" << m_firstFrameMs << "ms";
+    return true;
+}
+
+int VideoPlayer::readNextPacket()
+{
+    // 保留的帧显示后，先解码等待期间暂存的视频包（它们在剩余的预读包之后读到）
+    if (!m_hasPendingFrame && !m_heldPackets.isEmpty()) {
+        AVPacket *packet = m_heldPackets.takeFirst();
+        av_packet_move_ref(m_packet, packet);
+        av_packet_free(&packet);
+        return 0;
+    }
+    
+    // 先消费首帧预读时暂存的包
+    if (!m_prerollPackets.isEmpty()) {
+        AVPacket *packet = m_prerollPackets.takeFirst();
+        av_packet_move_ref(m_packet, packet);
+        av_packet_free(&packet);
+        return 0;
+    }
+    
+    // 直播回看从时移缓冲取包，追上录制位置后回到直播
+    if (m_timeshiftActive) {
+        int ret = m_timeshift.read(m_packet);
+        if (ret < 0) {
+            qDebug() << "[TIMESHIFT] Caught up with live edge";
+            jumpToLive();
+            return AVERROR(EAGAIN);
         }
+        return ret;
     }
     
-    // 分配帧和包
-    m_videoFrame = av_frame_alloc();
-    m_audioFrame = av_frame_alloc();
-    m_packet = av_packet_alloc();
-    
-    // 获取视频信息
-    m_duration = m_formatContext->duration;
-    m_fps = av_q2d(videoStream->r_frame_rate);
-    
-    // 保存视频原始尺寸和宽高比
-    m_originalVideoSize = QSize(m_videoCodecContext->width, m_videoCodecContext->height);
-    m_aspectRatio = (double)m_videoCodecContext->width / m_videoCodecContext->height;
+    // 网络流从抖动缓冲取包，缓冲中返回 AVERROR(EAGAIN)
+    if (m_jitterBuffer.isRunning()) {
+        return m_jitterBuffer.pop(m_packet);
+    }
     
-    // UI组件已移除，无需更新UI状态
+    if (m_abrController) {
+        m_abrController->syncDiscard();
+    }
+    return av_read_frame(m_formatContext, m_packet);
+}
+
+void VideoPlayer::clearPrerollPackets()
+{
+    for (AVPacket *packet : m_prerollPackets) {
+        av_packet_free(&packet);
+    }
+    m_prerollPackets.clear();
+    for (AVPacket *packet : m_heldPackets) {
+        av_packet_free(&packet);
+    }
+    m_heldPackets.clear();
+}
+
+void VideoPlayer::startJitterBuffer()
+{
+    m_jitterBuffer.start(m_formatContext);
+    m_streamManager->attachJitterBuffer(&m_jitterBuffer);
+}
+
+bool VideoPlayer::updateBufferingState()
+{
+    bool buffering = m_jitterBuffer.isRunning() && m_jitterBuffer.isBuffering();
+    if (buffering == m_isBuffering) {
+        return buffering;
+    }
     
-    // 自动适配窗口大小到视频尺寸
-    adaptWindowToVideo();
+    m_isBuffering = buffering;
     
-    // 自动开始播放
-    playPause();
+    // 缓冲期间时钟和音频一起停住，恢复后从停止处继续，不丢帧也不跳音
+    if (buffering) {
+        m_clock.pause();
+        if (m_audioProcessor) {
+            m_audioProcessor->pause();
+        }
+        qDebug() << "[BUFFER] Presentation paused, buffered" << (m_jitterBuffer.bufferedUs() / 1000) << "ms";
+    } else {
+        m_clock.resume();
+        if (m_audioProcessor) {
+            m_audioProcessor->resume();
+        }
+        qDebug() << "[BUFFER] Presentation resumed, buffered" << (m_jitterBuffer.bufferedUs() / 1000) << "ms";
+    }
     
-    QString displayName = isNetworkUrl(m_currentFile) ? "网络视频" : m_currentFile;
-    qDebug() << "Video opened successfully:" << displayName;
-    qDebug() << "Video size:" << m_videoCodecContext->width << "x" << m_videoCodecContext->height;
-    qDebug() << "FPS:" << m_fps;
-    qDebug() << "Duration:" << (m_duration / AV_TIME_BASE) << "seconds";
+    return buffering;
 }
 
 void VideoPlayer::setupAudio()
@@ -634,12 +817,25 @@ void VideoPlayer::setupAudio()
         // 移除缓冲状态日志，减少输出噪音
     }, Qt::QueuedConnection);
     
+    connect(m_audioProcessor, &AudioProcessor::latencyChanged,
+            this, [this](int64_t latencyUs) {
+        // 设备延迟已在 getAccurateAudioTime 中扣除：音频主时钟和呈现器不需要另外处理
+        // 音频跟随外部时钟时，缓冲目标变化会让测得的音频时间短暂跳动，推迟下一次硬同步避免误判
+        qDebug() << "[SYNC] Audio output latency target:" << (latencyUs / 1000) << "ms";
+        if (m_clock.mode() != MasterClock::Mode::AudioMaster) {
+            m_lastSyncTimer.restart();
+        }
+    }, Qt::QueuedConnection);
+    
     connect(m_audioProcessor, &AudioProcessor::audioError,
             this, [this](const QString& error) {
         qDebug() << "Audio error:" << error;
         // 可选：显示错误消息给用户
     }, Qt::QueuedConnection);
     
+    // 音频主时钟模式下由音频输出驱动统一时钟
+    m_audioProcessor->setClock(&m_clock);
+    
     // 初始化音频处理器
     if (!m_audioProcessor->initialize(m_audioCodecContext)) {
         qDebug() << "Failed to initialize audio processor";
@@ -670,12 +866,52 @@ void VideoPlayer::cleanupAudio()
 
 void VideoPlayer::closeVideo()
 {
+    // 重连过程中关闭：本次断线计为未恢复
+    if (m_reconnecting) {
+        finishReconnect(false);
+    }
+    
+    // 会话结束：导出同步遥测
+    finishTelemetrySession();
+    
     if (m_isPlaying) {
         m_timer->stop();
         m_isPlaying = false;
         m_isPaused = false;
     }
     
+    // 退出纯音频模式（流即将关闭，无需恢复视频）
+    if (m_audioOnlyActive) {
+        logDecodeLoad();
+        m_audioOnlyActive = false;
+    }
+    m_backgroundTimer->stop();
+    m_audioSkipUntilUs = AV_NOPTS_VALUE;
+    m_videoCatchupUs = AV_NOPTS_VALUE;
+    m_decodeLoadTimer.invalidate();
+    
+    // 重置主时钟和呈现器
+    m_catchUpTimer->stop();
+    m_catchUp.reset();
+    m_clock.setSpeed(1.0);
+    m_clock.reset();
+    m_hasPendingFrame = false;
+    clearPrerollPackets();
+    m_audioPending = false;
+    
+    // 关闭上下文前停止解复用线程，之后才能关闭时移缓冲
+    m_jitterBuffer.stop();
+    m_isBuffering = false;
+    m_jitterBuffer.setRecordOnly(false);
+    m_jitterBuffer.setRecorder(nullptr);
+    m_timeshift.close();
+    m_timeshiftActive = false;
+    if (m_streamManager) {
+        m_streamManager->attachJitterBuffer(nullptr);
+    }
+    m_abrTimer->stop();
+    m_abrController = nullptr;
+    
     cleanupAudio();
     
     if (m_videoFrame) {
@@ -704,7 +940,7 @@ void VideoPlayer::closeVideo()
     }
     
     if (m_formatContext) {
-        avformat_close_input(&m_formatContext);
+        NetworkStreamLoader::closeInput(&m_formatContext);
         m_formatContext = nullptr;
     }
     
@@ -740,8 +976,13 @@ void VideoPlayer::playVideo()
     m_playStartTime = QTime::currentTime();
     
     // 重置同步状态
-    m_lastSyncTime = 0;
+    m_lastSyncTimer.invalidate();
     m_syncAdjustmentCount = 0;
+    m_driftCorrectionTimes.clear();
+    m_residualSyncError = 0;
+    
+    // 主时钟从暂停处继续；首次播放时由第一帧或音频输出设置
+    m_clock.resume();
     
     // 启动音频处理器 - 区分首次播放和从暂停恢复
     if (m_audioProcessor) {
@@ -756,9 +997,23 @@ void VideoPlayer::playVideo()
     
     m_isPaused = false;
     
+    // 直播暂停期间只录制：从暂停处开始回看
+    if (m_timeshift.isOpen() && !m_timeshiftActive && m_jitterBuffer.isRecordOnly()) {
+        enterTimeshift(m_currentPosition, true);
+    }
+    
+    // 网络流首次播放或停止后重新播放时启动抖动缓冲
+    if (m_isNetworkStream && !m_jitterBuffer.isRunning()) {
+        startJitterBuffer();
+    }
+    
     // 启动高频定时器 - 追求最佳视觉体验
-    int interval = qMax(8, (int)(1000.0 / m_fps)); // 最小8ms，支持120fps+
-    m_timer->start(interval);
+    m_timer->start(playbackTimerInterval());
+    
+    if (!m_decodeLoadTimer.isValid()) {
+        m_decodeLoadTimer.start();
+        m_decodeLoadNs = 0;
+    }
 }
 
 void VideoPlayer::pauseVideo()
@@ -766,6 +1021,13 @@ void VideoPlayer::pauseVideo()
     m_isPlaying = false;
     m_isPaused = true;
     m_timer->stop();
+    m_clock.pause();
+    m_isBuffering = false;  // 继续播放时重新判断缓冲状态
+    
+    // 直播时移：暂停期间继续录制，不再向播放队列积压
+    if (m_timeshift.isOpen()) {
+        m_jitterBuffer.setRecordOnly(true);
+    }
     
     // 暂停音频处理器
     if (m_audioProcessor) {
@@ -790,9 +1052,16 @@ void VideoPlayer::stop()
         m_audioProcessor->stop();
     }
     
-    // 重置到开头
+    // 重置到开头，抖动缓冲在重新播放时启动（直播继续录制到时移缓冲）
+    clearPrerollPackets();
+    m_jitterBuffer.stop();
+    m_isBuffering = false;
+    m_jitterBuffer.setRecordOnly(false);
+    m_timeshiftActive = false;
     av_seek_frame(m_formatContext, m_videoStreamIndex, 0, AVSEEK_FLAG_BACKWARD);
     m_currentPosition = 0;
+    m_clock.reset();
+    m_hasPendingFrame = false;
     
     m_videoWidget->clearFrame();
 }
@@ -844,6 +1113,12 @@ void VideoPlayer::performSeek(int position)
         return;
     }
     
+    // 直播时移：在本地时移缓冲内跳转，不动网络输入
+    if (m_timeshift.isOpen()) {
+        seekTimeshift((int64_t)position * AV_TIME_BASE);
+        return;
+    }
+    
     // 边界检查 - 确保position在有效范围内
     int maxPosition = m_duration / AV_TIME_BASE;
     if (position < 0) position = 0;
@@ -864,7 +1139,10 @@ void VideoPlayer::performSeek(int position)
     
     int64_t seekTarget = (int64_t)position * AV_TIME_BASE;
     
-    // 执行seek操作
+    // 执行seek操作，首帧预读暂存的包和抖动缓冲中的包随之失效
+    clearPrerollPackets();
+    bool jitterBufferRunning = m_jitterBuffer.isRunning();
+    m_jitterBuffer.stop();
     bool seekSuccess = false;
     
     // 对于小步长的seek（15秒以内），尝试更精确的策略
@@ -923,181 +1201,1072 @@ void VideoPlayer::performSeek(int position)
             } else {
                 break; // 文件结束
             }
-            attempts++;
+            attempts++;
+        }
+        
+        // 如果没找到帧，使用目标位置
+        if (!foundFrame) {
+            m_currentPosition = seekTarget;
+        }
+        
+        // 主时钟跳到新位置，之前保留的帧已失效
+        m_clock.set(m_currentPosition);
+        m_hasPendingFrame = false;
+        
+        // UI组件已移除，无需更新UI
+        
+        qDebug() << "Seek completed - Target:" << position << "s, Actual:" << (m_currentPosition / AV_TIME_BASE) << "s, Distance:" << seekDistance << "s";
+    } else {
+        qDebug() << "Seek failed for position:" << position;
+    }
+    
+    // 从新位置重新缓冲
+    if (jitterBufferRunning) {
+        m_jitterBuffer.start(m_formatContext);
+    }
+    
+    // 恢复播放状态
+    if (wasPlaying) {
+        m_timer->start(playbackTimerInterval());
+    }
+    
+    // 清除seek状态 - 确保状态重置
+    m_isSeeking = false;
+    
+    qDebug() << "PerformSeek completed - Final position:" << (m_currentPosition / AV_TIME_BASE) << "s";
+}
+
+void VideoPlayer::updatePosition()
+{
+    if (!m_isPlaying || !m_formatContext || m_isSeeking) return;
+    
+    // 抖动缓冲低于低水位：暂停呈现，等待达到高水位
+    if (updateBufferingState()) return;
+    
+    // 只需要解码帧，UI组件已移除
+    decodeFrame();
+}
+
+bool VideoPlayer::decodeFrame()
+{
+    if (!m_formatContext || !m_videoCodecContext) return false;
+    
+    // 后台纯音频模式：视频流已在解复用层丢弃
+    if (m_audioOnlyActive) {
+        return decodeAudioOnly();
+    }
+    
+    // 上一轮解码出的帧还未到显示时间：继续为音频供数，否则音频主时钟等不到帧的显示时间
+    if (m_hasPendingFrame) {
+        if (presentPendingFrame()) {
+            m_hasPendingFrame = false;
+        } else {
+            demuxWhileHolding();
+        }
+        return true;
+    }
+    
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    
+    // 呈现容差：早于时钟半个定时周期以内直接显示，落后超过两帧则丢弃
+    const int64_t frameDurationUs = static_cast<int64_t>(1000000.0 / m_fps);
+    const int64_t holdThresholdUs = playbackTimerInterval() * 1000 / 2;
+    const int64_t lateThresholdUs = qMax<int64_t>(frameDurationUs * 2, 40000);
+    
+    bool videoFrameDecoded = false;
+    int readResult = 0;
+    
+    while (true) {
+        // 音频队列已满：本周期不再解复用，等设备消耗后继续（网络流的抖动缓冲随之积满，读取线程停在上限）
+        if (m_audioProcessor && m_audioProcessor->isQueueFull()) {
+            m_decodeLoadNs += decodeTimer.nsecsElapsed();
+            return true;
+        }
+        if ((readResult = readNextPacket()) < 0) {
+            break;
+        }
+        
+        // 码率切换：新档位从关键帧开始解码，之前的包仍来自旧档位
+        if (m_abrController && m_abrController->hasPendingSwitch() &&
+            m_packet->stream_index == m_abrController->pendingVideoStream() &&
+            (m_packet->flags & AV_PKT_FLAG_KEY)) {
+            completeVariantSwitch();
+        }
+        
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            int ret = avcodec_send_packet(m_videoCodecContext, m_packet);
+            if (ret < 0) {
+                av_packet_unref(m_packet);
+                continue;
+            }
+            
+            ret = avcodec_receive_frame(m_videoCodecContext, m_videoFrame);
+            if (ret == 0) {
+                AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
+                int64_t framePts = (m_videoFrame->best_effort_timestamp != AV_NOPTS_VALUE)
+                    ? av_rescale_q(m_videoFrame->best_effort_timestamp, stream->time_base, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+                
+                // 第一帧启动时钟（音频主时钟模式下随后由音频输出校正）
+                if (!m_clock.isValid() && framePts != AV_NOPTS_VALUE) {
+                    m_clock.set(framePts);
+                }
+                
+                int64_t clockNow = m_clock.now();
+                bool clockDriven = m_clock.mode() != MasterClock::Mode::VideoMaster &&
+                                   clockNow != AV_NOPTS_VALUE && framePts != AV_NOPTS_VALUE;
+                
+                if (clockDriven) {
+                    int64_t delay = framePts - clockNow;
+                    
+                    if (delay < -lateThresholdUs) {
+                        // 落后主时钟：丢弃，不做格式转换（恢复视频时的追帧也走这里）
+                        m_syncTelemetry.recordDroppedFrame();
+                        av_packet_unref(m_packet);
+                        // 每次最多占用8ms，避免阻塞音频供数
+                        if (decodeTimer.elapsed() >= 8) {
+                            m_decodeLoadNs += decodeTimer.nsecsElapsed();
+                            return true;
+                        }
+                        continue;
+                    }
+                    
+                    if (delay > holdThresholdUs) {
+                        // 早于主时钟：保留到显示时间
+                        m_hasPendingFrame = true;
+                        m_pendingFramePts = framePts;
+                        av_packet_unref(m_packet);
+                        m_decodeLoadNs += decodeTimer.nsecsElapsed();
+                        return true;
+                    }
+                }
+                
+                presentVideoFrame(framePts);
+                videoFrameDecoded = true;
+                // 不要在这里return，继续处理可能的音频包
+            }
+        } else if (m_packet->stream_index == m_audioStreamIndex && m_isPlaying) {
+            if (m_audioPending) {
+                // 快速探测时音频参数未确定，用收到的音频包接入音频
+                attachPendingAudio(m_packet);
+            } else if (m_audioCodecContext) {
+                // 发送音频包到音频处理器
+                sendAudioPacket(m_packet);
+            }
+        }
+        av_packet_unref(m_packet);
+        
+        // 如果已经解码了视频帧，可以返回让界面更新
+        if (videoFrameDecoded) {
+            m_decodeLoadNs += decodeTimer.nsecsElapsed();
+            return true;
+        }
+    }
+    
+    // 抖动缓冲已空，下一个定时周期进入缓冲状态
+    if (readResult == AVERROR(EAGAIN)) {
+        m_decodeLoadNs += decodeTimer.nsecsElapsed();
+        return true;
+    }
+    
+    // 网络流断开：重新打开输入后从断开处继续
+    if (beginReconnect(readResult)) {
+        return false;
+    }
+    
+    // 到达文件末尾
+    stop();
+    return false;
+}
+
+void VideoPlayer::presentVideoFrame(int64_t framePts)
+{
+    if (m_videoCatchupUs != AV_NOPTS_VALUE) {
+        m_videoCatchupUs = AV_NOPTS_VALUE;
+        m_videoCodecContext->skip_frame = AVDISCARD_DEFAULT;
+        qDebug() << "[BG] Video caught up with master clock";
+    }
+    
+    // 显示视频帧
+    m_videoWidget->displayFrame(m_videoFrame, m_videoCodecContext->width, m_videoCodecContext->height);
+    
+    // 更新当前位置
+    if (framePts != AV_NOPTS_VALUE) {
+        m_currentPosition = framePts;
+        
+        if (m_clock.mode() == MasterClock::Mode::VideoMaster) {
+            // 视频主时钟：显示时间即时钟
+            m_clock.update(framePts);
+            m_lastPresentError = 0;
+        } else {
+            m_lastPresentError = framePts - m_clock.now();
+        }
+    }
+    
+    if (m_isNetworkStream) {
+        updateGlassToGlassLatency(framePts);
+    }
+    
+    // 显示误差超过半帧计为迟到
+    m_syncTelemetry.recordPresentedFrame(m_lastPresentError, static_cast<int64_t>(500000.0 / m_fps));
+    
+    // 跟踪播放稳定性 - 快速稳定，提高响应性
+    m_frameCount++;
+    if (!m_isPlaybackStable && m_frameCount >= 5) {
+        m_isPlaybackStable = true;
+        // 移除播放稳定性日志，减少输出
+    }
+}
+
+void VideoPlayer::updateGlassToGlassLatency(int64_t framePts)
+{
+    // RTSP在收到RTCP发送端报告后给出流起点的绝对时间(NTP)，
+    // 摄像头与本机时钟同步时，显示时刻减去采集时刻即端到端延迟
+    int64_t startRealtime = m_formatContext->start_time_realtime;
+    if (startRealtime == AV_NOPTS_VALUE || startRealtime <= 0 || framePts == AV_NOPTS_VALUE) {
+        return;
+    }
+    
+    int64_t latency = av_gettime() - (startRealtime + framePts);
+    if (latency < 0 || latency > 60 * AV_TIME_BASE) {
+        return;  // 两端时钟未同步，测量无意义
+    }
+    
+    bool first = (m_glassToGlassUs == AV_NOPTS_VALUE);
+    m_glassToGlassUs = first ? latency : (m_glassToGlassUs * 15 + latency) / 16;
+    
+    if (first || m_frameCount % 300 == 0) {
+        qDebug() << "[LATENCY]" << m_latencyProfile.description() << "glass-to-glass:" << (m_glassToGlassUs / 1000) << "ms";
+    }
+}
+
+void VideoPlayer::demuxWhileHolding()
+{
+    if (!m_audioProcessor || m_audioStreamIndex < 0) {
+        return;  // 外部时钟不依赖音频输出
+    }
+    
+    // 只读取到音频缓冲达到目标水位；视频包暂存，帧显示后按原顺序解码
+    const int64_t targetBufferUs = 400000;
+    int packetBudget = 50;
+    while (m_audioProcessor->getBufferedDuration() < targetBufferUs &&
+           !m_audioProcessor->isQueueFull() && packetBudget-- > 0) {
+        // 缓冲中、断开和文件结束留给帧显示后的正常解码路径处理
+        if (readNextPacket() < 0) {
+            break;
+        }
+        
+        if (m_packet->stream_index == m_videoStreamIndex) {
+            AVPacket *held = av_packet_alloc();
+            av_packet_move_ref(held, m_packet);
+            m_heldPackets.append(held);
+            continue;
+        }
+        
+        if (m_packet->stream_index == m_audioStreamIndex) {
+            if (m_audioPending) {
+                attachPendingAudio(m_packet);
+            } else if (m_audioCodecContext) {
+                sendAudioPacket(m_packet);
+            }
+        }
+        av_packet_unref(m_packet);
+    }
+}
+
+bool VideoPlayer::presentPendingFrame()
+{
+    int64_t clockNow = m_clock.now();
+    int64_t holdThresholdUs = playbackTimerInterval() * 1000 / 2;
+    
+    if (clockNow != AV_NOPTS_VALUE && m_pendingFramePts - clockNow > holdThresholdUs) {
+        return false;
+    }
+    
+    presentVideoFrame(m_pendingFramePts);
+    return true;
+}
+
+void VideoPlayer::selectClockMode()
+{
+    if (m_clockModeForced) {
+        return;
+    }
+    
+    // 点播有可用音频输出时以音频为主，无音频时使用外部时钟
+    // 有视频的直播以外部时钟为主：源按自己的时钟推送，声卡时钟的漂移会让延迟不断积累或耗尽缓冲，
+    // 追帧变速也直接作用在外部时钟上；音频跟随主时钟，小漂移由swr补偿，大误差硬同步
+    bool hasAudio = m_audioProcessor && m_audioProcessor->isInitialized();
+    bool liveWithVideo = m_isNetworkStream && m_duration <= 0 && m_videoStreamIndex >= 0;
+    if (hasAudio && !liveWithVideo) {
+        m_clock.setMode(MasterClock::Mode::AudioMaster);
+    } else {
+        m_clock.setMode(MasterClock::Mode::External);
+    }
+}
+
+void VideoPlayer::beginTelemetrySession()
+{
+    // 只记录文件名或主机名，不导出完整路径
+    QString source;
+    if (isNetworkUrl(m_currentFile)) {
+        QUrl url(m_currentFile);
+        source = url.scheme() + "://" + url.host();
+    } else {
+        source = QFileInfo(m_currentFile).fileName();
+    }
+    
+    m_syncTelemetry.beginSession(source, MasterClock::modeName(m_clock.mode()));
+}
+
+void VideoPlayer::finishTelemetrySession()
+{
+    // 断线重连期间输入已关闭，会话仍然有效
+    if (!m_syncTelemetry.hasSamples()) {
+        return;
+    }
+    
+    m_syncTelemetry.exportJson();
+    
+    // 避免同一会话重复导出
+    m_syncTelemetry.beginSession(QString(), QString());
+}
+
+void VideoPlayer::setClockMode(MasterClock::Mode mode)
+{
+    m_clockModeForced = true;
+    m_clock.setMode(mode);
+}
+
+bool VideoPlayer::decodeAudioOnly()
+{
+    if (!m_audioProcessor) return false;
+    
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    
+    // 只读取到音频缓冲达到目标水位，剩余时间让出CPU
+    const int64_t targetBufferUs = 400000;
+    int packetBudget = 200;  // 防止音频无输出时一次读完整个文件
+    while (m_audioProcessor->getBufferedDuration() < targetBufferUs && packetBudget-- > 0) {
+        int readResult = readNextPacket();
+        if (readResult == AVERROR(EAGAIN)) {
+            break;  // 抖动缓冲中，等待水位恢复
+        }
+        if (readResult < 0) {
+            if (beginReconnect(readResult)) {
+                return false;
+            }
+            // 到达文件末尾
+            stop();
+            return false;
+        }
+        
+        if (m_packet->stream_index == m_audioStreamIndex && m_isPlaying) {
+            sendAudioPacket(m_packet);
+        }
+        av_packet_unref(m_packet);
+    }
+    
+    // 没有视频帧时，播放位置跟随主时钟
+    int64_t clockNow = m_clock.now();
+    m_currentPosition = (clockNow != AV_NOPTS_VALUE) ? clockNow : m_audioProcessor->getAccurateAudioTime();
+    
+    m_decodeLoadNs += decodeTimer.nsecsElapsed();
+    return true;
+}
+
+bool VideoPlayer::beginReconnect(int readResult)
+{
+    if (!m_isNetworkStream || !m_reconnectPolicy.isEnabled()) return false;
+    
+    // 按I/O错误码判断：解复用器在底层读取出错后往往只返回EOF，此时以输入IO记录的错误为准
+    int error = readResult;
+    if (error == AVERROR_EOF && m_formatContext && m_formatContext->pb && m_formatContext->pb->error < 0) {
+        error = m_formatContext->pb->error;
+    }
+    
+    // 点播的EOF是正常结束（无论播放位置）；直播没有终点，EOF说明服务端关闭了连接
+    bool live = m_duration <= 0;
+    if (!ReconnectPolicy::isConnectionError(error) && !(live && error == AVERROR_EOF)) {
+        return false;
+    }
+    
+    char errorText[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(error, errorText, sizeof(errorText));
+    qDebug() << "[RECONNECT] Stream interrupted at" << (m_currentPosition / 1000) << "ms:" << errorText;
+    
+    m_reconnecting = true;
+    m_resumePositionUs = live ? AV_NOPTS_VALUE : m_currentPosition;
+    m_reconnectPolicy.beginOutage();
+    m_streamManager->handleConnectionLost();
+    
+    // 时钟和音频停在断开处，与抖动缓冲欠载相同，新输入缓冲足够后恢复
+    m_timer->stop();
+    if (!m_isBuffering) {
+        m_isBuffering = true;
+        m_clock.pause();
+        if (m_audioProcessor) {
+            m_audioProcessor->pause();
+        }
+    }
+    
+    // 只关闭断开的输入，解码器和音频输出保留
+    clearPrerollPackets();
+    m_hasPendingFrame = false;
+    m_jitterBuffer.stop();
+    m_abrTimer->stop();
+    m_abrController = nullptr;
+    // 新连接的时间戳与断开前无关，时移缓冲随输入一起重建
+    m_jitterBuffer.setRecordOnly(false);
+    m_timeshift.close();
+    m_timeshiftActive = false;
+    NetworkStreamLoader::closeInput(&m_formatContext);
+    
+    scheduleReconnect();
+    return true;
+}
+
+void VideoPlayer::scheduleReconnect()
+{
+    int delayMs = m_reconnectPolicy.nextDelayMs();
+    if (delayMs < 0) {
+        int attempts = m_reconnectPolicy.attempt();
+        finishReconnect(false);
+        closeVideo();
+        m_streamManager->disconnectStream();
+        QMessageBox::warning(this, "网络流错误", QString("网络连接已断开，%1 次重连均未成功").arg(attempts));
+        return;
+    }
+    
+    qDebug() << "[RECONNECT] Attempt" << m_reconnectPolicy.attempt() << "/" << m_reconnectPolicy.maxRetries()
+             << "in" << delayMs << "ms";
+    m_reconnectTimer->start(delayMs);
+}
+
+void VideoPlayer::attemptReconnect()
+{
+    if (!m_reconnecting) return;
+    
+    // 重新走异步加载（有探测缓存，重开很快），结果在onStreamReady中接管
+    m_streamManager->reconnect();
+}
+
+bool VideoPlayer::resumeAfterReconnect(const NetworkStreamLoader::StreamInfo &streamInfo)
+{
+    AVFormatContext *formatContext = streamInfo.formatContext;
+    
+    // 沿用现有解码器要求编码参数不变（源端可能换了编码设置）
+    bool compatible = true;
+    if (m_videoCodecContext) {
+        AVCodecParameters *par = (streamInfo.videoStreamIndex >= 0)
+            ? formatContext->streams[streamInfo.videoStreamIndex]->codecpar : nullptr;
+        compatible = par && par->codec_id == m_videoCodecContext->codec_id &&
+                     par->width == m_videoCodecContext->width && par->height == m_videoCodecContext->height;
+    }
+    if (compatible && m_audioCodecContext && !streamInfo.audioPending) {
+        AVCodecParameters *par = (streamInfo.audioStreamIndex >= 0)
+            ? formatContext->streams[streamInfo.audioStreamIndex]->codecpar : nullptr;
+        compatible = par && par->codec_id == m_audioCodecContext->codec_id &&
+                     par->sample_rate == m_audioCodecContext->sample_rate &&
+                     par->ch_layout.nb_channels == m_audioCodecContext->ch_layout.nb_channels;
+    }
+    
+    finishReconnect(true);
+    
+    if (!compatible) {
+        qDebug() << "[RECONNECT] Stream parameters changed, reinitializing decoders";
+        return false;
+    }
+    
+    // 新打开的解码器和它预解码的首帧不需要，保留正在使用的解码器（预读的包仍在 prerollPackets 中）
+    AVCodecContext *videoCodecContext = streamInfo.videoCodecContext;
+    AVCodecContext *audioCodecContext = streamInfo.audioCodecContext;
+    AVFrame *firstFrame = streamInfo.firstFrame;
+    avcodec_free_context(&videoCodecContext);
+    avcodec_free_context(&audioCodecContext);
+    av_frame_free(&firstFrame);
+    
+    m_formatContext = formatContext;
+    m_prerollPackets = streamInfo.prerollPackets;
+    m_videoStreamIndex = streamInfo.videoStreamIndex;
+    if (m_audioCodecContext) {
+        m_audioStreamIndex = streamInfo.audioStreamIndex;
+        if (m_audioProcessor && m_audioStreamIndex >= 0) {
+            m_audioProcessor->setAudioStreamInfo(m_formatContext->streams[m_audioStreamIndex]);
+        }
+    }
+    if (m_audioOnlyActive && m_videoStreamIndex >= 0) {
+        m_formatContext->streams[m_videoStreamIndex]->discard = AVDISCARD_ALL;
+    }
+    
+    if (m_videoCodecContext) {
+        avcodec_flush_buffers(m_videoCodecContext);
+    }
+    
+    if (m_resumePositionUs != AV_NOPTS_VALUE) {
+        // 点播：回到断开处之前的关键帧，追帧期间丢弃早于主时钟的帧，跳过已送入音频的包
+        if (av_seek_frame(m_formatContext, -1, m_resumePositionUs, AVSEEK_FLAG_BACKWARD) >= 0) {
+            clearPrerollPackets();
+            m_audioSkipUntilUs = m_audioProcessor ? m_audioProcessor->getQueuedEndPts() : AV_NOPTS_VALUE;
+            if (!m_audioOnlyActive && m_videoCodecContext) {
+                m_videoCatchupUs = m_resumePositionUs;
+                m_videoCodecContext->skip_frame = AVDISCARD_NONREF;
+            }
+        } else {
+            qDebug() << "[RECONNECT] Resume seek failed, continuing from stream start";
+        }
+        m_currentPosition = m_resumePositionUs;
+    } else {
+        // 直播：新连接从直播边缘开始，时间戳与断开前无关，重新建立时钟和音频时间基准
+        m_clock.reset();
+        m_clock.pause();
+        if (m_audioCodecContext) {
+            avcodec_flush_buffers(m_audioCodecContext);
+        }
+        if (m_audioProcessor) {
+            m_audioProcessor->seek(0);
+        }
+        setupTimeshift();
+    }
+    
+    m_abrController = HlsAbrController::fromContext(m_formatContext);
+    if (m_abrController && !m_abrController->isActive()) {
+        m_abrController = nullptr;
+    }
+    if (m_abrController) {
+        m_abrTimer->start();
+    }
+    
+    // 暂停期间断线的，等用户继续播放时再启动抖动缓冲
+    if (m_isPlaying) {
+        startJitterBuffer();
+        m_timer->start(playbackTimerInterval());
+    }
+    updateBackgroundPlayback();
+    return true;
+}
+
+void VideoPlayer::finishReconnect(bool recovered)
+{
+    m_reconnectTimer->stop();
+    m_reconnecting = false;
+    
+    int attempts = m_reconnectPolicy.attempt();
+    qint64 outageMs = m_reconnectPolicy.finishOutage();
+    m_syncTelemetry.recordReconnect(recovered, outageMs, attempts);
+    
+    qDebug() << "[RECONNECT]" << (recovered ? "Recovered" : "Gave up") << "after" << attempts
+             << "attempt(s)," << outageMs << "ms offline";
+}
+
+void VideoPlayer::setupTimeshift()
+{
+    // 点播可以直接seek，只有直播需要录制
+    NetworkConfig config = m_streamManager->getNetworkConfig();
+    bool live = m_isNetworkStream && m_duration <= 0;
+    if (live && config.timeshiftSeconds > 0 &&
+        m_timeshift.open(m_formatContext, static_cast<int64_t>(config.timeshiftSeconds) * AV_TIME_BASE, config.timeshiftBytes)) {
+        m_jitterBuffer.setRecorder(&m_timeshift);
+    } else {
+        m_jitterBuffer.setRecorder(nullptr);
+    }
+}
+
+void VideoPlayer::enterTimeshift(int64_t targetUs, bool continuous)
+{
+    int64_t entryUs = m_timeshift.seek(targetUs);
+    if (entryUs == AV_NOPTS_VALUE) {
+        qDebug() << "[TIMESHIFT] Nothing recorded yet, staying live";
+        if (!m_timeshiftActive) {
+            m_jitterBuffer.setRecordOnly(false);
+        }
+        return;
+    }
+    // 目标（如很久之前的暂停位置）已被淘汰：从最早可回看的位置开始
+    if (entryUs > targetUs) {
+        targetUs = entryUs;
+        continuous = false;
+    }
+    
+    // 抖动缓冲只录制，播放改为从时移缓冲读取
+    m_jitterBuffer.setRecordOnly(true);
+    m_timeshiftActive = true;
+    m_isBuffering = false;
+    clearPrerollPackets();
+    m_hasPendingFrame = false;
+    if (m_videoCodecContext) {
+        avcodec_flush_buffers(m_videoCodecContext);
+    }
+    
+    if (continuous) {
+        // 暂停后继续：音频从暂停处接着播放，跳过重复读到的音频包
+        m_audioSkipUntilUs = m_audioProcessor ? m_audioProcessor->getQueuedEndPts() : AV_NOPTS_VALUE;
+    } else {
+        if (m_audioCodecContext) {
+            avcodec_flush_buffers(m_audioCodecContext);
+        }
+        if (m_audioProcessor) {
+            m_audioProcessor->seek(targetUs);
+        }
+        m_audioSkipUntilUs = AV_NOPTS_VALUE;
+        m_clock.set(targetUs);
+        m_currentPosition = targetUs;
+    }
+    
+    // 从入口关键帧追到目标位置，期间跳过非参考帧
+    if (!m_audioOnlyActive && m_videoCodecContext) {
+        m_videoCatchupUs = targetUs;
+        m_videoCodecContext->skip_frame = AVDISCARD_NONREF;
+    }
+    
+    qDebug() << "[TIMESHIFT] Playing from" << (targetUs / 1000) << "ms, entry" << (entryUs / 1000)
+             << "ms, live edge" << (m_timeshift.liveEdgeUs() / 1000) << "ms";
+}
+
+void VideoPlayer::seekTimeshift(int64_t targetUs)
+{
+    int64_t liveEdgeUs = m_timeshift.liveEdgeUs();
+    if (liveEdgeUs == AV_NOPTS_VALUE) {
+        return;
+    }
+    
+    // 落在直播边缘一个抖动缓冲之内：直接回到直播
+    if (targetUs >= liveEdgeUs - m_jitterBuffer.targetUs()) {
+        if (m_timeshiftActive || m_jitterBuffer.isRecordOnly()) {
+            jumpToLive();
+        }
+        return;
+    }
+    
+    int64_t startUs = m_timeshift.startUs();
+    enterTimeshift(qMax(targetUs, startUs), false);
+}
+
+void VideoPlayer::jumpToLive()
+{
+    qDebug() << "[TIMESHIFT] Jump to live," << (m_timeshift.liveEdgeUs() - m_currentPosition) / 1000 << "ms behind";
+    
+    m_timeshiftActive = false;
+    clearPrerollPackets();
+    m_hasPendingFrame = false;
+    m_audioSkipUntilUs = AV_NOPTS_VALUE;
+    m_videoCatchupUs = AV_NOPTS_VALUE;
+    if (m_videoCodecContext) {
+        avcodec_flush_buffers(m_videoCodecContext);
+        m_videoCodecContext->skip_frame = AVDISCARD_DEFAULT;
+    }
+    if (m_audioCodecContext) {
+        avcodec_flush_buffers(m_audioCodecContext);
+    }
+    
+    // 与直播重连相同：时钟和音频由直播边缘的第一帧重新建立
+    m_clock.reset();
+    m_clock.pause();
+    if (m_audioProcessor) {
+        m_audioProcessor->seek(0);
+    }
+    
+    // 抖动缓冲恢复排队，从直播边缘重新积累到高水位
+    m_jitterBuffer.setRecordOnly(false);
+    m_isBuffering = false;
+    
+    if (!m_isPlaying) {
+        playVideo();
+    }
+}
+
+void VideoPlayer::updateLiveCatchUp()
+{
+    // 只在直播正常播放时测量：暂停、缓冲、回看和重连期间的积压不代表直播延迟
+    bool measuring = m_isPlaying && !m_isBuffering && !m_timeshiftActive && !m_reconnecting &&
+                     m_jitterBuffer.isRunning() && !m_jitterBuffer.isRecordOnly();
+    if (!measuring) {
+        m_catchUp.reset();
+        if (m_clock.speed() != 1.0) {
+            applyPlaybackSpeed(1.0);
+        }
+        return;
+    }
+    
+    // 本地积压：已收到未解码的包 + 已解码未播放的音频
+    int64_t backlogUs = m_jitterBuffer.bufferedUs();
+    if (m_audioProcessor && m_audioCodecContext) {
+        backlogUs += m_audioProcessor->getBufferedDuration();
+    }
+    
+    double speed = m_catchUp.update(backlogUs);
+    if (speed != m_clock.speed()) {
+        applyPlaybackSpeed(speed);
+    }
+}
+
+void VideoPlayer::applyPlaybackSpeed(double speed)
+{
+    // 音频变速不变调，主时钟同速推进，视频按时钟呈现，音画保持同步
+    m_clock.setSpeed(speed);
+    if (m_audioProcessor) {
+        m_audioProcessor->setTempo(speed);
+    }
+}
+
+int64_t VideoPlayer::seekableEndUs() const
+{
+    // 直播时移可以前进到直播边缘
+    if (m_timeshift.isOpen()) {
+        int64_t liveEdgeUs = m_timeshift.liveEdgeUs();
+        if (liveEdgeUs != AV_NOPTS_VALUE) {
+            return liveEdgeUs;
+        }
+    }
+    return m_duration;
+}
+
+void VideoPlayer::evaluateAbr()
+{
+    // 纯音频模式下视频在解复用层被丢弃，吞吐量不代表视频档位；回看时抖动缓冲不积累，水位无意义
+    if (!m_abrController || !m_isPlaying || m_audioOnlyActive || m_timeshiftActive) return;
+    
+    m_abrController->evaluate(m_jitterBuffer.bufferedUs(), m_jitterBuffer.targetUs());
+}
+
+void VideoPlayer::completeVariantSwitch()
+{
+    // 各档位编码参数相同（准备档位时已过滤），沿用现有解码器
+    m_videoStreamIndex = m_abrController->pendingVideoStream();
+    
+    int audioStream = m_abrController->pendingAudioStream();
+    if (audioStream >= 0 && audioStream != m_audioStreamIndex) {
+        m_audioStreamIndex = audioStream;
+        if (m_audioProcessor) {
+            m_audioProcessor->setAudioStreamInfo(m_formatContext->streams[audioStream]);
+            // 新档位分片与旧档位重叠的部分已经送入音频处理器
+            m_audioSkipUntilUs = m_audioProcessor->getQueuedEndPts();
+        }
+    }
+    
+    m_abrController->commitSwitch();
+    qDebug() << "[ABR] Switched to" << m_abrController->description();
+}
+
+void VideoPlayer::sendAudioPacket(AVPacket *packet)
+{
+    if (!m_audioProcessor) return;
+    
+    // 恢复视频时的关键帧seek会回退解复用位置，跳过已经送入音频处理器的包
+    if (m_audioSkipUntilUs != AV_NOPTS_VALUE) {
+        if (packet->pts != AV_NOPTS_VALUE) {
+            AVStream *stream = m_formatContext->streams[m_audioStreamIndex];
+            int64_t packetPts = av_rescale_q(packet->pts, stream->time_base, AV_TIME_BASE_Q);
+            if (packetPts < m_audioSkipUntilUs) {
+                return;
+            }
         }
-        
-        // 如果没找到帧，使用目标位置
-        if (!foundFrame) {
-            m_currentPosition = seekTarget;
+        m_audioSkipUntilUs = AV_NOPTS_VALUE;
+    }
+    
+    m_audioProcessor->processAudioPacket(packet);
+}
+
+void VideoPlayer::attachPendingAudio(AVPacket *packet)
+{
+    // 长时间解不出音频帧时放弃，仅播放视频
+    const int maxPendingPackets = 200;
+    if (++m_pendingAudioPackets > maxPendingPackets) {
+        qDebug() << "[TTFF] Audio parameters still unknown, playing video only";
+        avcodec_free_context(&m_audioCodecContext);
+        m_audioPending = false;
+        return;
+    }
+    
+    AVStream *audioStream = m_formatContext->streams[m_audioStreamIndex];
+    if (!m_audioCodecContext) {
+        const AVCodec *audioCodec = avcodec_find_decoder(audioStream->codecpar->codec_id);
+        if (audioCodec) {
+            m_audioCodecContext = avcodec_alloc_context3(audioCodec);
+        }
+        if (!m_audioCodecContext ||
+            avcodec_parameters_to_context(m_audioCodecContext, audioStream->codecpar) < 0 ||
+            avcodec_open2(m_audioCodecContext, audioCodec, nullptr) < 0) {
+            qDebug() << "[TTFF] Cannot open audio decoder, playing video only";
+            avcodec_free_context(&m_audioCodecContext);
+            m_audioPending = false;
+            return;
         }
-        
-        // UI组件已移除，无需更新UI
-        
-        qDebug() << "Seek completed - Target:" << position << "s, Actual:" << (m_currentPosition / AV_TIME_BASE) << "s, Distance:" << seekDistance << "s";
-    } else {
-        qDebug() << "Seek failed for position:" << position;
     }
     
-    // 恢复播放状态
-    if (wasPlaying) {
-        m_timer->start(1000.0 / m_fps);
+    // 解码出第一帧后，采样率和声道布局才确定（如ADTS流中的AAC）
+    if (avcodec_send_packet(m_audioCodecContext, packet) < 0 ||
+        avcodec_receive_frame(m_audioCodecContext, m_audioFrame) != 0) {
+        return;
     }
     
-    // 清除seek状态 - 确保状态重置
-    m_isSeeking = false;
+    bool ready = m_audioFrame->sample_rate > 0 && m_audioFrame->ch_layout.nb_channels > 0;
+    if (ready) {
+        m_audioCodecContext->sample_rate = m_audioFrame->sample_rate;
+        m_audioCodecContext->sample_fmt = static_cast<AVSampleFormat>(m_audioFrame->format);
+        av_channel_layout_uninit(&m_audioCodecContext->ch_layout);
+        av_channel_layout_copy(&m_audioCodecContext->ch_layout, &m_audioFrame->ch_layout);
+    }
+    av_frame_unref(m_audioFrame);
     
-    qDebug() << "PerformSeek completed - Final position:" << (m_currentPosition / AV_TIME_BASE) << "s";
+    if (!ready) {
+        return;
+    }
+    
+    // 参数已确定：清空解码器，由音频处理器从当前包重新解码
+    avcodec_flush_buffers(m_audioCodecContext);
+    m_audioPending = false;
+    
+    setupAudio();
+    if (!m_audioProcessor) {
+        qDebug() << "[TTFF] Audio output unavailable, playing video only";
+        return;
+    }
+    
+    m_audioProcessor->start();
+    selectClockMode();
+    
+    m_audioAttachMs = m_openTimer.elapsed();
+    qDebug() << "[TTFF] Audio attached after" << m_audioAttachMs << "ms ("
+             << m_pendingAudioPackets << "packets)";
+    
+    sendAudioPacket(packet);
 }
 
-void VideoPlayer::updatePosition()
+void VideoPlayer::setAudioOnlyMode(bool enabled)
 {
-    if (!m_isPlaying || !m_formatContext || m_isSeeking) return;
+    m_audioOnlyRequested = enabled;
     
-    // 只需要解码帧，UI组件已移除
-    decodeFrame();
+    if (enabled) {
+        m_backgroundTimer->stop();
+        applyAudioOnlyMode(true);
+    } else {
+        updateBackgroundPlayback();
+    }
 }
 
-bool VideoPlayer::decodeFrame()
+void VideoPlayer::updateBackgroundPlayback()
 {
-    if (!m_formatContext || !m_videoCodecContext) return false;
+    // 最小化或窗口完全不可见（平台支持遮挡检测时）
+    bool hidden = isMinimized() || (windowHandle() && !windowHandle()->isExposed());
+    bool wanted = m_audioOnlyRequested || hidden;
     
-    bool videoFrameDecoded = false;
-    
-    while (av_read_frame(m_formatContext, m_packet) >= 0) {
-        if (m_packet->stream_index == m_videoStreamIndex) {
-            int ret = avcodec_send_packet(m_videoCodecContext, m_packet);
-            if (ret < 0) {
-                av_packet_unref(m_packet);
-                continue;
-            }
-            
-            ret = avcodec_receive_frame(m_videoCodecContext, m_videoFrame);
-            if (ret == 0) {
-                // 显示视频帧
-                m_videoWidget->displayFrame(m_videoFrame, m_videoCodecContext->width, m_videoCodecContext->height);
-                
-                // 更新当前位置
-                if (m_videoFrame->pts != AV_NOPTS_VALUE) {
-                    AVStream *stream = m_formatContext->streams[m_videoStreamIndex];
-                    m_currentPosition = av_rescale_q(m_videoFrame->pts, stream->time_base, AV_TIME_BASE_Q);
-                }
-                
-                // 跟踪播放稳定性 - 快速稳定，提高响应性
-                m_frameCount++;
-                if (!m_isPlaybackStable && m_frameCount >= 5) {
-                    m_isPlaybackStable = true;
-                    // 移除播放稳定性日志，减少输出
-                }
-                
-                videoFrameDecoded = true;
-                // 不要在这里return，继续处理可能的音频包
-            }
-        } else if (m_packet->stream_index == m_audioStreamIndex && m_audioCodecContext && m_isPlaying) {
-            // 发送音频包到音频处理器
-            if (m_audioProcessor) {
-                m_audioProcessor->processAudioPacket(m_packet);
-            }
+    if (wanted && !m_audioOnlyActive) {
+        if (!m_backgroundTimer->isActive()) {
+            m_backgroundTimer->start();
         }
-        av_packet_unref(m_packet);
-        
-        // 如果已经解码了视频帧，可以返回让界面更新
-        if (videoFrameDecoded) {
-            return true;
+    } else if (!wanted) {
+        m_backgroundTimer->stop();
+        if (m_audioOnlyActive) {
+            applyAudioOnlyMode(false);
         }
     }
+}
+
+void VideoPlayer::applyAudioOnlyMode(bool enabled)
+{
+    if (enabled == m_audioOnlyActive) return;
+    if (!m_formatContext || m_videoStreamIndex < 0) return;
     
-    // 到达文件末尾
-    stop();
-    return false;
+    // 没有音频时纯音频模式没有意义
+    if (enabled && (!m_audioProcessor || m_audioStreamIndex < 0)) return;
+    
+    // 结算上一模式的解码负载
+    logDecodeLoad();
+    
+    AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
+    
+    if (enabled) {
+        // 在解复用层丢弃视频包，不再解码和转换视频帧
+        videoStream->discard = AVDISCARD_ALL;
+        m_videoCatchupUs = AV_NOPTS_VALUE;
+        m_hasPendingFrame = false;
+        m_videoCodecContext->skip_frame = AVDISCARD_DEFAULT;
+        m_audioOnlyActive = true;
+        qDebug() << "[BG] Audio-only mode enabled";
+    } else {
+        videoStream->discard = AVDISCARD_DEFAULT;
+        m_audioOnlyActive = false;
+        resyncVideoToAudio();
+        qDebug() << "[BG] Audio-only mode disabled";
+    }
+    
+    if (m_isPlaying) {
+        m_timer->start(playbackTimerInterval());
+    }
+    
+    m_decodeLoadTimer.start();
+    m_decodeLoadNs = 0;
 }
 
-void VideoPlayer::syncAudioVideo()
+void VideoPlayer::resyncVideoToAudio()
 {
-    // 实现音视频同步逻辑
-    if (!m_audioProcessor || !m_isPlaying) {
+    if (!m_formatContext || !m_videoCodecContext) return;
+    
+    int64_t clockNow = m_clock.now();
+    int64_t resumeTime = (clockNow != AV_NOPTS_VALUE) ? clockNow : m_currentPosition;
+    AVStream *videoStream = m_formatContext->streams[m_videoStreamIndex];
+    int64_t target = av_rescale_q(resumeTime, AV_TIME_BASE_Q, videoStream->time_base);
+    
+    // 快速关键帧seek：定位到主时钟之前最近的关键帧
+    clearPrerollPackets();
+    int seekResult = 0;
+    if (m_timeshiftActive) {
+        // 回看中：在时移缓冲内定位
+        seekResult = (m_timeshift.seek(resumeTime) != AV_NOPTS_VALUE) ? 0 : -1;
+    } else {
+        bool jitterBufferRunning = m_jitterBuffer.isRunning();
+        m_jitterBuffer.stop();
+        seekResult = av_seek_frame(m_formatContext, m_videoStreamIndex, target, AVSEEK_FLAG_BACKWARD);
+        if (jitterBufferRunning) {
+            m_jitterBuffer.start(m_formatContext);
+        }
+    }
+    if (seekResult < 0) {
+        qDebug() << "[BG] Keyframe seek failed, video resumes from current position";
         return;
     }
     
-    // 获取精确的音频时间
-    int64_t audioTime = m_audioProcessor->getAccurateAudioTime();
+    avcodec_flush_buffers(m_videoCodecContext);
+    m_hasPendingFrame = false;
     
-    // 计算音视频时间差
-    int64_t timeDiff = m_currentPosition - audioTime;
+    // 音频解码器不刷新，保持连续播放；跳过seek后重复读到的音频包
+    m_audioSkipUntilUs = m_audioProcessor ? m_audioProcessor->getQueuedEndPts() : AV_NOPTS_VALUE;
     
-    // 根据流类型调整同步参数
-    int64_t syncThreshold, maxSyncAdjustment, minSyncAdjustment;
+    // 追帧期间跳过非参考帧；落后主时钟的帧由呈现器丢弃
+    m_videoCatchupUs = resumeTime;
+    m_videoCodecContext->skip_frame = AVDISCARD_NONREF;
+    m_currentPosition = resumeTime;
+}
+
+int VideoPlayer::playbackTimerInterval() const
+{
+    // 纯音频模式只需保持音频缓冲水位
+    if (m_audioOnlyActive) {
+        return 100;
+    }
+    // 以半帧周期检查主时钟，保证显示时刻误差在半帧以内
+    return qMax(4, (int)(500.0 / m_fps));
+}
+
+void VideoPlayer::logDecodeLoad()
+{
+    if (!m_decodeLoadTimer.isValid() || m_decodeLoadTimer.elapsed() < 1000) {
+        return;
+    }
     
-    if (m_isNetworkStream) {
-        // 网络流使用更宽松的阈值，考虑网络抖动
-        syncThreshold = 60000;       // 60ms同步阈值
-        maxSyncAdjustment = 300000;  // 最大调整量300ms
-        minSyncAdjustment = 15000;   // 最小调整量15ms
+    // 解码负载：解码耗时占墙钟时间的比例
+    double load = 100.0 * m_decodeLoadNs / m_decodeLoadTimer.nsecsElapsed();
+    if (m_audioOnlyActive) {
+        m_audioOnlyDecodeLoad = load;
     } else {
-        // 本地文件使用更严格的阈值
-        syncThreshold = 40000;       // 40ms同步阈值
-        maxSyncAdjustment = 200000;  // 最大调整量200ms
-        minSyncAdjustment = 10000;   // 最小调整量10ms
+        m_videoDecodeLoad = load;
+    }
+    
+    qDebug() << "[PERF]" << (m_audioOnlyActive ? "Audio-only" : "Video") << "decode load:"
+             << QString::number(load, 'f', 2) << "% over" << (m_decodeLoadTimer.elapsed() / 1000) << "s";
+    
+    if (m_videoDecodeLoad >= 0 && m_audioOnlyDecodeLoad >= 0) {
+        qDebug() << "[PERF] Background mode saves"
+                 << QString::number(m_videoDecodeLoad - m_audioOnlyDecodeLoad, 'f', 2) << "% of one core";
+    }
+}
+
+void VideoPlayer::syncAudioVideo()
+{
+    // 实现音视频同步逻辑
+    if (!m_audioProcessor || !m_isPlaying || m_clock.isPaused()) {
+        return;
+    }
+    
+    // 纯音频模式或追帧期间视频位置不代表实际显示，不做校正
+    if (m_audioOnlyActive || m_videoCatchupUs != AV_NOPTS_VALUE) {
+        return;
     }
     
+    int64_t clockNow = m_clock.now();
+    if (clockNow == AV_NOPTS_VALUE) {
+        return;
+    }
+    
+    int64_t audioTime = m_audioProcessor->getAccurateAudioTime();
+    
+    // 音频主时钟：视频由呈现器跟随时钟，误差取最近一帧的显示误差
+    // 其他模式：音频需要跟随主时钟
+    bool audioMaster = (m_clock.mode() == MasterClock::Mode::AudioMaster);
+    int64_t timeDiff = audioMaster ? m_lastPresentError : (clockNow - audioTime);
+    
+    // 残余误差：指数平滑的绝对误差
+    m_residualSyncError = (m_residualSyncError * 15 + std::abs(timeDiff)) / 16;
+    m_syncTelemetry.recordOffset(timeDiff);
+    
     // 定期输出同步状态（每100次调用输出一次，方便查看）
-    static int syncCallCount = 0;
-    syncCallCount++;
-    bool shouldLogStatus = (syncCallCount % 100 == 1);
+    if (++m_syncCallCount % 100 == 1) {
+        qDebug() << "[SYNC]" << MasterClock::modeName(m_clock.mode())
+                 << "Clock:" << (clockNow / 1000) << "ms V:" << (m_currentPosition / 1000)
+                 << "ms A:" << (audioTime / 1000) << "ms Residual:" << (m_residualSyncError / 1000)
+                 << "ms Dropped:" << m_syncTelemetry.droppedFrames()
+                 << "Corrections/min:" << getDriftCorrectionsPerMinute();
+    }
     
-    // 添加基本调试信息，确认函数被调用
-    if (shouldLogStatus) {
-        qDebug() << "[DEBUG] Sync called V:" << (m_currentPosition / 1000) << "ms A:" << (audioTime / 1000) << "ms Delta:" << (timeDiff / 1000) << "ms";
+    if (audioMaster) {
+        return;
     }
     
-    if (abs(timeDiff) > syncThreshold && abs(timeDiff) < maxSyncAdjustment) {
-        // 防止过于频繁的调整
-        int64_t currentTime = QDateTime::currentMSecsSinceEpoch();
-        if (currentTime - m_lastSyncTime < 100) { // 100ms内不重复调整
+    const int64_t syncDeadbandUs = 20000;        // 20ms以内不校正
+    const int64_t hardResyncThresholdUs = 200000; // 超过200ms硬同步
+    const int64_t discontinuityUs = 5000000;     // 超过5s视为时间戳不连续，不处理
+    
+    int64_t absDiff = std::abs(timeDiff);
+    
+    if (absDiff >= hardResyncThresholdUs && absDiff < discontinuityUs) {
+        // 大误差：丢弃或插入音频数据一次性对齐，限制频率避免反复跳变
+        if (m_lastSyncTimer.isValid() && m_lastSyncTimer.elapsed() < 1000) {
             return;
         }
         
-        // 使用自适应同步策略
-        int64_t adjustment;
-        
-        if (abs(timeDiff) > 150000) { // 超过150ms，快速调整
-            adjustment = timeDiff * 0.8; // 调整80%的差异
-        } else if (abs(timeDiff) > 100000) { // 100-150ms，中等调整
-            adjustment = timeDiff * 0.6; // 调整60%的差异
-        } else if (abs(timeDiff) > 60000) { // 60-100ms，温和调整
-            adjustment = timeDiff * 0.4; // 调整40%的差异
-        } else { // 40-60ms，轻微调整
-            adjustment = timeDiff * 0.3; // 调整30%的差异
-        }
-        
-        // 确保调整量不会太小
-        if (abs(adjustment) < minSyncAdjustment) {
-            adjustment = (timeDiff > 0) ? minSyncAdjustment : -minSyncAdjustment;
+        int64_t appliedUs = m_audioProcessor->hardResync(clockNow);
+        m_lastSyncTimer.restart();
+        // 队列中没有可丢弃的数据时没有实际校正，不计数
+        if (appliedUs == 0) {
+            return;
         }
+        m_syncTelemetry.recordCorrection(SyncTelemetry::Correction::HardResync, timeDiff);
+        recordDriftCorrection();
         
-        m_audioProcessor->setMasterClock(m_currentPosition - adjustment);
-        
-        // 记录同步调整
-        m_lastSyncTime = currentTime;
-        m_syncAdjustmentCount++;
+        qDebug() << "[SYNC] Hard resync Clock:" << (clockNow / 1000) << "ms"
+                 << "A:" << (audioTime / 1000) << "ms"
+                 << "Delta:" << (timeDiff / 1000) << "ms Applied:" << (appliedUs / 1000) << "ms";
         
-        // 输出同步调整日志
-        if (abs(timeDiff) > (m_isNetworkStream ? 50000 : 40000)) {
-            qDebug() << "[SYNC]" << (m_isNetworkStream ? "NET" : "LOCAL") 
-                     << "V:" << (m_currentPosition / 1000) << "ms"
-                     << "A:" << (audioTime / 1000) << "ms"
-                     << "Delta:" << (timeDiff / 1000) << "ms"
-                     << "Adj:" << (adjustment / 1000) << "ms";
+    } else if (absDiff > syncDeadbandUs && absDiff < hardResyncThresholdUs) {
+        // 小漂移：在补偿窗口内平滑伸缩音频，窗口结束前不重复设置
+        if (m_audioProcessor->isCompensating()) {
+            return;
         }
         
-    } else if (shouldLogStatus && abs(timeDiff) > syncThreshold) {
-        // 只在有问题时输出状态
-        QString status = (abs(timeDiff) >= maxSyncAdjustment) ? "FAR" : "MONITOR";
-        
-        qDebug() << "[A/V]" << status << (m_isNetworkStream ? "NET" : "LOCAL")
-                 << "V:" << (m_currentPosition / 1000) << "ms"
-                 << "A:" << (audioTime / 1000) << "ms" 
-                 << "Delta:" << (timeDiff / 1000) << "ms";
+        if (m_audioProcessor->compensateDrift(timeDiff)) {
+            m_lastSyncTimer.restart();
+            m_syncAdjustmentCount++;
+            m_syncTelemetry.recordCorrection(SyncTelemetry::Correction::Compensation, timeDiff);
+            recordDriftCorrection();
+        }
+    }
+}
+
+void VideoPlayer::recordDriftCorrection()
+{
+    m_driftCorrectionTimes.enqueue(QDateTime::currentMSecsSinceEpoch());
+}
+
+double VideoPlayer::getDriftCorrectionsPerMinute()
+{
+    // 只保留最近60秒内的校正记录
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!m_driftCorrectionTimes.isEmpty() && now - m_driftCorrectionTimes.head() > 60000) {
+        m_driftCorrectionTimes.dequeue();
     }
+    return m_driftCorrectionTimes.size();
 }
 
 void VideoPlayer::setupHelpOverlay()
@@ -1131,6 +2300,11 @@ void VideoPlayer::setupHelpOverlay()
         "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>Ctrl+← →</span>"
         "</div>"
         
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 9pt; min-width: 100px; display: inline-block;'>回到直播：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>L</span>"
+        "</div>"
+        
         // 音量控制
         "<div style='margin-bottom: 3px;'>"
         "<span style='color: rgba(255,255,255,0.7); font-size: 9pt; min-width: 100px; display: inline-block;'>音量调节：</span>"
@@ -1153,6 +2327,16 @@ void VideoPlayer::setupHelpOverlay()
         "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>Ctrl+U</span>"
         "</div>"
         
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 9pt; min-width: 100px; display: inline-block;'>频道列表：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>Ctrl+L</span>"
+        "</div>"
+        
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 9pt; min-width: 100px; display: inline-block;'>切换频道：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>PgUp PgDn</span>"
+        "</div>"
+        
         "<div style='margin-bottom: 3px;'>"
         "<span style='color: rgba(255,255,255,0.7); font-size: 9pt; min-width: 100px; display: inline-block;'>退出程序：</span>"
         "<span style='color: rgba(255,255,255,0.9); font-size: 9pt;'>Ctrl+Q</span>"
@@ -1205,7 +2389,7 @@ void VideoPlayer::toggleHelpOverlay()
         // 显示帮助
         int w = width(), h = height();
         int ow = 240;  // 固定宽度
-        int oh = 300;  // 高度以容纳所有快捷键
+        int oh = 320;  // 高度以容纳所有快捷键
         
         // 位置计算 - 显示在右侧
         int x = w - ow - 30;  // 右边距
@@ -1260,7 +2444,7 @@ void VideoPlayer::toggleVideoInfoOverlay()
         int ow = 280;  // 视频信息框稍宽一些
         
         // 动态计算高度，基于是否有视频加载
-        int oh = m_formatContext ? 320 : 120;  // 有视频时较高，无视频时较矮
+        int oh = m_formatContext ? (m_isNetworkStream ? 630 : 480) : 120;  // 有视频时较高，无视频时较矮
         
         // 位置计算 - 显示在左侧，与帮助框区分
         int x = 30;  // 左边距
@@ -1304,6 +2488,21 @@ QString VideoPlayer::generateVideoInfoText()
         "</div>"
     ).arg(displayName);
     
+    // 首帧耗时（延迟接入音频时一并显示）
+    if (m_firstFrameMs >= 0) {
+        QString ttffText = QString("%1 ms").arg(m_firstFrameMs);
+        if (m_audioAttachMs >= 0) {
+            ttffText += QString("（音频 %1 ms）").arg(m_audioAttachMs);
+        }
+        
+        infoText += QString(
+            "<div style='margin-bottom: 3px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>首帧耗时：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1</span>"
+            "</div>"
+        ).arg(ttffText);
+    }
+    
     // 视频流信息
     if (m_videoCodecContext) {
         infoText += QString(
@@ -1391,6 +2590,131 @@ QString VideoPlayer::generateVideoInfoText()
      .arg(currentSec % 60, 2, 10, QChar('0'))
      .arg((int)(m_volume * 100));
     
+    // 网络延迟
+    if (m_isNetworkStream) {
+        QString latencyText = (m_glassToGlassUs != AV_NOPTS_VALUE)
+            ? QString("%1 ms").arg(m_glassToGlassUs / 1000)
+            : QString("不可用（源未提供绝对时间）");
+        
+        infoText += QString(
+            "<div style='margin-bottom: 4px; margin-top: 8px;'>"
+            "<span style='color: rgba(100,149,237,0.9); font-size: 10pt; font-weight: bold;'>网络延迟</span>"
+            "</div>"
+            
+            "<div style='margin-bottom: 3px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>延迟模式：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1</span>"
+            "</div>"
+            
+            "<div style='margin-bottom: 3px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>端到端：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%2</span>"
+            "</div>"
+            
+            "<div style='margin-bottom: 0px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>抖动缓冲：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%3 / %4 ms%5（卡顿 %6 次）</span>"
+            "</div>"
+        ).arg(m_latencyProfile.description(), latencyText)
+         .arg(m_jitterBuffer.bufferedUs() / 1000)
+         .arg(m_jitterBuffer.targetUs() / 1000)
+         .arg(m_isBuffering ? QString(" 缓冲中") : QString())
+         .arg(m_jitterBuffer.rebufferCount());
+        
+        if (m_abrController) {
+            infoText += QString(
+                "<div style='margin-bottom: 0px;'>"
+                "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>码率档位：</span>"
+                "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1</span>"
+                "</div>"
+            ).arg(m_abrController->description().toHtmlEscaped());
+        }
+        
+        if (const MpegTsMonitor *tsMonitor = MpegTsMonitor::fromContext(m_formatContext)) {
+            infoText += QString(
+                "<div style='margin-bottom: 0px;'>"
+                "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>传输流：</span>"
+                "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1</span>"
+                "</div>"
+            ).arg(tsMonitor->summary().toHtmlEscaped());
+        }
+        
+        if (m_syncTelemetry.outageCount() > 0) {
+            infoText += QString(
+                "<div style='margin-bottom: 0px;'>"
+                "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>断线重连：</span>"
+                "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>断开 %1 次，恢复 %2 次，平均 %3 ms</span>"
+                "</div>"
+            ).arg(m_syncTelemetry.outageCount())
+             .arg(m_syncTelemetry.recoveredCount())
+             .arg(m_syncTelemetry.averageReconnectMs());
+        }
+        
+        if (m_timeshift.isOpen()) {
+            int64_t startUs = m_timeshift.startUs();
+            int64_t liveEdgeUs = m_timeshift.liveEdgeUs();
+            int64_t windowSec = (startUs != AV_NOPTS_VALUE) ? (liveEdgeUs - startUs) / AV_TIME_BASE : 0;
+            QString stateText = m_timeshiftActive
+                ? QString("落后直播 %1 s").arg((liveEdgeUs - m_currentPosition) / AV_TIME_BASE)
+                : QString(m_jitterBuffer.isRecordOnly() ? "暂停录制中" : "直播中");
+            infoText += QString(
+                "<div style='margin-bottom: 0px;'>"
+                "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>直播时移：</span>"
+                "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>可回看 %1 s（%2 MB），%3</span>"
+                "</div>"
+            ).arg(windowSec)
+             .arg(m_timeshift.diskBytes() / (1024 * 1024))
+             .arg(stateText);
+        }
+        
+        if (m_catchUp.isEnabled()) {
+            QString speedText = (m_catchUp.speed() > 1.0)
+                ? QString("加速 %1%").arg((m_catchUp.speed() - 1.0) * 100, 0, 'f', 1)
+                : QString("原速");
+            infoText += QString(
+                "<div style='margin-bottom: 0px;'>"
+                "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>延迟追赶：</span>"
+                "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>积压 %1 / %2 ms，%3（追赶 %4 次）</span>"
+                "</div>"
+            ).arg(m_catchUp.standingBacklogUs() / 1000)
+             .arg(m_catchUp.maxUs() / 1000)
+             .arg(speedText)
+             .arg(m_catchUp.catchUpCount());
+        }
+    }
+    
+    // 同步信息
+    infoText += QString(
+        "<div style='margin-bottom: 4px; margin-top: 8px;'>"
+        "<span style='color: rgba(100,149,237,0.9); font-size: 10pt; font-weight: bold;'>音视频同步</span>"
+        "</div>"
+        
+        "<div style='margin-bottom: 3px;'>"
+        "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>主时钟：</span>"
+        "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1（丢帧 %2）</span>"
+        "</div>"
+    ).arg(MasterClock::modeName(m_clock.mode()))
+     .arg(m_syncTelemetry.droppedFrames());
+    
+    if (m_audioProcessor) {
+        infoText += QString(
+            "<div style='margin-bottom: 3px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>残余误差：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%1 ms</span>"
+            "</div>"
+            
+            "<div style='margin-bottom: 3px;'>"
+            "<span style='color: rgba(255,255,255,0.7); font-size: 8pt; min-width: 60px; display: inline-block;'>校正频率：</span>"
+            "<span style='color: rgba(255,255,255,0.9); font-size: 8pt;'>%2 次/分钟（硬同步 %3 次）</span>"
+            "</div>"
+        ).arg(m_residualSyncError / 1000.0, 0, 'f', 1)
+         .arg(getDriftCorrectionsPerMinute(), 0, 'f', 0)
+         .arg(m_syncTelemetry.hardResyncCount());
+    }
+    
+    // 会话同步统计
+    infoText += m_syncTelemetry.toOverlayHtml();
+    
     infoText += "</div>";
     return infoText;
 }
@@ -1529,7 +2853,7 @@ void VideoPlayer::resizeEvent(QResizeEvent *event)
         
         // 使用固定的紧凑尺寸
         int overlayWidth = 240;
-        int overlayHeight = 300;
+        int overlayHeight = 320;
         
         // 智能位置选择
         int x = windowWidth - overlayWidth - 30;  // 右边距
@@ -1549,7 +2873,7 @@ void VideoPlayer::resizeEvent(QResizeEvent *event)
         
         // 动态计算尺寸
         int overlayWidth = 280;
-        int overlayHeight = m_formatContext ? 320 : 120;
+        int overlayHeight = m_formatContext ? (m_isNetworkStream ? 630 : 480) : 120;
         
         // 位置计算 - 显示在左侧
         int x = 30;  // 左边距
@@ -1615,7 +2939,7 @@ void VideoPlayer::moveEvent(QMoveEvent *event)
         
         // 使用固定的紧凑尺寸
         int overlayWidth = 240;
-        int overlayHeight = 300;
+        int overlayHeight = 320;
         
         // 智能位置选择
         int x = windowWidth - overlayWidth - 30;  // 右边距
@@ -1635,7 +2959,7 @@ void VideoPlayer::moveEvent(QMoveEvent *event)
         
         // 动态计算尺寸
         int overlayWidth = 280;
-        int overlayHeight = m_formatContext ? 320 : 120;
+        int overlayHeight = m_formatContext ? (m_isNetworkStream ? 630 : 480) : 120;
         
         // 位置计算 - 显示在左侧
         int x = 30;  // 左边距
@@ -1660,9 +2984,34 @@ bool VideoPlayer::eventFilter(QObject *obj, QEvent *event)
         QHoverEvent *hoverEvent = static_cast<QHoverEvent*>(event);
         updateCursor(hoverEvent->position().toPoint());
     }
+    
+    // 窗口被完全遮挡/重新可见（依赖平台的遮挡通知）
+    if (obj == windowHandle() && event->type() == QEvent::Expose) {
+        QTimer::singleShot(0, this, &VideoPlayer::updateBackgroundPlayback);
+    }
     return QMainWindow::eventFilter(obj, event);
 }
 
+void VideoPlayer::changeEvent(QEvent *event)
+{
+    QMainWindow::changeEvent(event);
+    
+    if (event->type() == QEvent::WindowStateChange) {
+        updateBackgroundPlayback();
+    }
+}
+
+void VideoPlayer::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    
+    // 窗口句柄在首次显示后才存在，此时安装曝光事件过滤器
+    if (!m_exposeFilterInstalled && windowHandle()) {
+        windowHandle()->installEventFilter(this);
+        m_exposeFilterInstalled = true;
+    }
+}
+
 void VideoPlayer::paintEvent(QPaintEvent *event)
 {
     // 极简绘制，最高性能
@@ -1814,6 +3163,12 @@ void VideoPlayer::onNetworkStreamRequested(const NetworkStreamUI::StreamSettings
 {
     qDebug() << "Network stream requested:" << settings.url;
     
+    // 对话框中的重连设置覆盖网络配置
+    NetworkConfig config = m_streamManager->getNetworkConfig();
+    config.autoReconnect = settings.autoReconnect;
+    config.maxRetries = settings.maxRetries;
+    m_streamManager->setNetworkConfig(config);
+    
     // 对话框已经在onConnectClicked中关闭了，这里直接开始异步加载
     openNetworkVideo(settings.url);
 }
@@ -1821,16 +3176,11 @@ void VideoPlayer::onNetworkStreamRequested(const NetworkStreamUI::StreamSettings
 void VideoPlayer::onStreamConnected()
 {
     m_streamUI->setConnecting(false);
-    m_streamUI->setStatus("连接成功");
+    m_streamUI->setStatus(QString("连接成功（%1 ms）").arg(m_streamManager->getConnectionLatency()));
     
-    // 获取当前URL并开始播放
-    QString url = m_streamManager->getCurrentUrl();
-    if (!url.isEmpty()) {
-        // 关闭UI对话框
+    // 流已由onStreamReady接管播放，这里只关闭UI对话框
+    if (m_streamUI->isVisible()) {
         m_streamUI->accept();
-        
-        // 开始播放网络视频
-        openNetworkVideo(url);
     }
 }
 
@@ -1850,16 +3200,14 @@ void VideoPlayer::onStreamError(const QString &error)
     m_streamUI->setConnecting(false);
     m_streamUI->setStatus(QString("错误: %1").arg(error));
     
-    // 显示错误消息
-    QMessageBox::warning(this, "网络流错误", error);
+    // 错误消息框由onStreamLoadingFailed显示
 }
 
 void VideoPlayer::onStreamStatusChanged()
 {
     // 更新状态显示
-    QString status = QString("网络流状态已更新");
     if (m_streamUI->isVisible()) {
-        m_streamUI->setStatus(status);
+        m_streamUI->setStatus(m_streamManager->getStatusText());
     }
 }
 
@@ -1871,17 +3219,44 @@ void VideoPlayer::onStreamLoadingStarted()
 
 void VideoPlayer::onStreamReady(const NetworkStreamLoader::StreamInfo &streamInfo)
 {
-    qDebug() << "Stream ready, setting up video player";
+    // 加载期间又打开了其他文件：丢弃过期结果
+    if (streamInfo.url != m_currentFile || m_formatContext) {
+        qDebug() << "Discarding superseded stream:" << streamInfo.url;
+        AVCodecContext *videoCodecContext = streamInfo.videoCodecContext;
+        AVCodecContext *audioCodecContext = streamInfo.audioCodecContext;
+        AVFormatContext *formatContext = streamInfo.formatContext;
+        avcodec_free_context(&videoCodecContext);
+        avcodec_free_context(&audioCodecContext);
+        for (AVPacket *packet : streamInfo.prerollPackets) {
+            av_packet_free(&packet);
+        }
+        AVFrame *firstFrame = streamInfo.firstFrame;
+        av_frame_free(&firstFrame);
+        NetworkStreamLoader::closeInput(&formatContext);
+        return;
+    }
     
     // 隐藏GIF加载动画
     m_loadingWidget->hideLoading();
     
+    // 断线重连：接管新输入，解码器和音频输出保持不变
+    if (m_reconnecting) {
+        if (resumeAfterReconnect(streamInfo)) {
+            return;
+        }
+        // 编码参数变了：释放旧解码器，按新打开的流完整初始化
+        closeVideo();
+    }
+    
+    qDebug() << "Stream ready, setting up video player";
+    
     // 设置FFmpeg上下文
     m_formatContext = streamInfo.formatContext;
     m_videoStreamIndex = streamInfo.videoStreamIndex;
     m_audioStreamIndex = streamInfo.audioStreamIndex;
     m_videoCodecContext = streamInfo.videoCodecContext;
     m_audioCodecContext = streamInfo.audioCodecContext;
+    m_prerollPackets = streamInfo.prerollPackets;
     
     // 分配帧和包
     m_videoFrame = av_frame_alloc();
@@ -1890,12 +3265,48 @@ void VideoPlayer::onStreamReady(const NetworkStreamLoader::StreamInfo &streamInf
     
     // 获取视频信息
     m_duration = streamInfo.duration;
-    m_fps = streamInfo.fps;
+    m_fps = (streamInfo.fps > 0) ? streamInfo.fps : 25.0;
+    m_latencyProfile = streamInfo.latencyProfile;
+    m_glassToGlassUs = AV_NOPTS_VALUE;
+    m_audioPending = streamInfo.audioPending;
+    
+    // 抖动缓冲水位和断线重连取自网络配置，低延迟源限制缓冲深度
+    if (m_isNetworkStream) {
+        NetworkConfig config = m_streamManager->getNetworkConfig();
+        m_jitterBuffer.configure(m_latencyProfile.jitterBufferMs(config.jitterBufferMs),
+                                 config.minBufferThreshold, config.maxBufferThreshold, config.maxBufferSize);
+        m_reconnectPolicy.configure(config.autoReconnect, config.maxRetries, config.retryDelay);
+        setupTimeshift();
+        
+        // 直播：积压超过最大延迟时加速追赶，抖动缓冲放宽容量使积压留在本地可测量
+        bool live = m_duration <= 0;
+        int64_t maxLatencyUs = static_cast<int64_t>(m_latencyProfile.maxLatencyMs(config.maxLatency)) * 1000;
+        m_catchUp.configure(live, m_jitterBuffer.targetUs(), maxLatencyUs);
+        m_jitterBuffer.setCapacityUs(m_catchUp.isEnabled() ? maxLatencyUs * 2 : 0);
+        if (m_catchUp.isEnabled()) {
+            m_catchUpTimer->start();
+        }
+    }
+    
+    // HLS多档位：加载时已按起始码率选定档位，播放中按吞吐量切换
+    m_abrController = HlsAbrController::fromContext(m_formatContext);
+    if (m_abrController && !m_abrController->isActive()) {
+        m_abrController = nullptr;
+    }
+    if (m_abrController) {
+        m_abrTimer->start();
+    }
+    m_pendingAudioPackets = 0;
+    m_firstFrameMs = -1;
+    m_audioAttachMs = -1;
     
     // 保存视频原始尺寸和宽高比
     m_originalVideoSize = QSize(streamInfo.width, streamInfo.height);
     m_aspectRatio = (double)streamInfo.width / streamInfo.height;
     
+    // 先显示第一帧，再初始化音频输出和窗口
+    showFirstFrame(streamInfo.firstFrame);
+    
     // 设置音频（如果有音频流）
     if (m_audioCodecContext) {
         setupAudio();
@@ -1904,12 +3315,20 @@ void VideoPlayer::onStreamReady(const NetworkStreamLoader::StreamInfo &streamInf
     // 自动适配窗口大小到视频尺寸
     adaptWindowToVideo();
     
+    // 选择主时钟模式并开始同步遥测
+    selectClockMode();
+    beginTelemetrySession();
+    
     // 自动开始播放
     playPause();
     
-    qDebug() << "Network video opened successfully";
+    // 窗口在后台时直接以纯音频模式播放
+    updateBackgroundPlayback();
+    
+    QString displayName = m_isNetworkStream ? "网络视频" : m_currentFile;
+    qDebug() << "Video opened successfully:" << displayName << "in" << m_openTimer.elapsed() << "ms";
     qDebug() << "Video size:" << streamInfo.width << "x" << streamInfo.height;
-    qDebug() << "FPS:" << streamInfo.fps;
+    qDebug() << "FPS:" << m_fps;
     qDebug() << "Duration:" << (streamInfo.duration / AV_TIME_BASE) << "seconds";
 }
 
@@ -1920,10 +3339,21 @@ void VideoPlayer::onStreamLoadingFailed(const QString &error)
     // 隐藏GIF加载动画
     m_loadingWidget->hideLoading();
     
+    // 重连尝试失败：按退避等待下一次
+    if (m_reconnecting) {
+        scheduleReconnect();
+        return;
+    }
+    
     // 只有在真正失败时才显示错误消息（检查是否已经有视频在播放）
     if (!m_formatContext || !m_isPlaying) {
-        QMessageBox::critical(this, "网络流加载失败", 
-            QString("无法加载网络视频流:\n%1").arg(error));
+        if (m_isNetworkStream) {
+            QMessageBox::critical(this, "网络流加载失败", 
+                QString("无法加载网络视频流:\n%1").arg(error));
+        } else {
+            QMessageBox::critical(this, "Error", 
+                QString("Cannot open video file: %1\n%2").arg(m_currentFile, error));
+        }
     } else {
         qDebug() << "Ignoring error signal as stream is already playing successfully";
     }
@@ -33,11 +33,22 @@
 #include <QUrl>
 #include <cmath>
 #include <QMoveEvent>
+#include <QWindow>
+#include <QElapsedTimer>
 
 #include "VideoWidget.h"
 #include "AudioProcessor.h"
+#include "MasterClock.h"
+#include "SyncTelemetry.h"
 #include "OverlayWidget.h"
 #include "NetworkStreamLoader.h"
+#include "JitterBuffer.h"
+#include "HlsAbrController.h"
+#include "ReconnectPolicy.h"
+#include "TimeshiftBuffer.h"
+#include "LiveCatchUp.h"
+#include "MpegTsMonitor.h"
+#include "ChannelZapper.h"
 #include "LoadingWidget.h"
 
 extern "C" {
@@ -46,6 +57,7 @@ extern "C" {
     #include <libswscale/swscale.h>
     #include <libavutil/imgutils.h>
     #include <libavutil/opt.h>
+    #include <libavutil/time.h>
 }
 
 class VideoPlayer : public QMainWindow
@@ -71,8 +83,17 @@ public:
     
     bool openVideo(const QString &filename);  // 修改返回类型为bool
     void openNetworkVideo(const QString &url);  // 重构：使用新的网络流管理器
+    void openNetworkVideo(const QString &url, const LatencyProfile &profile);  // 指定延迟配置
     void openNetworkStream();                   // 新增：打开网络流对话框
     bool isNetworkUrl(const QString &path);     // 新增：判断是否为网络URL
+    
+    // 纯音频模式：丢弃视频流，只解码音频（最小化/被遮挡时自动进入）
+    void setAudioOnlyMode(bool enabled);
+    bool isAudioOnlyMode() const { return m_audioOnlyActive; }
+    
+    // 主时钟模式（默认：有音频时音频主时钟，否则外部时钟）
+    void setClockMode(MasterClock::Mode mode);
+    MasterClock::Mode clockMode() const { return m_clock.mode(); }
 
 protected:
     // 鼠标事件处理
@@ -83,10 +104,14 @@ protected:
     void moveEvent(QMoveEvent *event) override;  // 处理窗口移动，更新覆盖层位置
     bool eventFilter(QObject *obj, QEvent *event) override;
     void paintEvent(QPaintEvent *event) override; // 自定义绘制圆角
+    void changeEvent(QEvent *event) override;     // 窗口最小化/恢复
+    void showEvent(QShowEvent *event) override;
 
 private slots:
     void openFile();
     void openNetworkUrl();     // 重构：使用新的网络流对话框
+    void openChannelList();    // 打开频道列表（M3U或每行一个地址）并播放第一个频道
+    void zapChannel(int delta);  // 切换到前/后频道，待机流就绪时直接接管
     void playPause();
     void stop();
     void seek(int position);
@@ -121,11 +146,47 @@ private:
     void playVideo();
     void pauseVideo();
     bool decodeFrame();
+    bool decodeAudioOnly();                  // 纯音频模式下只解码音频到目标水位
+    void presentVideoFrame(int64_t framePts); // 显示当前解码帧并更新位置
+    bool presentPendingFrame();              // 到时间则显示保留的帧
+    void demuxWhileHolding();                // 保留帧期间继续为音频解复用，视频包暂存
+    void selectClockMode();                  // 根据流信息选择主时钟模式
+    void beginTelemetrySession();            // 开始新的同步遥测会话
+    void finishTelemetrySession();           // 导出当前会话的同步遥测
+    void sendAudioPacket(AVPacket *packet);  // 送入音频处理器（跳过恢复时的重复音频）
+    void updateBackgroundPlayback();         // 根据窗口可见性决定是否进入纯音频模式
+    void applyAudioOnlyMode(bool enabled);
+    void resyncVideoToAudio();               // 退出纯音频模式时关键帧seek到音频时钟
+    int playbackTimerInterval() const;
+    void logDecodeLoad();                    // 输出当前模式的解码负载
+    void updateGlassToGlassLatency(int64_t framePts);  // 按源的绝对时间测量端到端延迟
     void setupAudio();
     void cleanupAudio();        // 新增：清理音频
     void syncAudioVideo();      // 新增：音视频同步
+    void recordDriftCorrection();            // 记录一次漂移校正
+    double getDriftCorrectionsPerMinute();   // 最近一分钟内的漂移校正次数
+    int64_t getResidualSyncError() const { return m_residualSyncError; }
     void performSeek(int position);  // 新增：执行跳转
-    void continueVideoOpening();  // 新增：继续视频打开流程（用于网络视频）
+    bool showFirstFrame(AVFrame *frame);     // 显示加载器解码的第一帧（取得所有权）；没有时只从已读到的包中解码
+    void attachPendingAudio(AVPacket *packet);  // 快速探测未确定音频参数时，解码出第一帧后接入音频
+    int readNextPacket();                    // 读取下一个包（优先消费预读暂存的包）
+    void clearPrerollPackets();
+    void startJitterBuffer();                // 网络流：启动解复用线程并向网络流管理器报告水位
+    bool updateBufferingState();             // 抖动缓冲进入/退出缓冲时暂停/恢复呈现，返回是否在缓冲
+    void evaluateAbr();                      // 按吞吐量和缓冲水位选择HLS码率档位
+    void completeVariantSwitch();            // 新档位关键帧到达：改为解码新档位的流
+    bool beginReconnect(int readResult);     // 网络流读取失败：关闭断开的输入并开始重连，返回false表示按流结束处理
+    void scheduleReconnect();                // 按退避等待下一次尝试，次数用尽时放弃
+    void attemptReconnect();
+    bool resumeAfterReconnect(const NetworkStreamLoader::StreamInfo &streamInfo);  // 接管新输入，编码参数变化时返回false
+    void finishReconnect(bool recovered);    // 结束本次断线并记录重连指标
+    void setupTimeshift();                   // 直播流：打开时移缓冲并让抖动缓冲录制
+    void enterTimeshift(int64_t targetUs, bool continuous);  // 从时移缓冲回看，continuous表示暂停后原处继续
+    void seekTimeshift(int64_t targetUs);    // 时移窗口内跳转，接近直播边缘时回到直播
+    void jumpToLive();                       // 退出回看，从直播边缘重新缓冲
+    int64_t seekableEndUs() const;           // 可跳转的终点：点播为时长，直播时移为直播边缘
+    void updateLiveCatchUp();                // 测量直播积压，超过上限时加速追赶
+    void applyPlaybackSpeed(double speed);   // 主时钟和音频同时变速
     
     // 窗口缩放辅助方法
     ResizeDirection getResizeDirection(const QPoint &pos);
@@ -164,16 +225,60 @@ private:
     float m_volume;
     
     QString m_currentFile;
+    QElapsedTimer m_openTimer;          // 打开文件以来的时间（首帧耗时统计）
+    qint64 m_firstFrameMs;              // 本次打开的首帧耗时(ms)，-1表示尚未显示
+    qint64 m_audioAttachMs;             // 延迟接入音频的耗时(ms)，-1表示未延迟接入
+    bool m_audioPending;                // 音频流存在但尚未接入
+    int m_pendingAudioPackets;          // 等待接入期间收到的音频包数
+    QList<AVPacket*> m_prerollPackets;  // 加载器移交的包和显示首帧时预读的非视频包
+    QList<AVPacket*> m_heldPackets;     // 保留帧期间读到的视频包，帧显示后先解码
     
     // 播放稳定性相关
     QTime m_playStartTime;
     bool m_isPlaybackStable;
     int m_frameCount;
     
+    // 统一主时钟与呈现器状态
+    MasterClock m_clock;
+    bool m_clockModeForced;          // 通过API指定了时钟模式
+    bool m_hasPendingFrame;          // 解码出的帧早于时钟，等待显示
+    int64_t m_pendingFramePts;
+    int64_t m_lastPresentError;      // 最近一帧显示时相对主时钟的误差(微秒)
+    SyncTelemetry m_syncTelemetry;   // 会话级同步遥测
+    
     // 新增：增强的同步控制
-    int64_t m_lastSyncTime;          // 上次同步调整的时间
+    QElapsedTimer m_lastSyncTimer;   // 上次同步调整以来的时间
+    int m_syncCallCount;             // 同步检查次数（用于定期日志）
     int m_syncAdjustmentCount;       // 同步调整次数
+    QQueue<qint64> m_driftCorrectionTimes;  // 最近一分钟内的校正时间点
+    int64_t m_residualSyncError;     // 残余同步误差(微秒, 指数平滑)
     bool m_isNetworkStream;          // 是否为网络流
+    LatencyProfile m_latencyProfile; // 当前流的延迟配置
+    int64_t m_glassToGlassUs;        // 端到端延迟(微秒, 指数平滑)，源未提供绝对时间时为AV_NOPTS_VALUE
+    JitterBuffer m_jitterBuffer;     // 网络流解复用与解码之间的抖动缓冲
+    bool m_isBuffering;              // 抖动缓冲不足，呈现已暂停
+    HlsAbrController *m_abrController;  // HLS自适应码率（属于格式上下文，由 NetworkStreamLoader::closeInput 释放）
+    QTimer *m_abrTimer;              // 周期评估是否切换码率档位
+    ReconnectPolicy m_reconnectPolicy;  // 断线重连的退避和重试次数
+    QTimer *m_reconnectTimer;        // 等待下一次重连尝试
+    bool m_reconnecting;             // 输入已断开，正在重新打开（解码器和音频输出保留）
+    int64_t m_resumePositionUs;      // 点播断线时的播放位置，直播为AV_NOPTS_VALUE（回到直播边缘）
+    TimeshiftBuffer m_timeshift;     // 直播时移：磁盘分段环形缓冲
+    bool m_timeshiftActive;          // 正在从时移缓冲回看（抖动缓冲只录制）
+    LiveCatchUp m_catchUp;           // 直播延迟追赶
+    QTimer *m_catchUpTimer;          // 周期测量积压
+    
+    // 纯音频（后台）模式
+    bool m_audioOnlyRequested;       // 通过API显式请求
+    bool m_audioOnlyActive;          // 当前是否丢弃视频
+    QTimer *m_backgroundTimer;       // 遮挡防抖，短暂遮挡不切换
+    bool m_exposeFilterInstalled;
+    int64_t m_audioSkipUntilUs;      // 恢复后跳过已播放过的音频包
+    int64_t m_videoCatchupUs;        // 恢复后快速解码到该时间点前不显示
+    QElapsedTimer m_decodeLoadTimer; // 当前模式的持续时间
+    qint64 m_decodeLoadNs;           // 当前模式下解码耗时累计
+    double m_videoDecodeLoad;        // 正常模式解码负载(%)
+    double m_audioOnlyDecodeLoad;    // 纯音频模式解码负载(%)
     
     // 窗口移动相关
     bool m_isDragging;
@@ -200,6 +305,7 @@ private:
     NetworkStreamManager *m_streamManager;
     NetworkStreamUI *m_streamUI;
     NetworkStreamLoader *m_streamLoader;
+    ChannelZapper *m_channelZapper;  // 频道列表和前后频道的待机流
 };
 
 #endif // VIDEOPLAYER_H
\ No newline at end of file
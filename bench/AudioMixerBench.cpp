@@ -0,0 +1,32 @@
+#include "AudioMixer.h"
+#include <cstdio>
+
+extern "C" {
+    #include <libavutil/channel_layout.h>
+}
+
+// 下混内核与swr内置重混音的对比，以及浮点输出级与原S16路径的对比（合成数据）
+int main()
+{
+    const int sampleRate = 48000;
+    AudioMixer::DownmixOptions options = AudioMixer::defaultOptions();
+
+    // 输入/输出声道数，使用各自的默认布局（6=5.1，8=7.1）
+    const int cases[][2] = { { 6, 2 }, { 8, 2 }, { 8, 6 } };
+    for (const auto &c : cases) {
+        AVChannelLayout inLayout;
+        AVChannelLayout outLayout;
+        av_channel_layout_default(&inLayout, c[0]);
+        av_channel_layout_default(&outLayout, c[1]);
+        QString result = AudioMixer::benchmarkAgainstSwr(&inLayout, &outLayout, options, sampleRate);
+        std::printf("downmix %dch -> %dch: %s\n", c[0], c[1], qPrintable(result));
+        av_channel_layout_uninit(&inLayout);
+        av_channel_layout_uninit(&outLayout);
+    }
+
+    for (int channels : { 2, 6 }) {
+        QString result = AudioMixer::benchmarkOutputStage(channels, sampleRate);
+        std::printf("output stage %dch: %s\n", channels, qPrintable(result));
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+    #include <libswscale/swscale.h>
+    #include <libavutil/imgutils.h>
+}
+
+// 后台纯音频模式的CPU节省：同一播放列表分别按正常播放（解码视频并转换为RGB）
+// 和后台模式（视频流在解复用层丢弃）处理，比较每秒媒体时长消耗的进程CPU时间
+
+namespace {
+
+// 进程CPU时间（所有线程，包括解码器的帧线程），毫秒
+double processCpuMs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exitTime, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user);
+    auto toMs = [](const FILETIME &t) {
+        ULARGE_INTEGER value;
+        value.LowPart = t.dwLowDateTime;
+        value.HighPart = t.dwHighDateTime;
+        return value.QuadPart / 10000.0;
+    };
+    return toMs(kernel) + toMs(user);
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#endif
+}
+
+struct RunResult
+{
+    double cpuMs = 0.0;
+    double mediaSeconds = 0.0;
+};
+
+AVCodecContext* openDecoder(AVStream *stream)
+{
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        return nullptr;
+    }
+    AVCodecContext *context = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(context, stream->codecpar);
+    if (avcodec_open2(context, codec, nullptr) < 0) {
+        avcodec_free_context(&context);
+    }
+    return context;
+}
+
+// 处理文件开头 seconds 秒媒体时长；audioOnly 时和播放器后台模式一样丢弃视频流
+bool runFile(const QString &path, double seconds, bool audioOnly, RunResult *result)
+{
+    AVFormatContext *formatContext = nullptr;
+    if (avformat_open_input(&formatContext, path.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    avformat_find_stream_info(formatContext, nullptr);
+
+    int videoIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    int audioIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (audioIndex < 0) {
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    AVStream *audioStream = formatContext->streams[audioIndex];
+    AVCodecContext *audioContext = openDecoder(audioStream);
+    AVCodecContext *videoContext = nullptr;
+    if (videoIndex >= 0) {
+        if (audioOnly) {
+            formatContext->streams[videoIndex]->discard = AVDISCARD_ALL;
+        } else {
+            videoContext = openDecoder(formatContext->streams[videoIndex]);
+        }
+    }
+
+    // 与 VideoWidget 相同的转换：YUV -> RGB24，最快算法
+    SwsContext *swsContext = nullptr;
+    uint8_t *rgbData[4] = {};
+    int rgbLinesize[4] = {};
+    if (videoContext) {
+        swsContext = sws_getContext(videoContext->width, videoContext->height, videoContext->pix_fmt,
+                                    videoContext->width, videoContext->height, AV_PIX_FMT_RGB24,
+                                    SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        av_image_alloc(rgbData, rgbLinesize, videoContext->width, videoContext->height, AV_PIX_FMT_RGB24, 1);
+    }
+
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    int64_t startPts = AV_NOPTS_VALUE;
+    int64_t lastPts = AV_NOPTS_VALUE;
+    const int64_t limitUs = static_cast<int64_t>(seconds * AV_TIME_BASE);
+
+    double cpuStart = processCpuMs();
+    while (av_read_frame(formatContext, packet) >= 0) {
+        if (packet->stream_index == audioIndex && audioContext) {
+            if (packet->pts != AV_NOPTS_VALUE) {
+                lastPts = av_rescale_q(packet->pts, audioStream->time_base, AV_TIME_BASE_Q);
+                if (startPts == AV_NOPTS_VALUE) {
+                    startPts = lastPts;
+                }
+            }
+            if (avcodec_send_packet(audioContext, packet) >= 0) {
+                while (avcodec_receive_frame(audioContext, frame) == 0) {
+                }
+            }
+        } else if (packet->stream_index == videoIndex && videoContext) {
+            if (avcodec_send_packet(videoContext, packet) >= 0) {
+                while (avcodec_receive_frame(videoContext, frame) == 0) {
+                    if (swsContext) {
+                        sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, rgbData, rgbLinesize);
+                    }
+                }
+            }
+        }
+        av_packet_unref(packet);
+
+        if (startPts != AV_NOPTS_VALUE && lastPts - startPts >= limitUs) {
+            break;
+        }
+    }
+    result->cpuMs += processCpuMs() - cpuStart;
+    if (startPts != AV_NOPTS_VALUE) {
+        result->mediaSeconds += (lastPts - startPts) / static_cast<double>(AV_TIME_BASE);
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    av_freep(&rgbData[0]);
+    sws_freeContext(swsContext);
+    avcodec_free_context(&videoContext);
+    avcodec_free_context(&audioContext);
+    avformat_close_input(&formatContext);
+    return true;
+}
+
+// 参数可以是媒体文件，也可以是每行一个路径的播放列表（.m3u/.m3u8/.txt，#开头的行忽略）
+QStringList expandPlaylist(const QStringList &args)
+{
+    QStringList files;
+    for (const QString &arg : args) {
+        QString suffix = QFileInfo(arg).suffix().toLower();
+        if (suffix != "m3u" && suffix != "m3u8" && suffix != "txt") {
+            files.append(arg);
+            continue;
+        }
+        QFile list(arg);
+        if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            continue;
+        }
+        QTextStream stream(&list);
+        while (!stream.atEnd()) {
+            QString line = stream.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#')) {
+                continue;
+            }
+            files.append(QFileInfo(line).isRelative() ? QFileInfo(arg).dir().filePath(line) : line);
+        }
+    }
+    return files;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+
+    double seconds = 60.0;
+    int secondsArg = args.indexOf("--seconds");
+    if (secondsArg >= 0 && secondsArg + 1 < args.size()) {
+        seconds = args.at(secondsArg + 1).toDouble();
+        args.remove(secondsArg, 2);
+    }
+
+    QStringList files = expandPlaylist(args);
+    if (files.isEmpty()) {
+        std::printf("usage: background_decode_bench [--seconds N] <playlist.m3u | files...>\n");
+        return 1;
+    }
+
+    RunResult full;
+    RunResult audioOnly;
+    for (const QString &file : files) {
+        RunResult fileFull;
+        RunResult fileAudio;
+        if (!runFile(file, seconds, false, &fileFull) || !runFile(file, seconds, true, &fileAudio)) {
+            std::printf("skip %s (cannot open or no audio)\n", qPrintable(file));
+            continue;
+        }
+        std::printf("%s: %.1fs media, full %.0f ms CPU, audio-only %.0f ms CPU\n",
+                    qPrintable(QFileInfo(file).fileName()), fileFull.mediaSeconds, fileFull.cpuMs, fileAudio.cpuMs);
+        full.cpuMs += fileFull.cpuMs;
+        full.mediaSeconds += fileFull.mediaSeconds;
+        audioOnly.cpuMs += fileAudio.cpuMs;
+        audioOnly.mediaSeconds += fileAudio.mediaSeconds;
+    }
+
+    if (full.mediaSeconds <= 0.0 || audioOnly.mediaSeconds <= 0.0) {
+        return 1;
+    }
+
+    // 播放器按实时速度播放，每秒媒体时长的CPU毫秒数即平均单核占用的千分比
+    double fullPerSecond = full.cpuMs / full.mediaSeconds;
+    double audioPerSecond = audioOnly.cpuMs / audioOnly.mediaSeconds;
+    std::printf("full playback: %.1f ms CPU per media second (%.1f%% of one core)\n", fullPerSecond, fullPerSecond / 10.0);
+    std::printf("audio-only:    %.1f ms CPU per media second (%.1f%% of one core)\n", audioPerSecond, audioPerSecond / 10.0);
+    std::printf("saved: %.1f%%\n", 100.0 * (1.0 - audioPerSecond / fullPerSecond));
+    return 0;
+}
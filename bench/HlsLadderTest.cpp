@@ -0,0 +1,370 @@
+#include "HlsAbrController.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHostAddress>
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+}
+
+// HLS自适应码率测试：生成三档码率的本地HLS，由限速的HTTP服务器提供
+// 带宽充足时应逐档升到最高档，带宽降低后应降档
+
+namespace {
+
+struct Rung
+{
+    int width;
+    int height;
+    int bitrate;
+};
+
+const Rung kLadder[] = { { 320, 180, 300000 }, { 640, 360, 900000 }, { 960, 540, 2500000 } };
+const int kRungCount = 3;
+const int kFps = 25;
+const int kSeconds = 60;
+const qint64 kFastRateBps = 10000000;
+const qint64 kSlowRateBps = 600000;
+
+// 生成一个档位：噪声画面几乎不可压缩，实际码率接近设定值；每0.5秒一个关键帧和一个分片
+bool encodeVariant(const QString &dir, int index, const Rung &rung)
+{
+    QString playlist = dir + QString("/v%1.m3u8").arg(index);
+    AVFormatContext *output = nullptr;
+    if (avformat_alloc_output_context2(&output, nullptr, "hls", playlist.toUtf8().constData()) < 0) {
+        return false;
+    }
+
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG2VIDEO);
+    AVCodecContext *encoder = codec ? avcodec_alloc_context3(codec) : nullptr;
+    if (!encoder) {
+        avformat_free_context(output);
+        return false;
+    }
+    encoder->width = rung.width;
+    encoder->height = rung.height;
+    encoder->time_base = AVRational{ 1, kFps };
+    encoder->framerate = AVRational{ kFps, 1 };
+    encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder->bit_rate = rung.bitrate;
+    encoder->rc_max_rate = rung.bitrate;
+    encoder->rc_buffer_size = rung.bitrate / 2;
+    encoder->gop_size = kFps / 2;
+    encoder->max_b_frames = 0;
+    if (output->oformat->flags & AVFMT_GLOBALHEADER) {
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    AVStream *stream = avformat_new_stream(output, nullptr);
+    AVDictionary *options = nullptr;
+    av_dict_set(&options, "hls_time", "0.5", 0);
+    av_dict_set(&options, "hls_list_size", "0", 0);
+    av_dict_set(&options, "hls_playlist_type", "vod", 0);
+    QString segments = dir + QString("/v%1_").arg(index) + "%03d.ts";
+    av_dict_set(&options, "hls_segment_filename", segments.toUtf8().constData(), 0);
+
+    bool ok = avcodec_open2(encoder, codec, nullptr) >= 0 &&
+              avcodec_parameters_from_context(stream->codecpar, encoder) >= 0;
+    stream->time_base = encoder->time_base;
+    ok = ok && avformat_write_header(output, &options) >= 0;
+    av_dict_free(&options);
+
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *packet = av_packet_alloc();
+    frame->format = encoder->pix_fmt;
+    frame->width = encoder->width;
+    frame->height = encoder->height;
+    ok = ok && av_frame_get_buffer(frame, 0) >= 0;
+
+    quint32 seed = 12345u + index;
+    for (int i = 0; ok && i <= kSeconds * kFps; ++i) {
+        bool flush = (i == kSeconds * kFps);
+        if (!flush) {
+            av_frame_make_writable(frame);
+            for (int y = 0; y < frame->height; ++y) {
+                uint8_t *row = frame->data[0] + y * frame->linesize[0];
+                for (int x = 0; x < frame->width; ++x) {
+                    seed = seed * 1664525u + 1013904223u;
+                    row[x] = static_cast<uint8_t>(seed >> 24);
+                }
+            }
+            for (int plane = 1; plane < 3; ++plane) {
+                for (int y = 0; y < frame->height / 2; ++y) {
+                    memset(frame->data[plane] + y * frame->linesize[plane], 128, frame->width / 2);
+                }
+            }
+            frame->pts = i;
+        }
+
+        ok = avcodec_send_frame(encoder, flush ? nullptr : frame) >= 0;
+        while (ok && avcodec_receive_packet(encoder, packet) == 0) {
+            av_packet_rescale_ts(packet, encoder->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            ok = av_interleaved_write_frame(output, packet) >= 0;
+        }
+    }
+    ok = ok && av_write_trailer(output) >= 0;
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&encoder);
+    avformat_free_context(output);
+    return ok;
+}
+
+bool writeLadder(const QString &dir)
+{
+    QByteArray master = "#EXTM3U\n";
+    for (int i = 0; i < kRungCount; ++i) {
+        if (!encodeVariant(dir, i, kLadder[i])) {
+            return false;
+        }
+        master += QString("#EXT-X-STREAM-INF:BANDWIDTH=%1,RESOLUTION=%2x%3\nv%4.m3u8\n")
+            .arg(kLadder[i].bitrate * 11 / 10).arg(kLadder[i].width).arg(kLadder[i].height).arg(i).toUtf8();
+    }
+
+    QFile file(dir + "/master.m3u8");
+    return file.open(QIODevice::WriteOnly) && file.write(master) == master.size();
+}
+
+// 所有连接共享的链路带宽：每个数据块按当前速率排队发送
+class Shaper
+{
+public:
+    Shaper() { m_clock.start(); }
+
+    void setRate(qint64 bitsPerSecond) { m_rateBps = bitsPerSecond; }
+
+    void consume(qint64 bytes)
+    {
+        qint64 waitNs;
+        {
+            QMutexLocker locker(&m_mutex);
+            qint64 now = m_clock.nsecsElapsed();
+            m_nextFreeNs = qMax(now, m_nextFreeNs) + bytes * 8 * 1000000000LL / m_rateBps;
+            waitNs = m_nextFreeNs - now;
+        }
+        if (waitNs > 0) {
+            QThread::usleep(static_cast<unsigned long>(waitNs / 1000));
+        }
+    }
+
+private:
+    std::atomic<qint64> m_rateBps{ kFastRateBps };
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_nextFreeNs = 0;
+};
+
+// 最简单的HTTP/1.1文件服务器：每个连接一个线程，分片按共享带宽限速，播放列表不限速
+class ShapedHttpServer : public QTcpServer
+{
+public:
+    ShapedHttpServer(const QString &root, Shaper *shaper, const std::atomic<bool> *stop)
+        : m_root(root), m_shaper(shaper), m_stop(stop) {}
+
+    ~ShapedHttpServer()
+    {
+        for (QThread *thread : m_connections) {
+            thread->wait();
+            delete thread;
+        }
+    }
+
+protected:
+    void incomingConnection(qintptr descriptor) override
+    {
+        QThread *thread = QThread::create([this, descriptor]() { serve(descriptor); });
+        m_connections.append(thread);
+        thread->start();
+    }
+
+private:
+    void serve(qintptr descriptor)
+    {
+        QTcpSocket socket;
+        socket.setSocketDescriptor(descriptor);
+
+        QByteArray request;
+        while (!request.contains("\r\n\r\n")) {
+            if (*m_stop || !socket.waitForReadyRead(5000)) {
+                return;
+            }
+            request += socket.readAll();
+        }
+
+        QByteArray path = request.left(request.indexOf("\r\n")).split(' ').value(1);
+        path = path.left(path.indexOf('?') >= 0 ? path.indexOf('?') : path.size());
+        QFile file(m_root + QString::fromUtf8(path));
+        if (path.contains("..") || !file.open(QIODevice::ReadOnly)) {
+            socket.write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket.waitForBytesWritten(5000);
+            return;
+        }
+
+        bool shaped = path.endsWith(".ts");
+        socket.write(QString("HTTP/1.1 200 OK\r\nContent-Length: %1\r\nContent-Type: %2\r\nConnection: close\r\n\r\n")
+                         .arg(file.size())
+                         .arg(shaped ? "video/mp2t" : "application/vnd.apple.mpegurl").toUtf8());
+
+        while (!*m_stop && !file.atEnd() && socket.state() == QAbstractSocket::ConnectedState) {
+            QByteArray chunk = file.read(8192);
+            if (shaped) {
+                m_shaper->consume(chunk.size());
+            }
+            socket.write(chunk);
+            if (!socket.waitForBytesWritten(5000)) {
+                break;
+            }
+        }
+        socket.disconnectFromHost();
+        if (socket.state() != QAbstractSocket::UnconnectedState) {
+            socket.waitForDisconnected(1000);
+        }
+    }
+
+    QString m_root;
+    Shaper *m_shaper;
+    const std::atomic<bool> *m_stop;
+    QList<QThread*> m_connections;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    avformat_network_init();
+
+    QTemporaryDir dir;
+    if (!dir.isValid() || !writeLadder(dir.path())) {
+        std::printf("FAIL: cannot generate HLS ladder\n");
+        return 1;
+    }
+
+    // 服务器对象在自己的线程中创建和使用
+    Shaper shaper;
+    std::atomic<bool> stop{ false };
+    std::atomic<int> port{ 0 };
+    QSemaphore listening;
+    QThread *serverThread = QThread::create([&]() {
+        ShapedHttpServer server(dir.path(), &shaper, &stop);
+        if (server.listen(QHostAddress::LocalHost, 0)) {
+            port = server.serverPort();
+        }
+        listening.release();
+        while (!stop && server.isListening()) {
+            server.waitForNewConnection(100);
+        }
+    });
+    serverThread->start();
+    listening.acquire();
+    if (port == 0) {
+        std::printf("FAIL: cannot listen\n");
+        return 1;
+    }
+
+    QString url = QString("http://127.0.0.1:%1/master.m3u8").arg(port.load());
+    AVFormatContext *formatContext = avformat_alloc_context();
+    AVDictionary *options = nullptr;
+    av_dict_set(&options, "rw_timeout", "10000000", 0);
+    HlsAbrController *abr = HlsAbrController::install(formatContext, &options, 0);
+    int ret = avformat_open_input(&formatContext, url.toUtf8().constData(), nullptr, &options);
+    av_dict_free(&options);
+    if (ret < 0 || avformat_find_stream_info(formatContext, nullptr) < 0) {
+        std::printf("FAIL: cannot open %s\n", qPrintable(url));
+        return 1;
+    }
+    abr->prepare(formatContext);
+    if (!abr->isActive()) {
+        std::printf("FAIL: ladder not detected\n");
+        return 1;
+    }
+
+    auto currentHeight = [&]() {
+        return formatContext->streams[abr->currentVideoStream()]->codecpar->height;
+    };
+    const int topHeight = kLadder[kRungCount - 1].height;
+    std::printf("start at %dp, link %lld kbps\n", currentHeight(), kFastRateBps / 1000);
+
+    // 模拟播放：按实时速度消耗，缓冲超过目标时停止读取（这段等待不计入吞吐量）
+    const int64_t targetUs = 4000000;
+    QElapsedTimer playback;
+    QElapsedTimer phase;
+    phase.start();
+    int64_t firstPts = AV_NOPTS_VALUE;
+    int64_t mediaUs = 0;
+    bool reachedTop = false;
+    bool steppedDown = false;
+    AVPacket *packet = av_packet_alloc();
+
+    while (phase.elapsed() < 40000) {
+        int64_t bufferedUs = playback.isValid() ? mediaUs - playback.nsecsElapsed() / 1000 : 0;
+        if (bufferedUs > targetUs) {
+            QThread::msleep(20);
+            continue;
+        }
+
+        // 与抖动缓冲读取线程相同：切换档位请求的丢弃标志在两次读取之间应用
+        abr->syncDiscard();
+        if (av_read_frame(formatContext, packet) < 0) {
+            break;
+        }
+
+        AVStream *stream = formatContext->streams[packet->stream_index];
+        if (packet->stream_index == abr->currentVideoStream() && packet->pts != AV_NOPTS_VALUE) {
+            int64_t pts = av_rescale_q(packet->pts, stream->time_base, AV_TIME_BASE_Q);
+            if (firstPts == AV_NOPTS_VALUE) {
+                firstPts = pts;
+                playback.start();
+            }
+            mediaUs = qMax(mediaUs, pts - firstPts);
+        }
+        if (abr->hasPendingSwitch() && packet->stream_index == abr->pendingVideoStream() &&
+            (packet->flags & AV_PKT_FLAG_KEY)) {
+            abr->commitSwitch();
+        }
+        av_packet_unref(packet);
+
+        abr->evaluate(qMax<int64_t>(0, bufferedUs), targetUs);
+
+        if (!reachedTop && currentHeight() == topHeight) {
+            reachedTop = true;
+            shaper.setRate(kSlowRateBps);
+            std::printf("reached %dp after %lld ms, link %lld kbps\n", topHeight, phase.elapsed(), kSlowRateBps / 1000);
+            phase.restart();
+        } else if (reachedTop && currentHeight() < topHeight) {
+            steppedDown = true;
+            std::printf("stepped down to %dp after %lld ms\n", currentHeight(), phase.elapsed());
+            break;
+        }
+    }
+
+    av_packet_free(&packet);
+    avformat_close_input(&formatContext);
+    delete abr;
+
+    stop = true;
+    serverThread->wait();
+    delete serverThread;
+    avformat_network_deinit();
+
+    if (!reachedTop || !steppedDown) {
+        std::printf("FAIL: %s\n", reachedTop ? "no down-switch after bandwidth drop" : "never reached the top variant");
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}
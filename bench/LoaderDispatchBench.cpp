@@ -0,0 +1,105 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+// 加载任务的启动开销：原来每次加载新建 QThread 并移入一个临时 QObject，
+// 现在由常驻线程池分派。测量从发起加载到任务开始执行的延迟（换台时省下的部分）
+
+namespace {
+
+struct Stats
+{
+    std::vector<qint64> samplesNs;
+
+    void print(const char *label)
+    {
+        std::sort(samplesNs.begin(), samplesNs.end());
+        qint64 total = 0;
+        for (qint64 sample : samplesNs) {
+            total += sample;
+        }
+        std::printf("%-24s mean %7.1f us, median %7.1f us, p99 %7.1f us\n", label,
+                    total / 1000.0 / samplesNs.size(),
+                    samplesNs[samplesNs.size() / 2] / 1000.0,
+                    samplesNs[samplesNs.size() * 99 / 100] / 1000.0);
+    }
+};
+
+// 原实现：新线程 + 移入线程的工作对象，线程启动后由 started 信号开始加载
+void runPerLoadThread(int iterations, Stats *stats)
+{
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        std::atomic<qint64> startedNs{0};
+
+        timer.start();
+        QThread *thread = new QThread;
+        QObject *worker = new QObject;
+        worker->moveToThread(thread);
+        QObject::connect(thread, &QThread::started, worker, [&]() {
+            startedNs = timer.nsecsElapsed();
+            thread->quit();
+        });
+        thread->start();
+        thread->wait();
+        delete worker;
+        delete thread;
+
+        stats->samplesNs.push_back(startedNs);
+    }
+}
+
+// 现实现：常驻线程池（与 NetworkStreamLoader 相同的配置），任务直接分派到空闲线程
+void runThreadPool(int iterations, Stats *stats)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    pool.setExpiryTimeout(-1);
+
+    // 预热：第一次分派会创建线程，与播放器启动后的首次加载相同
+    QSemaphore done;
+    pool.start([&done]() { done.release(); });
+    done.acquire();
+
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        std::atomic<qint64> startedNs{0};
+
+        timer.start();
+        pool.start([&]() {
+            startedNs = timer.nsecsElapsed();
+            done.release();
+        });
+        done.acquire();
+
+        stats->samplesNs.push_back(startedNs);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int iterations = (argc > 1) ? QString(argv[1]).toInt() : 500;
+    if (iterations <= 0) {
+        iterations = 500;
+    }
+
+    Stats perLoad;
+    Stats pooled;
+    runPerLoadThread(iterations, &perLoad);
+    runThreadPool(iterations, &pooled);
+
+    std::printf("load dispatch latency over %d loads:\n", iterations);
+    perLoad.print("new QThread per load:");
+    pooled.print("persistent pool:");
+    return 0;
+}
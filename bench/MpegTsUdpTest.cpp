@@ -0,0 +1,195 @@
+#include "MpegTsMonitor.h"
+#include "StreamProtocolHandler.h"
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QThread>
+#include <QUdpSocket>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+// MPEG-TS连续性监测测试：本机UDP发送端按已知位置制造CC跳变，
+// 接收端与播放器一样经 UdpStreamHandler 设置接收参数、通过 MpegTsMonitor 打开 udp:// 地址，统计结果应与注入的丢包完全一致
+
+namespace {
+
+const int kPacketSize = 188;
+const int kPacketsPerDatagram = 7;        // 1316字节，常见的UDP直播封包大小
+const int kDatagrams = 2000;
+const int kGapInterval = 1000;            // 每隔多少个包注入一次跳变
+const int kGapSize = 3;                   // 每次跳过的计数，即丢失的包数
+const int kVideoPid = 0x100;
+const int kAudioPid = 0x101;
+const int kNullPid = 0x1FFF;
+
+struct Expected
+{
+    int packets = 0;
+    int gaps = 0;
+    int lost = 0;
+};
+
+void appendPacket(QByteArray *stream, int pid, int counter)
+{
+    char packet[kPacketSize];
+    memset(packet, 0xFF, sizeof(packet));
+    packet[0] = 0x47;
+    packet[1] = static_cast<char>((pid >> 8) & 0x1F);
+    packet[2] = static_cast<char>(pid & 0xFF);
+    packet[3] = static_cast<char>(0x10 | (counter & 0x0F));   // 只有负载
+    stream->append(packet, sizeof(packet));
+}
+
+// 两个PID交错；视频PID定期跳过计数，并插入一次标准允许的重复包（不应计为错误）
+QByteArray buildStream(Expected *expected)
+{
+    QByteArray stream;
+    int counters[2] = {0, 0};
+    const int total = kPacketsPerDatagram * kDatagrams;
+
+    for (int i = 0; i < total - 1; ++i) {
+        int slot = (i % kPacketsPerDatagram == 0) ? 1 : 0;
+        int pid = slot ? kAudioPid : kVideoPid;
+
+        if (i % kGapInterval == kGapInterval / 2) {
+            counters[slot] += kGapSize;
+            expected->gaps++;
+            expected->lost += kGapSize;
+        }
+        appendPacket(&stream, pid, counters[slot]);
+        if (i == total / 3 && !slot) {
+            appendPacket(&stream, pid, counters[slot]);
+        }
+        counters[slot]++;
+    }
+    // 空包补齐最后一个数据报（空包不检查计数）
+    while ((stream.size() / kPacketSize) % kPacketsPerDatagram != 0) {
+        appendPacket(&stream, kNullPid, 0);
+    }
+    expected->packets = stream.size() / kPacketSize;
+    return stream;
+}
+
+// 内核分配一个空闲端口，释放后交给接收端绑定
+int freeUdpPort()
+{
+    QUdpSocket socket;
+    if (!socket.bind(QHostAddress::LocalHost, 0)) {
+        return -1;
+    }
+    return socket.localPort();
+}
+
+// 源特定组播地址：源地址转为 sources 选项并从实际打开的URL中去掉，其余接收参数照常设置
+bool checkSocketOptions()
+{
+    const QString url("udp://10.0.0.1,10.0.0.2@239.1.1.1:5000?localaddr=127.0.0.1");
+    if (StreamProtocolHandler::detectProtocol(url) != StreamProtocolHandler::UDP_PROTOCOL) {
+        std::printf("FAIL: %s not detected as UDP\n", qPrintable(url));
+        return false;
+    }
+
+    AVDictionary *options = nullptr;
+    QString openUrl = UdpStreamHandler::applySocketOptions(&options, url, 0);
+    AVDictionaryEntry *sources = av_dict_get(options, "sources", nullptr, 0);
+    bool ok = openUrl == "udp://239.1.1.1:5000?localaddr=127.0.0.1"
+              && sources && QString(sources->value) == "10.0.0.1,10.0.0.2"
+              && av_dict_get(options, "buffer_size", nullptr, 0)
+              && av_dict_get(options, "fifo_size", nullptr, 0)
+              && av_dict_get(options, "overrun_nonfatal", nullptr, 0);
+    if (!ok) {
+        std::printf("FAIL: unexpected socket options for %s -> %s\n", qPrintable(url), qPrintable(openUrl));
+    }
+    av_dict_free(&options);
+    return ok;
+}
+
+bool sendStream(const QString &url, const QByteArray &stream)
+{
+    AVIOContext *output = nullptr;
+    if (avio_open2(&output, url.toUtf8().constData(), AVIO_FLAG_WRITE, nullptr, nullptr) < 0) {
+        return false;
+    }
+    const int datagramSize = kPacketSize * kPacketsPerDatagram;
+    for (int offset = 0, sent = 0; offset < stream.size(); offset += datagramSize, ++sent) {
+        avio_write(output, reinterpret_cast<const unsigned char*>(stream.constData() + offset), datagramSize);
+        avio_flush(output);
+        // 回环接口上也要限速，避免接收端套接字缓冲溢出造成真实丢包
+        if (sent % 20 == 19) {
+            QThread::msleep(1);
+        }
+    }
+    avio_closep(&output);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    avformat_network_init();
+
+    if (!checkSocketOptions()) {
+        avformat_network_deinit();
+        return 1;
+    }
+
+    Expected expected;
+    QByteArray stream = buildStream(&expected);
+
+    int port = freeUdpPort();
+    if (port < 0) {
+        std::printf("FAIL: no free UDP port\n");
+        return 1;
+    }
+
+    // 接收端参数由播放器的UDP直播同一函数设置：大套接字缓冲和接收FIFO，超时后读取返回错误
+    AVFormatContext *formatContext = avformat_alloc_context();
+    AVDictionary *options = nullptr;
+    av_dict_set(&options, "timeout", "2000000", 0);
+    QString receiveUrl = UdpStreamHandler::applySocketOptions(&options, QString("udp://127.0.0.1:%1").arg(port), 0);
+    MpegTsMonitor *monitor = MpegTsMonitor::open(receiveUrl, formatContext, options);
+    av_dict_free(&options);
+    if (!monitor) {
+        std::printf("FAIL: cannot open %s\n", qPrintable(receiveUrl));
+        avformat_free_context(formatContext);
+        return 1;
+    }
+
+    QString sendUrl = QString("udp://127.0.0.1:%1?pkt_size=%2").arg(port).arg(kPacketSize * kPacketsPerDatagram);
+    bool sent = false;
+    QThread *sender = QThread::create([&]() { sent = sendStream(sendUrl, stream); });
+    sender->start();
+
+    // 读到全部包或超时为止；解复用器在播放器中做的就是这样的读取
+    unsigned char buffer[kPacketSize * kPacketsPerDatagram];
+    while (monitor->packetCount() < expected.packets) {
+        if (avio_read(formatContext->pb, buffer, sizeof(buffer)) <= 0) {
+            break;
+        }
+    }
+    sender->wait();
+    delete sender;
+
+    std::printf("sent %d packets with %d gaps (%d lost)\n", expected.packets, expected.gaps, expected.lost);
+    std::printf("monitor: %lld packets, %s\n", static_cast<long long>(monitor->packetCount()),
+                qPrintable(monitor->summary()));
+
+    bool ok = sent && monitor->packetCount() == expected.packets
+              && monitor->continuityErrors() == expected.gaps
+              && monitor->lostPackets() == expected.lost
+              && monitor->transportErrors() == 0 && monitor->syncLosses() == 0;
+
+    monitor->detach();
+    delete monitor;
+    avformat_free_context(formatContext);
+    avformat_network_deinit();
+
+    std::printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
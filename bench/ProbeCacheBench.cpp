@@ -0,0 +1,121 @@
+#include "ProbeCache.h"
+#include "HttpValidator.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <cstdio>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+// 探测缓存的冷/热打开对比：与 NetworkStreamLoader::findStreamInfo 相同的流程，
+// 冷打开前清空缓存目录，热打开使用冷打开保存的结果
+
+namespace {
+
+struct OpenResult
+{
+    bool ok = false;
+    bool warm = false;
+    qint64 elapsedUs = 0;
+    qint64 bytesRead = 0;
+};
+
+OpenResult openOnce(const QString &url, ProbeCache *cache)
+{
+    OpenResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    AVFormatContext *formatContext = nullptr;
+    if (avformat_open_input(&formatContext, url.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return result;
+    }
+
+    // 计算键（网络点播已有条目时包括取ETag的HEAD请求）也计入打开耗时
+    HttpValidator validator(url, nullptr, nullptr);
+    QString key = cache->keyFor(url, formatContext, &validator);
+    result.warm = cache->apply(key, formatContext);
+    if (result.warm) {
+        formatContext->probesize = ProbeCache::kWarmProbeSize;
+        formatContext->max_analyze_duration = ProbeCache::kWarmAnalyzeDurationUs;
+        formatContext->skip_estimate_duration_from_pts = 1;
+    }
+
+    if (avformat_find_stream_info(formatContext, nullptr) >= 0) {
+        if (result.warm) {
+            cache->restoreTimings(key, formatContext);
+        } else {
+            cache->store(key, formatContext);
+        }
+        result.ok = true;
+    }
+
+    result.elapsedUs = timer.nsecsElapsed() / 1000;
+    result.bytesRead = formatContext->pb ? formatContext->pb->bytes_read : 0;
+    avformat_close_input(&formatContext);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 使用独立的缓存目录，不影响播放器的缓存
+    QCoreApplication::setApplicationName("probe_cache_bench");
+    QCoreApplication app(argc, argv);
+    QStringList inputs = app.arguments().mid(1);
+    if (inputs.isEmpty()) {
+        std::printf("usage: probe_cache_bench <file or http url>...\n");
+        return 1;
+    }
+
+    avformat_network_init();
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/probe";
+    const int rounds = 5;
+
+    for (const QString &input : inputs) {
+        ProbeCache cache;
+        qint64 coldUs = 0, warmUs = 0, coldBytes = 0, warmBytes = 0;
+        int warmHits = 0;
+        bool ok = true;
+
+        for (int round = 0; round < rounds && ok; ++round) {
+            QDir(cacheDir).removeRecursively();
+            OpenResult cold = openOnce(input, &cache);
+            // 网络点播首次打开只保存未校验的条目，再打开一次取得版本标识后才可命中
+            if (input.contains("://")) {
+                openOnce(input, &cache);
+            }
+            OpenResult warm = openOnce(input, &cache);
+            ok = cold.ok && warm.ok;
+            coldUs += cold.elapsedUs;
+            coldBytes += cold.bytesRead;
+            warmUs += warm.elapsedUs;
+            warmBytes += warm.bytesRead;
+            warmHits += warm.warm ? 1 : 0;
+        }
+
+        QString name = input.contains("://") ? input : QFileInfo(input).fileName();
+        if (!ok) {
+            std::printf("%s: cannot open\n", qPrintable(name));
+            continue;
+        }
+        if (warmHits == 0) {
+            std::printf("%s: not cacheable (live stream or no ETag/Last-Modified)\n", qPrintable(name));
+            continue;
+        }
+        std::printf("%s: cold %.1f ms / %lld KB read, warm %.1f ms / %lld KB read (%d/%d hits)\n",
+                    qPrintable(name),
+                    coldUs / 1000.0 / rounds, coldBytes / 1024 / rounds,
+                    warmUs / 1000.0 / rounds, warmBytes / 1024 / rounds,
+                    warmHits, rounds);
+    }
+
+    QDir(cacheDir).removeRecursively();
+    avformat_network_deinit();
+    return 0;
+}